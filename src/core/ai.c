@@ -0,0 +1,270 @@
+#include "ai.h"
+#include "linmath.h"
+#include "math_helper.h"
+#include "physics.h"
+#include "timer.h"
+#include <assert.h>
+#include <string.h>
+
+// How far the observed puck may drift from the prediction before we throw
+// the prediction away and start over.
+static const float prediction_tolerance = 0.0001f;
+
+// Reading the clock costs more than a simulation step or a candidate
+// evaluation, so the budget is only checked every so often.
+#define STEPS_BETWEEN_CLOCK_CHECKS 16
+
+static int prediction_matches(const AiController* ai, vec3 puck_position, vec3 puck_vector);
+static void restart_prediction(AiController* ai, vec3 puck_position, vec3 puck_vector);
+static void compact_prediction(AiController* ai);
+static void extend_prediction(AiController* ai, long long deadline);
+static void search_for_intercept(AiController* ai, vec3 mallet_position, long long deadline);
+static float score_intercept(const AiController* ai, int frame, vec3 mallet_position, vec3 strike_point);
+static void get_approach_point(const AiController* ai, vec3 mallet_position, vec3 approach_point);
+static void clamp_to_mallet_area(const AiController* ai, vec3 point);
+static void move_mallet_towards(const AiController* ai, vec3 mallet_position, vec3 target);
+static void advance_predicted_puck(const AiController* ai, vec3 position, vec3 vector);
+
+void init_ai_controller(AiController* ai, TableBounds bounds,
+	float puck_radius, float mallet_radius, float max_mallet_speed, long long budget_us) {
+	assert(ai != NULL);
+	assert(max_mallet_speed > 0.0f);
+
+	memset(ai, 0, sizeof(*ai));
+	ai->bounds = bounds;
+	ai->puck_radius = puck_radius;
+	ai->mallet_radius = mallet_radius;
+	ai->max_mallet_speed = max_mallet_speed;
+	ai->budget_us = budget_us;
+	ai->best_frame = -1;
+}
+
+void set_ai_controller_table(AiController* ai, const TableSdf* table) {
+	assert(ai != NULL);
+	ai->table = table;
+	ai->prediction_count = 0;
+}
+
+void update_ai_controller(AiController* ai, vec3 puck_position, vec3 puck_vector, vec3 mallet_position) {
+	assert(ai != NULL);
+	const long long deadline = get_time_in_microseconds() + ai->budget_us;
+
+	// If the puck went where we said it would, the rest of the prediction
+	// and the search over it are still good; just advance by one frame.
+	// Otherwise (the puck was struck, or this is the first update) start over.
+	if (prediction_matches(ai, puck_position, puck_vector)) {
+		ai->prediction_start++;
+		if (ai->prediction_start >= AI_MAX_PREDICTED_FRAMES / 2)
+			compact_prediction(ai);
+	} else {
+		restart_prediction(ai, puck_position, puck_vector);
+	}
+
+	extend_prediction(ai, deadline);
+	search_for_intercept(ai, mallet_position, deadline);
+
+	vec3 approach_point;
+	if (ai->best_frame >= 0) {
+		get_approach_point(ai, mallet_position, approach_point);
+	} else {
+		// Nothing we can reach in time: fall back between the puck and our goal.
+		ai->target[0] = puck_position[0] * 0.5f;
+		ai->target[1] = mallet_position[1];
+		ai->target[2] = ai->bounds.far + ai->mallet_radius * 2.0f;
+		clamp_to_mallet_area(ai, ai->target);
+		memcpy(approach_point, ai->target, sizeof(vec3));
+	}
+
+	move_mallet_towards(ai, mallet_position, approach_point);
+}
+
+static int prediction_matches(const AiController* ai, vec3 puck_position, vec3 puck_vector) {
+	if (ai->prediction_start >= ai->prediction_count)
+		return 0;
+
+	const float* expected_position = ai->predicted_positions[ai->prediction_start];
+	const float* expected_vector = ai->predicted_vectors[ai->prediction_start];
+	int i;
+	for (i = 0; i < 3; i++) {
+		if (fabsf(expected_position[i] - puck_position[i]) > prediction_tolerance
+		 || fabsf(expected_vector[i] - puck_vector[i]) > prediction_tolerance)
+			return 0;
+	}
+
+	return 1;
+}
+
+static void restart_prediction(AiController* ai, vec3 puck_position, vec3 puck_vector) {
+	// The first entry is always computed so that extend_prediction() has a
+	// state to continue from.
+	memcpy(ai->predicted_positions[0], puck_position, sizeof(vec3));
+	memcpy(ai->predicted_vectors[0], puck_vector, sizeof(vec3));
+	advance_predicted_puck(ai, ai->predicted_positions[0], ai->predicted_vectors[0]);
+
+	ai->prediction_start = 0;
+	ai->prediction_count = 1;
+	ai->search_cursor = 0;
+	ai->best_frame = -1;
+}
+
+static void compact_prediction(AiController* ai) {
+	const int shift = ai->prediction_start;
+	const int remaining = ai->prediction_count - shift;
+
+	memmove(ai->predicted_positions, ai->predicted_positions[shift], remaining * sizeof(vec3));
+	memmove(ai->predicted_vectors, ai->predicted_vectors[shift], remaining * sizeof(vec3));
+
+	ai->prediction_start = 0;
+	ai->prediction_count = remaining;
+	ai->search_cursor = ai->search_cursor > shift ? ai->search_cursor - shift : 0;
+	ai->best_frame = ai->best_frame >= shift ? ai->best_frame - shift : -1;
+}
+
+static void extend_prediction(AiController* ai, long long deadline) {
+	int steps = 0;
+
+	while (ai->prediction_count < AI_MAX_PREDICTED_FRAMES) {
+		const int previous = ai->prediction_count - 1;
+		float* position = ai->predicted_positions[ai->prediction_count];
+		float* vector = ai->predicted_vectors[ai->prediction_count];
+
+		memcpy(position, ai->predicted_positions[previous], sizeof(vec3));
+		memcpy(vector, ai->predicted_vectors[previous], sizeof(vec3));
+		advance_predicted_puck(ai, position, vector);
+		ai->prediction_count++;
+
+		if (++steps % STEPS_BETWEEN_CLOCK_CHECKS == 0 && get_time_in_microseconds() >= deadline)
+			return;
+	}
+}
+
+static void search_for_intercept(AiController* ai, vec3 mallet_position, long long deadline) {
+	const int first = ai->prediction_start;
+	const int count = ai->prediction_count - first;
+	float best_score = -1.0f;
+	vec3 strike_point;
+
+	// The mallet has moved since the last search, so the previous plan has
+	// to be re-scored before anything can be compared against it.
+	if (ai->best_frame >= first) {
+		best_score = score_intercept(ai, ai->best_frame, mallet_position, strike_point);
+		if (best_score > 0.0f)
+			memcpy(ai->target, strike_point, sizeof(vec3));
+		else
+			ai->best_frame = -1;
+	} else {
+		ai->best_frame = -1;
+	}
+
+	if (ai->search_cursor < first || ai->search_cursor >= ai->prediction_count)
+		ai->search_cursor = first;
+
+	// Visit every candidate frame at most once per update, resuming where
+	// the previous update ran out of time.
+	int evaluated;
+	for (evaluated = 0; evaluated < count; evaluated++) {
+		const int frame = ai->search_cursor;
+		const float score = score_intercept(ai, frame, mallet_position, strike_point);
+
+		if (score > best_score) {
+			best_score = score;
+			ai->best_frame = frame;
+			memcpy(ai->target, strike_point, sizeof(vec3));
+		}
+
+		if (++ai->search_cursor >= ai->prediction_count)
+			ai->search_cursor = first;
+
+		if ((evaluated + 1) % STEPS_BETWEEN_CLOCK_CHECKS == 0 && get_time_in_microseconds() >= deadline)
+			return;
+	}
+}
+
+/* Returns a positive score if the mallet can get behind the puck at the given
+   predicted frame in time to strike it towards the opponent's goal, and
+   writes the point the mallet should head for. Earlier intercepts score
+   higher, as they leave the puck less time to get past us. */
+static float score_intercept(const AiController* ai, int frame, vec3 mallet_position, vec3 strike_point) {
+	const float* puck = ai->predicted_positions[frame];
+
+	// Line up behind the puck, aiming for the centre of the opponent's goal.
+	vec3 aim = {-puck[0], 0.0f, ai->bounds.near - puck[2]};
+	vec3_scale(aim, aim, 1.0f / vec3_len(aim));
+
+	// Aim half-way into the puck so that the mallet is still moving at impact.
+	const float overlap = (ai->puck_radius + ai->mallet_radius) * 0.5f;
+	strike_point[0] = puck[0] - aim[0] * overlap;
+	strike_point[1] = mallet_position[1];
+	strike_point[2] = puck[2] - aim[2] * overlap;
+
+	// If the mallet can't get behind the puck because it's on the other half
+	// of the table or pinned against a side, the puck is out of reach.
+	vec3 ideal_strike_point = {strike_point[0], strike_point[1], strike_point[2]};
+	clamp_to_mallet_area(ai, strike_point);
+	vec3 clamping_error;
+	vec3_sub(clamping_error, strike_point, ideal_strike_point);
+	if (vec3_len(clamping_error) > overlap * 0.5f)
+		return -1.0f;
+
+	vec3 mallet_to_strike_point;
+	vec3_sub(mallet_to_strike_point, strike_point, mallet_position);
+	const float frames_needed = vec3_len(mallet_to_strike_point) / ai->max_mallet_speed;
+	const int frames_ahead = frame - ai->prediction_start + 1;
+
+	if (frames_needed > (float) frames_ahead)
+		return -1.0f;
+
+	return (float) (AI_MAX_PREDICTED_FRAMES - frames_ahead + 1);
+}
+
+/* A mallet that reaches the strike point early and waits there would stop
+   the puck dead, so hold back along the line of the shot until there's just
+   enough time left to arrive at full speed. */
+static void get_approach_point(const AiController* ai, vec3 mallet_position, vec3 approach_point) {
+	const float* puck = ai->predicted_positions[ai->best_frame];
+	const int frames_ahead = ai->best_frame - ai->prediction_start + 1;
+
+	vec3 target = {ai->target[0], ai->target[1], ai->target[2]};
+	vec3 mallet_to_target;
+	vec3_sub(mallet_to_target, target, mallet_position);
+	const float spare_distance = frames_ahead * ai->max_mallet_speed - vec3_len(mallet_to_target);
+
+	memcpy(approach_point, ai->target, sizeof(vec3));
+	if (spare_distance <= ai->max_mallet_speed)
+		return;
+
+	vec3 line_of_shot = {puck[0] - ai->target[0], 0.0f, puck[2] - ai->target[2]};
+	const float line_of_shot_length = vec3_len(line_of_shot);
+	if (line_of_shot_length <= 0.0f)
+		return;
+
+	const float hold_back = fminf(spare_distance * 0.5f, ai->mallet_radius * 2.0f) / line_of_shot_length;
+	approach_point[0] -= line_of_shot[0] * hold_back;
+	approach_point[2] -= line_of_shot[2] * hold_back;
+	clamp_to_mallet_area(ai, approach_point);
+}
+
+static void clamp_to_mallet_area(const AiController* ai, vec3 point) {
+	point[0] = clamp(point[0], ai->bounds.left + ai->mallet_radius, ai->bounds.right - ai->mallet_radius);
+	point[2] = clamp(point[2], ai->bounds.far + ai->mallet_radius, 0.0f - ai->mallet_radius);
+}
+
+static void move_mallet_towards(const AiController* ai, vec3 mallet_position, vec3 target) {
+	vec3 to_target;
+	vec3_sub(to_target, target, mallet_position);
+	to_target[1] = 0.0f;
+
+	const float distance = vec3_len(to_target);
+	if (distance > ai->max_mallet_speed)
+		vec3_scale(to_target, to_target, ai->max_mallet_speed / distance);
+
+	vec3_add(mallet_position, mallet_position, to_target);
+	clamp_to_mallet_area(ai, mallet_position);
+}
+
+static void advance_predicted_puck(const AiController* ai, vec3 position, vec3 vector) {
+	if (ai->table != NULL)
+		advance_puck_on_table(position, vector, ai->table, ai->puck_radius);
+	else
+		advance_puck(position, vector, &ai->bounds, ai->puck_radius);
+}
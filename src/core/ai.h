@@ -0,0 +1,45 @@
+#pragma once
+#include "linmath.h"
+#include "physics.h"
+
+#define AI_MAX_PREDICTED_FRAMES 240
+
+/* An opponent that drives a mallet on the far half of the table. Each update
+   is an anytime search bounded by budget_us: the predicted puck path and the
+   search over it are carried over from frame to frame, so an update picks up
+   where the previous one stopped and returns the best plan found so far once
+   the budget runs out. Controllers share no state, so any number of them can
+   run side by side. */
+typedef struct {
+	TableBounds bounds;
+	// If set, the puck's path is predicted on this table rather than the bounds.
+	const TableSdf* table;
+	float puck_radius;
+	float mallet_radius;
+	float max_mallet_speed;
+	long long budget_us;
+
+	// Predicted puck path. Entry i is the puck state i + 1 frames after the
+	// state the prediction was started from; entries before prediction_start
+	// have already happened.
+	vec3 predicted_positions[AI_MAX_PREDICTED_FRAMES];
+	vec3 predicted_vectors[AI_MAX_PREDICTED_FRAMES];
+	int prediction_start;
+	int prediction_count;
+
+	// Search state over the predicted path.
+	int search_cursor;
+	int best_frame;
+	vec3 target;
+} AiController;
+
+void init_ai_controller(AiController* ai, TableBounds bounds,
+	float puck_radius, float mallet_radius, float max_mallet_speed, long long budget_us);
+/* Has the controller predict bounces off a table of any shape, which should
+   be the one the game is played on. The bounds still limit where it plans to
+   move the mallet. */
+void set_ai_controller_table(AiController* ai, const TableSdf* table);
+
+/* Plans against the current puck state and moves mallet_position by at most
+   one frame's worth of travel. */
+void update_ai_controller(AiController* ai, vec3 puck_position, vec3 puck_vector, vec3 mallet_position);
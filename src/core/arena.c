@@ -0,0 +1,120 @@
+#include "arena.h"
+#include "platform_log.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGNMENT 16
+
+struct ArenaBlock {
+	ArenaBlock* next;
+	size_t size;
+	size_t offset;
+	// Keeps the data that follows aligned.
+	size_t padding;
+};
+
+static inline size_t align_size(size_t size) {
+	return (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+}
+
+static inline unsigned char* get_block_data(ArenaBlock* block) {
+	return (unsigned char*) (block + 1);
+}
+
+void init_arena(Arena* arena, size_t block_size) {
+	assert(arena != NULL);
+	assert(block_size > 0);
+	*arena = (Arena) {align_size(block_size), NULL, NULL, 0, 0, 0, 0};
+}
+
+static ArenaBlock* add_block(Arena* arena, ArenaBlock* previous, size_t minimum_size) {
+	const size_t size = minimum_size > arena->block_size ? minimum_size : arena->block_size;
+	ArenaBlock* block = malloc(sizeof(ArenaBlock) + size);
+	if (block == NULL) {
+		CRASH("Out of memory!");
+	}
+
+	*block = (ArenaBlock) {previous != NULL ? previous->next : NULL, size, 0, 0};
+	if (previous != NULL)
+		previous->next = block;
+	else
+		arena->first_block = block;
+
+	arena->bytes_reserved += size;
+	arena->block_count++;
+	return block;
+}
+
+void* allocate_from_arena(Arena* arena, size_t size) {
+	assert(arena != NULL);
+	size = align_size(size ? size : 1);
+
+	ArenaBlock* block = arena->current_block;
+	if (block == NULL) {
+		block = arena->first_block;
+		if (block == NULL)
+			block = add_block(arena, NULL, size);
+	}
+
+	// Move on through the blocks kept from earlier scopes, and only ask the
+	// system for a new one when none of them has room.
+	while (block->offset + size > block->size) {
+		if (block->next != NULL && block->next->size >= size) {
+			block = block->next;
+			block->offset = 0;
+		} else {
+			block = add_block(arena, block, size);
+		}
+	}
+
+	void* allocation = get_block_data(block) + block->offset;
+	block->offset += size;
+	arena->current_block = block;
+
+	arena->bytes_used += size;
+	if (arena->bytes_used > arena->peak_bytes_used)
+		arena->peak_bytes_used = arena->bytes_used;
+
+	return allocation;
+}
+
+ArenaMarker begin_arena_scope(Arena* arena) {
+	assert(arena != NULL);
+	const ArenaMarker marker = {
+		arena->current_block,
+		arena->current_block != NULL ? arena->current_block->offset : 0,
+		arena->bytes_used,
+		arena->peak_bytes_used};
+
+	arena->peak_bytes_used = arena->bytes_used;
+	return marker;
+}
+
+size_t end_arena_scope(Arena* arena, ArenaMarker marker) {
+	assert(arena != NULL);
+	assert(arena->bytes_used >= marker.bytes_used);
+	const size_t scope_peak_bytes_used = arena->peak_bytes_used - marker.bytes_used;
+
+	arena->current_block = marker.block;
+	if (marker.block != NULL)
+		marker.block->offset = marker.block_offset;
+	else if (arena->first_block != NULL)
+		arena->first_block->offset = 0;
+
+	arena->bytes_used = marker.bytes_used;
+	if (marker.enclosing_peak_bytes_used > arena->peak_bytes_used)
+		arena->peak_bytes_used = marker.enclosing_peak_bytes_used;
+
+	return scope_peak_bytes_used;
+}
+
+void release_arena(Arena* arena) {
+	assert(arena != NULL);
+	ArenaBlock* block = arena->first_block;
+	while (block != NULL) {
+		ArenaBlock* next = block->next;
+		free(block);
+		block = next;
+	}
+	init_arena(arena, arena->block_size);
+}
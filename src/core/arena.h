@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+
+/* A linear allocator for memory that only lives while something is loading.
+   Allocations are carved out of large blocks and never freed one by one;
+   instead, everything allocated since a scope began is released together
+   when it ends, and the blocks are kept for the next scope. */
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+	size_t block_size;
+	ArenaBlock* first_block;
+	ArenaBlock* current_block;
+
+	size_t bytes_used;
+	size_t peak_bytes_used;
+	size_t bytes_reserved;
+	int block_count;
+} Arena;
+
+typedef struct {
+	ArenaBlock* block;
+	size_t block_offset;
+	size_t bytes_used;
+	size_t enclosing_peak_bytes_used;
+} ArenaMarker;
+
+void init_arena(Arena* arena, size_t block_size);
+
+/* Returns memory aligned for any type, or aborts if the system is out of memory. */
+void* allocate_from_arena(Arena* arena, size_t size);
+
+/* Scopes can nest; each end releases what was allocated since its begin. */
+ArenaMarker begin_arena_scope(Arena* arena);
+/* Returns the most memory that was in use at once inside the scope. */
+size_t end_arena_scope(Arena* arena, ArenaMarker marker);
+
+/* Gives every block back to the system. */
+void release_arena(Arena* arena);
@@ -1,37 +1,93 @@
 #include "asset_utils.h"
+#include "gl_resources.h"
 #include "image.h"
+#include "ktx.h"
 #include "platform_asset_utils.h"
+#include "platform_log.h"
 #include "shader.h"
+#include "telemetry.h"
 #include "texture.h"
+#include "timer.h"
 #include <assert.h>
 #include <stdlib.h>
 
-GLuint load_png_asset_into_texture(const char* relative_path) {
+#define TAG "assets"
+
+GLuint load_image_asset_into_texture(const char* relative_path, Arena* arena) {
 	assert(relative_path != NULL);
+	assert(arena != NULL);
 
-	const FileData png_file = get_asset_data(relative_path);
-	const RawImageData raw_image_data = get_raw_image_data_from_png(png_file.data, png_file.data_length);
+	const long long start_us = get_time_in_microseconds();
+	const ArenaMarker marker = begin_arena_scope(arena);
+	const FileData image_file = get_asset_data(relative_path, arena);
+	const RawImageData raw_image_data = get_raw_image_data(image_file.data, image_file.data_length, arena);
 	const GLuint texture_object_id = load_texture(
 		raw_image_data.width, raw_image_data.height, raw_image_data.gl_color_format, raw_image_data.data);
+	label_gl_resource(GL_RESOURCE_TEXTURE, texture_object_id, relative_path);
+
+	record_asset_load_telemetry((size_t) image_file.data_length, get_time_in_microseconds() - start_us);
+	release_asset_data(&image_file);
+	end_arena_scope(arena, marker);
+
+	return texture_object_id;
+}
+
+GLuint load_ktx_asset_into_texture(const char* ktx_path, const char* fallback_image_path, Arena* arena) {
+	assert(ktx_path != NULL);
+	assert(fallback_image_path != NULL);
+	assert(arena != NULL);
+
+	const long long start_us = get_time_in_microseconds();
+	const ArenaMarker marker = begin_arena_scope(arena);
+	const FileData ktx_file = get_asset_data(ktx_path, arena);
+	KtxImage image;
+	GLuint texture_object_id = 0;
+
+	if (!parse_ktx_image(ktx_file.data, ktx_file.data_length, &image)) {
+		DEBUG_LOG_PRINT_W(TAG, "%s isn't a compressed KTX texture", ktx_path);
+	} else if (!is_compressed_texture_format_supported(image.internal_format, arena)) {
+		DEBUG_LOG_PRINT_D(TAG, "Compressed format 0x%x isn't supported; using %s", image.internal_format, fallback_image_path);
+	} else {
+		texture_object_id = load_compressed_texture(image.internal_format, image.level_count, image.levels);
+		label_gl_resource(GL_RESOURCE_TEXTURE, texture_object_id, ktx_path);
+
+		// As RGBA, the mipmaps would add another third to the base level.
+		size_t compressed_size = 0;
+		int level;
+		for (level = 0; level < image.level_count; level++)
+			compressed_size += image.levels[level].size;
+		DEBUG_LOG_PRINT_D(TAG, "Loaded %s as format 0x%x: %zu bytes, against %zu as RGBA",
+			ktx_path, image.internal_format, compressed_size, (size_t) image.width * image.height * 4 * 4 / 3);
+	}
 
-	release_raw_image_data(&raw_image_data);
-	release_asset_data(&png_file);
+	record_asset_load_telemetry((size_t) ktx_file.data_length, get_time_in_microseconds() - start_us);
+	release_asset_data(&ktx_file);
+	end_arena_scope(arena, marker);
 
+	if (texture_object_id == 0)
+		texture_object_id = load_image_asset_into_texture(fallback_image_path, arena);
 	return texture_object_id;
 }
 
-GLuint build_program_from_assets(const char* vertex_shader_path, const char* fragment_shader_path) {
+GLuint build_program_from_assets(const char* vertex_shader_path, const char* fragment_shader_path, Arena* arena) {
 	assert(vertex_shader_path != NULL);
 	assert(fragment_shader_path != NULL);
+	assert(arena != NULL);
 
-	const FileData vertex_shader_source = get_asset_data(vertex_shader_path);
-	const FileData fragment_shader_source = get_asset_data(fragment_shader_path);
+	const long long start_us = get_time_in_microseconds();
+	const ArenaMarker marker = begin_arena_scope(arena);
+	const FileData vertex_shader_source = get_asset_data(vertex_shader_path, arena);
+	const FileData fragment_shader_source = get_asset_data(fragment_shader_path, arena);
 	const GLuint program_object_id = build_program(
 		vertex_shader_source.data, vertex_shader_source.data_length,
-		fragment_shader_source.data, fragment_shader_source.data_length);
+		fragment_shader_source.data, fragment_shader_source.data_length, arena);
+	label_gl_resource(GL_RESOURCE_PROGRAM, program_object_id, vertex_shader_path);
 
+	record_asset_load_telemetry((size_t) (vertex_shader_source.data_length + fragment_shader_source.data_length),
+		get_time_in_microseconds() - start_us);
 	release_asset_data(&vertex_shader_source);
 	release_asset_data(&fragment_shader_source);
+	end_arena_scope(arena, marker);
 
 	return program_object_id;
 }
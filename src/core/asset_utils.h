@@ -1,4 +1,10 @@
+#include "arena.h"
 #include "platform_gl.h"
 
-GLuint load_png_asset_into_texture(const char* relative_path);
-GLuint build_program_from_assets(const char* vertex_shader_path, const char* fragment_shader_path);
+/* Decodes a PNG or QOI image, going by its magic. Everything needed while
+   loading is allocated from the arena, and released before returning. */
+GLuint load_image_asset_into_texture(const char* relative_path, Arena* arena);
+/* Uploads the KTX file's compressed levels if the context supports its
+   format, or decodes the fallback image into a texture if not. */
+GLuint load_ktx_asset_into_texture(const char* ktx_path, const char* fallback_image_path, Arena* arena);
+GLuint build_program_from_assets(const char* vertex_shader_path, const char* fragment_shader_path, Arena* arena);
@@ -1,4 +1,5 @@
 #include "buffer.h"
+#include "gl_resources.h"
 #include "platform_gl.h"
 #include <assert.h>
 #include <stdlib.h>
@@ -12,6 +13,12 @@ GLuint create_vbo(const GLsizeiptr size, const GLvoid* data, const GLenum usage)
 	glBindBuffer(GL_ARRAY_BUFFER, vbo_object);
 	glBufferData(GL_ARRAY_BUFFER, size, data, usage);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	track_gl_resource(GL_RESOURCE_BUFFER, vbo_object, size);
 
 	return vbo_object;
 }
+
+void delete_vbo(const GLuint vbo) {
+	if (untrack_gl_resource(GL_RESOURCE_BUFFER, vbo))
+		glDeleteBuffers(1, &vbo);
+}
@@ -3,3 +3,5 @@
 #define BUFFER_OFFSET(i) ((void*)(i))
 
 GLuint create_vbo(const GLsizeiptr size, const GLvoid* data, const GLenum usage);
+/* Only deletes buffers that gl_resources is tracking. */
+void delete_vbo(const GLuint vbo);
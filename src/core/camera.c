@@ -0,0 +1,84 @@
+#include "camera.h"
+#include "geometry.h"
+#include "linmath.h"
+#include "math_helper.h"
+#include <assert.h>
+#include <string.h>
+
+static void divide_by_w(vec4 vector);
+
+void init_camera(Camera* camera, float aspect_ratio, int from_far_end) {
+	assert(camera != NULL);
+	const float eye_z = from_far_end ? -2.2f : 2.2f;
+
+	mat4x4_perspective(camera->projection_matrix, deg_to_radf(45), aspect_ratio, 1.0f, 10.0f);
+	mat4x4_look_at(camera->view_matrix, (vec3){0.0f, 1.2f, eye_z}, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f});
+	mat4x4_mul(camera->view_projection_matrix, camera->projection_matrix, camera->view_matrix);
+	mat4x4_invert(camera->inverted_view_projection_matrix, camera->view_projection_matrix);
+}
+
+Ray convert_normalized_2D_point_to_ray(const Camera* camera, float normalized_x, float normalized_y) {
+	assert(camera != NULL);
+
+	// We'll convert these normalized device coordinates into world-space
+	// coordinates. We'll pick a point on the near and far planes, and draw a
+	// line between them. To do this transform, we need to first multiply by
+	// the inverse matrix, and then we need to undo the perspective divide.
+	vec4 near_point_ndc = {normalized_x, normalized_y, -1, 1};
+	vec4 far_point_ndc = {normalized_x, normalized_y,  1, 1};
+
+	mat4x4 inverted_view_projection_matrix;
+	memcpy(inverted_view_projection_matrix, camera->inverted_view_projection_matrix, sizeof(mat4x4));
+
+	vec4 near_point_world, far_point_world;
+	mat4x4_mul_vec4(near_point_world, inverted_view_projection_matrix, near_point_ndc);
+	mat4x4_mul_vec4(far_point_world, inverted_view_projection_matrix, far_point_ndc);
+
+	// Why are we dividing by W? We multiplied our vector by an inverse
+	// matrix, so the W value that we end up is actually the *inverse* of
+	// what the projection matrix would create. By dividing all 3 components
+	// by W, we effectively undo the hardware perspective divide.
+	divide_by_w(near_point_world);
+	divide_by_w(far_point_world);
+
+	// We don't care about the W value anymore, because our points are now
+	// in world coordinates.
+	vec3 near_point_ray = {near_point_world[0], near_point_world[1], near_point_world[2]};
+	vec3 far_point_ray = {far_point_world[0], far_point_world[1], far_point_world[2]};
+	vec3 vector_between;
+	vec3_sub(vector_between, far_point_ray, near_point_ray);
+	return (Ray) {
+		{near_point_ray[0], near_point_ray[1], near_point_ray[2]},
+		{vector_between[0], vector_between[1], vector_between[2]}};
+}
+
+static void divide_by_w(vec4 vector) {
+	vector[0] /= vector[3];
+	vector[1] /= vector[3];
+	vector[2] /= vector[3];
+}
+
+int is_mallet_touched(const Camera* camera, vec3 mallet_position, float mallet_height,
+	float normalized_x, float normalized_y) {
+	Ray ray = convert_normalized_2D_point_to_ray(camera, normalized_x, normalized_y);
+
+	// Now test if this ray intersects with the mallet by creating a
+	// bounding sphere that wraps the mallet.
+	Sphere mallet_bounding_sphere = (Sphere) {
+	   {mallet_position[0],
+		mallet_position[1],
+		mallet_position[2]},
+	mallet_height / 2.0f};
+
+	return sphere_intersects_ray(mallet_bounding_sphere, ray);
+}
+
+void get_touched_point_on_table(const Camera* camera, float normalized_x, float normalized_y, vec3 touched_point) {
+	Ray ray = convert_normalized_2D_point_to_ray(camera, normalized_x, normalized_y);
+	// Define a plane representing our air hockey table.
+	Plane plane = (Plane) {{0, 0, 0}, {0, 1, 0}};
+
+	// Find out where the touched point intersects the plane
+	// representing our table.
+	ray_intersection_point(touched_point, ray, plane);
+}
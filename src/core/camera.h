@@ -0,0 +1,23 @@
+#pragma once
+#include "geometry.h"
+#include "linmath.h"
+
+typedef struct {
+	mat4x4 projection_matrix;
+	mat4x4 view_matrix;
+	mat4x4 view_projection_matrix;
+	mat4x4 inverted_view_projection_matrix;
+} Camera;
+
+/* Sets up the camera looking down the table from the blue player's end, or
+   from the red player's end if from_far_end is set. */
+void init_camera(Camera* camera, float aspect_ratio, int from_far_end);
+
+Ray convert_normalized_2D_point_to_ray(const Camera* camera, float normalized_x, float normalized_y);
+
+/* Returns non-zero if the touched point hits the mallet. */
+int is_mallet_touched(const Camera* camera, vec3 mallet_position, float mallet_height,
+	float normalized_x, float normalized_y);
+
+/* Finds where the touched point lands on the surface of the table. */
+void get_touched_point_on_table(const Camera* camera, float normalized_x, float normalized_y, vec3 touched_point);
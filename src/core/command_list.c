@@ -0,0 +1,70 @@
+#include "command_list.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+void init_command_list(CommandList* list, int max_objects, int max_vertex_floats) {
+	assert(list != NULL);
+	assert(max_objects > 0 && max_vertex_floats >= 0);
+	memset(list, 0, sizeof(CommandList));
+
+	list->uniforms = calloc(max_objects, sizeof(ObjectUniforms));
+	list->packets = calloc(max_objects, sizeof(DrawPacket));
+	list->vertices = malloc((max_vertex_floats > 0 ? max_vertex_floats : 1) * sizeof(float));
+	assert(list->uniforms != NULL && list->packets != NULL && list->vertices != NULL);
+	list->max_uniforms = max_objects;
+	list->max_packets = max_objects;
+	list->max_vertex_floats = max_vertex_floats;
+}
+
+void free_command_list(CommandList* list) {
+	assert(list != NULL);
+	free(list->uniforms);
+	free(list->packets);
+	free(list->vertices);
+	memset(list, 0, sizeof(CommandList));
+}
+
+void reset_command_list(CommandList* list) {
+	assert(list != NULL);
+	list->input_time_us = 0;
+	list->predicted_at_us = 0;
+	list->has_changes = 0;
+	list->uniforms_count = 0;
+	list->packet_count = 0;
+	list->vertex_float_count = 0;
+}
+
+int record_uniforms(CommandList* list, mat4x4 mvp_matrix, const GLfloat* color) {
+	assert(list != NULL);
+	if (list->uniforms_count == list->max_uniforms)
+		return -1;
+
+	ObjectUniforms* object = &list->uniforms[list->uniforms_count];
+	memcpy(object->mvp_matrix, mvp_matrix, sizeof(object->mvp_matrix));
+	if (color != NULL)
+		memcpy(object->color, color, sizeof(object->color));
+	else
+		memset(object->color, 0, sizeof(object->color));
+	return list->uniforms_count++;
+}
+
+float* reserve_vertices(CommandList* list, int max_floats) {
+	assert(list != NULL);
+	assert(max_floats >= 0);
+	if (list->vertex_float_count + max_floats > list->max_vertex_floats)
+		return NULL;
+	return list->vertices + list->vertex_float_count;
+}
+
+void record_draw(CommandList* list, int mesh, int uniforms_index, int vertex_count, int vertex_floats) {
+	assert(list != NULL);
+	assert(uniforms_index >= 0 && uniforms_index < list->uniforms_count);
+	assert(list->vertex_float_count + vertex_floats <= list->max_vertex_floats);
+	if (list->packet_count == list->max_packets)
+		return;
+
+	list->packets[list->packet_count++] = (DrawPacket) {
+		(uint16_t) mesh, (int16_t) uniforms_index, list->vertex_float_count, vertex_count};
+	list->vertex_float_count += vertex_floats;
+}
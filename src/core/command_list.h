@@ -0,0 +1,56 @@
+#pragma once
+#include "frame_uniforms.h"
+#include "linmath.h"
+#include <stdint.h>
+
+/* Everything needed to draw a frame, recorded without touching GL so that it
+   can be done on another thread: every object's uniforms, a packet per draw,
+   and the vertices of anything that's streamed rather than kept in a buffer.
+   What a packet's mesh means is up to whoever replays the list. */
+
+typedef struct {
+	uint16_t mesh;
+	int16_t uniforms_index;
+	// Where the draw's streamed vertices start in the list, and how many
+	// there are. Both are zero for meshes that have their own buffer.
+	int32_t first_vertex_float;
+	int32_t vertex_count;
+} DrawPacket;
+
+typedef struct {
+	// When the oldest touch that this frame applied came in, or zero.
+	long long input_time_us;
+	// When the blue mallet was placed by a dragging finger, or zero.
+	long long predicted_at_us;
+	// Non-zero if the frame looks any different from the one recorded before it.
+	int has_changes;
+
+	ObjectUniforms* uniforms;
+	int uniforms_count;
+	int max_uniforms;
+
+	DrawPacket* packets;
+	int packet_count;
+	int max_packets;
+
+	float* vertices;
+	int vertex_float_count;
+	int max_vertex_floats;
+} CommandList;
+
+void init_command_list(CommandList* list, int max_objects, int max_vertex_floats);
+void free_command_list(CommandList* list);
+void reset_command_list(CommandList* list);
+
+/* Returns the object's index in the list, or -1 if the list is full. The
+   color can be NULL for programs without one. */
+int record_uniforms(CommandList* list, mat4x4 mvp_matrix, const GLfloat* color);
+
+/* Returns space for up to max_floats of vertex data, or NULL if there isn't
+   enough left. The space is only kept once a draw is recorded with it. */
+float* reserve_vertices(CommandList* list, int max_floats);
+
+/* Records a draw of the mesh with the uniforms at the given index. For streamed
+   meshes, the vertices are the ones just written to reserve_vertices(), of which
+   vertex_floats were used; otherwise both are zero. */
+void record_draw(CommandList* list, int mesh, int uniforms_index, int vertex_count, int vertex_floats);
@@ -0,0 +1,188 @@
+#include "entities.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+static inline int get_slot(Entity entity) {
+	return (int) (entity & 0xFFFF);
+}
+
+static inline uint16_t get_generation(Entity entity) {
+	return (uint16_t) (entity >> 16);
+}
+
+/* Sparse sets */
+
+int find_component(const SparseSet* set, Entity entity) {
+	assert(set != NULL);
+	if (entity == NO_ENTITY)
+		return -1;
+
+	const int index = set->sparse[get_slot(entity)];
+	return index < set->count && set->dense[index] == entity ? index : -1;
+}
+
+/* Returns the index of the entity, adding it at the end if it's not there yet. */
+static int insert_into_set(SparseSet* set, Entity entity) {
+	const int existing_index = find_component(set, entity);
+	if (existing_index >= 0)
+		return existing_index;
+
+	assert(set->count < MAX_ENTITIES);
+	const int index = set->count++;
+	set->sparse[get_slot(entity)] = (uint16_t) index;
+	set->dense[index] = entity;
+	return index;
+}
+
+/* Moves the last entity into the removed one's place. Returns the index that
+   was removed, with the index it was refilled from in last_index, or -1 if
+   the entity wasn't in the set. */
+static int remove_from_set(SparseSet* set, Entity entity, int* last_index) {
+	const int index = find_component(set, entity);
+	if (index < 0)
+		return -1;
+
+	*last_index = --set->count;
+	const Entity last_entity = set->dense[*last_index];
+	set->dense[index] = last_entity;
+	set->sparse[get_slot(last_entity)] = (uint16_t) index;
+	return index;
+}
+
+/* Entities */
+
+void init_world(World* world) {
+	assert(world != NULL);
+	memset(world, 0, sizeof(World));
+}
+
+Entity create_entity(World* world) {
+	assert(world != NULL);
+
+	int slot;
+	if (world->free_slot_count > 0)
+		slot = world->free_slots[--world->free_slot_count];
+	else if (world->used_slot_count < MAX_ENTITIES)
+		slot = world->used_slot_count++;
+	else
+		return NO_ENTITY;
+
+	return (Entity) world->generations[slot] << 16 | (Entity) slot;
+}
+
+void destroy_entity(World* world, Entity entity) {
+	assert(world != NULL);
+	if (!is_entity_alive(world, entity))
+		return;
+
+	remove_transform(world, entity);
+	remove_velocity(world, entity);
+	remove_collider(world, entity);
+	remove_renderable(world, entity);
+
+	const int slot = get_slot(entity);
+	world->generations[slot]++;
+	world->free_slots[world->free_slot_count++] = (uint16_t) slot;
+}
+
+int is_entity_alive(const World* world, Entity entity) {
+	assert(world != NULL);
+	if (entity == NO_ENTITY || get_slot(entity) >= world->used_slot_count)
+		return 0;
+	return world->generations[get_slot(entity)] == get_generation(entity);
+}
+
+/* Components */
+
+int add_transform(World* world, Entity entity, float x, float y, float z) {
+	assert(is_entity_alive(world, entity));
+	TransformComponents* transforms = &world->transforms;
+	const int index = insert_into_set(&transforms->set, entity);
+	transforms->x[index] = x;
+	transforms->y[index] = y;
+	transforms->z[index] = z;
+	return index;
+}
+
+int add_velocity(World* world, Entity entity, float x, float y, float z) {
+	assert(is_entity_alive(world, entity));
+	VelocityComponents* velocities = &world->velocities;
+	const int index = insert_into_set(&velocities->set, entity);
+	velocities->x[index] = x;
+	velocities->y[index] = y;
+	velocities->z[index] = z;
+	return index;
+}
+
+int add_collider(World* world, Entity entity, float radius, float height) {
+	assert(is_entity_alive(world, entity));
+	ColliderComponents* colliders = &world->colliders;
+	const int index = insert_into_set(&colliders->set, entity);
+	colliders->radius[index] = radius;
+	colliders->height[index] = height;
+	return index;
+}
+
+int add_renderable(World* world, Entity entity, int mesh) {
+	assert(is_entity_alive(world, entity));
+	RenderableComponents* renderables = &world->renderables;
+	const int index = insert_into_set(&renderables->set, entity);
+	renderables->mesh[index] = mesh;
+	return index;
+}
+
+void remove_transform(World* world, Entity entity) {
+	TransformComponents* transforms = &world->transforms;
+	int last_index;
+	const int index = remove_from_set(&transforms->set, entity, &last_index);
+	if (index < 0)
+		return;
+	transforms->x[index] = transforms->x[last_index];
+	transforms->y[index] = transforms->y[last_index];
+	transforms->z[index] = transforms->z[last_index];
+}
+
+void remove_velocity(World* world, Entity entity) {
+	VelocityComponents* velocities = &world->velocities;
+	int last_index;
+	const int index = remove_from_set(&velocities->set, entity, &last_index);
+	if (index < 0)
+		return;
+	velocities->x[index] = velocities->x[last_index];
+	velocities->y[index] = velocities->y[last_index];
+	velocities->z[index] = velocities->z[last_index];
+}
+
+void remove_collider(World* world, Entity entity) {
+	ColliderComponents* colliders = &world->colliders;
+	int last_index;
+	const int index = remove_from_set(&colliders->set, entity, &last_index);
+	if (index < 0)
+		return;
+	colliders->radius[index] = colliders->radius[last_index];
+	colliders->height[index] = colliders->height[last_index];
+}
+
+void remove_renderable(World* world, Entity entity) {
+	RenderableComponents* renderables = &world->renderables;
+	int last_index;
+	const int index = remove_from_set(&renderables->set, entity, &last_index);
+	if (index < 0)
+		return;
+	renderables->mesh[index] = renderables->mesh[last_index];
+}
+
+/* Systems */
+
+int has_moving_entities(const World* world, float threshold) {
+	assert(world != NULL);
+	const VelocityComponents* velocities = &world->velocities;
+	int i;
+
+	for (i = 0; i < velocities->set.count; i++) {
+		if (fabsf(velocities->x[i]) > threshold || fabsf(velocities->z[i]) > threshold)
+			return 1;
+	}
+	return 0;
+}
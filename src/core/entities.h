@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+
+/* Game objects as entities with components. Each kind of component is kept
+   in its own packed arrays, one array per field, so systems walk contiguous
+   memory. A sparse set per component maps entities to their slot in those
+   arrays: adding, removing and looking up are constant time, and removing
+   moves the last slot into the gap so the arrays stay packed. */
+
+#define MAX_ENTITIES 4096
+
+/* The low 16 bits index the entity's slot; the high 16 bits count how many
+   times that slot has been reused, so stale handles can be told apart. */
+typedef uint32_t Entity;
+
+#define NO_ENTITY 0xFFFFFFFFu
+
+typedef struct {
+	// The dense index of each entity slot; only meaningful while the dense
+	// array points back at the same entity.
+	uint16_t sparse[MAX_ENTITIES];
+	Entity dense[MAX_ENTITIES];
+	int count;
+} SparseSet;
+
+typedef struct {
+	SparseSet set;
+	float x[MAX_ENTITIES];
+	float y[MAX_ENTITIES];
+	float z[MAX_ENTITIES];
+} TransformComponents;
+
+/* How far the entity moved in the last frame. */
+typedef struct {
+	SparseSet set;
+	float x[MAX_ENTITIES];
+	float y[MAX_ENTITIES];
+	float z[MAX_ENTITIES];
+} VelocityComponents;
+
+/* An upright cylinder centered on the entity's transform. */
+typedef struct {
+	SparseSet set;
+	float radius[MAX_ENTITIES];
+	float height[MAX_ENTITIES];
+} ColliderComponents;
+
+/* Which mesh draws the entity; the ids are up to the renderer. */
+typedef struct {
+	SparseSet set;
+	int mesh[MAX_ENTITIES];
+} RenderableComponents;
+
+typedef struct {
+	uint16_t generations[MAX_ENTITIES];
+	uint16_t free_slots[MAX_ENTITIES];
+	int free_slot_count;
+	int used_slot_count;
+
+	TransformComponents transforms;
+	VelocityComponents velocities;
+	ColliderComponents colliders;
+	RenderableComponents renderables;
+} World;
+
+void init_world(World* world);
+
+/* Returns NO_ENTITY once MAX_ENTITIES are alive. */
+Entity create_entity(World* world);
+/* Removes the entity's components and frees its slot for reuse. */
+void destroy_entity(World* world, Entity entity);
+int is_entity_alive(const World* world, Entity entity);
+
+/* Returns the entity's index into the component arrays, or -1 if it doesn't have the component. */
+int find_component(const SparseSet* set, Entity entity);
+
+/* Each returns the component's index, overwriting the component if the
+   entity already has one. */
+int add_transform(World* world, Entity entity, float x, float y, float z);
+int add_velocity(World* world, Entity entity, float x, float y, float z);
+int add_collider(World* world, Entity entity, float radius, float height);
+int add_renderable(World* world, Entity entity, int mesh);
+
+void remove_transform(World* world, Entity entity);
+void remove_velocity(World* world, Entity entity);
+void remove_collider(World* world, Entity entity);
+void remove_renderable(World* world, Entity entity);
+
+/* Returns non-zero if any entity's velocity moved it further than the
+   threshold along X or Z in the last frame. */
+int has_moving_entities(const World* world, float threshold);
@@ -0,0 +1,185 @@
+#include "frame_pipeline.h"
+#include "macros.h"
+#include <assert.h>
+#include <stdlib.h>
+#if USE_GAME_THREAD
+#include <pthread.h>
+#endif
+
+// Set on the index in between once a newer list is in it.
+#define FRESH_LIST_FLAG 4
+#define LIST_INDEX_MASK 3
+
+// Waits start by spinning this many times, since the other side is usually
+// close to done, before going to sleep.
+#define SPINS_BEFORE_SLEEPING 200
+
+struct FramePipeline {
+	CommandList lists[COMMAND_LIST_COUNT];
+	RecordFrameFunction record_frame;
+
+	// Only the game thread touches the list it records into, and only the
+	// render thread touches the one it draws. The one in between goes back
+	// and forth through atomic swaps.
+	int recording_list;
+	int drawing_list;
+	int in_between_list;
+
+	// Each side counts up and the other waits for it to get ahead.
+	unsigned long long frames_requested;
+	unsigned long long frames_recorded;
+	// Only the render thread's.
+	unsigned long long frames_acquired;
+
+#if USE_GAME_THREAD
+	// Only there to sleep on when spinning doesn't pay off.
+	pthread_mutex_t mutex;
+	pthread_cond_t changed;
+	int is_stopping;
+	pthread_t game_thread;
+#endif
+};
+
+/* Gives the list that was just recorded to the render thread, and takes back
+   whichever list it isn't using. */
+static void publish_recorded_list(FramePipeline* pipeline) {
+	const int previous = __atomic_exchange_n(
+		&pipeline->in_between_list, pipeline->recording_list | FRESH_LIST_FLAG, __ATOMIC_ACQ_REL);
+	pipeline->recording_list = previous & LIST_INDEX_MASK;
+}
+
+/* Takes the newest recorded list, if there's one the render thread hasn't seen. */
+static void take_recorded_list(FramePipeline* pipeline) {
+	if ((__atomic_load_n(&pipeline->in_between_list, __ATOMIC_ACQUIRE) & FRESH_LIST_FLAG) == 0)
+		return;
+	const int fresh = __atomic_exchange_n(&pipeline->in_between_list, pipeline->drawing_list, __ATOMIC_ACQ_REL);
+	pipeline->drawing_list = fresh & LIST_INDEX_MASK;
+}
+
+static void record_list(FramePipeline* pipeline) {
+	CommandList* list = &pipeline->lists[pipeline->recording_list];
+	reset_command_list(list);
+	pipeline->record_frame(list);
+	publish_recorded_list(pipeline);
+}
+
+#if USE_GAME_THREAD
+/* Waits for the counter to reach the value, spinning first and then sleeping. */
+static void wait_for_count(FramePipeline* pipeline, const unsigned long long* counter, unsigned long long count,
+	const int* is_stopping) {
+	int spins;
+	for (spins = 0; spins < SPINS_BEFORE_SLEEPING; spins++) {
+		if (__atomic_load_n(counter, __ATOMIC_ACQUIRE) >= count)
+			return;
+	}
+
+	pthread_mutex_lock(&pipeline->mutex);
+	while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < count && (is_stopping == NULL || !*is_stopping))
+		pthread_cond_wait(&pipeline->changed, &pipeline->mutex);
+	pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void count_up(FramePipeline* pipeline, unsigned long long* counter) {
+	__atomic_add_fetch(counter, 1, __ATOMIC_RELEASE);
+	// Taking the mutex makes sure a waiter that just found nothing to do is
+	// already asleep, rather than about to sleep, when it's woken.
+	pthread_mutex_lock(&pipeline->mutex);
+	pthread_cond_broadcast(&pipeline->changed);
+	pthread_mutex_unlock(&pipeline->mutex);
+}
+
+static void* run_game_thread(void* argument) {
+	FramePipeline* pipeline = argument;
+	unsigned long long frame = 0;
+
+	for (;;) {
+		wait_for_count(pipeline, &pipeline->frames_requested, frame + 1, &pipeline->is_stopping);
+		if (__atomic_load_n(&pipeline->frames_requested, __ATOMIC_ACQUIRE) <= frame)
+			break;
+
+		record_list(pipeline);
+		frame++;
+		count_up(pipeline, &pipeline->frames_recorded);
+	}
+	return NULL;
+}
+#endif
+
+FramePipeline* create_frame_pipeline(RecordFrameFunction record_frame, int max_objects, int max_vertex_floats) {
+	assert(record_frame != NULL);
+	FramePipeline* pipeline = calloc(1, sizeof(FramePipeline));
+	assert(pipeline != NULL);
+	pipeline->record_frame = record_frame;
+
+	int i;
+	for (i = 0; i < COMMAND_LIST_COUNT; i++)
+		init_command_list(&pipeline->lists[i], max_objects, max_vertex_floats);
+	pipeline->recording_list = 0;
+	pipeline->in_between_list = 1;
+	pipeline->drawing_list = 2;
+
+#if USE_GAME_THREAD
+	pthread_mutex_init(&pipeline->mutex, NULL);
+	pthread_cond_init(&pipeline->changed, NULL);
+	const int result = pthread_create(&pipeline->game_thread, NULL, run_game_thread, pipeline);
+	assert(result == 0);
+	UNUSED(result);
+#endif
+
+	return pipeline;
+}
+
+void destroy_frame_pipeline(FramePipeline* pipeline) {
+	assert(pipeline != NULL);
+#if USE_GAME_THREAD
+	wait_for_recorded_frame(pipeline);
+	pthread_mutex_lock(&pipeline->mutex);
+	pipeline->is_stopping = 1;
+	pthread_cond_broadcast(&pipeline->changed);
+	pthread_mutex_unlock(&pipeline->mutex);
+	pthread_join(pipeline->game_thread, NULL);
+	pthread_cond_destroy(&pipeline->changed);
+	pthread_mutex_destroy(&pipeline->mutex);
+#endif
+
+	int i;
+	for (i = 0; i < COMMAND_LIST_COUNT; i++)
+		free_command_list(&pipeline->lists[i]);
+	free(pipeline);
+}
+
+const CommandList* acquire_recorded_frame(FramePipeline* pipeline) {
+	assert(pipeline != NULL);
+	if (pipeline->frames_requested == pipeline->frames_acquired)
+		record_next_frame(pipeline);
+
+#if USE_GAME_THREAD
+	wait_for_count(pipeline, &pipeline->frames_recorded, pipeline->frames_requested, NULL);
+#endif
+	pipeline->frames_acquired = pipeline->frames_requested;
+
+	take_recorded_list(pipeline);
+	return &pipeline->lists[pipeline->drawing_list];
+}
+
+void record_next_frame(FramePipeline* pipeline) {
+	assert(pipeline != NULL);
+	// Only one frame is recorded at a time.
+	assert(pipeline->frames_requested == pipeline->frames_acquired);
+#if USE_GAME_THREAD
+	count_up(pipeline, &pipeline->frames_requested);
+#else
+	pipeline->frames_requested++;
+	record_list(pipeline);
+	pipeline->frames_recorded++;
+#endif
+}
+
+void wait_for_recorded_frame(FramePipeline* pipeline) {
+	assert(pipeline != NULL);
+#if USE_GAME_THREAD
+	wait_for_count(pipeline, &pipeline->frames_recorded, pipeline->frames_requested, NULL);
+#else
+	UNUSED(pipeline);
+#endif
+}
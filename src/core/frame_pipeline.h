@@ -0,0 +1,45 @@
+#pragma once
+#include "command_list.h"
+
+/* Lets the game record the next frame's command list on a thread of its own
+   while the current one is drawn on the render thread, which is whichever
+   thread the platform calls on_draw_frame() from and has the GL context.
+
+   The lists are triple buffered: the game thread records into one, the
+   render thread draws another, and the one in between is handed over by
+   swapping its index atomically, so neither side ever holds a lock on a list.
+   The render thread asks for each frame, so the game thread stays one frame
+   ahead rather than running free.
+
+   Without threads, as on Emscripten, the frame is recorded right away on the
+   render thread instead. */
+
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+#define USE_GAME_THREAD 0
+#else
+#define USE_GAME_THREAD 1
+#endif
+
+#define COMMAND_LIST_COUNT 3
+
+/* Runs on the game thread to fill in the next frame. The list is empty. */
+typedef void (*RecordFrameFunction)(CommandList* list);
+
+typedef struct FramePipeline FramePipeline;
+
+FramePipeline* create_frame_pipeline(RecordFrameFunction record_frame, int max_objects, int max_vertex_floats);
+void destroy_frame_pipeline(FramePipeline* pipeline);
+
+/* Waits for the frame being recorded and returns its list, which stays the
+   render thread's until the next call. If no frame was being recorded, one is
+   recorded first. */
+const CommandList* acquire_recorded_frame(FramePipeline* pipeline);
+
+/* Starts recording the next frame, which the next acquire_recorded_frame()
+   returns. */
+void record_next_frame(FramePipeline* pipeline);
+
+/* Waits for the frame being recorded, if any, without taking it. Until the
+   next record_next_frame(), the render thread can touch what the game thread
+   records from. */
+void wait_for_recorded_frame(FramePipeline* pipeline);
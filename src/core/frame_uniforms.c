@@ -0,0 +1,142 @@
+#include "frame_uniforms.h"
+#include "gl_features.h"
+#include "gl_resources.h"
+#include "macros.h"
+#include "stream_buffer.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct FrameUniforms {
+	ObjectUniforms* objects;
+	int count;
+	int capacity;
+
+	int uses_uniform_buffers;
+	StreamBuffer* stream_buffer;
+	// Objects are spaced out so that each one starts where a range can be bound.
+	GLsizeiptr stride;
+	GLintptr offset;
+	int is_uploaded;
+};
+
+FrameUniforms* create_frame_uniforms(int max_objects_per_frame) {
+	assert(max_objects_per_frame > 0);
+	FrameUniforms* uniforms = calloc(1, sizeof(FrameUniforms));
+	assert(uniforms != NULL);
+	uniforms->objects = calloc(max_objects_per_frame, sizeof(ObjectUniforms));
+	assert(uniforms->objects != NULL);
+	uniforms->capacity = max_objects_per_frame;
+
+	uniforms->uses_uniform_buffers = get_gl_features()->has_uniform_buffers;
+#if HAVE_GLES3_HEADERS
+	if (!uniforms->uses_uniform_buffers)
+		return uniforms;
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment < 16)
+		alignment = 16;
+	uniforms->stride = ((GLsizeiptr) sizeof(ObjectUniforms) + alignment - 1) & ~(GLsizeiptr) (alignment - 1);
+	uniforms->stream_buffer = create_stream_buffer(uniforms->stride * max_objects_per_frame, alignment);
+	label_gl_resource(GL_RESOURCE_BUFFER, get_stream_buffer_object(uniforms->stream_buffer), "frame uniforms");
+#endif
+
+	return uniforms;
+}
+
+void destroy_frame_uniforms(FrameUniforms* uniforms) {
+	assert(uniforms != NULL);
+	if (uniforms->stream_buffer != NULL)
+		destroy_stream_buffer(uniforms->stream_buffer);
+	free(uniforms->objects);
+	free(uniforms);
+}
+
+void begin_frame_uniforms(FrameUniforms* uniforms) {
+	assert(uniforms != NULL);
+	uniforms->count = 0;
+	uniforms->is_uploaded = 0;
+	if (uniforms->uses_uniform_buffers)
+		begin_stream_buffer_frame(uniforms->stream_buffer);
+}
+
+int add_object_uniforms(FrameUniforms* uniforms, mat4x4 mvp_matrix, const GLfloat* color) {
+	assert(uniforms != NULL);
+	assert(!uniforms->is_uploaded);
+	if (uniforms->count == uniforms->capacity)
+		return -1;
+
+	ObjectUniforms* object = &uniforms->objects[uniforms->count];
+	memcpy(object->mvp_matrix, mvp_matrix, sizeof(object->mvp_matrix));
+	if (color != NULL)
+		memcpy(object->color, color, sizeof(object->color));
+	else
+		memset(object->color, 0, sizeof(object->color));
+	return uniforms->count++;
+}
+
+int add_recorded_object_uniforms(FrameUniforms* uniforms, const ObjectUniforms* objects, int count) {
+	assert(uniforms != NULL);
+	assert(count >= 0 && (objects != NULL || count == 0));
+	assert(!uniforms->is_uploaded);
+	if (uniforms->count + count > uniforms->capacity)
+		return -1;
+
+	memcpy(&uniforms->objects[uniforms->count], objects, count * sizeof(ObjectUniforms));
+	const int first = uniforms->count;
+	uniforms->count += count;
+	return first;
+}
+
+void upload_frame_uniforms(FrameUniforms* uniforms) {
+	assert(uniforms != NULL);
+	uniforms->is_uploaded = 1;
+	// Without uniform buffers, each draw sets its own uniforms.
+	if (!uniforms->uses_uniform_buffers || uniforms->count == 0)
+		return;
+
+	unsigned char* data = map_stream_buffer(uniforms->stream_buffer, uniforms->stride * uniforms->count, &uniforms->offset);
+	assert(data != NULL);
+	int i;
+	for (i = 0; i < uniforms->count; i++)
+		memcpy(data + i * uniforms->stride, &uniforms->objects[i], sizeof(ObjectUniforms));
+	unmap_stream_buffer(uniforms->stream_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void end_frame_uniforms(FrameUniforms* uniforms) {
+	assert(uniforms != NULL);
+	if (uniforms->uses_uniform_buffers)
+		end_stream_buffer_frame(uniforms->stream_buffer);
+}
+
+void apply_object_uniforms(const FrameUniforms* uniforms, int index, GLint mvp_matrix_location, GLint color_location) {
+	assert(uniforms != NULL);
+	assert(index >= 0 && index < uniforms->count);
+	assert(uniforms->is_uploaded);
+#if HAVE_GLES3_HEADERS
+	if (uniforms->uses_uniform_buffers) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORMS_BINDING, get_stream_buffer_object(uniforms->stream_buffer),
+			uniforms->offset + index * uniforms->stride, sizeof(ObjectUniforms));
+		return;
+	}
+#endif
+
+	const ObjectUniforms* object = &uniforms->objects[index];
+	glUniformMatrix4fv(mvp_matrix_location, 1, GL_FALSE, object->mvp_matrix);
+	if (color_location >= 0)
+		glUniform4fv(color_location, 1, object->color);
+}
+
+void bind_object_uniforms_block(GLuint program) {
+#if HAVE_GLES3_HEADERS
+	if (!get_gl_features()->has_uniform_buffers)
+		return;
+	const GLuint block_index = glGetUniformBlockIndex(program, "ObjectUniforms");
+	if (block_index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, block_index, OBJECT_UNIFORMS_BINDING);
+#else
+	UNUSED(program);
+#endif
+}
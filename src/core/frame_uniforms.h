@@ -0,0 +1,46 @@
+#pragma once
+#include "platform_gl.h"
+#include "linmath.h"
+
+/* The matrix and color of every object drawn in a frame. They're added up
+   front, then uploaded together, and each draw only has to point its program
+   at its own.
+
+   Where the context has uniform buffers, they all go into one per frame,
+   streamed like the particles' vertices, and each draw binds its range of
+   the buffer to the programs' ObjectUniforms block. Otherwise, each draw
+   sets them with glUniform*() as before. Which it is is decided when they're
+   created, from get_gl_features(), and the programs have to match. */
+
+// The binding point that every program's ObjectUniforms block uses.
+#define OBJECT_UNIFORMS_BINDING 0
+
+/* Laid out like the ObjectUniforms block under std140. */
+typedef struct {
+	GLfloat mvp_matrix[16];
+	GLfloat color[4];
+} ObjectUniforms;
+
+typedef struct FrameUniforms FrameUniforms;
+
+FrameUniforms* create_frame_uniforms(int max_objects_per_frame);
+void destroy_frame_uniforms(FrameUniforms* uniforms);
+
+void begin_frame_uniforms(FrameUniforms* uniforms);
+/* Returns the object's index for this frame, or -1 if the frame is full. The
+   color can be NULL for programs without one. */
+int add_object_uniforms(FrameUniforms* uniforms, mat4x4 mvp_matrix, const GLfloat* color);
+/* Adds uniforms that were put together elsewhere, such as in a command list,
+   in order. Returns the first one's index, or -1 if they don't all fit. */
+int add_recorded_object_uniforms(FrameUniforms* uniforms, const ObjectUniforms* objects, int count);
+/* Uploads everything added this frame; call it after the last add and before the first draw. */
+void upload_frame_uniforms(FrameUniforms* uniforms);
+void end_frame_uniforms(FrameUniforms* uniforms);
+
+/* Points the current program at the object's uniforms. The locations are only
+   used without uniform buffers. */
+void apply_object_uniforms(const FrameUniforms* uniforms, int index, GLint mvp_matrix_location, GLint color_location);
+
+/* Attaches the program's ObjectUniforms block to OBJECT_UNIFORMS_BINDING, if
+   it has one. */
+void bind_object_uniforms_block(GLuint program);
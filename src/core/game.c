@@ -1,218 +1,755 @@
 #include "game.h"
 #include "game_objects.h"
+#include "ai.h"
+#include "arena.h"
 #include "asset_utils.h"
 #include "buffer.h"
+#include "camera.h"
+#include "command_list.h"
+#include "entities.h"
+#include "frame_pipeline.h"
+#include "frame_uniforms.h"
+#include "game_state.h"
 #include "geometry.h"
+#include "gl_features.h"
+#include "gl_resources.h"
 #include "image.h"
 #include "linmath.h"
 #include "math_helper.h"
+#include "particles.h"
+#include "picking.h"
 #include "platform_gl.h"
 #include "platform_asset_utils.h"
+#include "platform_log.h"
 #include "program.h"
+#include "render_target.h"
+#include "resolution_scaler.h"
 #include "shader.h"
+#include "stream_buffer.h"
+#include "table_sdf.h"
+#include "telemetry.h"
 #include "texture.h"
-
-static const float puck_height = 0.02f;
-static const float puck_radius = 0.06f;
-static const float mallet_height = 0.15f;
-static const float mallet_radius = 0.08f;
-
-static const float left_bound = -0.5f;
-static const float right_bound = 0.5f;
-static const float far_bound = -0.8f;
-static const float near_bound = 0.8f;
+#include "timer.h"
+#include "touch_predictor.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#define TAG "game"
+
+// The opponent moves at most this far per frame, and plans for at most this
+// long per frame.
+static const float red_mallet_speed = 0.03f;
+static const long long red_mallet_budget_us = 200;
+
+// A change to the puck's vector bigger than this, beyond what friction takes
+// off, means it hit a side or a mallet.
+static const float puck_impact_threshold = 0.002f;
+static const float particle_size = 0.012f;
+
+// Once nothing on the table moves further than this in a frame, and there
+// are no touches or particles, frames stop changing and needn't be drawn.
+static const float idle_motion_threshold = 0.0001f;
+
+// Frames that take longer than this, on average, render at a lower resolution.
+static const long long frame_budget_us = 16667;
+
+// The GPU is shared on kiosks, so the game keeps to this much of its memory.
+// Render targets that don't fit aren't made; anything else is only logged.
+static const long long gl_memory_budget_bytes = 32 * 1024 * 1024;
+
+// Enough for every renderable, the particles and the screen quad.
+#define MAX_OBJECTS_PER_FRAME 64
+#define MAX_PARTICLE_VERTEX_FLOATS (MAX_PARTICLES * VERTICES_PER_PARTICLE * COMPONENTS_PER_PARTICLE_VERTEX)
+
+// How far ahead of the latest touch the blue mallet is drawn by default,
+// which is about how long a recorded frame takes to be shown.
+static const long long default_touch_lookahead_us = 16667;
+
+// Touches that come in between two frames; past this, drags are merged.
+// They're all picked together, so there can't be more than a batch.
+#define MAX_TOUCH_EVENTS MAX_PICK_TOUCHES
+
+// Big enough that loading everything, including decoding the table texture,
+// fits in a single block.
+static const size_t load_arena_block_size = 2 * 1024 * 1024;
+
+// The meshes that renderable entities can be drawn with.
+typedef enum {
+	MESH_TABLE,
+	MESH_PUCK,
+	MESH_RED_MALLET,
+	MESH_BLUE_MALLET,
+	// Streamed, with its vertices in the command list.
+	MESH_PARTICLES,
+} MeshId;
+
+typedef struct {
+	enum {TOUCH_PRESS, TOUCH_DRAG} type;
+	float normalized_x;
+	float normalized_y;
+	long long time_us;
+} TouchEvent;
 
 static Table table;
 static Puck puck;
 static Mallet red_mallet;
 static Mallet blue_mallet;
 
+// The simulation lives in game_state, which rollback needs to be able to
+// copy. It's mirrored into the world each frame, where drawing and the
+// check for whether anything moved walk the packed component arrays.
+static World world;
+static Entity puck_entity;
+static Entity red_mallet_entity;
+static Entity blue_mallet_entity;
+
+static ParticleSystem particles;
+static StreamBuffer* particle_stream_buffer;
+
+// The game thread simulates each frame and records it into a command list,
+// while the render thread draws the one before. The game's state, the world,
+// the particles and the camera are the game thread's while it records, and
+// the render thread's otherwise.
+static FramePipeline* frame_pipeline;
+
+// Touches come in on the render thread, and go to the game thread with the
+// frame that it's asked to record next.
+static TouchEvent pending_touches[MAX_TOUCH_EVENTS];
+static int pending_touch_count;
+static TouchEvent frame_touches[MAX_TOUCH_EVENTS];
+static int frame_touch_count;
+
+// Drags on the blue mallet are extrapolated to when the frame will be shown.
+// The lookahead and the measurement are the game thread's, and the render
+// thread passes back how long the last predicted frame took to be shown.
+static TouchPredictor blue_touch_predictor;
+static long long touch_lookahead_us = default_touch_lookahead_us;
+static int is_measuring_touch_prediction;
+static TouchPredictionMeasurement touch_prediction_measurement;
+static long long touch_show_delay_us;
+static long long drawn_predicted_at_us;
+
+// Every object's uniforms are added before anything is drawn, and uploaded
+// together.
+static FrameUniforms* frame_uniforms;
+
+// While the render scale is below one, the scene is drawn into the render
+// target and then stretched over the window.
+static ScreenQuad screen_quad;
+static ResolutionScaler resolution_scaler;
+static RenderTarget render_target;
+static int is_using_render_target;
+static int can_render_to_texture;
+static int window_width;
+static int window_height;
+static long long last_frame_start_us;
+// The scaler goes by how long the render thread spent on each frame, from
+// when it started drawing until it was presented, or failing that until its
+// commands were issued. Waits for vsync and idle time in between don't count.
+static long long drawn_frame_start_us;
+static long long drawn_frame_work_us;
+
+// What's drawn only changes when the game thread records a frame that moved,
+// or when a touch or a new surface is handed to it, which shows a frame later.
+static int needs_redraw;
+static int last_frame_had_changes;
+static int is_next_frame_needed;
+// Since when is_frame_needed() has been returning zero without that time
+// going into telemetry yet, or zero while drawing.
+static long long idle_start_us;
+
 static TextureProgram texture_program;
 static ColorProgram color_program;
 
-static mat4x4 projection_matrix;
+static Camera camera;
 static mat4x4 model_matrix;
-static mat4x4 view_matrix;
-
-static mat4x4 view_projection_matrix;
 static mat4x4 model_view_projection_matrix;
-static mat4x4 inverted_view_projection_matrix;
 
-static int mallet_pressed;
-static vec3 blue_mallet_position;
-static vec3 previous_blue_mallet_position;
-static vec3 puck_position;
-static vec3 puck_vector;
+static GameState game_state;
+static GameStateHistory game_state_history;
+static GameInput pending_input;
+// Whether the touch that's down grabbed the blue mallet. It's the game
+// thread's, and stays out of game_state so that rollback leaves it alone.
+static int is_blue_mallet_pressed;
+
+static AiController red_mallet_ai;
+
+// Baked on the first load, and kept for as long as the game runs.
+static TableSdf table_sdf;
 
-static Ray convert_normalized_2D_point_to_ray(float normalized_x, float normalized_y);
-static void divide_by_w(vec4 vector);
-static float clamp(float value, float min, float max);
+// Set once everything above that lives in GL has been made for a surface.
+static int has_surface_objects;
+
+static void end_load_phase(Arena* arena, ArenaMarker marker, const char* phase) {
+	const size_t peak_bytes_used = end_arena_scope(arena, marker);
+	DEBUG_LOG_PRINT_D(TAG, "Loading %s used at most %zu bytes", phase, peak_bytes_used);
+}
+
+static void delete_surface_objects();
+static void update_render_target();
+static void record_idle_time(long long now_us, int is_drawing_again);
+static void bake_table();
+static void record_frame(CommandList* list);
+static void apply_touches(CommandList* list);
+static void pick_frame_touches();
+static int draw_command_list(const CommandList* list);
+static void create_entities();
+static void sync_world_with_game_state(const GameState* previous_state);
+static void record_renderables(CommandList* list);
+static void emit_puck_particles(vec3 previous_puck_vector);
 static void position_table_in_scene();
+static void position_particles_in_scene();
 static void position_object_in_scene(float x, float y, float z);
+static int has_moved(const float* from, const float* to);
+
+static void queue_touch(TouchEvent touch) {
+	if (pending_touch_count == MAX_TOUCH_EVENTS) {
+		// Of two drags in a row, only the second matters, so the first such
+		// pair makes room, or failing that the oldest touch.
+		int i;
+		for (i = 1; i < pending_touch_count; i++) {
+			if (pending_touches[i - 1].type == TOUCH_DRAG && pending_touches[i].type == TOUCH_DRAG)
+				break;
+		}
+		if (i == pending_touch_count)
+			i = 1;
+		memmove(&pending_touches[i - 1], &pending_touches[i], (pending_touch_count - i) * sizeof(TouchEvent));
+		pending_touch_count--;
+	}
+	pending_touches[pending_touch_count++] = touch;
+}
 
 void on_touch_press(float normalized_x, float normalized_y) {
-	Ray ray = convert_normalized_2D_point_to_ray(normalized_x, normalized_y);
-
-	// Now test if this ray intersects with the mallet by creating a
-	// bounding sphere that wraps the mallet.
-	Sphere mallet_bounding_sphere = (Sphere) {
-	   {blue_mallet_position[0],
-		blue_mallet_position[1],
-		blue_mallet_position[2]},
-	mallet_height / 2.0f};
-
-	// If the ray intersects (if the user touched a part of the screen that
-	// intersects the mallet's bounding sphere), then set malletPressed =
-	// true.
-	mallet_pressed = sphere_intersects_ray(mallet_bounding_sphere, ray);
-}
-
-static Ray convert_normalized_2D_point_to_ray(float normalized_x, float normalized_y) {
-	// We'll convert these normalized device coordinates into world-space
-	// coordinates. We'll pick a point on the near and far planes, and draw a
-	// line between them. To do this transform, we need to first multiply by
-	// the inverse matrix, and then we need to undo the perspective divide.
-	vec4 near_point_ndc = {normalized_x, normalized_y, -1, 1};
-	vec4 far_point_ndc = {normalized_x, normalized_y,  1, 1};
-
-    vec4 near_point_world, far_point_world;
-    mat4x4_mul_vec4(near_point_world, inverted_view_projection_matrix, near_point_ndc);
-    mat4x4_mul_vec4(far_point_world, inverted_view_projection_matrix, far_point_ndc);
-
-	// Why are we dividing by W? We multiplied our vector by an inverse
-	// matrix, so the W value that we end up is actually the *inverse* of
-	// what the projection matrix would create. By dividing all 3 components
-	// by W, we effectively undo the hardware perspective divide.
-    divide_by_w(near_point_world);
-    divide_by_w(far_point_world);
-
-	// We don't care about the W value anymore, because our points are now
-	// in world coordinates.
-	vec3 near_point_ray = {near_point_world[0], near_point_world[1], near_point_world[2]};
-	vec3 far_point_ray = {far_point_world[0], far_point_world[1], far_point_world[2]};
-	vec3 vector_between;
-	vec3_sub(vector_between, far_point_ray, near_point_ray);
-	return (Ray) {
-		{near_point_ray[0], near_point_ray[1], near_point_ray[2]},
-		{vector_between[0], vector_between[1], vector_between[2]}};
-}
-
-static void divide_by_w(vec4 vector) {
-	vector[0] /= vector[3];
-	vector[1] /= vector[3];
-	vector[2] /= vector[3];
+	queue_touch((TouchEvent) {TOUCH_PRESS, normalized_x, normalized_y, get_time_in_microseconds()});
 }
 
 void on_touch_drag(float normalized_x, float normalized_y) {
-	if (mallet_pressed == 0)
-		return;
-
-	Ray ray = convert_normalized_2D_point_to_ray(normalized_x, normalized_y);
-	// Define a plane representing our air hockey table.
-	Plane plane = (Plane) {{0, 0, 0}, {0, 1, 0}};
-
-	// Find out where the touched point intersects the plane
-	// representing our table. We'll move the mallet along this plane.
-	vec3 touched_point;
-	ray_intersection_point(touched_point, ray, plane);
-
-	memcpy(previous_blue_mallet_position, blue_mallet_position, sizeof(blue_mallet_position));
-
-	// Clamp to bounds
-	blue_mallet_position[0] = clamp(touched_point[0], left_bound + mallet_radius, right_bound - mallet_radius);
-	blue_mallet_position[1] = mallet_height / 2.0f;
-	blue_mallet_position[2] = clamp(touched_point[2], 0.0f + mallet_radius, near_bound - mallet_radius);
-
-	// Now test if mallet has struck the puck.
-	vec3 mallet_to_puck;
-	vec3_sub(mallet_to_puck, puck_position, blue_mallet_position);
-	float distance = vec3_len(mallet_to_puck);
-
-	if (distance < (puck_radius + mallet_radius)) {
-		// The mallet has struck the puck. Now send the puck flying
-		// based on the mallet velocity.
-		vec3_sub(puck_vector, blue_mallet_position, previous_blue_mallet_position);
-	}
+	queue_touch((TouchEvent) {TOUCH_DRAG, normalized_x, normalized_y, get_time_in_microseconds()});
 }
 
-static float clamp(float value, float min, float max) {
-	return fmin(max, fmax(value, min));
+/* Until the next frame is recorded, what the game thread records from is
+   the caller's. Without a surface, there's no game thread to wait for. */
+static void wait_for_game_thread() {
+	if (frame_pipeline != NULL)
+		wait_for_recorded_frame(frame_pipeline);
 }
 
 void on_surface_created() {
+	// The game thread is stopped when the surface is destroyed, but Android
+	// loses contexts without saying so, and then it's left running. Either
+	// way, it can't be recording while everything is set up again.
+	if (frame_pipeline == NULL)
+		frame_pipeline = create_frame_pipeline(record_frame, MAX_OBJECTS_PER_FRAME, MAX_PARTICLE_VERTEX_FLOATS);
+	else
+		wait_for_recorded_frame(frame_pipeline);
+
+	// Android makes a new context whenever it recreates the surface, which
+	// takes everything in the old one with it. Whatever survived is deleted
+	// before it's all made again.
+	const int lost_objects = forget_lost_gl_resources();
+	if (lost_objects > 0)
+		DEBUG_LOG_PRINT_D(TAG, "%d GL objects went with the old context", lost_objects);
+	if (has_surface_objects)
+		delete_surface_objects();
+	// A new context can be a different version from the last one.
+	detect_gl_features();
+	set_gl_memory_budget(gl_memory_budget_bytes);
+
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glEnable(GL_DEPTH_TEST);
 
-	table = create_table(load_png_asset_into_texture("textures/air_hockey_surface.png"));
+	// Everything that's only needed while loading comes from one arena,
+	// which is given back as soon as loading is done.
+	Arena load_arena;
+	init_arena(&load_arena, load_arena_block_size);
+
+	ArenaMarker phase = begin_arena_scope(&load_arena);
+	const GLuint table_texture = load_ktx_asset_into_texture(
+		"textures/air_hockey_surface.ktx", "textures/air_hockey_surface.qoi", &load_arena);
+	end_load_phase(&load_arena, phase, "textures");
 
 	vec4 puck_color = {0.8f, 0.8f, 1.0f, 1.0f};
 	vec4 red = {1.0f, 0.0f, 0.0f, 1.0f};
 	vec4 blue = {0.0f, 0.0f, 1.0f, 1.0f};
 
-	puck = create_puck(puck_radius, puck_height, 32, puck_color);
-	red_mallet = create_mallet(mallet_radius, mallet_height, 32, red);
-	blue_mallet = create_mallet(mallet_radius, mallet_height, 32, blue);
-
-	blue_mallet_position[0] = 0;
-	blue_mallet_position[1] = mallet_height / 2.0f;
-	blue_mallet_position[2] = 0.4f;
-	puck_position[0] = 0;
-	puck_position[1] = puck_height / 2.0f;
-	puck_position[2] = 0;
-	puck_vector[0] = 0;
-	puck_vector[1] = 0;
-	puck_vector[2] = 0;
+	phase = begin_arena_scope(&load_arena);
+	table = create_table(table_texture, &load_arena);
+	screen_quad = create_screen_quad(&load_arena);
+	puck = create_puck(puck_radius, puck_height, 32, puck_color, &load_arena);
+	red_mallet = create_mallet(mallet_radius, mallet_height, 32, red, &load_arena);
+	blue_mallet = create_mallet(mallet_radius, mallet_height, 32, blue, &load_arena);
+	end_load_phase(&load_arena, phase, "geometry");
+
+	if (table_sdf.samples == NULL)
+		bake_table();
+	init_game_state(&game_state);
+	init_game_state_history(&game_state_history, &game_state, &table_sdf);
+	memset(&pending_input, 0, sizeof(pending_input));
+	is_blue_mallet_pressed = 0;
+	pending_touch_count = 0;
+	create_entities();
+
+	// The blue mallet's center stays on the near half of the table.
+	const TableBounds blue_mallet_bounds = {table_bounds.left + mallet_radius, table_bounds.right - mallet_radius,
+		0.0f + mallet_radius, table_bounds.near - mallet_radius};
+	init_touch_predictor(&blue_touch_predictor, &blue_mallet_bounds);
+
+	init_resolution_scaler(&resolution_scaler, frame_budget_us);
+	is_using_render_target = 0;
+	can_render_to_texture = 1;
+	last_frame_start_us = 0;
+	drawn_frame_start_us = 0;
+	drawn_frame_work_us = 0;
+	needs_redraw = 1;
+
+	init_particle_system(&particles);
+	particle_stream_buffer = create_stream_buffer(
+		MAX_PARTICLES * VERTICES_PER_PARTICLE * COMPONENTS_PER_PARTICLE_VERTEX * sizeof(float), 16);
+	label_gl_resource(GL_RESOURCE_BUFFER, get_stream_buffer_object(particle_stream_buffer), "particles");
+
+	init_ai_controller(&red_mallet_ai, table_bounds, puck_radius, mallet_radius, red_mallet_speed, red_mallet_budget_us);
+	set_ai_controller_table(&red_mallet_ai, &table_sdf);
+
+	phase = begin_arena_scope(&load_arena);
+	// The frame uniforms go by the same feature, so the programs match them.
+	if (get_gl_features()->has_uniform_buffers) {
+		texture_program = get_texture_program(build_program_from_assets("shaders/es3/texture_shader.vsh", "shaders/es3/texture_shader.fsh", &load_arena));
+		color_program = get_color_program(build_program_from_assets("shaders/es3/color_shader.vsh", "shaders/es3/color_shader.fsh", &load_arena));
+	} else {
+		texture_program = get_texture_program(build_program_from_assets("shaders/texture_shader.vsh", "shaders/texture_shader.fsh", &load_arena));
+		color_program = get_color_program(build_program_from_assets("shaders/color_shader.vsh", "shaders/color_shader.fsh", &load_arena));
+	}
+	end_load_phase(&load_arena, phase, "shaders");
+	frame_uniforms = create_frame_uniforms(MAX_OBJECTS_PER_FRAME);
+
+	DEBUG_LOG_PRINT_D(TAG, "Loading took %d allocations totalling %zu bytes",
+		load_arena.block_count, load_arena.bytes_reserved);
+	release_arena(&load_arena);
+	has_surface_objects = 1;
+	log_gl_resources(0);
+}
 
-	texture_program = get_texture_program(build_program_from_assets("shaders/texture_shader.vsh", "shaders/texture_shader.fsh"));
-	color_program = get_color_program(build_program_from_assets("shaders/color_shader.vsh", "shaders/color_shader.fsh"));
+void on_surface_destroyed() {
+	// The game thread records from what's deleted here, so it's stopped
+	// first. The next on_surface_created() starts another.
+	if (frame_pipeline != NULL) {
+		destroy_frame_pipeline(frame_pipeline);
+		frame_pipeline = NULL;
+	}
+	if (has_surface_objects)
+		delete_surface_objects();
+	log_gl_resources(1);
 }
 
 void on_surface_changed(int width, int height) {
+	wait_for_game_thread();
+	window_width = width;
+	window_height = height;
 	glViewport(0, 0, width, height);
-	mat4x4_perspective(projection_matrix, deg_to_radf(45), (float) width / (float) height, 1.0f, 10.0f);
-	mat4x4_look_at(view_matrix, (vec3){0.0f, 1.2f, 2.2f}, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f});
+
+	// The camera always takes the window's aspect ratio, since the render
+	// target is stretched over the whole window. Touches are in normalized
+	// device coordinates, so picking doesn't depend on the render scale.
+	init_camera(&camera, (float) width / (float) height, 0);
+	// A render target that couldn't be made while the surface was being
+	// recreated may well be fine now.
+	can_render_to_texture = 1;
+	update_render_target();
+	needs_redraw = 1;
+}
+
+int is_frame_needed() {
+	if (last_frame_had_changes || is_next_frame_needed || needs_redraw || pending_touch_count > 0)
+		return 1;
+	// Platforms that keep asking while idle keep telemetry up to date.
+	const long long now_us = get_time_in_microseconds();
+	if (idle_start_us == 0)
+		idle_start_us = now_us;
+	else
+		record_idle_time(now_us, 0);
+	return 0;
 }
 
 void on_draw_frame() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	const long long frame_start_us = get_time_in_microseconds();
+	if (idle_start_us != 0) {
+		// The time since the last frame drawn isn't a frame interval.
+		record_idle_time(frame_start_us, 1);
+		idle_start_us = 0;
+		last_frame_start_us = 0;
+	}
+	const long long frame_interval_us = last_frame_start_us != 0 ? frame_start_us - last_frame_start_us : 0;
+	last_frame_start_us = frame_start_us;
+	if (drawn_frame_work_us != 0 && record_frame_time(&resolution_scaler, drawn_frame_work_us))
+		update_render_target();
+
+	// This frame was recorded while the last one was drawn, and the next one
+	// is recorded while this one is drawn, with the touches since the last.
+	const CommandList* list = acquire_recorded_frame(frame_pipeline);
+	last_frame_had_changes = list->has_changes;
+	is_next_frame_needed = pending_touch_count > 0 || needs_redraw;
+	needs_redraw = 0;
+	memcpy(frame_touches, pending_touches, pending_touch_count * sizeof(TouchEvent));
+	frame_touch_count = pending_touch_count;
+	pending_touch_count = 0;
+	record_next_frame(frame_pipeline);
+
+	const long long render_start_us = get_time_in_microseconds();
+	const int draw_calls = draw_command_list(list);
+	const long long render_end_us = get_time_in_microseconds();
+	record_frame_telemetry(frame_interval_us, render_end_us - render_start_us, draw_calls,
+		is_using_render_target ? get_render_scale(&resolution_scaler) : 1.0f);
+	if (list->input_time_us != 0)
+		record_input_latency_telemetry(render_end_us - list->input_time_us);
+	drawn_predicted_at_us = list->predicted_at_us;
+	drawn_frame_start_us = frame_start_us;
+	drawn_frame_work_us = render_end_us - frame_start_us;
+}
 
-    // Translate the puck by its vector
-	vec3_add(puck_position, puck_position, puck_vector);
+void on_frame_presented() {
+	const long long now_us = get_time_in_microseconds();
+	if (drawn_frame_start_us != 0) {
+		drawn_frame_work_us = now_us - drawn_frame_start_us;
+		drawn_frame_start_us = 0;
+	}
 
-	// If the puck struck a side, reflect it off that side.
-	if (puck_position[0] < left_bound + puck_radius
-	 || puck_position[0] > right_bound - puck_radius) {
-		puck_vector[0] = -puck_vector[0];
-		vec3_scale(puck_vector, puck_vector, 0.9f);
+	// Issuing the frame's commands doesn't show it, so the delay runs until
+	// the platform says that it's been swapped to the display.
+	if (drawn_predicted_at_us == 0)
+		return;
+	__atomic_store_n(&touch_show_delay_us, now_us - drawn_predicted_at_us, __ATOMIC_RELAXED);
+	drawn_predicted_at_us = 0;
+}
+
+void set_touch_lookahead(long long lookahead_us) {
+	assert(lookahead_us >= 0);
+	wait_for_game_thread();
+	touch_lookahead_us = lookahead_us;
+}
+
+void set_touch_prediction_measuring(int is_measuring) {
+	wait_for_game_thread();
+	if (is_measuring && !is_measuring_touch_prediction)
+		reset_touch_prediction_measurement(&touch_prediction_measurement);
+	else if (!is_measuring && is_measuring_touch_prediction)
+		log_touch_prediction_measurement(&touch_prediction_measurement);
+	is_measuring_touch_prediction = is_measuring;
+}
+
+/* Game thread */
+
+static void record_frame(CommandList* list) {
+	const long long start_us = get_time_in_microseconds();
+	apply_touches(list);
+	if (frame_touch_count > 0)
+		list->input_time_us = frame_touches[0].time_us;
+
+	vec3 red_mallet_target;
+	memcpy(red_mallet_target, game_state.red_mallet_position, sizeof(red_mallet_target));
+	update_ai_controller(&red_mallet_ai, game_state.puck_position, game_state.puck_vector, red_mallet_target);
+	pending_input.red = (MalletInput) {1, red_mallet_target[0], red_mallet_target[2]};
+
+	GameState previous_state;
+	memcpy(&previous_state, &game_state, sizeof(previous_state));
+	step_game_state(&game_state_history, &game_state, &pending_input);
+	memset(&pending_input, 0, sizeof(pending_input));
+
+	update_particles(&particles);
+	emit_puck_particles(previous_state.puck_vector);
+	sync_world_with_game_state(&previous_state);
+	list->has_changes = frame_touch_count > 0 || particles.count > 0
+		|| has_moving_entities(&world, idle_motion_threshold);
+	record_renderables(list);
+
+	vec4 particle_color = {1.0f, 0.9f, 0.5f, 1.0f};
+	position_particles_in_scene();
+	const int particle_uniforms = record_uniforms(list, model_view_projection_matrix, particle_color);
+	float* particle_vertices = reserve_vertices(list, get_particle_vertex_buffer_size(&particles) / (int) sizeof(float));
+	if (particle_uniforms >= 0 && particle_vertices != NULL && particles.count > 0) {
+		const int vertex_count = write_particle_vertices(&particles, particle_size, particle_vertices);
+		record_draw(list, MESH_PARTICLES, particle_uniforms, vertex_count, vertex_count * COMPONENTS_PER_PARTICLE_VERTEX);
 	}
-	if (puck_position[2] < far_bound + puck_radius
-	 || puck_position[2] > near_bound - puck_radius) {
-		puck_vector[2] = -puck_vector[2];
-		vec3_scale(puck_vector, puck_vector, 0.9f);
+
+	record_simulation_telemetry(frame_touch_count, get_time_in_microseconds() - start_us);
+}
+
+// What touches can land on.
+typedef enum {
+	PICKABLE_BLUE_MALLET,
+	PICKABLE_RED_MALLET,
+	PICKABLE_COUNT,
+} PickableObject;
+
+static void apply_touches(CommandList* list) {
+	if (frame_touch_count > 0)
+		pick_frame_touches();
+	if (is_blue_mallet_pressed == 0)
+		return;
+
+	const long long now_us = get_time_in_microseconds();
+	if (is_measuring_touch_prediction) {
+		resolve_touch_predictions(&touch_prediction_measurement, &blue_touch_predictor);
+		const long long show_delay_us = __atomic_load_n(&touch_show_delay_us, __ATOMIC_RELAXED);
+		if (show_delay_us > 0)
+			record_touch_prediction(&touch_prediction_measurement, &blue_touch_predictor, now_us, show_delay_us);
 	}
 
-	// Clamp the puck position.
-	puck_position[0] = clamp(puck_position[0], left_bound + puck_radius, right_bound - puck_radius);
-	puck_position[2] = clamp(puck_position[2], far_bound + puck_radius, near_bound - puck_radius);
+	// We'll move the mallet along the table to where the finger should be
+	// when this frame is shown, once it's simulated. Between drags, that
+	// keeps it moving, until the prediction settles where the finger stopped.
+	float x, z;
+	if (touch_lookahead_us > 0 && predict_touch(&blue_touch_predictor, now_us, touch_lookahead_us, &x, &z)) {
+		const vec3 predicted_position = {x, game_state.blue_mallet_position[1], z};
+		if (has_moved(game_state.blue_mallet_position, predicted_position))
+			pending_input.blue = (MalletInput) {1, x, z};
+	}
+	list->predicted_at_us = now_us;
+}
+
+static void pick_frame_touches() {
+	// The mallets don't move until the frame is simulated, so every touch
+	// since the last frame can be picked against them at once. Each mallet is
+	// wrapped in a bounding sphere; a touch on the red one mustn't grab the
+	// blue one behind it.
+	const Plane table_plane = (Plane) {{0, 0, 0}, {0, 1, 0}};
+	const int blue_collider = find_component(&world.colliders.set, blue_mallet_entity);
+	const int red_collider = find_component(&world.colliders.set, red_mallet_entity);
+	Sphere pickables[PICKABLE_COUNT] = {
+		{{game_state.blue_mallet_position[0], game_state.blue_mallet_position[1], game_state.blue_mallet_position[2]},
+			world.colliders.height[blue_collider] / 2.0f},
+		{{game_state.red_mallet_position[0], game_state.red_mallet_position[1], game_state.red_mallet_position[2]},
+			world.colliders.height[red_collider] / 2.0f},
+	};
+
+	TouchPoint points[MAX_TOUCH_EVENTS];
+	PickHit hits[MAX_TOUCH_EVENTS];
+	int i;
+	for (i = 0; i < frame_touch_count; i++)
+		points[i] = (TouchPoint) {frame_touches[i].normalized_x, frame_touches[i].normalized_y};
+	pick_touches(&camera, points, frame_touch_count, pickables, PICKABLE_COUNT, table_plane, hits);
+
+	for (i = 0; i < frame_touch_count; i++) {
+		if (frame_touches[i].type == TOUCH_PRESS) {
+			is_blue_mallet_pressed = hits[i].object == PICKABLE_BLUE_MALLET;
+			reset_touch_predictor(&blue_touch_predictor);
+		} else if (is_blue_mallet_pressed) {
+			add_touch_sample(&blue_touch_predictor, frame_touches[i].time_us,
+				hits[i].plane_point[0], hits[i].plane_point[2]);
+			// Without prediction, the mallet goes to the touched point.
+			if (touch_lookahead_us == 0)
+				pending_input.blue = (MalletInput) {1, hits[i].plane_point[0], hits[i].plane_point[2]};
+		}
+	}
+}
+
+/* Render thread */
+
+/* Returns the number of draw calls. */
+static int draw_command_list(const CommandList* list) {
+	// Some platforms, like iOS, draw to a framebuffer of their own rather than zero.
+	GLint window_framebuffer = 0;
+	if (is_using_render_target) {
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &window_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, render_target.framebuffer);
+		glViewport(0, 0, render_target.width, render_target.height);
+	}
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// The list's uniforms come first, so they keep their indices.
+	begin_frame_uniforms(frame_uniforms);
+	add_recorded_object_uniforms(frame_uniforms, list->uniforms, list->uniforms_count);
+	const int screen_quad_uniforms = is_using_render_target ? add_screen_quad_uniforms(frame_uniforms, &screen_quad) : -1;
+	upload_frame_uniforms(frame_uniforms);
+
+	begin_stream_buffer_frame(particle_stream_buffer);
+	int draw_calls = list->packet_count;
+	int i;
+	for (i = 0; i < list->packet_count; i++) {
+		const DrawPacket* packet = &list->packets[i];
+		switch ((MeshId) packet->mesh) {
+			case MESH_TABLE:
+				draw_table(&table, &texture_program, frame_uniforms, packet->uniforms_index);
+				break;
+			case MESH_PUCK:
+				draw_puck(&puck, &color_program, frame_uniforms, packet->uniforms_index);
+				break;
+			case MESH_RED_MALLET:
+				draw_mallet(&red_mallet, &color_program, frame_uniforms, packet->uniforms_index);
+				break;
+			case MESH_BLUE_MALLET:
+				draw_mallet(&blue_mallet, &color_program, frame_uniforms, packet->uniforms_index);
+				break;
+			case MESH_PARTICLES:
+				draw_particles(list->vertices + packet->first_vertex_float, packet->vertex_count,
+					particle_stream_buffer, &color_program, frame_uniforms, packet->uniforms_index);
+				break;
+		}
+	}
+	end_stream_buffer_frame(particle_stream_buffer);
+
+	if (is_using_render_target) {
+		glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) window_framebuffer);
+		glViewport(0, 0, window_width, window_height);
+		glDisable(GL_DEPTH_TEST);
+		if (screen_quad_uniforms >= 0) {
+			draw_screen_quad(&screen_quad, render_target.color_texture, &texture_program, frame_uniforms, screen_quad_uniforms);
+			draw_calls++;
+		}
+		glEnable(GL_DEPTH_TEST);
+	}
+	end_frame_uniforms(frame_uniforms);
+	return draw_calls;
+}
+
+static void delete_surface_objects() {
+	if (is_using_render_target) {
+		destroy_render_target(&render_target);
+		is_using_render_target = 0;
+	}
+	destroy_frame_uniforms(frame_uniforms);
+	destroy_stream_buffer(particle_stream_buffer);
+	delete_program(texture_program.program);
+	delete_program(color_program.program);
+	delete_vbo(table.buffer);
+	delete_vbo(screen_quad.buffer);
+	delete_vbo(puck.buffer);
+	delete_vbo(red_mallet.buffer);
+	delete_vbo(blue_mallet.buffer);
+	delete_texture(table.texture);
+	has_surface_objects = 0;
+}
+
+static void bake_table() {
+	const long long start_us = get_time_in_microseconds();
+	bake_standard_table_sdf(&table_sdf);
+	DEBUG_LOG_PRINT_D(TAG, "Baked the table's walls into %dx%d samples in %lld us",
+		table_sdf.width, table_sdf.height, get_time_in_microseconds() - start_us);
+}
+
+/* Idle time goes into telemetry in whole frame budgets, each one a frame
+   skipped, with whatever's left over once drawing starts again. */
+static void record_idle_time(long long now_us, int is_drawing_again) {
+	long long idle_time_us = now_us - idle_start_us;
+	if (!is_drawing_again)
+		idle_time_us -= idle_time_us % frame_budget_us;
+	if (idle_time_us > 0)
+		record_idle_telemetry((int) (idle_time_us / frame_budget_us), idle_time_us);
+	idle_start_us += idle_time_us;
+}
+
+static void update_render_target() {
+	const float scale = get_render_scale(&resolution_scaler);
+	const int width = (int) lroundf(window_width * scale);
+	const int height = (int) lroundf(window_height * scale);
+
+	if (is_using_render_target && (scale == 1.0f || width != render_target.width || height != render_target.height)) {
+		destroy_render_target(&render_target);
+		is_using_render_target = 0;
+	}
+	if (scale == 1.0f || is_using_render_target || !can_render_to_texture || width < 1 || height < 1)
+		return;
 
-	// Friction factor
-	vec3_scale(puck_vector, puck_vector, 0.99f);
+	is_using_render_target = create_render_target(&render_target, width, height);
+	if (is_using_render_target) {
+		DEBUG_LOG_PRINT_D(TAG, "Rendering at %dx%d, %.2f of the window's size", width, height, scale);
+	} else {
+		DEBUG_LOG_WRITE_W(TAG, "Can't render to a texture; staying at the window's resolution");
+		can_render_to_texture = 0;
+	}
+}
 
-    mat4x4_mul(view_projection_matrix, projection_matrix, view_matrix);
-    mat4x4_invert(inverted_view_projection_matrix, view_projection_matrix);
+static void emit_puck_particles(vec3 previous_puck_vector) {
+	vec3 expected_puck_vector, change;
+	vec3_scale(expected_puck_vector, previous_puck_vector, puck_friction);
+	vec3_sub(change, game_state.puck_vector, expected_puck_vector);
+	if (vec3_len(change) > puck_impact_threshold)
+		emit_particles(&particles, game_state.puck_position[0], game_state.puck_position[2], 96, 0.02f, 40);
+
+	// A trail that gets denser the faster the puck goes.
+	const float speed = vec3_len(game_state.puck_vector);
+	if (speed > 0.005f)
+		emit_particles(&particles, game_state.puck_position[0], game_state.puck_position[2], (int) (speed * 200.0f), speed * 0.1f, 20);
+}
 
-	position_table_in_scene();
-    draw_table(&table, &texture_program, model_view_projection_matrix);
+static int has_moved(const float* from, const float* to) {
+	return fabsf(to[0] - from[0]) > idle_motion_threshold || fabsf(to[2] - from[2]) > idle_motion_threshold;
+}
 
-	position_object_in_scene(0.0f, mallet_height / 2.0f, -0.4f);
-	draw_mallet(&red_mallet, &color_program, model_view_projection_matrix);
+static void create_entities() {
+	init_world(&world);
 
-	position_object_in_scene(blue_mallet_position[0], blue_mallet_position[1], blue_mallet_position[2]);
-	draw_mallet(&blue_mallet, &color_program, model_view_projection_matrix);
+	const Entity table_entity = create_entity(&world);
+	add_transform(&world, table_entity, 0.0f, 0.0f, 0.0f);
+	add_renderable(&world, table_entity, MESH_TABLE);
+
+	puck_entity = create_entity(&world);
+	add_collider(&world, puck_entity, puck_radius, puck_height);
+	add_renderable(&world, puck_entity, MESH_PUCK);
+
+	red_mallet_entity = create_entity(&world);
+	add_collider(&world, red_mallet_entity, mallet_radius, mallet_height);
+	add_renderable(&world, red_mallet_entity, MESH_RED_MALLET);
+
+	blue_mallet_entity = create_entity(&world);
+	add_collider(&world, blue_mallet_entity, mallet_radius, mallet_height);
+	add_renderable(&world, blue_mallet_entity, MESH_BLUE_MALLET);
+
+	sync_world_with_game_state(&game_state);
+}
 
-	// Draw the puck.
-	position_object_in_scene(puck_position[0], puck_position[1], puck_position[2]);
-	draw_puck(&puck, &color_program, model_view_projection_matrix);
+static void sync_entity(Entity entity, const float* previous_position, const float* position) {
+	add_transform(&world, entity, position[0], position[1], position[2]);
+	add_velocity(&world, entity,
+		position[0] - previous_position[0], position[1] - previous_position[1], position[2] - previous_position[2]);
+}
+
+/* Each entity that the simulation moves takes its position, and how far it
+   moved since the previous state as its velocity. */
+static void sync_world_with_game_state(const GameState* previous_state) {
+	sync_entity(puck_entity, previous_state->puck_position, game_state.puck_position);
+	sync_entity(red_mallet_entity, previous_state->red_mallet_position, game_state.red_mallet_position);
+	sync_entity(blue_mallet_entity, previous_state->blue_mallet_position, game_state.blue_mallet_position);
+}
+
+static void record_renderables(CommandList* list) {
+	const RenderableComponents* renderables = &world.renderables;
+	const TransformComponents* transforms = &world.transforms;
+	int i;
+
+	for (i = 0; i < renderables->set.count; i++) {
+		const int transform = find_component(&transforms->set, renderables->set.dense[i]);
+		if (transform < 0)
+			continue;
+
+		const MeshId mesh = (MeshId) renderables->mesh[i];
+		if (mesh == MESH_TABLE) {
+			position_table_in_scene();
+		} else {
+			position_object_in_scene(transforms->x[transform], transforms->y[transform], transforms->z[transform]);
+		}
+
+		int uniforms = -1;
+		switch (mesh) {
+			case MESH_TABLE:
+				uniforms = record_table_uniforms(list, &table, model_view_projection_matrix);
+				break;
+			case MESH_PUCK:
+				uniforms = record_puck_uniforms(list, &puck, model_view_projection_matrix);
+				break;
+			case MESH_RED_MALLET:
+				uniforms = record_mallet_uniforms(list, &red_mallet, model_view_projection_matrix);
+				break;
+			case MESH_BLUE_MALLET:
+				uniforms = record_mallet_uniforms(list, &blue_mallet, model_view_projection_matrix);
+				break;
+			case MESH_PARTICLES:
+				break;
+		}
+		if (uniforms >= 0)
+			record_draw(list, mesh, uniforms, 0, 0);
+	}
 }
 
 static void position_table_in_scene() {
@@ -221,11 +758,20 @@ static void position_table_in_scene() {
 	mat4x4 rotated_model_matrix;
 	mat4x4_identity(model_matrix);
 	mat4x4_rotate_X(rotated_model_matrix, model_matrix, deg_to_radf(-90.0f));
-	mat4x4_mul(model_view_projection_matrix, view_projection_matrix, rotated_model_matrix);
+	mat4x4_mul(model_view_projection_matrix, camera.view_projection_matrix, rotated_model_matrix);
+}
+
+static void position_particles_in_scene() {
+	// Particles are laid out like the table, just above it.
+	mat4x4 rotated_model_matrix;
+	mat4x4_identity(model_matrix);
+	mat4x4_translate_in_place(model_matrix, 0.0f, 0.002f, 0.0f);
+	mat4x4_rotate_X(rotated_model_matrix, model_matrix, deg_to_radf(-90.0f));
+	mat4x4_mul(model_view_projection_matrix, camera.view_projection_matrix, rotated_model_matrix);
 }
 
 static void position_object_in_scene(float x, float y, float z) {
 	mat4x4_identity(model_matrix);
 	mat4x4_translate_in_place(model_matrix, x, y, z);
-	mat4x4_mul(model_view_projection_matrix, view_projection_matrix, model_matrix);
+	mat4x4_mul(model_view_projection_matrix, camera.view_projection_matrix, model_matrix);
 }
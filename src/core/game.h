@@ -1,5 +1,28 @@
 void on_surface_created();
 void on_surface_changed(int width, int height);
+/* Stops the game thread, deletes everything that the game made in the
+   context, while it's still current, and logs anything left over as a leak. */
+void on_surface_destroyed();
 void on_draw_frame();
+/* Called once the frame last drawn has been swapped to the display, so that
+   touch prediction can be measured against when frames are really shown,
+   and the render scale goes by how long they took to finish. Platforms that
+   present after their draw callback returns can't call it; they don't
+   measure, and their frames are timed until their commands are issued. */
+void on_frame_presented();
+/* Returns non-zero if a frame drawn now would look any different from the
+   last one: something on the table is moving, a touch came in, or the
+   surface changed. While it returns zero, platforms can skip drawing and
+   swapping until the next touch. */
+int is_frame_needed();
 void on_touch_press(float normalized_x, float normalized_y);
 void on_touch_drag(float normalized_x, float normalized_y);
+
+/* How far ahead of the latest drag the blue mallet is drawn, to make up for
+   the time it takes for a frame to be shown. Zero draws it where the latest
+   drag was. */
+void set_touch_lookahead(long long lookahead_us);
+/* While measuring, predictions are compared against where the finger really
+   was when each frame was shown, at a range of lookaheads. Stopping logs
+   the results. */
+void set_touch_prediction_measuring(int is_measuring);
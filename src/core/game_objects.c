@@ -1,9 +1,17 @@
 #include "game_objects.h"
 #include "buffer.h"
+#include "command_list.h"
+#include "frame_uniforms.h"
+#include "gl_resources.h"
+#include "particles.h"
 #include "platform_gl.h"
 #include "program.h"
+#include "shapes.h"
+#include "stream_buffer.h"
+#include "vertex_format.h"
 #include "linmath.h"
 #include <math.h>
+#include <string.h>
 
 // Triangle fan
 // position X, Y, texture S, T
@@ -14,100 +22,124 @@ static const float table_data[] = { 0.0f,  0.0f, 0.5f, 0.5f,
         						   -0.5f,  0.8f, 0.0f, 0.1f,
         						   -0.5f, -0.8f, 0.0f, 0.9f};
 
-Table create_table(GLuint texture) {
-	return (Table) {texture, create_vbo(sizeof(table_data), table_data, GL_STATIC_DRAW)};
+static const int table_vertex_count = 6;
+
+/* Objects are drawn with the matrix that places them scaled by their
+   position_scale, which turns their quantized vertices back into positions. */
+static int add_scaled_object_uniforms(FrameUniforms* uniforms, mat4x4 m, const float* position_scale, const GLfloat* color)
+{
+	mat4x4 scaled_m;
+	mat4x4_scale_aniso(scaled_m, m, position_scale[0], position_scale[1], position_scale[2]);
+	return add_object_uniforms(uniforms, scaled_m, color);
 }
 
-void draw_table(const Table* table, const TextureProgram* texture_program, mat4x4 m)
+static int record_scaled_object_uniforms(CommandList* list, mat4x4 m, const float* position_scale, const GLfloat* color)
+{
+	mat4x4 scaled_m;
+	mat4x4_scale_aniso(scaled_m, m, position_scale[0], position_scale[1], position_scale[2]);
+	return record_uniforms(list, scaled_m, color);
+}
+
+Table create_table(GLuint texture, Arena* arena) {
+	const VertexFormat* format = &quantized_position_2d_texture_format;
+	Table table = {.texture = texture};
+	const void* data = quantize_vertices(format, table_data, table_vertex_count, table.position_scale, arena);
+	table.buffer = create_vbo(table_vertex_count * format->stride, data, GL_STATIC_DRAW);
+	label_gl_resource(GL_RESOURCE_BUFFER, table.buffer, "table");
+	return table;
+}
+
+int record_table_uniforms(CommandList* list, const Table* table, mat4x4 m)
+{
+	return record_scaled_object_uniforms(list, m, table->position_scale, NULL);
+}
+
+void draw_table(const Table* table, const TextureProgram* texture_program, const FrameUniforms* uniforms, int uniforms_index)
 {
 	glUseProgram(texture_program->program);
 
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, table->texture);
-	glUniformMatrix4fv(texture_program->u_mvp_matrix_location, 1, GL_FALSE, (GLfloat*)m);
+	apply_object_uniforms(uniforms, uniforms_index, texture_program->u_mvp_matrix_location, -1);
 	glUniform1i(texture_program->u_texture_unit_location, 0);
 
 	glBindBuffer(GL_ARRAY_BUFFER, table->buffer);
-	glVertexAttribPointer(texture_program->a_position_location, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GL_FLOAT), BUFFER_OFFSET(0));
-	glVertexAttribPointer(texture_program->a_texture_coordinates_location, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GL_FLOAT), BUFFER_OFFSET(2 * sizeof(GL_FLOAT)));
-	glEnableVertexAttribArray(texture_program->a_position_location);
-	glEnableVertexAttribArray(texture_program->a_texture_coordinates_location);
-	glDrawArrays(GL_TRIANGLE_FAN, 0, 6);
+	bind_vertex_format(&quantized_position_2d_texture_format, 0,
+		texture_program->a_position_location, texture_program->a_texture_coordinates_location);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, table_vertex_count);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-static inline int size_of_circle_in_vertices(int num_points) {
-	return 1 + (num_points + 1);
-}
-
-static inline int size_of_open_cylinder_in_vertices(int num_points) {
-	return (num_points + 1) * 2;
+// Triangle strip
+// position X, Y, texture S, T
+static const float screen_quad_data[] = {-1.0f, -1.0f, 0.0f, 0.0f,
+										  1.0f, -1.0f, 1.0f, 0.0f,
+										 -1.0f,  1.0f, 0.0f, 1.0f,
+										  1.0f,  1.0f, 1.0f, 1.0f};
+
+ScreenQuad create_screen_quad(Arena* arena) {
+	const VertexFormat* format = &quantized_position_2d_texture_format;
+	ScreenQuad quad;
+	const void* data = quantize_vertices(format, screen_quad_data, 4, quad.position_scale, arena);
+	quad.buffer = create_vbo(4 * format->stride, data, GL_STATIC_DRAW);
+	label_gl_resource(GL_RESOURCE_BUFFER, quad.buffer, "screen quad");
+	return quad;
 }
 
-static inline int gen_circle(float* out, int offset, float center_x, float center_y, float center_z, float radius, int num_points)
+int add_screen_quad_uniforms(FrameUniforms* uniforms, const ScreenQuad* quad)
 {
-	out[offset++] = center_x;
-	out[offset++] = center_y;
-	out[offset++] = center_z;
-
-	int i;
-	for (i = 0; i <= num_points; ++i) {
-		float angle_in_radians = ((float) i / (float) num_points) * ((float) M_PI * 2.0f);
-		out[offset++] = center_x + radius * cos(angle_in_radians);
-		out[offset++] = center_y;
-		out[offset++] = center_z + radius * sin(angle_in_radians);
-	}
-
-	return offset;
+	mat4x4 identity;
+	mat4x4_identity(identity);
+	return add_scaled_object_uniforms(uniforms, identity, quad->position_scale, NULL);
 }
 
-static inline int gen_cylinder(float* out, int offset, float center_x, float center_y, float center_z, float height, float radius, int num_points)
+void draw_screen_quad(const ScreenQuad* quad, GLuint texture, const TextureProgram* texture_program,
+	const FrameUniforms* uniforms, int uniforms_index)
 {
-	const float y_start = center_y - (height / 2.0f);
-	const float y_end = center_y + (height / 2.0f);
-
-	int i;
-	for (i = 0; i <= num_points; i++) {
-		float angle_in_radians = ((float) i / (float) num_points) * ((float) M_PI * 2.0f);
-
-		float x_position = center_x + radius * cos(angle_in_radians);
-		float z_position = center_z + radius * sin(angle_in_radians);
+	glUseProgram(texture_program->program);
 
-		out[offset++] = x_position;
-		out[offset++] = y_start;
-		out[offset++] = z_position;
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	apply_object_uniforms(uniforms, uniforms_index, texture_program->u_mvp_matrix_location, -1);
+	glUniform1i(texture_program->u_texture_unit_location, 0);
 
-		out[offset++] = x_position;
-		out[offset++] = y_end;
-		out[offset++] = z_position;
-	}
+	glBindBuffer(GL_ARRAY_BUFFER, quad->buffer);
+	bind_vertex_format(&quantized_position_2d_texture_format, 0,
+		texture_program->a_position_location, texture_program->a_texture_coordinates_location);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	return offset;
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-Puck create_puck(float radius, float height, int num_points, vec4 color)
+Puck create_puck(float radius, float height, int num_points, vec4 color, Arena* arena)
 {
-	float data[(size_of_circle_in_vertices(num_points) + size_of_open_cylinder_in_vertices(num_points)) * 3];
+	const VertexFormat* format = &quantized_position_3d_format;
+	const int vertex_count = size_of_circle_in_vertices(num_points) + size_of_open_cylinder_in_vertices(num_points);
+	float* data = allocate_from_arena(arena, vertex_count * 3 * sizeof(float));
 
 	int offset = gen_circle(data, 0, 0.0f, height / 2.0f, 0.0f, radius, num_points);
 	gen_cylinder(data, offset, 0.0f, 0.0f, 0.0f, height, radius, num_points);
 
-	return (Puck) {{color[0], color[1], color[2], color[3]},
-				   create_vbo(sizeof(data), data, GL_STATIC_DRAW),
-				   num_points};
+	Puck puck = {{color[0], color[1], color[2], color[3]}, 0, num_points, {0.0f, 0.0f, 0.0f}};
+	const void* quantized_data = quantize_vertices(format, data, vertex_count, puck.position_scale, arena);
+	puck.buffer = create_vbo(vertex_count * format->stride, quantized_data, GL_STATIC_DRAW);
+	label_gl_resource(GL_RESOURCE_BUFFER, puck.buffer, "puck");
+	return puck;
 }
 
-void draw_puck(const Puck* puck, const ColorProgram* color_program, mat4x4 m)
+int record_puck_uniforms(CommandList* list, const Puck* puck, mat4x4 m)
 {
-	glUseProgram(color_program->program);
+	return record_scaled_object_uniforms(list, m, puck->position_scale, puck->color);
+}
 
-	glUniformMatrix4fv(color_program->u_mvp_matrix_location, 1, GL_FALSE, (GLfloat*)m);
-	glUniform4fv(color_program->u_color_location, 1, puck->color);
+void draw_puck(const Puck* puck, const ColorProgram* color_program, const FrameUniforms* uniforms, int uniforms_index)
+{
+	glUseProgram(color_program->program);
+	apply_object_uniforms(uniforms, uniforms_index, color_program->u_mvp_matrix_location, color_program->u_color_location);
 
 	glBindBuffer(GL_ARRAY_BUFFER, puck->buffer);
-	glVertexAttribPointer(color_program->a_position_location, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-	glEnableVertexAttribArray(color_program->a_position_location);
+	bind_vertex_format(&quantized_position_3d_format, 0, color_program->a_position_location, -1);
 
 	int circle_vertex_count = size_of_circle_in_vertices(puck->num_points);
 	int cylinder_vertex_count = size_of_open_cylinder_in_vertices(puck->num_points);
@@ -117,9 +149,11 @@ void draw_puck(const Puck* puck, const ColorProgram* color_program, mat4x4 m)
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-Mallet create_mallet(float radius, float height, int num_points, vec4 color)
+Mallet create_mallet(float radius, float height, int num_points, vec4 color, Arena* arena)
 {
-	float data[(size_of_circle_in_vertices(num_points) * 2 + size_of_open_cylinder_in_vertices(num_points) * 2) * 3];
+	const VertexFormat* format = &quantized_position_3d_format;
+	const int vertex_count = size_of_circle_in_vertices(num_points) * 2 + size_of_open_cylinder_in_vertices(num_points) * 2;
+	float* data = allocate_from_arena(arena, vertex_count * 3 * sizeof(float));
 
 	float base_height = height * 0.25f;
 	float handle_height = height * 0.75f;
@@ -130,21 +164,25 @@ Mallet create_mallet(float radius, float height, int num_points, vec4 color)
 	offset = gen_cylinder(data, offset, 0.0f, -base_height - base_height / 2.0f, 0.0f, base_height, radius, num_points);
 	gen_cylinder(data, offset, 0.0f, height * 0.5f - handle_height / 2.0f, 0.0f, handle_height, handle_radius, num_points);
 
-	return (Mallet) {{color[0], color[1], color[2], color[3]},
-					 create_vbo(sizeof(data), data, GL_STATIC_DRAW),
-				     num_points};
+	Mallet mallet = {{color[0], color[1], color[2], color[3]}, 0, num_points, {0.0f, 0.0f, 0.0f}};
+	const void* quantized_data = quantize_vertices(format, data, vertex_count, mallet.position_scale, arena);
+	mallet.buffer = create_vbo(vertex_count * format->stride, quantized_data, GL_STATIC_DRAW);
+	label_gl_resource(GL_RESOURCE_BUFFER, mallet.buffer, "mallet");
+	return mallet;
 }
 
-void draw_mallet(const Mallet* mallet, const ColorProgram* color_program, mat4x4 m)
+int record_mallet_uniforms(CommandList* list, const Mallet* mallet, mat4x4 m)
 {
-	glUseProgram(color_program->program);
+	return record_scaled_object_uniforms(list, m, mallet->position_scale, mallet->color);
+}
 
-	glUniformMatrix4fv(color_program->u_mvp_matrix_location, 1, GL_FALSE, (GLfloat*)m);
-	glUniform4fv(color_program->u_color_location, 1, mallet->color);
+void draw_mallet(const Mallet* mallet, const ColorProgram* color_program, const FrameUniforms* uniforms, int uniforms_index)
+{
+	glUseProgram(color_program->program);
+	apply_object_uniforms(uniforms, uniforms_index, color_program->u_mvp_matrix_location, color_program->u_color_location);
 
 	glBindBuffer(GL_ARRAY_BUFFER, mallet->buffer);
-	glVertexAttribPointer(color_program->a_position_location, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-	glEnableVertexAttribArray(color_program->a_position_location);
+	bind_vertex_format(&quantized_position_3d_format, 0, color_program->a_position_location, -1);
 
 	int circle_vertex_count = size_of_circle_in_vertices(mallet->num_points);
 	int cylinder_vertex_count = size_of_open_cylinder_in_vertices(mallet->num_points);
@@ -156,3 +194,30 @@ void draw_mallet(const Mallet* mallet, const ColorProgram* color_program, mat4x4
 	glDrawArrays(GL_TRIANGLE_STRIP, start_vertex, cylinder_vertex_count);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
+
+void draw_particles(const float* vertices, int vertex_count, StreamBuffer* stream_buffer,
+	const ColorProgram* color_program, const FrameUniforms* uniforms, int uniforms_index)
+{
+	if (vertex_count == 0)
+		return;
+
+	const GLsizeiptr size = vertex_count * COMPONENTS_PER_PARTICLE_VERTEX * sizeof(float);
+	GLintptr offset;
+	float* mapped_vertices = map_stream_buffer(stream_buffer, size, &offset);
+	if (mapped_vertices == NULL)
+		return;
+	// The game thread writes the next frame's vertices while this one is
+	// drawn, so they're staged in its command list and copied in here. They
+	// can't be written into the ring directly: only the thread that owns the
+	// context can map it, and OpenGL ES 3.0 can't draw from a buffer while
+	// it's mapped. The copy is a few kilobytes a frame.
+	memcpy(mapped_vertices, vertices, size);
+	unmap_stream_buffer(stream_buffer);
+
+	glUseProgram(color_program->program);
+	apply_object_uniforms(uniforms, uniforms_index, color_program->u_mvp_matrix_location, color_program->u_color_location);
+
+	bind_vertex_format(&position_2d_format, (size_t) offset, color_program->a_position_location, -1);
+	glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -1,29 +1,65 @@
+#include "arena.h"
+#include "command_list.h"
+#include "frame_uniforms.h"
+#include "particles.h"
 #include "platform_gl.h"
 #include "program.h"
+#include "stream_buffer.h"
 #include "linmath.h"
 
+/* Vertices are quantized; each object keeps the scale it's drawn with.
+
+   Each frame, every object's uniforms are recorded with m placing it in the
+   scene, and the index that comes back is what it's drawn with once the
+   frame's uniforms are uploaded. The screen quad's are added on the render
+   thread, straight to the frame's uniforms. */
+
 typedef struct {
 	GLuint texture;
 	GLuint buffer;
+	vec3 position_scale;
 } Table;
 
 typedef struct {
 	vec4 color;
 	GLuint buffer;
 	int num_points;
+	vec3 position_scale;
 } Puck;
 
 typedef struct {
 	vec4 color;
 	GLuint buffer;
 	int num_points;
+	vec3 position_scale;
 } Mallet;
 
-Table create_table(GLuint texture);
-void draw_table(const Table* table, const TextureProgram* texture_program, mat4x4 m);
+/* Covers the whole viewport, for drawing a texture to the screen. */
+typedef struct {
+	GLuint buffer;
+	vec3 position_scale;
+} ScreenQuad;
+
+Table create_table(GLuint texture, Arena* arena);
+int record_table_uniforms(CommandList* list, const Table* table, mat4x4 m);
+void draw_table(const Table* table, const TextureProgram* texture_program, const FrameUniforms* uniforms, int uniforms_index);
+
+/* The vertex data is built in the arena before it goes into a buffer. */
+Puck create_puck(float radius, float height, int num_points, vec4 color, Arena* arena);
+int record_puck_uniforms(CommandList* list, const Puck* puck, mat4x4 m);
+void draw_puck(const Puck* puck, const ColorProgram* color_program, const FrameUniforms* uniforms, int uniforms_index);
+
+Mallet create_mallet(float radius, float height, int num_points, vec4 color, Arena* arena);
+int record_mallet_uniforms(CommandList* list, const Mallet* mallet, mat4x4 m);
+void draw_mallet(const Mallet* mallet, const ColorProgram* color_program, const FrameUniforms* uniforms, int uniforms_index);
 
-Puck create_puck(float radius, float height, int num_points, vec4 color);
-void draw_puck(const Puck* puck, const ColorProgram* color_program, mat4x4 m);
+ScreenQuad create_screen_quad(Arena* arena);
+int add_screen_quad_uniforms(FrameUniforms* uniforms, const ScreenQuad* quad);
+void draw_screen_quad(const ScreenQuad* quad, GLuint texture, const TextureProgram* texture_program,
+	const FrameUniforms* uniforms, int uniforms_index);
 
-Mallet create_mallet(float radius, float height, int num_points, vec4 color);
-void draw_mallet(const Mallet* mallet, const ColorProgram* color_program, mat4x4 m);
+/* Streams the particles' vertices, as write_particle_vertices() wrote them,
+   into the buffer and draws them in one call. Their uniforms place them the
+   way the table is placed. */
+void draw_particles(const float* vertices, int vertex_count, StreamBuffer* stream_buffer,
+	const ColorProgram* color_program, const FrameUniforms* uniforms, int uniforms_index);
@@ -0,0 +1,178 @@
+#include "game_state.h"
+#include "linmath.h"
+#include "math_helper.h"
+#include "physics.h"
+#include <assert.h>
+#include <string.h>
+
+static void move_mallet(GameState* state, const MalletInput* input, const TableSdf* table_sdf,
+	vec3 mallet_position, vec3 previous_mallet_position, float near_limit, float far_limit);
+static void strike_puck_if_hit(GameState* state, vec3 mallet_position, vec3 previous_mallet_position);
+static int is_in_history(const GameStateHistory* history, unsigned int frame);
+
+// The walls' distance field is sampled this often, out to a bit past them.
+static const float table_sdf_cell_size = 0.01f;
+static const float table_sdf_margin = 0.1f;
+
+void bake_standard_table_sdf(TableSdf* table) {
+	assert(table != NULL);
+	float points[4 * 2];
+	const TableOutline walls = {points, build_rounded_rectangle_outline(points,
+		table_bounds.left, table_bounds.right, table_bounds.far, table_bounds.near, 0.0f, 0)};
+	const TableShape shape = {&walls, 1};
+	bake_table_sdf(table, &shape, table_sdf_cell_size, table_sdf_margin);
+}
+
+void init_game_state(GameState* state) {
+	assert(state != NULL);
+	memset(state, 0, sizeof(*state));
+
+	state->blue_mallet_position[1] = mallet_height / 2.0f;
+	state->blue_mallet_position[2] = 0.4f;
+	state->red_mallet_position[1] = mallet_height / 2.0f;
+	state->red_mallet_position[2] = -0.4f;
+	state->puck_position[1] = puck_height / 2.0f;
+
+	memcpy(state->previous_blue_mallet_position, state->blue_mallet_position, sizeof(vec3));
+	memcpy(state->previous_red_mallet_position, state->red_mallet_position, sizeof(vec3));
+}
+
+void update_game_state(GameState* state, const GameInput* input, const TableSdf* table) {
+	assert(state != NULL);
+	assert(input != NULL);
+
+	// Each player stays on their own half of the table.
+	move_mallet(state, &input->blue, table, state->blue_mallet_position, state->previous_blue_mallet_position,
+		0.0f + mallet_radius, table_bounds.near - mallet_radius);
+	move_mallet(state, &input->red, table, state->red_mallet_position, state->previous_red_mallet_position,
+		table_bounds.far + mallet_radius, 0.0f - mallet_radius);
+
+	if (table != NULL)
+		advance_puck_on_table(state->puck_position, state->puck_vector, table, puck_radius);
+	else
+		advance_puck(state->puck_position, state->puck_vector, &table_bounds, puck_radius);
+	state->frame++;
+}
+
+static void move_mallet(GameState* state, const MalletInput* input, const TableSdf* table_sdf,
+	vec3 mallet_position, vec3 previous_mallet_position, float near_limit, float far_limit) {
+	if (input->moved == 0)
+		return;
+
+	memcpy(previous_mallet_position, mallet_position, sizeof(vec3));
+
+	// Clamp to bounds
+	mallet_position[1] = mallet_height / 2.0f;
+	if (table_sdf != NULL) {
+		float normal[2];
+		mallet_position[0] = input->x;
+		mallet_position[2] = clamp(input->z, near_limit, far_limit);
+		if (push_circle_out_of_wall(table_sdf, mallet_position, mallet_radius, normal))
+			push_circle_out_of_wall(table_sdf, mallet_position, mallet_radius, normal);
+		// Obstacles can only push the mallet further in, so whatever the
+		// pushes leave, it's still kept within the sides and its own half.
+		mallet_position[0] = clamp(mallet_position[0], table_bounds.left + mallet_radius, table_bounds.right - mallet_radius);
+		mallet_position[2] = clamp(mallet_position[2], near_limit, far_limit);
+	} else {
+		mallet_position[0] = clamp(input->x, table_bounds.left + mallet_radius, table_bounds.right - mallet_radius);
+		mallet_position[2] = clamp(input->z, near_limit, far_limit);
+	}
+
+	strike_puck_if_hit(state, mallet_position, previous_mallet_position);
+}
+
+static void strike_puck_if_hit(GameState* state, vec3 mallet_position, vec3 previous_mallet_position) {
+	// Now test if mallet has struck the puck.
+	vec3 mallet_to_puck;
+	vec3_sub(mallet_to_puck, state->puck_position, mallet_position);
+	float distance = vec3_len(mallet_to_puck);
+
+	if (distance < (puck_radius + mallet_radius)) {
+		// The mallet has struck the puck. Now send the puck flying
+		// based on the mallet velocity.
+		vec3_sub(state->puck_vector, mallet_position, previous_mallet_position);
+	}
+}
+
+void init_game_state_history(GameStateHistory* history, const GameState* state, const TableSdf* table) {
+	assert(history != NULL);
+	assert(state != NULL);
+
+	history->table = table;
+	history->first_frame = state->frame;
+	history->next_frame = state->frame;
+}
+
+void step_game_state(GameStateHistory* history, GameState* state, const GameInput* input) {
+	assert(history != NULL);
+	assert(state != NULL);
+	assert(state->frame == history->next_frame);
+
+	const unsigned int slot = state->frame % GAME_STATE_HISTORY_LENGTH;
+	history->states[slot] = *state;
+	history->inputs[slot] = *input;
+	history->next_frame = state->frame + 1;
+	if (history->next_frame - history->first_frame > GAME_STATE_HISTORY_LENGTH)
+		history->first_frame = history->next_frame - GAME_STATE_HISTORY_LENGTH;
+
+	update_game_state(state, input, history->table);
+}
+
+int load_game_state(const GameStateHistory* history, unsigned int frame, GameState* state) {
+	assert(history != NULL);
+	assert(state != NULL);
+
+	if (!is_in_history(history, frame))
+		return 0;
+
+	*state = history->states[frame % GAME_STATE_HISTORY_LENGTH];
+	return 1;
+}
+
+const GameInput* get_recorded_input(const GameStateHistory* history, unsigned int frame) {
+	assert(history != NULL);
+
+	if (!is_in_history(history, frame))
+		return NULL;
+
+	return &history->inputs[frame % GAME_STATE_HISTORY_LENGTH];
+}
+
+int set_recorded_input(GameStateHistory* history, unsigned int frame, const GameInput* input) {
+	assert(history != NULL);
+	assert(input != NULL);
+
+	if (!is_in_history(history, frame))
+		return 0;
+
+	history->inputs[frame % GAME_STATE_HISTORY_LENGTH] = *input;
+	return 1;
+}
+
+int rollback_game_state(GameStateHistory* history, GameState* state, unsigned int frame) {
+	assert(history != NULL);
+	assert(state != NULL);
+
+	const unsigned int current_frame = state->frame;
+	// The current frame hasn't been recorded yet, and there's nothing to redo.
+	if (frame == current_frame)
+		return 0;
+	if (current_frame - frame > MAX_ROLLBACK_FRAMES || !load_game_state(history, frame, state))
+		return -1;
+
+	history->next_frame = frame;
+
+	// Re-record every frame on the way back up, as the states after the
+	// corrected frame have all changed.
+	unsigned int i;
+	for (i = frame; i < current_frame; i++) {
+		const GameInput input = history->inputs[i % GAME_STATE_HISTORY_LENGTH];
+		step_game_state(history, state, &input);
+	}
+
+	return (int) (current_frame - frame);
+}
+
+static int is_in_history(const GameStateHistory* history, unsigned int frame) {
+	return frame - history->first_frame < history->next_frame - history->first_frame;
+}
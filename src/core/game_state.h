@@ -0,0 +1,87 @@
+#pragma once
+#include "linmath.h"
+#include "physics.h"
+#include "platform_macros.h"
+#include "table_sdf.h"
+
+#define CACHE_LINE_SIZE 64
+#define GAME_STATE_HISTORY_LENGTH 16
+#define MAX_ROLLBACK_FRAMES 8
+
+static const float puck_height = 0.02f;
+static const float puck_radius = 0.06f;
+static const float mallet_height = 0.15f;
+static const float mallet_radius = 0.08f;
+
+static const TableBounds table_bounds = {-0.5f, 0.5f, -0.8f, 0.8f};
+
+/* Everything the simulation needs to advance by one frame. It's plain data
+   without pointers, so a copy is a complete snapshot. What the players are
+   touching isn't in it, since a rollback mustn't undo a press. */
+typedef struct {
+	vec3 puck_position;
+	vec3 puck_vector;
+	vec3 blue_mallet_position;
+	vec3 previous_blue_mallet_position;
+	vec3 red_mallet_position;
+	vec3 previous_red_mallet_position;
+	unsigned int frame;
+} ALIGN_ATTRIBUTE(CACHE_LINE_SIZE) GameState;
+
+/* Where a player moved their mallet to during a frame, if they moved it. */
+typedef struct {
+	int moved;
+	float x;
+	float z;
+} MalletInput;
+
+typedef struct {
+	MalletInput blue;
+	MalletInput red;
+} GameInput;
+
+/* The last GAME_STATE_HISTORY_LENGTH frames: the state at the start of each
+   frame and the input that was applied during it, and the table that every
+   frame was, and will be re-simulated, on. */
+typedef struct {
+	GameState states[GAME_STATE_HISTORY_LENGTH];
+	GameInput inputs[GAME_STATE_HISTORY_LENGTH];
+	const TableSdf* table;
+	unsigned int first_frame;
+	unsigned int next_frame;
+} GameStateHistory;
+
+/* Bakes the rectangle in table_bounds, which is the table that the game, the
+   server and the training env all play on. */
+void bake_standard_table_sdf(TableSdf* table);
+
+void init_game_state(GameState* state);
+/* Advances the state by one frame on the given table. With NULL, it's the
+   rectangle in table_bounds, without the distance field. Every peer of a
+   game has to simulate it on the same table. */
+void update_game_state(GameState* state, const GameInput* input, const TableSdf* table);
+
+/* The history keeps the table, which has to outlive it, for every frame it
+   steps or re-simulates. */
+void init_game_state_history(GameStateHistory* history, const GameState* state, const TableSdf* table);
+
+/* Records the state and input in the history, then advances the state by one frame. */
+void step_game_state(GameStateHistory* history, GameState* state, const GameInput* input);
+
+/* Copies the state from the start of the given frame. Returns 0 if that
+   frame is no longer, or not yet, in the history. */
+int load_game_state(const GameStateHistory* history, unsigned int frame, GameState* state);
+
+/* Returns the input recorded for the given frame, or NULL if it's not in the history. */
+const GameInput* get_recorded_input(const GameStateHistory* history, unsigned int frame);
+
+/* Replaces the input recorded for an earlier frame, for example once the
+   real input of a remote player arrives. Returns 0 if the frame is not in
+   the history. Takes effect on the next rollback_game_state(). */
+int set_recorded_input(GameStateHistory* history, unsigned int frame, const GameInput* input);
+
+/* Restores the state from the start of an earlier frame and re-simulates
+   from there up to the current frame with the recorded inputs. Returns the
+   number of frames re-simulated, which is zero for the current frame, or -1
+   if the frame is more than MAX_ROLLBACK_FRAMES old or not in the history. */
+int rollback_game_state(GameStateHistory* history, GameState* state, unsigned int frame);
@@ -1,3 +1,4 @@
+#pragma once
 #include "linmath.h"
 #include <math.h>
 
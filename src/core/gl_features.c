@@ -0,0 +1,49 @@
+#include "gl_features.h"
+#include "platform_gl.h"
+#include "platform_log.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TAG "gl_features"
+
+static GlFeatures features = {2, 0, 0, 0, 0, 0};
+
+void detect_gl_features() {
+	memset(&features, 0, sizeof(features));
+	features.major_version = 2;
+
+	// OpenGL ES contexts, WebGL included, report "OpenGL ES major.minor",
+	// followed by anything the vendor likes.
+	const char* version = (const char*) glGetString(GL_VERSION);
+	if (version != NULL) {
+		const char* numbers = strstr(version, "OpenGL ES ");
+		if (numbers == NULL || sscanf(numbers, "OpenGL ES %d.%d", &features.major_version, &features.minor_version) != 2) {
+			features.major_version = 2;
+			features.minor_version = 0;
+		}
+		features.is_webgl = strstr(version, "WebGL") != NULL;
+	}
+
+#if HAVE_GLES3_HEADERS
+	int is_gles3 = features.major_version >= 3;
+#if defined(PLATFORM_LOADS_GLES3_FUNCTIONS)
+	// Linked against ES 2, the platform looks up the ES 3 functions itself.
+	if (is_gles3 && !load_gles3_functions()) {
+		DEBUG_LOG_WRITE_W(TAG, "Some OpenGL ES 3.0 functions are missing; using OpenGL ES 2.0");
+		is_gles3 = 0;
+	}
+#endif
+	features.has_uniform_buffers = is_gles3;
+	features.has_buffer_mapping = is_gles3 && !features.is_webgl;
+	features.has_pixel_pack_buffers = is_gles3 && !features.is_webgl;
+#endif
+
+	DEBUG_LOG_PRINT_D(TAG, "%s: uniform buffers %s, buffer mapping %s, pixel pack buffers %s",
+		version != NULL ? version : "unknown version",
+		features.has_uniform_buffers ? "on" : "off", features.has_buffer_mapping ? "on" : "off",
+		features.has_pixel_pack_buffers ? "on" : "off");
+}
+
+const GlFeatures* get_gl_features() {
+	return &features;
+}
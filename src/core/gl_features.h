@@ -0,0 +1,37 @@
+#pragma once
+#include "platform_gl.h"
+
+/* What the context can do beyond OpenGL ES 2.0.
+
+   Code for OpenGL ES 3 is only built where platform_gl.h declares it, and
+   then only used if the context that was actually created is version 3 or
+   later. The same build can get either, such as on a phone without ES 3
+   drivers, or in a browser without WebGL 2.
+
+   Only the thread that owns the GL context should call these. */
+
+#if defined(GL_ES_VERSION_3_0)
+#define HAVE_GLES3_HEADERS 1
+#else
+#define HAVE_GLES3_HEADERS 0
+#endif
+
+typedef struct {
+	int major_version;
+	int minor_version;
+	int is_webgl;
+	// Uniform blocks, backed by ranges of uniform buffers.
+	int has_uniform_buffers;
+	// glMapBufferRange() and fences. WebGL 2 can't map buffers, and
+	// Emscripten only emulates it with a copy, so there it's left out.
+	int has_buffer_mapping;
+	// glReadPixels() into a buffer, which is mapped later to read it back.
+	int has_pixel_pack_buffers;
+} GlFeatures;
+
+/* Reads the version of the current context. Call it once a context has been
+   made current, before anything that depends on it is created. */
+void detect_gl_features();
+
+/* Until detect_gl_features() is called, everything beyond OpenGL ES 2.0 is off. */
+const GlFeatures* get_gl_features();
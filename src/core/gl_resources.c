@@ -0,0 +1,175 @@
+#include "gl_resources.h"
+#include "platform_gl.h"
+#include "platform_log.h"
+#include "telemetry.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "gl_resources"
+
+typedef struct {
+	GLuint name;
+	GlResourceType type;
+	long long bytes;
+	const char* file;
+	int line;
+	char label[48];
+} GlResource;
+
+static const char* const type_names[GL_RESOURCE_TYPE_COUNT] = {
+	"buffer", "texture", "renderbuffer", "framebuffer", "shader", "program",
+};
+
+static GlResource* resources;
+static int resource_count;
+static int resource_capacity;
+static GlResourceStats stats;
+
+static int find_resource(GlResourceType type, GLuint name) {
+	int i;
+	for (i = 0; i < resource_count; i++) {
+		if (resources[i].name == name && resources[i].type == type)
+			return i;
+	}
+	return -1;
+}
+
+static void update_telemetry() {
+	set_gpu_memory_telemetry(
+		stats.live_bytes[GL_RESOURCE_TEXTURE] + stats.live_bytes[GL_RESOURCE_RENDERBUFFER],
+		stats.live_bytes[GL_RESOURCE_BUFFER], resource_count);
+}
+
+static void remove_resource(int index) {
+	const GlResource* resource = &resources[index];
+	stats.live_objects[resource->type]--;
+	stats.live_bytes[resource->type] -= resource->bytes;
+	stats.bytes_in_use -= resource->bytes;
+	resources[index] = resources[--resource_count];
+}
+
+static const char* get_site(const GlResource* resource, char* buffer, size_t size) {
+	if (resource->label[0] != '\0')
+		return resource->label;
+	snprintf(buffer, size, "%s:%d", resource->file, resource->line);
+	return buffer;
+}
+
+static GLboolean is_in_current_context(const GlResource* resource) {
+	switch (resource->type) {
+		case GL_RESOURCE_BUFFER: return glIsBuffer(resource->name);
+		case GL_RESOURCE_TEXTURE: return glIsTexture(resource->name);
+		case GL_RESOURCE_RENDERBUFFER: return glIsRenderbuffer(resource->name);
+		case GL_RESOURCE_FRAMEBUFFER: return glIsFramebuffer(resource->name);
+		case GL_RESOURCE_SHADER: return glIsShader(resource->name);
+		case GL_RESOURCE_PROGRAM: return glIsProgram(resource->name);
+		default: return GL_FALSE;
+	}
+}
+
+void track_gl_resource_at(GlResourceType type, GLuint name, long long bytes, const char* file, int line) {
+	assert(type >= 0 && type < GL_RESOURCE_TYPE_COUNT);
+	assert(name != 0);
+	assert(bytes >= 0);
+	assert(find_resource(type, name) < 0);
+
+	if (resource_count == resource_capacity) {
+		resource_capacity = resource_capacity ? resource_capacity * 2 : 32;
+		resources = realloc(resources, resource_capacity * sizeof(GlResource));
+		assert(resources != NULL);
+	}
+	resources[resource_count++] = (GlResource) {name, type, bytes, file, line, {0}};
+
+	stats.live_objects[type]++;
+	stats.live_bytes[type] += bytes;
+	stats.bytes_in_use += bytes;
+	if (stats.bytes_in_use > stats.peak_bytes_in_use)
+		stats.peak_bytes_in_use = stats.bytes_in_use;
+
+	if (stats.budget_bytes > 0 && bytes > 0 && stats.bytes_in_use > stats.budget_bytes) {
+		stats.objects_over_budget++;
+		DEBUG_LOG_PRINT_W(TAG, "A %s of %lld bytes from %s:%d takes GPU memory to %lld bytes, over the budget of %lld",
+			type_names[type], bytes, file, line, stats.bytes_in_use, stats.budget_bytes);
+	}
+	update_telemetry();
+}
+
+void label_gl_resource(GlResourceType type, GLuint name, const char* label) {
+	assert(label != NULL);
+	const int index = find_resource(type, name);
+	assert(index >= 0);
+	strncpy(resources[index].label, label, sizeof(resources[index].label) - 1);
+	resources[index].label[sizeof(resources[index].label) - 1] = '\0';
+}
+
+int untrack_gl_resource(GlResourceType type, GLuint name) {
+	const int index = find_resource(type, name);
+	if (index < 0)
+		return 0;
+	remove_resource(index);
+	update_telemetry();
+	return 1;
+}
+
+int forget_lost_gl_resources() {
+	int lost = 0;
+	int i = 0;
+	while (i < resource_count) {
+		if (is_in_current_context(&resources[i])) {
+			i++;
+		} else {
+			remove_resource(i);
+			lost++;
+		}
+	}
+	stats.objects_lost += lost;
+	update_telemetry();
+	return lost;
+}
+
+void set_gl_memory_budget(long long bytes) {
+	assert(bytes >= 0);
+	stats.budget_bytes = bytes;
+}
+
+int fits_in_gl_memory_budget(long long bytes) {
+	return stats.budget_bytes == 0 || stats.bytes_in_use + bytes <= stats.budget_bytes;
+}
+
+GlResourceStats get_gl_resource_stats() {
+	return stats;
+}
+
+void log_gl_resources(int as_leaks) {
+	if (!LOGGING_ON)
+		return;
+
+	if (as_leaks && resource_count == 0) {
+		DEBUG_LOG_WRITE_D(TAG, "No GL objects were leaked");
+		return;
+	}
+
+	DEBUG_LOG_PRINT_D(TAG, "%d GL objects %s, taking %lld bytes; at most %lld were in use%s",
+		resource_count, as_leaks ? "were leaked" : "are live", stats.bytes_in_use, stats.peak_bytes_in_use,
+		stats.objects_over_budget > 0 ? ", which went over budget" : "");
+	int type;
+	for (type = 0; type < GL_RESOURCE_TYPE_COUNT; type++) {
+		if (stats.live_objects[type] > 0)
+			DEBUG_LOG_PRINT_D(TAG, "  %d %ss, %lld bytes", stats.live_objects[type], type_names[type], stats.live_bytes[type]);
+	}
+
+	int i;
+	for (i = 0; i < resource_count; i++) {
+		char site[64];
+		const GlResource* resource = &resources[i];
+		if (as_leaks) {
+			DEBUG_LOG_PRINT_W(TAG, "Leaked %s %u, %lld bytes, from %s",
+				type_names[resource->type], resource->name, resource->bytes, get_site(resource, site, sizeof(site)));
+		} else {
+			DEBUG_LOG_PRINT_D(TAG, "  %s %u, %lld bytes, from %s",
+				type_names[resource->type], resource->name, resource->bytes, get_site(resource, site, sizeof(site)));
+		}
+	}
+}
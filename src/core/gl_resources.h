@@ -0,0 +1,62 @@
+#pragma once
+#include "platform_gl.h"
+
+/* Keeps track of every GL object the game creates, with roughly how much GPU
+   memory it takes and where it came from, so that nothing outlives the
+   surface it was made for without anyone noticing.
+
+   Objects are tracked where they're created, by the file and line, and whoever
+   knows what one is for can label it, like with an asset's path. Deleting
+   one through untrack_gl_resource() first makes sure that it was tracked, so
+   that objects that went with a lost context are never deleted in the new one.
+
+   There's an optional budget for GPU memory. Going over it is only logged,
+   since there's nothing else to do about assets the game can't do without,
+   but optional allocations, like render targets, can check before they're made.
+
+   Only the thread that owns the GL context should call these. */
+
+typedef enum {
+	GL_RESOURCE_BUFFER,
+	GL_RESOURCE_TEXTURE,
+	GL_RESOURCE_RENDERBUFFER,
+	GL_RESOURCE_FRAMEBUFFER,
+	GL_RESOURCE_SHADER,
+	GL_RESOURCE_PROGRAM,
+	GL_RESOURCE_TYPE_COUNT,
+} GlResourceType;
+
+typedef struct {
+	int live_objects[GL_RESOURCE_TYPE_COUNT];
+	long long live_bytes[GL_RESOURCE_TYPE_COUNT];
+	long long bytes_in_use;
+	long long peak_bytes_in_use;
+	long long budget_bytes;
+	// Objects whose creation took the total over the budget.
+	int objects_over_budget;
+	// Objects that were forgotten because their context went away.
+	int objects_lost;
+} GlResourceStats;
+
+#define track_gl_resource(type, name, bytes) track_gl_resource_at((type), (name), (bytes), __FILE__, __LINE__)
+void track_gl_resource_at(GlResourceType type, GLuint name, long long bytes, const char* file, int line);
+
+/* Replaces the file and line in reports; the label is copied. */
+void label_gl_resource(GlResourceType type, GLuint name, const char* label);
+
+/* Returns zero if the object isn't tracked, in which case it shouldn't be
+   deleted either. */
+int untrack_gl_resource(GlResourceType type, GLuint name);
+
+/* Forgets every object that the current context doesn't know about, since
+   they went with an earlier context. Returns how many there were. */
+int forget_lost_gl_resources();
+
+/* Zero for no budget. */
+void set_gl_memory_budget(long long bytes);
+int fits_in_gl_memory_budget(long long bytes);
+
+GlResourceStats get_gl_resource_stats();
+
+/* Logs what's live, by type and then object by object, as leaks if asked. */
+void log_gl_resources(int as_leaks);
@@ -1,10 +1,71 @@
 #include "image.h"
+#include "macros.h"
 #include "platform_log.h"
+#include "qoi.h"
 #include <assert.h>
-#include <png.h>
+#include <limits.h>
 #include <string.h>
-#include <stdlib.h>
 
+#if USE_PNG_DECODER
+#include <png.h>
+
+static const unsigned char png_magic[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+#endif
+
+static ImageDecoder decoders[MAX_IMAGE_DECODERS] = {
+#if USE_PNG_DECODER
+	{"PNG", png_magic, sizeof(png_magic), get_raw_image_data_from_png},
+#endif
+	{"QOI", qoi_magic, sizeof(qoi_magic), get_raw_image_data_from_qoi},
+};
+static int decoder_count = 1 + USE_PNG_DECODER;
+
+void register_image_decoder(const ImageDecoder* decoder) {
+	assert(decoder != NULL && decoder->decode != NULL);
+	assert(decoder->magic != NULL && decoder->magic_length > 0);
+	assert(decoder_count < MAX_IMAGE_DECODERS);
+	decoders[decoder_count++] = *decoder;
+}
+
+const ImageDecoder* find_image_decoder(const void* data, const int data_size) {
+	assert(data != NULL);
+	int i;
+	for (i = decoder_count - 1; i >= 0; i--) {
+		const ImageDecoder* decoder = &decoders[i];
+		if (data_size >= decoder->magic_length && memcmp(data, decoder->magic, decoder->magic_length) == 0)
+			return decoder;
+	}
+	return NULL;
+}
+
+RawImageData get_raw_image_data(const void* data, const int data_size, Arena* arena) {
+	const ImageDecoder* decoder = find_image_decoder(data, data_size);
+	if (decoder == NULL) {
+		CRASH("No decoder for this image format!");
+	}
+	return decoder->decode(data, data_size, arena);
+}
+
+RawImageData get_raw_image_data_from_qoi(const void* qoi_data, const int qoi_data_size, Arena* arena) {
+	assert(qoi_data != NULL && qoi_data_size > 0);
+	assert(arena != NULL);
+
+	QoiHeader header;
+	if (!parse_qoi_header(qoi_data, qoi_data_size, &header)) {
+		CRASH("Invalid QOI header!");
+	}
+
+	const size_t size = (size_t) header.width * header.height * 4;
+	assert(size <= INT_MAX);
+	uint8_t* pixels = allocate_from_arena(arena, size);
+	if (!decode_qoi_pixels(qoi_data, qoi_data_size, &header, pixels)) {
+		CRASH("Error reading QOI file!");
+	}
+
+	return (RawImageData) {header.width, header.height, (int) size, GL_RGBA, pixels};
+}
+
+#if USE_PNG_DECODER
 typedef struct {
 	const png_byte* data;
 	const png_size_t size;
@@ -21,18 +82,23 @@ typedef struct {
 	const int color_type;
 } PngInfo;
 
+static png_voidp allocate_png_memory(png_structp png_ptr, png_alloc_size_t size);
+static void free_png_memory(png_structp png_ptr, png_voidp ptr);
 static void read_png_data_callback(
 	png_structp png_ptr, png_byte* png_data, png_size_t read_length);
 static PngInfo read_and_update_info(const png_structp png_ptr, const png_infop info_ptr);
 static DataHandle read_entire_png_image(
-	const png_structp png_ptr, const png_infop info_ptr, const png_uint_32 height);
+	const png_structp png_ptr, const png_infop info_ptr, const png_uint_32 height, Arena* arena);
 static GLenum get_gl_color_format(const int png_color_format);
 
-RawImageData get_raw_image_data_from_png(const void* png_data, const int png_data_size) {
+RawImageData get_raw_image_data_from_png(const void* png_data, const int png_data_size, Arena* arena) {
 	assert(png_data != NULL && png_data_size > 8);
 	assert(png_check_sig((void*)png_data, 8));
+	assert(arena != NULL);
 
-	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	// Everything libpng allocates while decoding comes from the arena as well.
+	png_structp png_ptr = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL,
+		arena, allocate_png_memory, free_png_memory);
 	assert(png_ptr != NULL);
 	png_infop info_ptr = png_create_info_struct(png_ptr);
 	assert(info_ptr != NULL);
@@ -45,7 +111,7 @@ RawImageData get_raw_image_data_from_png(const void* png_data, const int png_dat
 	}
 
 	const PngInfo png_info = read_and_update_info(png_ptr, info_ptr);
-	const DataHandle raw_image = read_entire_png_image(png_ptr, info_ptr, png_info.height);
+	const DataHandle raw_image = read_entire_png_image(png_ptr, info_ptr, png_info.height, arena);
 
 	png_read_end(png_ptr, info_ptr);
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
@@ -58,9 +124,14 @@ RawImageData get_raw_image_data_from_png(const void* png_data, const int png_dat
         raw_image.data};
 }
 
-void release_raw_image_data(const RawImageData* data) {
-	assert(data != NULL);
-	free((void*)data->data);
+static png_voidp allocate_png_memory(png_structp png_ptr, png_alloc_size_t size) {
+	return allocate_from_arena(png_get_mem_ptr(png_ptr), size);
+}
+
+static void free_png_memory(png_structp png_ptr, png_voidp ptr) {
+	// Released along with the rest of the arena.
+	UNUSED(png_ptr);
+	UNUSED(ptr);
 }
 
 static void read_png_data_callback(png_structp png_ptr, png_byte* raw_data, png_size_t read_length) {
@@ -108,15 +179,14 @@ static PngInfo read_and_update_info(const png_structp png_ptr, const png_infop i
 	return (PngInfo) {width, height, color_type};
 }
 
-static DataHandle read_entire_png_image(const png_structp png_ptr, const png_infop info_ptr, const png_uint_32 height) {
+static DataHandle read_entire_png_image(
+	const png_structp png_ptr, const png_infop info_ptr, const png_uint_32 height, Arena* arena) {
 	const png_size_t row_size = png_get_rowbytes(png_ptr, info_ptr);
 	const int data_length = row_size * height;
 	assert(row_size > 0);
 
-	png_byte* raw_image = malloc(data_length);
-	assert(raw_image != NULL);
-
-	png_byte* row_ptrs[height];
+	png_byte* raw_image = allocate_from_arena(arena, data_length);
+	png_byte** row_ptrs = allocate_from_arena(arena, height * sizeof(png_byte*));
 
 	png_uint_32 i;
 	for (i = 0; i < height; i++) {
@@ -144,3 +214,4 @@ static GLenum get_gl_color_format(const int png_color_format) {
 
 	return 0;
 }
+#endif
@@ -1,3 +1,5 @@
+#pragma once
+#include "arena.h"
 #include "platform_gl.h"
 
 typedef struct {
@@ -8,6 +10,38 @@ typedef struct {
 	const void* data;
 } RawImageData;
 
-/* Returns the decoded image data, or aborts if there's an error during decoding. */
-RawImageData get_raw_image_data_from_png(const void* png_data, const int png_data_size);
-void release_raw_image_data(const RawImageData* data);
+// Builds without libpng, like the web build, can only decode QOI images.
+#ifndef USE_PNG_DECODER
+#define USE_PNG_DECODER 1
+#endif
+
+#define MAX_IMAGE_DECODERS 8
+
+/* Decoders return the decoded image data, allocated from the arena, or abort
+   if there's an error during decoding. */
+typedef RawImageData (*DecodeImage)(const void* data, const int data_size, Arena* arena);
+
+typedef struct {
+	const char* name;
+	// Files that start with these bytes go to this decoder.
+	const unsigned char* magic;
+	int magic_length;
+	DecodeImage decode;
+} ImageDecoder;
+
+/* Adds a decoder for another format. Decoders registered later are tried
+   first, so they can also take over a built-in format. */
+void register_image_decoder(const ImageDecoder* decoder);
+
+/* Returns NULL if no decoder knows the file's magic. */
+const ImageDecoder* find_image_decoder(const void* data, const int data_size);
+
+/* Decodes the image with whichever decoder knows its format, or aborts if
+   none does. */
+RawImageData get_raw_image_data(const void* data, const int data_size, Arena* arena);
+
+#if USE_PNG_DECODER
+RawImageData get_raw_image_data_from_png(const void* png_data, const int png_data_size, Arena* arena);
+#endif
+/* Always decodes to RGBA. */
+RawImageData get_raw_image_data_from_qoi(const void* qoi_data, const int qoi_data_size, Arena* arena);
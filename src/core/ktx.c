@@ -0,0 +1,75 @@
+#include "ktx.h"
+#include "platform_gl.h"
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+	uint8_t identifier[12];
+	uint32_t endianness;
+	uint32_t gl_type;
+	uint32_t gl_type_size;
+	uint32_t gl_format;
+	uint32_t gl_internal_format;
+	uint32_t gl_base_internal_format;
+	uint32_t pixel_width;
+	uint32_t pixel_height;
+	uint32_t pixel_depth;
+	uint32_t number_of_array_elements;
+	uint32_t number_of_faces;
+	uint32_t number_of_mipmap_levels;
+	uint32_t bytes_of_key_value_data;
+} KtxHeader;
+
+static const uint8_t ktx_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+static const uint32_t native_endianness = 0x04030201;
+
+int parse_ktx_image(const void* data, size_t data_length, KtxImage* image) {
+	assert(data != NULL);
+	assert(image != NULL);
+
+	KtxHeader header;
+	if (data_length < sizeof(header))
+		return 0;
+	memcpy(&header, data, sizeof(header));
+
+	// Files from the texture encoder are always in native byte order, so
+	// swapping isn't supported; neither are arrays, cube maps or 3D textures.
+	if (memcmp(header.identifier, ktx_identifier, sizeof(ktx_identifier)) != 0
+		|| header.endianness != native_endianness
+		|| header.gl_type != 0 || header.gl_format != 0
+		|| header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth != 0
+		|| header.number_of_array_elements != 0 || header.number_of_faces != 1
+		|| header.number_of_mipmap_levels > KTX_MAX_LEVELS)
+		return 0;
+
+	image->internal_format = header.gl_internal_format;
+	image->width = (GLsizei) header.pixel_width;
+	image->height = (GLsizei) header.pixel_height;
+	image->level_count = header.number_of_mipmap_levels > 0 ? (int) header.number_of_mipmap_levels : 1;
+
+	const uint8_t* bytes = data;
+	size_t offset = sizeof(header) + header.bytes_of_key_value_data;
+	int level;
+
+	for (level = 0; level < image->level_count; level++) {
+		uint32_t image_size;
+		if (offset + sizeof(image_size) > data_length)
+			return 0;
+		memcpy(&image_size, bytes + offset, sizeof(image_size));
+		offset += sizeof(image_size);
+		if (image_size > data_length - offset)
+			return 0;
+
+		CompressedTextureLevel* image_level = &image->levels[level];
+		image_level->width = image->width >> level > 0 ? image->width >> level : 1;
+		image_level->height = image->height >> level > 0 ? image->height >> level : 1;
+		image_level->size = (GLsizei) image_size;
+		image_level->data = bytes + offset;
+
+		// Each level is padded to a multiple of four bytes.
+		offset += (image_size + 3) & ~(size_t) 3;
+	}
+
+	return 1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "platform_gl.h"
+#include "texture.h"
+#include <stddef.h>
+
+#define KTX_MAX_LEVELS 16
+
+typedef struct {
+	GLenum internal_format;
+	GLsizei width;
+	GLsizei height;
+	int level_count;
+	CompressedTextureLevel levels[KTX_MAX_LEVELS];
+} KtxImage;
+
+/* Reads a compressed 2D texture from a KTX 1.1 file in memory. The levels point
+   into the file's data, so it has to stay around until they're uploaded.
+   Returns 0 if the file is anything else. */
+int parse_ktx_image(const void* data, size_t data_length, KtxImage* image);
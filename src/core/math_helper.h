@@ -1,5 +1,10 @@
+#pragma once
 #include <math.h>
 
 static inline float deg_to_radf(float deg) {
 	return deg * (float)M_PI / 180.0f;
 }
+
+static inline float clamp(float value, float min, float max) {
+	return fmin(max, fmax(value, min));
+}
@@ -0,0 +1,141 @@
+#include "particles.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// How much of its velocity a particle keeps from one frame to the next.
+static const float particle_drag = 0.95f;
+
+static inline int round_up_to_four(int value) {
+	return (value + 3) & ~3;
+}
+
+static float next_random(ParticleSystem* particles) {
+	particles->random_state = particles->random_state * 1664525u + 1013904223u;
+	return (float) (particles->random_state >> 8) / 16777216.0f;
+}
+
+void init_particle_system(ParticleSystem* particles) {
+	assert(particles != NULL);
+	memset(particles, 0, sizeof(ParticleSystem));
+	particles->random_state = 1;
+}
+
+void emit_particles(ParticleSystem* particles, float x, float z, int count, float speed, int lifetime_in_frames) {
+	assert(particles != NULL);
+	assert(lifetime_in_frames > 0);
+
+	int i;
+	for (i = 0; i < count && particles->count < MAX_PARTICLES; i++) {
+		const int particle = particles->count++;
+		const float angle = next_random(particles) * (float) M_PI * 2.0f;
+		const float particle_speed = speed * (0.25f + 0.75f * next_random(particles));
+
+		particles->x[particle] = x;
+		particles->z[particle] = z;
+		particles->velocity_x[particle] = cosf(angle) * particle_speed;
+		particles->velocity_z[particle] = sinf(angle) * particle_speed;
+		particles->life[particle] = 1.0f;
+		particles->fade_per_frame[particle] = 1.0f / (lifetime_in_frames * (0.5f + 0.5f * next_random(particles)));
+	}
+}
+
+void update_particles(ParticleSystem* particles) {
+	assert(particles != NULL);
+	int i;
+
+	// The arrays are sized in multiples of four, so the last group can run
+	// past the count into particles that aren't alive.
+#if defined(__SSE2__)
+	const __m128 drag = _mm_set1_ps(particle_drag);
+	for (i = 0; i < particles->count; i += 4) {
+		const __m128 velocity_x = _mm_load_ps(particles->velocity_x + i);
+		const __m128 velocity_z = _mm_load_ps(particles->velocity_z + i);
+		_mm_store_ps(particles->x + i, _mm_add_ps(_mm_load_ps(particles->x + i), velocity_x));
+		_mm_store_ps(particles->z + i, _mm_add_ps(_mm_load_ps(particles->z + i), velocity_z));
+		_mm_store_ps(particles->velocity_x + i, _mm_mul_ps(velocity_x, drag));
+		_mm_store_ps(particles->velocity_z + i, _mm_mul_ps(velocity_z, drag));
+		_mm_store_ps(particles->life + i,
+			_mm_sub_ps(_mm_load_ps(particles->life + i), _mm_load_ps(particles->fade_per_frame + i)));
+	}
+#else
+	for (i = 0; i < particles->count; i++) {
+		particles->x[i] += particles->velocity_x[i];
+		particles->z[i] += particles->velocity_z[i];
+		particles->velocity_x[i] *= particle_drag;
+		particles->velocity_z[i] *= particle_drag;
+		particles->life[i] -= particles->fade_per_frame[i];
+	}
+#endif
+
+	// Faded particles are replaced by the last one, keeping the arrays packed.
+	for (i = 0; i < particles->count; ) {
+		if (particles->life[i] > 0.0f) {
+			i++;
+			continue;
+		}
+
+		const int last = --particles->count;
+		particles->x[i] = particles->x[last];
+		particles->z[i] = particles->z[last];
+		particles->velocity_x[i] = particles->velocity_x[last];
+		particles->velocity_z[i] = particles->velocity_z[last];
+		particles->life[i] = particles->life[last];
+		particles->fade_per_frame[i] = particles->fade_per_frame[last];
+	}
+}
+
+int get_particle_vertex_buffer_size(const ParticleSystem* particles) {
+	assert(particles != NULL);
+	return round_up_to_four(particles->count) * VERTICES_PER_PARTICLE * COMPONENTS_PER_PARTICLE_VERTEX * (int) sizeof(float);
+}
+
+int write_particle_vertices(const ParticleSystem* particles, float size, float* out) {
+	assert(particles != NULL);
+	assert(out != NULL);
+
+	// An equilateral triangle around each particle, with the table's Y
+	// running against the world's Z.
+	static const float offsets[VERTICES_PER_PARTICLE][2] = {
+		{-1.0f, -0.57735f}, {1.0f, -0.57735f}, {0.0f, 1.1547f}};
+	const int floats_per_particle = VERTICES_PER_PARTICLE * COMPONENTS_PER_PARTICLE_VERTEX;
+	int i, vertex;
+
+#if defined(__SSE2__)
+	// Builds each corner for four particles at once, then pairs up X and Y and
+	// stores them to where each particle's corner goes.
+	const __m128 scale = _mm_set1_ps(size);
+	for (i = 0; i < particles->count; i += 4) {
+		const __m128 x = _mm_load_ps(particles->x + i);
+		const __m128 y = _mm_sub_ps(_mm_setzero_ps(), _mm_load_ps(particles->z + i));
+		const __m128 particle_size = _mm_mul_ps(_mm_load_ps(particles->life + i), scale);
+		float* particle_out = out + i * floats_per_particle;
+
+		for (vertex = 0; vertex < VERTICES_PER_PARTICLE; vertex++) {
+			const __m128 corner_x = _mm_add_ps(x, _mm_mul_ps(particle_size, _mm_set1_ps(offsets[vertex][0])));
+			const __m128 corner_y = _mm_add_ps(y, _mm_mul_ps(particle_size, _mm_set1_ps(offsets[vertex][1])));
+			const __m128 first_pair = _mm_unpacklo_ps(corner_x, corner_y);
+			const __m128 second_pair = _mm_unpackhi_ps(corner_x, corner_y);
+			float* corner_out = particle_out + vertex * COMPONENTS_PER_PARTICLE_VERTEX;
+
+			_mm_storel_pi((__m64*) corner_out, first_pair);
+			_mm_storeh_pi((__m64*) (corner_out + floats_per_particle), first_pair);
+			_mm_storel_pi((__m64*) (corner_out + 2 * floats_per_particle), second_pair);
+			_mm_storeh_pi((__m64*) (corner_out + 3 * floats_per_particle), second_pair);
+		}
+	}
+#else
+	for (i = 0; i < particles->count; i++) {
+		const float particle_size = particles->life[i] * size;
+		for (vertex = 0; vertex < VERTICES_PER_PARTICLE; vertex++) {
+			out[i * floats_per_particle + vertex * 2] = particles->x[i] + particle_size * offsets[vertex][0];
+			out[i * floats_per_particle + vertex * 2 + 1] = -particles->z[i] + particle_size * offsets[vertex][1];
+		}
+	}
+#endif
+
+	return particles->count * VERTICES_PER_PARTICLE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "platform_macros.h"
+
+/* Sparks that fly across the table from where the puck is struck, and a
+   trail behind it. Particles only live on the table's surface, so each is a
+   position and velocity in X and Z, kept one array per field so the update
+   and vertex generation can work on four particles at a time. */
+
+#define MAX_PARTICLES 4096
+#define VERTICES_PER_PARTICLE 3
+// Each vertex is X and Z on the table, drawn as X and Y with the table's rotation.
+#define COMPONENTS_PER_PARTICLE_VERTEX 2
+
+typedef struct {
+	float x[MAX_PARTICLES] ALIGN_ATTRIBUTE(16);
+	float z[MAX_PARTICLES] ALIGN_ATTRIBUTE(16);
+	float velocity_x[MAX_PARTICLES] ALIGN_ATTRIBUTE(16);
+	float velocity_z[MAX_PARTICLES] ALIGN_ATTRIBUTE(16);
+	// Starts at one and fades to zero, shrinking the particle as it goes.
+	float life[MAX_PARTICLES] ALIGN_ATTRIBUTE(16);
+	float fade_per_frame[MAX_PARTICLES] ALIGN_ATTRIBUTE(16);
+	int count;
+	unsigned int random_state;
+} ParticleSystem;
+
+void init_particle_system(ParticleSystem* particles);
+
+/* Sends particles out in every direction at up to the given speed per frame.
+   Once the system is full, new particles are dropped. */
+void emit_particles(ParticleSystem* particles, float x, float z, int count, float speed, int lifetime_in_frames);
+
+/* Moves every particle by one frame, and removes the ones that have faded out. */
+void update_particles(ParticleSystem* particles);
+
+/* The space write_particle_vertices() needs, which can be a little more than
+   the vertices it writes. */
+int get_particle_vertex_buffer_size(const ParticleSystem* particles);
+
+/* Writes a triangle per particle, flat on the table. Returns the number of vertices. */
+int write_particle_vertices(const ParticleSystem* particles, float size, float* out);
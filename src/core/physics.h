@@ -0,0 +1,98 @@
+#pragma once
+#include "linmath.h"
+#include "math_helper.h"
+#include "table_sdf.h"
+
+// How much of its vector the puck keeps from one frame to the next.
+static const float puck_friction = 0.99f;
+
+typedef struct {
+	float left;
+	float right;
+	float far;
+	float near;
+} TableBounds;
+
+/* Advances the puck by one frame: it moves by its vector, bounces off the
+   sides of the table while losing some energy, and is slowed by friction.
+   Returns non-zero if the puck struck a side during this frame. */
+static inline int advance_puck(vec3 position, vec3 vector, const TableBounds* bounds, float puck_radius) {
+	int struck_side = 0;
+
+	// Translate the puck by its vector
+	vec3_add(position, position, vector);
+
+	// If the puck struck a side, reflect it off that side.
+	if (position[0] < bounds->left + puck_radius
+	 || position[0] > bounds->right - puck_radius) {
+		vector[0] = -vector[0];
+		vec3_scale(vector, vector, 0.9f);
+		struck_side = 1;
+	}
+	if (position[2] < bounds->far + puck_radius
+	 || position[2] > bounds->near - puck_radius) {
+		vector[2] = -vector[2];
+		vec3_scale(vector, vector, 0.9f);
+		struck_side = 1;
+	}
+
+	// Clamp the puck position.
+	position[0] = clamp(position[0], bounds->left + puck_radius, bounds->right - puck_radius);
+	position[2] = clamp(position[2], bounds->far + puck_radius, bounds->near - puck_radius);
+
+	// Friction factor
+	vec3_scale(vector, vector, puck_friction);
+
+	return struck_side;
+}
+
+/* Pushes a circle out of the wall it overlaps most, if any, along the wall's
+   normal, which it writes out. Returns non-zero if it pushed the circle. In a
+   corner, a second push gets it out of the other wall. */
+static inline int push_circle_out_of_wall(const TableSdf* table, vec3 position, float radius, float* normal) {
+	const float distance = sample_table_sdf(table, position[0], position[2], normal);
+	if (distance >= radius)
+		return 0;
+
+	position[0] += normal[0] * (radius - distance);
+	position[2] += normal[1] * (radius - distance);
+	return 1;
+}
+
+/* Like advance_puck(), on a table of any shape: the puck bounces off
+   whichever wall it runs into, along that wall's normal. A puck that moves
+   further than its radius in a frame is moved in steps no longer than that,
+   so that it can't pass through a thin wall or obstacle between two of them. */
+static inline int advance_puck_on_table(vec3 position, vec3 vector, const TableSdf* table, float puck_radius) {
+	int struck_side = 0;
+
+	const float distance = sqrtf(vector[0] * vector[0] + vector[2] * vector[2]);
+	const int step_count = distance > puck_radius ? (int) ceilf(distance / puck_radius) : 1;
+	int step;
+	for (step = 0; step < step_count; step++) {
+		// A bounce turns the rest of the frame's movement around with it.
+		vec3 step_vector;
+		vec3_scale(step_vector, vector, 1.0f / (float) step_count);
+		vec3_add(position, position, step_vector);
+
+		int i;
+		for (i = 0; i < 2; i++) {
+			float normal[2];
+			if (!push_circle_out_of_wall(table, position, puck_radius, normal))
+				break;
+
+			// Only bounce if it's still heading into the wall.
+			const float speed_into_wall = vector[0] * normal[0] + vector[2] * normal[1];
+			if (speed_into_wall < 0.0f) {
+				vector[0] -= 2.0f * speed_into_wall * normal[0];
+				vector[2] -= 2.0f * speed_into_wall * normal[1];
+				vec3_scale(vector, vector, 0.9f);
+				struck_side = 1;
+			}
+		}
+	}
+
+	vec3_scale(vector, vector, puck_friction);
+
+	return struck_side;
+}
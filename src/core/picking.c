@@ -0,0 +1,243 @@
+#include "picking.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void unproject_touches(const Camera* camera, const TouchPoint* touches, int touch_count, RayBatch* rays) {
+	assert(camera != NULL);
+	assert(touches != NULL || touch_count == 0);
+	assert(touch_count >= 0 && touch_count <= MAX_PICK_TOUCHES);
+	assert(rays != NULL);
+
+	// As in convert_normalized_2D_point_to_ray(), each touch goes through the
+	// inverted matrix at the near and far planes, where Z is -1 and 1, so
+	// each component is the same sum of X and Y plus a constant for either
+	// plane. Rows are the components, and columns are X, Y and the two constants.
+	const float (*m)[4] = (const float (*)[4]) camera->inverted_view_projection_matrix;
+	float terms[4][4];
+	int i, component;
+	for (component = 0; component < 4; component++) {
+		terms[component][0] = m[0][component];
+		terms[component][1] = m[1][component];
+		terms[component][2] = m[3][component] - m[2][component];
+		terms[component][3] = m[3][component] + m[2][component];
+	}
+
+	// Unused lanes in the last group of four are zeroed, and their results ignored.
+	float x[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16) = {0};
+	float y[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16) = {0};
+	for (i = 0; i < touch_count; i++) {
+		x[i] = touches[i].normalized_x;
+		y[i] = touches[i].normalized_y;
+	}
+	rays->count = touch_count;
+
+#if defined(__SSE2__)
+	for (i = 0; i < touch_count; i += 4) {
+		const __m128 touch_x = _mm_load_ps(x + i);
+		const __m128 touch_y = _mm_load_ps(y + i);
+		__m128 near[4], far[4];
+		for (component = 0; component < 4; component++) {
+			const __m128 shared = _mm_add_ps(_mm_mul_ps(touch_x, _mm_set1_ps(terms[component][0])),
+				_mm_mul_ps(touch_y, _mm_set1_ps(terms[component][1])));
+			near[component] = _mm_add_ps(shared, _mm_set1_ps(terms[component][2]));
+			far[component] = _mm_add_ps(shared, _mm_set1_ps(terms[component][3]));
+		}
+
+		// Undo the perspective divide.
+		const __m128 near_w = near[3], far_w = far[3];
+		for (component = 0; component < 3; component++) {
+			near[component] = _mm_div_ps(near[component], near_w);
+			far[component] = _mm_div_ps(far[component], far_w);
+		}
+
+		const __m128 vector_x = _mm_sub_ps(far[0], near[0]);
+		const __m128 vector_y = _mm_sub_ps(far[1], near[1]);
+		const __m128 vector_z = _mm_sub_ps(far[2], near[2]);
+		const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(vector_x, vector_x), _mm_mul_ps(vector_y, vector_y)), _mm_mul_ps(vector_z, vector_z)));
+		const __m128 inverse_length = _mm_div_ps(_mm_set1_ps(1.0f), length);
+
+		_mm_store_ps(rays->origin_x + i, near[0]);
+		_mm_store_ps(rays->origin_y + i, near[1]);
+		_mm_store_ps(rays->origin_z + i, near[2]);
+		_mm_store_ps(rays->vector_x + i, _mm_mul_ps(vector_x, inverse_length));
+		_mm_store_ps(rays->vector_y + i, _mm_mul_ps(vector_y, inverse_length));
+		_mm_store_ps(rays->vector_z + i, _mm_mul_ps(vector_z, inverse_length));
+	}
+#else
+	for (i = 0; i < touch_count; i++) {
+		float near[4], far[4];
+		for (component = 0; component < 4; component++) {
+			const float shared = x[i] * terms[component][0] + y[i] * terms[component][1];
+			near[component] = shared + terms[component][2];
+			far[component] = shared + terms[component][3];
+		}
+
+		for (component = 0; component < 3; component++) {
+			near[component] /= near[3];
+			far[component] /= far[3];
+		}
+
+		const float vector_x = far[0] - near[0];
+		const float vector_y = far[1] - near[1];
+		const float vector_z = far[2] - near[2];
+		const float inverse_length = 1.0f / sqrtf(vector_x * vector_x + vector_y * vector_y + vector_z * vector_z);
+
+		rays->origin_x[i] = near[0];
+		rays->origin_y[i] = near[1];
+		rays->origin_z[i] = near[2];
+		rays->vector_x[i] = vector_x * inverse_length;
+		rays->vector_y[i] = vector_y * inverse_length;
+		rays->vector_z[i] = vector_z * inverse_length;
+	}
+#endif
+}
+
+void pick_nearest_spheres(const RayBatch* rays, const Sphere* spheres, int sphere_count, PickHit* hits) {
+	assert(rays != NULL);
+	assert(spheres != NULL || sphere_count == 0);
+	assert(hits != NULL);
+
+	// With a unit vector, the point on the ray nearest the center is at the
+	// dot product of the two, and the distance from there to where the ray
+	// enters the sphere follows from Pythagoras.
+	int objects[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	float distances[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	int i, sphere;
+
+#if defined(__SSE2__)
+	for (i = 0; i < rays->count; i += 4) {
+		const __m128 origin_x = _mm_load_ps(rays->origin_x + i);
+		const __m128 origin_y = _mm_load_ps(rays->origin_y + i);
+		const __m128 origin_z = _mm_load_ps(rays->origin_z + i);
+		const __m128 vector_x = _mm_load_ps(rays->vector_x + i);
+		const __m128 vector_y = _mm_load_ps(rays->vector_y + i);
+		const __m128 vector_z = _mm_load_ps(rays->vector_z + i);
+		__m128 nearest = _mm_set1_ps(FLT_MAX);
+		__m128i nearest_object = _mm_set1_epi32(-1);
+
+		for (sphere = 0; sphere < sphere_count; sphere++) {
+			const __m128 to_center_x = _mm_sub_ps(_mm_set1_ps(spheres[sphere].center[0]), origin_x);
+			const __m128 to_center_y = _mm_sub_ps(_mm_set1_ps(spheres[sphere].center[1]), origin_y);
+			const __m128 to_center_z = _mm_sub_ps(_mm_set1_ps(spheres[sphere].center[2]), origin_z);
+			const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(to_center_x, vector_x),
+				_mm_mul_ps(to_center_y, vector_y)), _mm_mul_ps(to_center_z, vector_z));
+			const __m128 to_center_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(to_center_x, to_center_x),
+				_mm_mul_ps(to_center_y, to_center_y)), _mm_mul_ps(to_center_z, to_center_z));
+			const __m128 radius_squared = _mm_set1_ps(spheres[sphere].radius * spheres[sphere].radius);
+			const __m128 inside_squared = _mm_sub_ps(radius_squared,
+				_mm_sub_ps(to_center_squared, _mm_mul_ps(along, along)));
+			const __m128 distance = _mm_sub_ps(along, _mm_sqrt_ps(_mm_max_ps(inside_squared, _mm_setzero_ps())));
+
+			const __m128 is_nearer = _mm_and_ps(_mm_cmpgt_ps(inside_squared, _mm_setzero_ps()),
+				_mm_cmplt_ps(distance, nearest));
+			nearest = _mm_or_ps(_mm_and_ps(is_nearer, distance), _mm_andnot_ps(is_nearer, nearest));
+			nearest_object = _mm_or_si128(_mm_and_si128(_mm_castps_si128(is_nearer), _mm_set1_epi32(sphere)),
+				_mm_andnot_si128(_mm_castps_si128(is_nearer), nearest_object));
+		}
+
+		_mm_store_ps(distances + i, nearest);
+		_mm_store_si128((__m128i*) (objects + i), nearest_object);
+	}
+#else
+	for (i = 0; i < rays->count; i++) {
+		float nearest = FLT_MAX;
+		int nearest_object = -1;
+
+		for (sphere = 0; sphere < sphere_count; sphere++) {
+			const float to_center_x = spheres[sphere].center[0] - rays->origin_x[i];
+			const float to_center_y = spheres[sphere].center[1] - rays->origin_y[i];
+			const float to_center_z = spheres[sphere].center[2] - rays->origin_z[i];
+			const float along = to_center_x * rays->vector_x[i] + to_center_y * rays->vector_y[i]
+				+ to_center_z * rays->vector_z[i];
+			const float to_center_squared = to_center_x * to_center_x + to_center_y * to_center_y
+				+ to_center_z * to_center_z;
+			const float inside_squared = spheres[sphere].radius * spheres[sphere].radius
+				- (to_center_squared - along * along);
+			if (inside_squared <= 0.0f)
+				continue;
+
+			const float distance = along - sqrtf(inside_squared);
+			if (distance < nearest) {
+				nearest = distance;
+				nearest_object = sphere;
+			}
+		}
+
+		distances[i] = nearest;
+		objects[i] = nearest_object;
+	}
+#endif
+
+	for (i = 0; i < rays->count; i++) {
+		hits[i].object = objects[i];
+		hits[i].distance = distances[i];
+	}
+}
+
+void intersect_rays_with_plane(const RayBatch* rays, Plane plane, PickHit* hits) {
+	assert(rays != NULL);
+	assert(hits != NULL);
+
+	// As in ray_intersection_point(), the ray's vector is scaled by how far
+	// the plane is along the normal, over how fast the ray goes along it.
+	float points[3][MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	int i;
+
+#if defined(__SSE2__)
+	const __m128 normal_x = _mm_set1_ps(plane.normal[0]);
+	const __m128 normal_y = _mm_set1_ps(plane.normal[1]);
+	const __m128 normal_z = _mm_set1_ps(plane.normal[2]);
+	for (i = 0; i < rays->count; i += 4) {
+		const __m128 origin_x = _mm_load_ps(rays->origin_x + i);
+		const __m128 origin_y = _mm_load_ps(rays->origin_y + i);
+		const __m128 origin_z = _mm_load_ps(rays->origin_z + i);
+		const __m128 vector_x = _mm_load_ps(rays->vector_x + i);
+		const __m128 vector_y = _mm_load_ps(rays->vector_y + i);
+		const __m128 vector_z = _mm_load_ps(rays->vector_z + i);
+
+		const __m128 to_plane = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(plane.point[0]), origin_x), normal_x),
+			_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(plane.point[1]), origin_y), normal_y)),
+			_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(plane.point[2]), origin_z), normal_z));
+		const __m128 speed = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vector_x, normal_x),
+			_mm_mul_ps(vector_y, normal_y)), _mm_mul_ps(vector_z, normal_z));
+		const __m128 scale = _mm_div_ps(to_plane, speed);
+
+		_mm_store_ps(points[0] + i, _mm_add_ps(origin_x, _mm_mul_ps(vector_x, scale)));
+		_mm_store_ps(points[1] + i, _mm_add_ps(origin_y, _mm_mul_ps(vector_y, scale)));
+		_mm_store_ps(points[2] + i, _mm_add_ps(origin_z, _mm_mul_ps(vector_z, scale)));
+	}
+#else
+	for (i = 0; i < rays->count; i++) {
+		const float to_plane = (plane.point[0] - rays->origin_x[i]) * plane.normal[0]
+			+ (plane.point[1] - rays->origin_y[i]) * plane.normal[1]
+			+ (plane.point[2] - rays->origin_z[i]) * plane.normal[2];
+		const float speed = rays->vector_x[i] * plane.normal[0] + rays->vector_y[i] * plane.normal[1]
+			+ rays->vector_z[i] * plane.normal[2];
+		const float scale = to_plane / speed;
+
+		points[0][i] = rays->origin_x[i] + rays->vector_x[i] * scale;
+		points[1][i] = rays->origin_y[i] + rays->vector_y[i] * scale;
+		points[2][i] = rays->origin_z[i] + rays->vector_z[i] * scale;
+	}
+#endif
+
+	for (i = 0; i < rays->count; i++) {
+		hits[i].plane_point[0] = points[0][i];
+		hits[i].plane_point[1] = points[1][i];
+		hits[i].plane_point[2] = points[2][i];
+	}
+}
+
+void pick_touches(const Camera* camera, const TouchPoint* touches, int touch_count,
+	const Sphere* objects, int object_count, Plane plane, PickHit* hits) {
+	RayBatch rays;
+	unproject_touches(camera, touches, touch_count, &rays);
+	pick_nearest_spheres(&rays, objects, object_count, hits);
+	intersect_rays_with_plane(&rays, plane, hits);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "camera.h"
+#include "geometry.h"
+#include "platform_macros.h"
+
+/* Finds what's under a batch of touches at once, like every touch that came
+   in during a frame, or every finger on the screen.
+
+   All of the touches are unprojected into rays in one pass, and the rays are
+   kept one array per component, so that the queries can test four of them at
+   a time against each object. Ray vectors are normalized as they're made,
+   so unlike sphere_intersects_ray(), nothing divides by their length later. */
+
+// A multiple of four.
+#define MAX_PICK_TOUCHES 16
+
+typedef struct {
+	float normalized_x;
+	float normalized_y;
+} TouchPoint;
+
+typedef struct {
+	float origin_x[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	float origin_y[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	float origin_z[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	float vector_x[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	float vector_y[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	float vector_z[MAX_PICK_TOUCHES] ALIGN_ATTRIBUTE(16);
+	int count;
+} RayBatch;
+
+typedef struct {
+	// The nearest object whose sphere the touch's ray passes through, or -1.
+	int object;
+	// How far along the ray that sphere starts, from the near plane.
+	float distance;
+	// Where the ray crosses the plane, or NaNs if it runs alongside it.
+	vec3 plane_point;
+} PickHit;
+
+/* Casts a ray from the near plane through each touch. */
+void unproject_touches(const Camera* camera, const TouchPoint* touches, int touch_count, RayBatch* rays);
+
+/* Fills in the object and distance of each ray's hit. Like
+   sphere_intersects_ray(), rays are taken as infinite lines. */
+void pick_nearest_spheres(const RayBatch* rays, const Sphere* spheres, int sphere_count, PickHit* hits);
+
+/* Fills in the plane point of each ray's hit. */
+void intersect_rays_with_plane(const RayBatch* rays, Plane plane, PickHit* hits);
+
+/* All of the above, for up to MAX_PICK_TOUCHES touches. */
+void pick_touches(const Camera* camera, const TouchPoint* touches, int touch_count,
+	const Sphere* objects, int object_count, Plane plane, PickHit* hits);
@@ -1,8 +1,10 @@
 #include "program.h"
+#include "frame_uniforms.h"
 #include "platform_gl.h"
 
 TextureProgram get_texture_program(GLuint program)
 {
+	bind_object_uniforms_block(program);
 	return (TextureProgram) {
 			program,
 			glGetAttribLocation(program, "a_Position"),
@@ -13,6 +15,7 @@ TextureProgram get_texture_program(GLuint program)
 
 ColorProgram get_color_program(GLuint program)
 {
+	bind_object_uniforms_block(program);
 	return (ColorProgram) {
 			program,
 			glGetAttribLocation(program, "a_Position"),
@@ -0,0 +1,107 @@
+#include "qoi.h"
+#include <assert.h>
+#include <string.h>
+
+// Pixels are kept packed, in the same byte order as they're stored on the
+// little-endian CPUs we run on, and channels wrap around as bytes.
+#define PACK(r, g, b, a) ((uint32_t) (uint8_t) (r) | (uint32_t) (uint8_t) (g) << 8 \
+	| (uint32_t) (uint8_t) (b) << 16 | (uint32_t) (uint8_t) (a) << 24)
+#define RED(px) ((uint8_t) (px))
+#define GREEN(px) ((uint8_t) ((px) >> 8))
+#define BLUE(px) ((uint8_t) ((px) >> 16))
+#define ALPHA(px) ((uint8_t) ((px) >> 24))
+
+static uint32_t read_big_endian_32(const uint8_t* bytes) {
+	return (uint32_t) bytes[0] << 24 | (uint32_t) bytes[1] << 16 | (uint32_t) bytes[2] << 8 | bytes[3];
+}
+
+static inline void store_pixel(uint8_t* pixels, size_t index, uint32_t px) {
+	// Compiles to a single store, without assuming the buffer is aligned.
+	memcpy(pixels + index * 4, &px, 4);
+}
+
+static inline int get_index_position(uint32_t px) {
+	return get_qoi_index_position(RED(px), GREEN(px), BLUE(px), ALPHA(px));
+}
+
+int parse_qoi_header(const void* data, size_t data_length, QoiHeader* header) {
+	assert(header != NULL);
+	const uint8_t* bytes = data;
+
+	if (data == NULL || data_length < QOI_HEADER_SIZE + QOI_PADDING_SIZE
+	 || memcmp(bytes, qoi_magic, sizeof(qoi_magic)) != 0)
+		return 0;
+
+	header->width = read_big_endian_32(bytes + 4);
+	header->height = read_big_endian_32(bytes + 8);
+	header->channels = bytes[12];
+	header->colorspace = bytes[13];
+
+	if (header->width == 0 || header->height == 0
+	 || header->height > QOI_MAX_PIXELS / header->width
+	 || (header->channels != 3 && header->channels != 4)
+	 || header->colorspace > 1)
+		return 0;
+
+	return 1;
+}
+
+int decode_qoi_pixels(const void* data, size_t data_length, const QoiHeader* header, uint8_t* pixels) {
+	assert(data != NULL);
+	assert(header != NULL);
+	assert(pixels != NULL);
+	assert(data_length >= QOI_HEADER_SIZE + QOI_PADDING_SIZE);
+
+	const uint8_t* p = (const uint8_t*) data + QOI_HEADER_SIZE;
+	// Every op starts before the padding, and none is longer than it, so
+	// only the op's first byte needs to be checked.
+	const uint8_t* const end = (const uint8_t*) data + data_length - QOI_PADDING_SIZE;
+	const size_t pixel_count = (size_t) header->width * header->height;
+	uint32_t index[64] = {0};
+	uint32_t px = PACK(0, 0, 0, 255);
+	size_t i = 0;
+
+	while (i < pixel_count) {
+		if (p >= end)
+			return 0;
+		const uint8_t op = *p++;
+
+		if (op == QOI_OP_RGB) {
+			px = PACK(p[0], p[1], p[2], ALPHA(px));
+			p += 3;
+		} else if (op == QOI_OP_RGBA) {
+			px = PACK(p[0], p[1], p[2], p[3]);
+			p += 4;
+		} else if ((op & QOI_MASK_2) == QOI_OP_INDEX) {
+			px = index[op];
+		} else if ((op & QOI_MASK_2) == QOI_OP_DIFF) {
+			px = PACK(RED(px) + ((op >> 4) & 0x03) - 2,
+			          GREEN(px) + ((op >> 2) & 0x03) - 2,
+			          BLUE(px) + (op & 0x03) - 2,
+			          ALPHA(px));
+		} else if ((op & QOI_MASK_2) == QOI_OP_LUMA) {
+			const int green_diff = (op & 0x3f) - 32;
+			const uint8_t next = *p++;
+			px = PACK(RED(px) + green_diff - 8 + ((next >> 4) & 0x0f),
+			          GREEN(px) + green_diff,
+			          BLUE(px) + green_diff - 8 + (next & 0x0f),
+			          ALPHA(px));
+		} else {
+			// Only a run at the very start adds anything to the index.
+			const size_t run = (op & 0x3f) + 1;
+			if (run > pixel_count - i)
+				return 0;
+			index[get_index_position(px)] = px;
+			const size_t run_end = i + run;
+			for (; i < run_end; i++)
+				store_pixel(pixels, i, px);
+			continue;
+		}
+
+		index[get_index_position(px)] = px;
+		store_pixel(pixels, i++, px);
+	}
+
+	// The stream has to end right where the padding does.
+	return p == end && memcmp(end, qoi_padding, QOI_PADDING_SIZE) == 0;
+}
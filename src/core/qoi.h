@@ -0,0 +1,48 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* The "Quite OK Image" format: a lossless RGB(A) codec that's far simpler and
+   faster to decode than PNG, at a similar size for textures like ours. See
+   qoiformat.org for the specification.
+
+   A file is a 14 byte header, then the pixels as a stream of ops, each
+   encoding one or more pixels against the previous one or against a table
+   of 64 recently seen colors, then 7 zero bytes and a one. */
+
+#define QOI_HEADER_SIZE 14
+#define QOI_PADDING_SIZE 8
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+#define QOI_MASK_2 0xc0
+
+// Anything bigger than this is taken to be a corrupt header.
+#define QOI_MAX_PIXELS 400000000u
+
+static const unsigned char qoi_magic[4] = {'q', 'o', 'i', 'f'};
+static const unsigned char qoi_padding[QOI_PADDING_SIZE] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+typedef struct {
+	uint32_t width;
+	uint32_t height;
+	// 3 for RGB or 4 for RGBA; decoded pixels are always RGBA.
+	uint8_t channels;
+	// 0 for sRGB with linear alpha, 1 for all linear.
+	uint8_t colorspace;
+} QoiHeader;
+
+static inline int get_qoi_index_position(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+	return (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+}
+
+/* Returns 0 if the data doesn't start with a valid QOI header. */
+int parse_qoi_header(const void* data, size_t data_length, QoiHeader* header);
+
+/* Decodes width * height RGBA pixels, 4 bytes each, into the given buffer.
+   Returns 0 if the data is cut short or the stream is malformed. */
+int decode_qoi_pixels(const void* data, size_t data_length, const QoiHeader* header, uint8_t* pixels);
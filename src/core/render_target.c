@@ -0,0 +1,68 @@
+#include "render_target.h"
+#include "gl_resources.h"
+#include "platform_gl.h"
+#include "platform_log.h"
+#include <assert.h>
+#include <string.h>
+
+#define TAG "render_target"
+
+int create_render_target(RenderTarget* render_target, int width, int height) {
+	assert(render_target != NULL);
+	assert(width > 0 && height > 0);
+	memset(render_target, 0, sizeof(RenderTarget));
+
+	// The color texture in RGBA, and the 16-bit depth renderbuffer.
+	const long long color_bytes = (long long) width * height * 4;
+	const long long depth_bytes = (long long) width * height * 2;
+	if (!fits_in_gl_memory_budget(color_bytes + depth_bytes)) {
+		DEBUG_LOG_PRINT_W(TAG, "A %dx%d render target doesn't fit in the GPU memory budget", width, height);
+		return 0;
+	}
+	render_target->width = width;
+	render_target->height = height;
+
+	// GLES2 only allows non-power-of-two textures without mipmaps or repeating.
+	glGenTextures(1, &render_target->color_texture);
+	glBindTexture(GL_TEXTURE_2D, render_target->color_texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	track_gl_resource(GL_RESOURCE_TEXTURE, render_target->color_texture, color_bytes);
+
+	glGenRenderbuffers(1, &render_target->depth_renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, render_target->depth_renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	track_gl_resource(GL_RESOURCE_RENDERBUFFER, render_target->depth_renderbuffer, depth_bytes);
+
+	GLint previous_framebuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+	glGenFramebuffers(1, &render_target->framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, render_target->framebuffer);
+	track_gl_resource(GL_RESOURCE_FRAMEBUFFER, render_target->framebuffer, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, render_target->color_texture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, render_target->depth_renderbuffer);
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previous_framebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		destroy_render_target(render_target);
+		return 0;
+	}
+	return 1;
+}
+
+void destroy_render_target(RenderTarget* render_target) {
+	assert(render_target != NULL);
+	if (untrack_gl_resource(GL_RESOURCE_FRAMEBUFFER, render_target->framebuffer))
+		glDeleteFramebuffers(1, &render_target->framebuffer);
+	if (untrack_gl_resource(GL_RESOURCE_RENDERBUFFER, render_target->depth_renderbuffer))
+		glDeleteRenderbuffers(1, &render_target->depth_renderbuffer);
+	if (untrack_gl_resource(GL_RESOURCE_TEXTURE, render_target->color_texture))
+		glDeleteTextures(1, &render_target->color_texture);
+	memset(render_target, 0, sizeof(RenderTarget));
+}
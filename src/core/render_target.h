@@ -0,0 +1,18 @@
+#pragma once
+#include "platform_gl.h"
+
+/* An offscreen framebuffer with a color texture and a depth buffer, for
+   rendering at a different resolution than the window's. */
+typedef struct {
+	GLuint framebuffer;
+	GLuint color_texture;
+	GLuint depth_renderbuffer;
+	int width;
+	int height;
+} RenderTarget;
+
+/* Returns 0, with nothing left allocated, if the context can't render to a
+   texture of this size, or it doesn't fit in the GPU memory budget. The
+   texture is sampled with linear filtering. */
+int create_render_target(RenderTarget* render_target, int width, int height);
+void destroy_render_target(RenderTarget* render_target);
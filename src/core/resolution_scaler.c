@@ -0,0 +1,102 @@
+#include "resolution_scaler.h"
+#include <assert.h>
+#include <string.h>
+
+#define FRAMES_PER_WINDOW 30
+#define SCALE_STEP_COUNT 5
+#define FRAMES_TO_IGNORE_AFTER_CHANGE 5
+
+static const float scale_steps[SCALE_STEP_COUNT] = {1.0f, 0.85f, 0.75f, 0.65f, 0.5f};
+
+// A window is over budget past the first threshold, and within it under the
+// second; anything between counts as neither.
+static const float over_budget_factor = 1.15f;
+static const float within_budget_factor = 1.05f;
+static const int windows_over_budget_to_step_down = 2;
+static const int initial_windows_before_step_up = 4;
+static const int max_windows_before_step_up = 64;
+
+void init_resolution_scaler(ResolutionScaler* scaler, long long frame_budget_us) {
+	assert(scaler != NULL);
+	assert(frame_budget_us > 0);
+	memset(scaler, 0, sizeof(ResolutionScaler));
+	scaler->frame_budget_us = frame_budget_us;
+	scaler->windows_before_step_up = initial_windows_before_step_up;
+	scaler->lowest_step = SCALE_STEP_COUNT - 1;
+}
+
+static void change_step(ResolutionScaler* scaler, int step) {
+	scaler->step = step;
+	scaler->windows_over_budget = 0;
+	scaler->windows_within_budget = 0;
+	scaler->frames_to_ignore = FRAMES_TO_IGNORE_AFTER_CHANGE;
+	scaler->scale_changes++;
+}
+
+static int finish_window(ResolutionScaler* scaler, long long average_us) {
+	if (scaler->is_trying_step_down) {
+		scaler->is_trying_step_down = 0;
+		if (average_us >= scaler->average_before_step_down_us) {
+			scaler->lowest_step = scaler->step - 1;
+			change_step(scaler, scaler->step - 1);
+			return 1;
+		}
+	}
+
+	if (average_us > scaler->frame_budget_us * over_budget_factor) {
+		scaler->windows_within_budget = 0;
+		scaler->windows_over_budget++;
+
+		if (scaler->is_trying_step_up) {
+			scaler->is_trying_step_up = 0;
+			scaler->windows_before_step_up *= 2;
+			if (scaler->windows_before_step_up > max_windows_before_step_up)
+				scaler->windows_before_step_up = max_windows_before_step_up;
+			change_step(scaler, scaler->step + 1);
+			return 1;
+		}
+		if (scaler->windows_over_budget >= windows_over_budget_to_step_down && scaler->step < scaler->lowest_step) {
+			scaler->is_trying_step_down = 1;
+			scaler->average_before_step_down_us = average_us;
+			change_step(scaler, scaler->step + 1);
+			return 1;
+		}
+	} else if (average_us <= scaler->frame_budget_us * within_budget_factor) {
+		scaler->windows_over_budget = 0;
+		scaler->windows_within_budget++;
+		// A step up that held for a whole window is kept.
+		scaler->is_trying_step_up = 0;
+
+		if (scaler->windows_within_budget >= scaler->windows_before_step_up && scaler->step > 0) {
+			scaler->is_trying_step_up = 1;
+			change_step(scaler, scaler->step - 1);
+			return 1;
+		}
+	} else {
+		scaler->windows_over_budget = 0;
+		scaler->windows_within_budget = 0;
+	}
+	return 0;
+}
+
+int record_frame_time(ResolutionScaler* scaler, long long frame_time_us) {
+	assert(scaler != NULL);
+	if (scaler->frames_to_ignore > 0) {
+		scaler->frames_to_ignore--;
+		return 0;
+	}
+
+	scaler->window_total_us += frame_time_us;
+	if (++scaler->window_frame_count < FRAMES_PER_WINDOW)
+		return 0;
+
+	const long long average_us = scaler->window_total_us / scaler->window_frame_count;
+	scaler->window_frame_count = 0;
+	scaler->window_total_us = 0;
+	return finish_window(scaler, average_us);
+}
+
+float get_render_scale(const ResolutionScaler* scaler) {
+	assert(scaler != NULL);
+	return scale_steps[scaler->step];
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/* Picks the resolution to render at from how long frames are taking against
+   a budget. Frame times are averaged over windows of frames; the scale
+   steps down after consecutive windows over budget, and steps back up after
+   a longer run of windows within it. A step up that goes over budget
+   straight away is undone, and the next step up waits twice as long, so the
+   scale doesn't bounce between two steps. A step down that doesn't make
+   frames any faster is undone too, and the scale stays above it from then
+   on: the time is going somewhere other than filling pixels, or the upscale
+   costs more than the smaller render target saves. */
+
+typedef struct {
+	long long frame_budget_us;
+	int step;
+
+	int window_frame_count;
+	long long window_total_us;
+	// Frames still to skip after a change, while the new size settles in.
+	int frames_to_ignore;
+
+	int windows_over_budget;
+	int windows_within_budget;
+	int windows_before_step_up;
+	int is_trying_step_up;
+	int is_trying_step_down;
+	long long average_before_step_down_us;
+	// The lowest step that has made frames faster.
+	int lowest_step;
+
+	int scale_changes;
+} ResolutionScaler;
+
+void init_resolution_scaler(ResolutionScaler* scaler, long long frame_budget_us);
+
+/* Takes how long a frame took to draw, not counting any wait for vsync or
+   for input before the next one, so that the scale can come back up while
+   frames are waiting on the display. Returns non-zero if the render scale
+   changed. */
+int record_frame_time(ResolutionScaler* scaler, long long frame_time_us);
+
+/* The fraction of the window's width and height to render at, from 1 down to 0.5. */
+float get_render_scale(const ResolutionScaler* scaler);
@@ -1,4 +1,5 @@
 #include "shader.h"
+#include "gl_resources.h"
 #include "platform_gl.h"
 #include "platform_log.h"
 #include <assert.h>
@@ -7,9 +8,9 @@
 
 #define TAG "shaders"
 
-static void log_v_fixed_length(const GLchar* source, const GLint length) {
+static void log_v_fixed_length(const GLchar* source, const GLint length, Arena* arena) {
 	if (LOGGING_ON) {
-		char log_buffer[length + 1];
+		char* log_buffer = allocate_from_arena(arena, length + 1);
 		memcpy(log_buffer, source, length);
 		log_buffer[length] = '\0';
 
@@ -17,34 +18,41 @@ static void log_v_fixed_length(const GLchar* source, const GLint length) {
 	}
 }
 
-static void log_shader_info_log(GLuint shader_object_id) {
+static void log_shader_info_log(GLuint shader_object_id, Arena* arena) {
 	if (LOGGING_ON) {
-		GLint log_length;
+		// The length includes the terminator, and is zero when there's no log.
+		GLint log_length = 0;
 		glGetShaderiv(shader_object_id, GL_INFO_LOG_LENGTH, &log_length);
-		GLchar log_buffer[log_length];
+		if (log_length <= 1)
+			return;
+		GLchar* log_buffer = allocate_from_arena(arena, log_length);
 		glGetShaderInfoLog(shader_object_id, log_length, NULL, log_buffer);
 
 		DEBUG_LOG_WRITE_V(TAG, log_buffer);
 	}
 }
 
-static void log_program_info_log(GLuint program_object_id) {
+static void log_program_info_log(GLuint program_object_id, Arena* arena) {
 	if (LOGGING_ON) {
-		GLint log_length;
+		GLint log_length = 0;
 		glGetProgramiv(program_object_id, GL_INFO_LOG_LENGTH, &log_length);
-		GLchar log_buffer[log_length];
+		if (log_length <= 1)
+			return;
+		GLchar* log_buffer = allocate_from_arena(arena, log_length);
 		glGetProgramInfoLog(program_object_id, log_length, NULL, log_buffer);
 
 		DEBUG_LOG_WRITE_V(TAG, log_buffer);
 	}
 }
 
-GLuint compile_shader(const GLenum type, const GLchar* source, const GLint length) {
+GLuint compile_shader(const GLenum type, const GLchar* source, const GLint length, Arena* arena) {
 	assert(source != NULL);
+	assert(arena != NULL);
 	GLuint shader_object_id = glCreateShader(type);
 	GLint compile_status;
 
 	assert(shader_object_id != 0);
+	track_gl_resource(GL_RESOURCE_SHADER, shader_object_id, 0);
 
 	glShaderSource(shader_object_id, 1, (const GLchar **)&source, &length);
 	glCompileShader(shader_object_id);
@@ -52,8 +60,8 @@ GLuint compile_shader(const GLenum type, const GLchar* source, const GLint lengt
 
 	if (LOGGING_ON) {
 		DEBUG_LOG_WRITE_D(TAG, "Results of compiling shader source:");
-		log_v_fixed_length(source, length);
-		log_shader_info_log(shader_object_id);
+		log_v_fixed_length(source, length, arena);
+		log_shader_info_log(shader_object_id, arena);
 	}
 
 	assert(compile_status != 0);
@@ -61,11 +69,13 @@ GLuint compile_shader(const GLenum type, const GLchar* source, const GLint lengt
 	return shader_object_id;
 }
 
-GLuint link_program(const GLuint vertex_shader, const GLuint fragment_shader) {
+GLuint link_program(const GLuint vertex_shader, const GLuint fragment_shader, Arena* arena) {
+	assert(arena != NULL);
 	GLuint program_object_id = glCreateProgram();
 	GLint link_status;
 
 	assert(program_object_id != 0);
+	track_gl_resource(GL_RESOURCE_PROGRAM, program_object_id, 0);
 
 	glAttachShader(program_object_id, vertex_shader);
 	glAttachShader(program_object_id, fragment_shader);
@@ -74,7 +84,7 @@ GLuint link_program(const GLuint vertex_shader, const GLuint fragment_shader) {
 
 	if (LOGGING_ON) {
 		DEBUG_LOG_WRITE_D(TAG, "Results of linking program:");
-		log_program_info_log(program_object_id);
+		log_program_info_log(program_object_id, arena);
 	}
 
 	assert(link_status != 0);
@@ -84,25 +94,42 @@ GLuint link_program(const GLuint vertex_shader, const GLuint fragment_shader) {
 
 GLuint build_program(
     const GLchar * vertex_shader_source, const GLint vertex_shader_source_length,
-    const GLchar * fragment_shader_source, const GLint fragment_shader_source_length) {
+    const GLchar * fragment_shader_source, const GLint fragment_shader_source_length, Arena* arena) {
 	assert(vertex_shader_source != NULL);
 	assert(fragment_shader_source != NULL);
 
 	GLuint vertex_shader = compile_shader(
-        GL_VERTEX_SHADER, vertex_shader_source, vertex_shader_source_length);
+        GL_VERTEX_SHADER, vertex_shader_source, vertex_shader_source_length, arena);
 	GLuint fragment_shader = compile_shader(
-        GL_FRAGMENT_SHADER, fragment_shader_source, fragment_shader_source_length);
-	return link_program(vertex_shader, fragment_shader);
+        GL_FRAGMENT_SHADER, fragment_shader_source, fragment_shader_source_length, arena);
+	const GLuint program = link_program(vertex_shader, fragment_shader, arena);
+
+	// The program keeps what it needs from the shaders once it's linked.
+	glDetachShader(program, vertex_shader);
+	glDetachShader(program, fragment_shader);
+	delete_shader(vertex_shader);
+	delete_shader(fragment_shader);
+	return program;
 }
 
-GLint validate_program(const GLuint program) {
+void delete_shader(const GLuint shader) {
+	if (untrack_gl_resource(GL_RESOURCE_SHADER, shader))
+		glDeleteShader(shader);
+}
+
+void delete_program(const GLuint program) {
+	if (untrack_gl_resource(GL_RESOURCE_PROGRAM, program))
+		glDeleteProgram(program);
+}
+
+GLint validate_program(const GLuint program, Arena* arena) {
 	if (LOGGING_ON) {
 		int validate_status;
 
 		glValidateProgram(program);
 		glGetProgramiv(program, GL_VALIDATE_STATUS, &validate_status);
 		DEBUG_LOG_PRINT_D(TAG, "Results of validating program: %d", validate_status);
-		log_program_info_log(program);
+		log_program_info_log(program, arena);
 		return validate_status;
 	}
 
@@ -1,10 +1,16 @@
+#include "arena.h"
 #include "platform_gl.h"
 
-GLuint compile_shader(const GLenum type, const GLchar* source, const GLint length);
-GLuint link_program(const GLuint vertex_shader, const GLuint fragment_shader);
+/* The arena is only used for scratch memory while logging. */
+GLuint compile_shader(const GLenum type, const GLchar* source, const GLint length, Arena* arena);
+GLuint link_program(const GLuint vertex_shader, const GLuint fragment_shader, Arena* arena);
 GLuint build_program(
 	const GLchar * vertex_shader_source, const GLint vertex_shader_source_length,
-	const GLchar * fragment_shader_source, const GLint fragment_shader_source_length);
+	const GLchar * fragment_shader_source, const GLint fragment_shader_source_length, Arena* arena);
+
+/* These only delete objects that gl_resources is tracking. */
+void delete_shader(const GLuint shader);
+void delete_program(const GLuint program);
 
 /* Should be called just before using a program to draw, if validation is needed. */
-GLint validate_program(const GLuint program);
+GLint validate_program(const GLuint program, Arena* arena);
@@ -0,0 +1,55 @@
+#pragma once
+#include <math.h>
+
+/* Vertex positions for the round shapes the puck and mallets are built
+   from, written as X, Y, Z from offset onwards. Each returns the offset
+   just past what it wrote. */
+
+static inline int size_of_circle_in_vertices(int num_points) {
+	return 1 + (num_points + 1);
+}
+
+static inline int size_of_open_cylinder_in_vertices(int num_points) {
+	return (num_points + 1) * 2;
+}
+
+static inline int gen_circle(float* out, int offset, float center_x, float center_y, float center_z, float radius, int num_points)
+{
+	out[offset++] = center_x;
+	out[offset++] = center_y;
+	out[offset++] = center_z;
+
+	int i;
+	for (i = 0; i <= num_points; ++i) {
+		float angle_in_radians = ((float) i / (float) num_points) * ((float) M_PI * 2.0f);
+		out[offset++] = center_x + radius * cos(angle_in_radians);
+		out[offset++] = center_y;
+		out[offset++] = center_z + radius * sin(angle_in_radians);
+	}
+
+	return offset;
+}
+
+static inline int gen_cylinder(float* out, int offset, float center_x, float center_y, float center_z, float height, float radius, int num_points)
+{
+	const float y_start = center_y - (height / 2.0f);
+	const float y_end = center_y + (height / 2.0f);
+
+	int i;
+	for (i = 0; i <= num_points; i++) {
+		float angle_in_radians = ((float) i / (float) num_points) * ((float) M_PI * 2.0f);
+
+		float x_position = center_x + radius * cos(angle_in_radians);
+		float z_position = center_z + radius * sin(angle_in_radians);
+
+		out[offset++] = x_position;
+		out[offset++] = y_start;
+		out[offset++] = z_position;
+
+		out[offset++] = x_position;
+		out[offset++] = y_end;
+		out[offset++] = z_position;
+	}
+
+	return offset;
+}
@@ -0,0 +1,170 @@
+#include "stream_buffer.h"
+#include "gl_features.h"
+#include "gl_resources.h"
+#include "platform_gl.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// A segment is reused this many frames after it was written.
+#define FRAMES_IN_FLIGHT 3
+
+struct StreamBuffer {
+	GLuint buffer;
+	GLsizeiptr segment_size;
+	GLsizeiptr alignment;
+	int segment;
+	// Where the next allocation starts, and where the open one ends.
+	GLintptr offset;
+	GLintptr allocation_end;
+
+	int uses_mapping;
+#if HAVE_GLES3_HEADERS
+	GLsync fences[FRAMES_IN_FLIGHT];
+#endif
+	// Only without mapping.
+	unsigned char* staging;
+
+	StreamBufferStats stats;
+};
+
+static inline GLintptr align_offset(GLintptr offset, GLsizeiptr alignment) {
+	return (offset + alignment - 1) & ~(GLintptr) (alignment - 1);
+}
+
+StreamBuffer* create_stream_buffer(GLsizeiptr bytes_per_frame, GLsizeiptr alignment) {
+	assert(bytes_per_frame > 0);
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	StreamBuffer* stream_buffer = calloc(1, sizeof(StreamBuffer));
+	assert(stream_buffer != NULL);
+
+	stream_buffer->alignment = alignment;
+	stream_buffer->segment_size = align_offset(bytes_per_frame, alignment);
+	stream_buffer->uses_mapping = get_gl_features()->has_buffer_mapping;
+	stream_buffer->stats.uses_mapping = stream_buffer->uses_mapping;
+
+	glGenBuffers(1, &stream_buffer->buffer);
+	assert(stream_buffer->buffer != 0);
+	glBindBuffer(GL_ARRAY_BUFFER, stream_buffer->buffer);
+	GLsizeiptr buffer_size = stream_buffer->segment_size * FRAMES_IN_FLIGHT;
+	if (!stream_buffer->uses_mapping) {
+		buffer_size = stream_buffer->segment_size;
+		stream_buffer->staging = malloc(stream_buffer->segment_size);
+		assert(stream_buffer->staging != NULL);
+	}
+	glBufferData(GL_ARRAY_BUFFER, buffer_size, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	track_gl_resource(GL_RESOURCE_BUFFER, stream_buffer->buffer, buffer_size);
+
+	return stream_buffer;
+}
+
+void destroy_stream_buffer(StreamBuffer* stream_buffer) {
+	assert(stream_buffer != NULL);
+	// The buffer and fences go with the context, if it was lost.
+	if (untrack_gl_resource(GL_RESOURCE_BUFFER, stream_buffer->buffer)) {
+#if HAVE_GLES3_HEADERS
+		int i;
+		for (i = 0; i < FRAMES_IN_FLIGHT; i++) {
+			if (stream_buffer->fences[i] != NULL)
+				glDeleteSync(stream_buffer->fences[i]);
+		}
+#endif
+		glDeleteBuffers(1, &stream_buffer->buffer);
+	}
+	free(stream_buffer->staging);
+	free(stream_buffer);
+}
+
+void begin_stream_buffer_frame(StreamBuffer* stream_buffer) {
+	assert(stream_buffer != NULL);
+	stream_buffer->stats.frames++;
+
+#if HAVE_GLES3_HEADERS
+	if (stream_buffer->uses_mapping) {
+		stream_buffer->segment = (stream_buffer->segment + 1) % FRAMES_IN_FLIGHT;
+		stream_buffer->offset = stream_buffer->segment * stream_buffer->segment_size;
+
+		GLsync fence = stream_buffer->fences[stream_buffer->segment];
+		if (fence != NULL) {
+			if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+				stream_buffer->stats.frames_waited_for_gpu++;
+				while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+					;
+			}
+			glDeleteSync(fence);
+			stream_buffer->fences[stream_buffer->segment] = NULL;
+		}
+		return;
+	}
+#endif
+
+	// Orphaning gives the buffer new storage, so the driver doesn't have to
+	// wait for draws from earlier frames that still read the old one.
+	stream_buffer->offset = 0;
+	glBindBuffer(GL_ARRAY_BUFFER, stream_buffer->buffer);
+	glBufferData(GL_ARRAY_BUFFER, stream_buffer->segment_size, NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void end_stream_buffer_frame(StreamBuffer* stream_buffer) {
+	assert(stream_buffer != NULL);
+#if HAVE_GLES3_HEADERS
+	if (stream_buffer->uses_mapping)
+		stream_buffer->fences[stream_buffer->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+}
+
+void* map_stream_buffer(StreamBuffer* stream_buffer, GLsizeiptr size, GLintptr* offset) {
+	assert(stream_buffer != NULL);
+	assert(offset != NULL);
+	assert(stream_buffer->allocation_end == 0);
+
+	// Without mapping there's only ever the one segment.
+	const GLintptr segment_end = (stream_buffer->segment + 1) * stream_buffer->segment_size;
+	if (size <= 0 || stream_buffer->offset + size > segment_end) {
+		stream_buffer->stats.allocations_dropped++;
+		return NULL;
+	}
+
+	*offset = stream_buffer->offset;
+	stream_buffer->allocation_end = stream_buffer->offset + size;
+
+#if HAVE_GLES3_HEADERS
+	if (stream_buffer->uses_mapping) {
+		glBindBuffer(GL_ARRAY_BUFFER, stream_buffer->buffer);
+		void* data = glMapBufferRange(GL_ARRAY_BUFFER, *offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		assert(data != NULL);
+		return data;
+	}
+#endif
+	return stream_buffer->staging + *offset;
+}
+
+void unmap_stream_buffer(StreamBuffer* stream_buffer) {
+	assert(stream_buffer != NULL);
+	assert(stream_buffer->allocation_end > stream_buffer->offset);
+
+	const GLsizeiptr size = stream_buffer->allocation_end - stream_buffer->offset;
+	glBindBuffer(GL_ARRAY_BUFFER, stream_buffer->buffer);
+#if HAVE_GLES3_HEADERS
+	if (stream_buffer->uses_mapping)
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	else
+#endif
+		glBufferSubData(GL_ARRAY_BUFFER, stream_buffer->offset, size, stream_buffer->staging + stream_buffer->offset);
+
+	stream_buffer->stats.bytes_streamed += size;
+	stream_buffer->offset = align_offset(stream_buffer->allocation_end, stream_buffer->alignment);
+	stream_buffer->allocation_end = 0;
+}
+
+GLuint get_stream_buffer_object(const StreamBuffer* stream_buffer) {
+	assert(stream_buffer != NULL);
+	return stream_buffer->buffer;
+}
+
+StreamBufferStats get_stream_buffer_stats(const StreamBuffer* stream_buffer) {
+	assert(stream_buffer != NULL);
+	return stream_buffer->stats;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "platform_gl.h"
+
+/* A vertex buffer for data that's rewritten every frame. It's split into one
+   segment per frame in flight, and each frame's allocations are carved out
+   of the next segment in turn.
+
+   Where the context can map buffers, which is decided from get_gl_features()
+   when the buffer is created, allocations are written straight into
+   the buffer with unsynchronized mapping, and a fence at the end of each
+   frame says when the GPU is done with its segment, so the segment is only
+   waited on if the GPU has fallen that far behind. Elsewhere, the buffer is
+   orphaned at the start of each frame, and allocations are written to
+   memory on the CPU and copied in with glBufferSubData(). */
+
+typedef struct {
+	unsigned long long frames;
+	// Frames that had to wait for the GPU to finish with their segment.
+	unsigned long long frames_waited_for_gpu;
+	unsigned long long bytes_streamed;
+	// Allocations that didn't fit in what was left of their frame's segment.
+	unsigned long long allocations_dropped;
+	int uses_mapping;
+} StreamBufferStats;
+
+typedef struct StreamBuffer StreamBuffer;
+
+/* Each frame can allocate up to bytes_per_frame. Allocations start at
+   multiples of alignment, which must be a power of two; 16 is enough for any
+   vertex attribute. */
+StreamBuffer* create_stream_buffer(GLsizeiptr bytes_per_frame, GLsizeiptr alignment);
+void destroy_stream_buffer(StreamBuffer* stream_buffer);
+
+void begin_stream_buffer_frame(StreamBuffer* stream_buffer);
+void end_stream_buffer_frame(StreamBuffer* stream_buffer);
+
+/* Returns memory to write size bytes of vertices to, or NULL if the frame's
+   segment is full. offset is where they'll be in the buffer. Only one
+   allocation can be open at a time. */
+void* map_stream_buffer(StreamBuffer* stream_buffer, GLsizeiptr size, GLintptr* offset);
+
+/* Makes the allocation's vertices available to draw with, and leaves the
+   buffer bound to GL_ARRAY_BUFFER. */
+void unmap_stream_buffer(StreamBuffer* stream_buffer);
+
+/* The buffer that allocations are carved out of, for binding ranges of it
+   to targets other than GL_ARRAY_BUFFER. */
+GLuint get_stream_buffer_object(const StreamBuffer* stream_buffer);
+
+StreamBufferStats get_stream_buffer_stats(const StreamBuffer* stream_buffer);
@@ -0,0 +1,146 @@
+#include "table_sdf.h"
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+int append_arc_to_outline(float* points, int point_count,
+	float center_x, float center_z, float radius, float start_angle, float end_angle, int segments) {
+	assert(points != NULL);
+	assert(segments > 0);
+	int i;
+	for (i = 0; i <= segments; i++) {
+		const float angle = start_angle + (end_angle - start_angle) * (float) i / (float) segments;
+		points[point_count * 2] = center_x + cosf(angle) * radius;
+		points[point_count * 2 + 1] = center_z + sinf(angle) * radius;
+		point_count++;
+	}
+	return point_count;
+}
+
+int build_rounded_rectangle_outline(float* points, float left, float right, float far, float near,
+	float corner_radius, int corner_segments) {
+	assert(points != NULL);
+	assert(left < right && far < near);
+	if (corner_radius <= 0.0f) {
+		const float corners[] = {left, far, right, far, right, near, left, near};
+		int i;
+		for (i = 0; i < 8; i++)
+			points[i] = corners[i];
+		return 4;
+	}
+
+	const float pi = (float) M_PI;
+	int count = 0;
+	count = append_arc_to_outline(points, count, left + corner_radius, far + corner_radius, corner_radius,
+		pi, 1.5f * pi, corner_segments);
+	count = append_arc_to_outline(points, count, right - corner_radius, far + corner_radius, corner_radius,
+		1.5f * pi, 2.0f * pi, corner_segments);
+	count = append_arc_to_outline(points, count, right - corner_radius, near - corner_radius, corner_radius,
+		0.0f, 0.5f * pi, corner_segments);
+	count = append_arc_to_outline(points, count, left + corner_radius, near - corner_radius, corner_radius,
+		0.5f * pi, pi, corner_segments);
+	return count;
+}
+
+float get_distance_to_table_edges(const TableShape* shape, float x, float z, float* normal) {
+	assert(shape != NULL && shape->outline_count > 0);
+	assert(normal != NULL);
+	float nearest_distance_squared = FLT_MAX;
+	float nearest_x = x, nearest_z = z;
+	float nearest_edge_x = 1.0f, nearest_edge_z = 0.0f;
+	int is_on_playing_area = 0;
+	int outline, i;
+
+	for (outline = 0; outline < shape->outline_count; outline++) {
+		const float* points = shape->outlines[outline].points;
+		const int point_count = shape->outlines[outline].point_count;
+		int is_inside = 0;
+
+		for (i = 0; i < point_count; i++) {
+			const float* start = points + i * 2;
+			const float* end = points + ((i + 1) % point_count) * 2;
+			const float edge_x = end[0] - start[0];
+			const float edge_z = end[1] - start[1];
+			const float edge_length_squared = edge_x * edge_x + edge_z * edge_z;
+			if (edge_length_squared <= 0.0f)
+				continue;
+
+			// The nearest point on the edge.
+			float t = ((x - start[0]) * edge_x + (z - start[1]) * edge_z) / edge_length_squared;
+			t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+			const float point_x = start[0] + edge_x * t;
+			const float point_z = start[1] + edge_z * t;
+			const float distance_squared = (x - point_x) * (x - point_x) + (z - point_z) * (z - point_z);
+			if (distance_squared < nearest_distance_squared) {
+				nearest_distance_squared = distance_squared;
+				nearest_x = point_x;
+				nearest_z = point_z;
+				nearest_edge_x = edge_x;
+				nearest_edge_z = edge_z;
+			}
+
+			// Even-odd crossings of a ray going towards +X.
+			if ((start[1] > z) != (end[1] > z)
+			 && x < start[0] + (z - start[1]) * edge_x / edge_z)
+				is_inside = !is_inside;
+		}
+
+		if (outline == 0)
+			is_on_playing_area = is_inside;
+		else if (is_inside)
+			is_on_playing_area = 0;
+	}
+
+	const float distance = sqrtf(nearest_distance_squared);
+	const float sign = is_on_playing_area ? 1.0f : -1.0f;
+	if (distance > 0.0f) {
+		normal[0] = (x - nearest_x) / distance * sign;
+		normal[1] = (z - nearest_z) / distance * sign;
+	} else {
+		// Right on the wall, so either side of the edge will do.
+		const float edge_length = sqrtf(nearest_edge_x * nearest_edge_x + nearest_edge_z * nearest_edge_z);
+		normal[0] = -nearest_edge_z / edge_length;
+		normal[1] = nearest_edge_x / edge_length;
+	}
+	return distance * sign;
+}
+
+void bake_table_sdf(TableSdf* sdf, const TableShape* shape, float cell_size, float margin) {
+	assert(sdf != NULL && shape != NULL && shape->outline_count > 0);
+	assert(cell_size > 0.0f && margin >= 0.0f);
+
+	// Obstacles are on the playing area, so its outline bounds everything.
+	const TableOutline* outline = &shape->outlines[0];
+	float min_x = FLT_MAX, max_x = -FLT_MAX, min_z = FLT_MAX, max_z = -FLT_MAX;
+	int i;
+	for (i = 0; i < outline->point_count; i++) {
+		min_x = fminf(min_x, outline->points[i * 2]);
+		max_x = fmaxf(max_x, outline->points[i * 2]);
+		min_z = fminf(min_z, outline->points[i * 2 + 1]);
+		max_z = fmaxf(max_z, outline->points[i * 2 + 1]);
+	}
+
+	sdf->min_x = min_x - margin;
+	sdf->min_z = min_z - margin;
+	sdf->inverse_cell_size = 1.0f / cell_size;
+	sdf->width = (int) ceilf((max_x - min_x + 2.0f * margin) / cell_size) + 1;
+	sdf->height = (int) ceilf((max_z - min_z + 2.0f * margin) / cell_size) + 1;
+	sdf->samples = malloc((size_t) sdf->width * sdf->height * 3 * sizeof(float));
+	assert(sdf->samples != NULL);
+
+	int column, row;
+	for (row = 0; row < sdf->height; row++) {
+		for (column = 0; column < sdf->width; column++) {
+			float* sample = sdf->samples + ((size_t) row * sdf->width + column) * 3;
+			sample[0] = get_distance_to_table_edges(shape,
+				sdf->min_x + (float) column * cell_size, sdf->min_z + (float) row * cell_size, sample + 1);
+		}
+	}
+}
+
+void free_table_sdf(TableSdf* sdf) {
+	assert(sdf != NULL);
+	free(sdf->samples);
+	sdf->samples = NULL;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+
+/* The table's walls as a signed distance field, so that colliding with a
+   table of any shape costs the same as with a rectangle.
+
+   A table is authored as outlines on the XZ plane: the first one goes around
+   the playing area and any others go around obstacles on it. Curves, like
+   rounded corners or round obstacles, are flattened into the outlines with
+   the helpers below. At load time, the distance to the nearest wall is baked
+   into a grid, along with the direction away from it, and each query is then
+   a bilinear lookup.
+
+   Distances are positive on the playing area and negative inside walls and
+   obstacles, and normals point towards the playing area. */
+
+typedef struct {
+	// X and Z pairs, in order around the outline, which closes by itself.
+	const float* points;
+	int point_count;
+} TableOutline;
+
+typedef struct {
+	const TableOutline* outlines;
+	int outline_count;
+} TableShape;
+
+typedef struct {
+	float min_x;
+	float min_z;
+	float inverse_cell_size;
+	int width;
+	int height;
+	// Per sample, row by row from min_z: the distance, then the normal's X and Z.
+	float* samples;
+} TableSdf;
+
+/* Appends points along an arc, from the start angle to the end angle in
+   radians, with the given number of segments. Angles go from +X towards +Z.
+   Returns the new point count. */
+int append_arc_to_outline(float* points, int point_count,
+	float center_x, float center_z, float radius, float start_angle, float end_angle, int segments);
+
+/* Fills in a rectangle with its corners rounded off, going around it from
+   the far left corner. Returns the number of points, which is at most
+   4 * (corner_segments + 1). With no corner radius, it's just the four corners. */
+int build_rounded_rectangle_outline(float* points, float left, float right, float far, float near,
+	float corner_radius, int corner_segments);
+
+/* The exact distance to the nearest wall, and the normal away from it,
+   found by going through every edge. This is what's baked. */
+float get_distance_to_table_edges(const TableShape* shape, float x, float z, float* normal);
+
+/* Bakes the shape's distance field over its bounds, plus a margin, with
+   samples cell_size apart. */
+void bake_table_sdf(TableSdf* sdf, const TableShape* shape, float cell_size, float margin);
+void free_table_sdf(TableSdf* sdf);
+
+/* Looks up the distance to the nearest wall, and writes the normal away from
+   it. Outside the baked area, the nearest edge of the grid is used, and the
+   distance keeps falling by however far the point is past that edge, so
+   that anything far outside is still pushed all the way back in. */
+static inline float sample_table_sdf(const TableSdf* sdf, float x, float z, float* normal) {
+	const float unclamped_grid_x = (x - sdf->min_x) * sdf->inverse_cell_size;
+	const float unclamped_grid_z = (z - sdf->min_z) * sdf->inverse_cell_size;
+	float grid_x = unclamped_grid_x, grid_z = unclamped_grid_z;
+	grid_x = grid_x < 0.0f ? 0.0f : (grid_x > (float) (sdf->width - 1) ? (float) (sdf->width - 1) : grid_x);
+	grid_z = grid_z < 0.0f ? 0.0f : (grid_z > (float) (sdf->height - 1) ? (float) (sdf->height - 1) : grid_z);
+
+	int column = (int) grid_x;
+	int row = (int) grid_z;
+	if (column > sdf->width - 2)
+		column = sdf->width - 2;
+	if (row > sdf->height - 2)
+		row = sdf->height - 2;
+	const float fraction_x = grid_x - (float) column;
+	const float fraction_z = grid_z - (float) row;
+
+	const float* row_samples = sdf->samples + ((size_t) row * sdf->width + column) * 3;
+	const float* next_row_samples = row_samples + (size_t) sdf->width * 3;
+	float values[3];
+	int i;
+	for (i = 0; i < 3; i++) {
+		const float in_row = row_samples[i] + (row_samples[3 + i] - row_samples[i]) * fraction_x;
+		const float in_next_row = next_row_samples[i] + (next_row_samples[3 + i] - next_row_samples[i]) * fraction_x;
+		values[i] = in_row + (in_next_row - in_row) * fraction_z;
+	}
+
+	// Blending normals across a corner shortens them.
+	const float length_squared = values[1] * values[1] + values[2] * values[2];
+	const float inverse_length = length_squared > 0.0f ? 1.0f / sqrtf(length_squared) : 0.0f;
+	normal[0] = values[1] * inverse_length;
+	normal[1] = values[2] * inverse_length;
+
+	const float outside_x = unclamped_grid_x - grid_x, outside_z = unclamped_grid_z - grid_z;
+	if (outside_x != 0.0f || outside_z != 0.0f)
+		return values[0] - sqrtf(outside_x * outside_x + outside_z * outside_z) / sdf->inverse_cell_size;
+	return values[0];
+}
@@ -0,0 +1,160 @@
+#include "telemetry.h"
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__ANDROID__) || defined(__EMSCRIPTEN__)
+#define USE_SHARED_TELEMETRY 0
+#else
+#define USE_SHARED_TELEMETRY 1
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static TelemetryBlock private_block = {.magic = TELEMETRY_MAGIC, .version = TELEMETRY_VERSION, .size = sizeof(TelemetryBlock)};
+static TelemetryBlock* block = &private_block;
+
+#if USE_SHARED_TELEMETRY
+static char shared_name[64];
+#endif
+
+/* Sections */
+
+static void begin_update(uint32_t* sequence) {
+	__atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void end_update(uint32_t* sequence) {
+	__atomic_store_n(sequence, *sequence + 1, __ATOMIC_RELEASE);
+}
+
+static void add_to_histogram(TelemetryHistogram* histogram, long long value) {
+	const uint64_t sample = value > 0 ? (uint64_t) value : 0;
+	histogram->count++;
+	histogram->sum += sample;
+	if (sample > histogram->max)
+		histogram->max = sample;
+	histogram->buckets[get_telemetry_bucket(sample)]++;
+}
+
+/* Sharing */
+
+const TelemetryBlock* get_telemetry_block() {
+	return block;
+}
+
+int share_telemetry() {
+#if USE_SHARED_TELEMETRY
+	if (block != &private_block)
+		return 1;
+
+	snprintf(shared_name, sizeof(shared_name), "%s%d", TELEMETRY_NAME_PREFIX, (int) getpid());
+	const int fd = shm_open(shared_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return 0;
+	if (ftruncate(fd, sizeof(TelemetryBlock)) != 0) {
+		close(fd);
+		shm_unlink(shared_name);
+		return 0;
+	}
+	TelemetryBlock* shared_block = mmap(NULL, sizeof(TelemetryBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shared_block == MAP_FAILED) {
+		shm_unlink(shared_name);
+		return 0;
+	}
+
+	// The new segment is all zeroes, and the magic number goes in last, so
+	// readers never see a block that's only partly there.
+	const size_t header_size = offsetof(TelemetryBlock, version);
+	memcpy((char*) shared_block + header_size, (const char*) &private_block + header_size,
+		sizeof(TelemetryBlock) - header_size);
+	shared_block->process_id = (int32_t) getpid();
+	__atomic_store_n(&shared_block->magic, TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+	block = shared_block;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void stop_sharing_telemetry() {
+#if USE_SHARED_TELEMETRY
+	if (block != &private_block)
+		shm_unlink(shared_name);
+#endif
+}
+
+/* Render thread */
+
+void record_frame_telemetry(long long frame_interval_us, long long render_time_us, int draw_calls, float render_scale) {
+	TelemetryRenderSection* render = &block->render;
+	begin_update(&render->sequence);
+	render->frames++;
+	render->draw_calls += (uint64_t) draw_calls;
+	render->last_frame_draw_calls = (uint32_t) draw_calls;
+	render->render_scale_per_mille = (uint32_t) (render_scale * 1000.0f + 0.5f);
+	if (frame_interval_us > 0)
+		add_to_histogram(&render->frame_interval, frame_interval_us);
+	add_to_histogram(&render->render_time, render_time_us);
+	end_update(&render->sequence);
+}
+
+void record_input_latency_telemetry(long long input_latency_us) {
+	TelemetryRenderSection* render = &block->render;
+	begin_update(&render->sequence);
+	add_to_histogram(&render->input_latency, input_latency_us);
+	end_update(&render->sequence);
+}
+
+void record_asset_load_telemetry(size_t bytes, long long load_time_us) {
+	TelemetryRenderSection* render = &block->render;
+	begin_update(&render->sequence);
+	render->assets_loaded++;
+	render->asset_bytes_loaded += bytes;
+	add_to_histogram(&render->asset_load_time, load_time_us);
+	end_update(&render->sequence);
+}
+
+void record_idle_telemetry(int frames_skipped, long long idle_time_us) {
+	TelemetryRenderSection* render = &block->render;
+	begin_update(&render->sequence);
+	render->frames_skipped += (uint64_t) frames_skipped;
+	render->idle_time += (uint64_t) idle_time_us;
+	end_update(&render->sequence);
+}
+
+void set_gpu_memory_telemetry(long long texture_bytes, long long buffer_bytes, int gl_objects) {
+	TelemetryRenderSection* render = &block->render;
+	begin_update(&render->sequence);
+	render->texture_bytes = texture_bytes;
+	render->buffer_bytes = buffer_bytes;
+	render->gl_objects = (uint64_t) gl_objects;
+	end_update(&render->sequence);
+}
+
+/* Game thread */
+
+void record_simulation_telemetry(int touches, long long simulation_time_us) {
+	TelemetryGameSection* game = &block->game;
+	begin_update(&game->sequence);
+	game->simulation_steps++;
+	game->touches += (uint64_t) touches;
+	add_to_histogram(&game->simulation_time, simulation_time_us);
+	end_update(&game->sequence);
+}
+
+/* Shard threads */
+
+void record_shard_tick_telemetry(int shard, int sessions, long long tick_time_us) {
+	if (shard < 0 || shard >= TELEMETRY_MAX_SHARDS)
+		return;
+	TelemetryShardSection* section = &block->shards[shard];
+	begin_update(&section->sequence);
+	section->ticks++;
+	section->sessions = (uint64_t) sessions;
+	add_to_histogram(&section->tick_time, tick_time_us);
+	end_update(&section->sequence);
+}
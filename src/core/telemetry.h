@@ -0,0 +1,150 @@
+#pragma once
+#include "platform_macros.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* Counters and histograms that other processes can watch while the game or
+   the match server runs, without attaching a profiler or reading logs.
+
+   They live in one TelemetryBlock with a fixed layout. Where POSIX shared
+   memory is available, share_telemetry() puts the block in a segment named
+   TELEMETRY_NAME_PREFIX followed by the process ID, which a reader can map
+   read-only. Bump TELEMETRY_VERSION whenever the layout changes.
+
+   Each section of the block is only ever written by one thread, and has a
+   sequence number that's odd while that thread is in the middle of an
+   update. To take a consistent snapshot, a reader loads the sequence with
+   acquire ordering, copies the section if the sequence is even, then loads
+   it again after an acquire fence; if it changed, the copy is thrown away and
+   it tries again. Writers never wait for readers.
+
+   Times are in microseconds. */
+
+#define TELEMETRY_MAGIC 0x4d4c4554 // "TELM"
+#define TELEMETRY_VERSION 4
+#define TELEMETRY_NAME_PREFIX "/airhockey_telemetry_"
+
+// Values under four get a bucket each; above that, each power of two is split
+// into four buckets, so a bucket is at most a quarter of its lower bound wide.
+#define TELEMETRY_HISTOGRAM_BUCKETS 128
+// A server with more shards than this only reports the first ones.
+#define TELEMETRY_MAX_SHARDS 64
+
+typedef struct {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[TELEMETRY_HISTOGRAM_BUCKETS];
+} TelemetryHistogram;
+
+/* Written by the render thread, which draws frames and loads assets. */
+typedef struct {
+	uint32_t sequence;
+	uint32_t reserved;
+
+	uint64_t frames;
+	uint64_t draw_calls;
+	uint32_t last_frame_draw_calls;
+	// Below one when rendering at less than the window's resolution, in thousandths.
+	uint32_t render_scale_per_mille;
+
+	// What's currently allocated for textures and renderbuffers, with
+	// mipmaps, and for buffers, as far as the game can tell.
+	int64_t texture_bytes;
+	int64_t buffer_bytes;
+	uint64_t gl_objects;
+	uint64_t assets_loaded;
+	uint64_t asset_bytes_loaded;
+
+	// Frames that weren't drawn since nothing on screen would have changed,
+	// counted in frame budgets, and the time spent not drawing them.
+	uint64_t frames_skipped;
+	uint64_t idle_time;
+
+	// From the start of one frame to the start of the next.
+	TelemetryHistogram frame_interval;
+	// Spent submitting each frame to GL.
+	TelemetryHistogram render_time;
+	// From a touch coming in to the first frame showing it being submitted.
+	TelemetryHistogram input_latency;
+	TelemetryHistogram asset_load_time;
+} TelemetryRenderSection;
+
+/* Written by the game thread, which steps the simulation. */
+typedef struct {
+	uint32_t sequence;
+	uint32_t reserved;
+
+	uint64_t simulation_steps;
+	uint64_t touches;
+	// Stepping the game and recording a frame to draw.
+	TelemetryHistogram simulation_time;
+} TelemetryGameSection;
+
+/* Written by one of the match server's shard threads, which ticks the
+   sessions on its core. Each starts on its own cache line. */
+typedef struct {
+	uint32_t sequence;
+	uint32_t reserved;
+
+	uint64_t ticks;
+	// Sessions in the shard as of its last tick.
+	uint64_t sessions;
+	// Stepping every session in the shard and sending out their states.
+	TelemetryHistogram tick_time;
+} ALIGN_ATTRIBUTE(64) TelemetryShardSection;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	int32_t process_id;
+
+	// Sections start on their own cache lines, so that the threads don't
+	// share one.
+	TelemetryRenderSection render ALIGN_ATTRIBUTE(64);
+	TelemetryGameSection game ALIGN_ATTRIBUTE(64);
+	// Only the server writes these; the game leaves them at zero.
+	TelemetryShardSection shards[TELEMETRY_MAX_SHARDS];
+} TelemetryBlock;
+
+static inline int get_telemetry_bucket(uint64_t value) {
+	if (value < 4)
+		return (int) value;
+	if (value >= (1ULL << 32))
+		return TELEMETRY_HISTOGRAM_BUCKETS - 1;
+	const int exponent = 63 - __builtin_clzll(value);
+	return 4 * (exponent - 1) + (int) ((value >> (exponent - 2)) & 3);
+}
+
+/* The smallest value that goes into the bucket. */
+static inline uint64_t get_telemetry_bucket_lower_bound(int bucket) {
+	if (bucket < 4)
+		return (uint64_t) bucket;
+	return (uint64_t) (4 + bucket % 4) << (bucket / 4 - 1);
+}
+
+/* Returns the block the game writes to, whether or not it's shared. */
+const TelemetryBlock* get_telemetry_block();
+
+/* Moves the block into shared memory, if it isn't already there. Returns 0
+   if shared memory isn't available, in which case the block stays private. */
+int share_telemetry();
+/* Removes the shared memory segment's name, so that it goes away once every
+   reader has unmapped it. The game keeps writing to it. */
+void stop_sharing_telemetry();
+
+/* Render thread */
+void record_frame_telemetry(long long frame_interval_us, long long render_time_us, int draw_calls, float render_scale);
+/* For a frame that applied touches, when the oldest of them came in. */
+void record_input_latency_telemetry(long long input_latency_us);
+void record_asset_load_telemetry(size_t bytes, long long load_time_us);
+void record_idle_telemetry(int frames_skipped, long long idle_time_us);
+/* Called by gl_resources whenever a GL object comes or goes. */
+void set_gpu_memory_telemetry(long long texture_bytes, long long buffer_bytes, int gl_objects);
+
+/* Game thread */
+void record_simulation_telemetry(int touches, long long simulation_time_us);
+
+/* Shard threads, each with its own index */
+void record_shard_tick_telemetry(int shard, int sessions, long long tick_time_us);
@@ -1,7 +1,17 @@
 #include "texture.h"
+#include "gl_resources.h"
 #include "platform_gl.h"
 #include <assert.h>
 
+static int get_bytes_per_pixel(const GLenum type) {
+	switch (type) {
+		case GL_RGBA: return 4;
+		case GL_RGB: return 3;
+		case GL_LUMINANCE_ALPHA: return 2;
+		default: return 1;
+	}
+}
+
 GLuint load_texture(
                     const GLsizei width, const GLsizei height,
                     const GLenum type, const GLvoid* pixels) {
@@ -15,7 +25,64 @@ GLuint load_texture(
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexImage2D(GL_TEXTURE_2D, 0, type, width, height, 0, type, GL_UNSIGNED_BYTE, pixels);
 	glGenerateMipmap(GL_TEXTURE_2D);
+	// The mipmaps add another third.
+	track_gl_resource(GL_RESOURCE_TEXTURE, texture_object_id, (long long) width * height * get_bytes_per_pixel(type) * 4 / 3);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture_object_id;
+}
+
+GLuint load_compressed_texture(
+	const GLenum internal_format, const int level_count, const CompressedTextureLevel* levels) {
+	assert(level_count > 0);
+	assert(levels != NULL);
+
+	GLuint texture_object_id;
+	glGenTextures(1, &texture_object_id);
+	assert(texture_object_id != 0);
+
+	glBindTexture(GL_TEXTURE_2D, texture_object_id);
+
+	// Compressed textures can't have their mipmaps generated, so they're only
+	// sampled with mipmapping if the file brought them along.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	long long bytes = 0;
+	int level;
+	for (level = 0; level < level_count; level++) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, internal_format,
+			levels[level].width, levels[level].height, 0, levels[level].size, levels[level].data);
+		bytes += levels[level].size;
+	}
+	track_gl_resource(GL_RESOURCE_TEXTURE, texture_object_id, bytes);
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 	return texture_object_id;
 }
+
+void delete_texture(const GLuint texture) {
+	if (untrack_gl_resource(GL_RESOURCE_TEXTURE, texture))
+		glDeleteTextures(1, &texture);
+}
+
+int is_compressed_texture_format_supported(const GLenum internal_format, Arena* arena) {
+	assert(arena != NULL);
+
+	GLint format_count = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &format_count);
+	if (format_count <= 0)
+		return 0;
+
+	const ArenaMarker marker = begin_arena_scope(arena);
+	GLint* formats = allocate_from_arena(arena, (size_t) format_count * sizeof(GLint));
+	glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats);
+
+	int is_supported = 0;
+	int i;
+	for (i = 0; i < format_count && !is_supported; i++)
+		is_supported = (GLenum) formats[i] == internal_format;
+
+	end_arena_scope(arena, marker);
+	return is_supported;
+}
@@ -1,5 +1,35 @@
+#pragma once
+#include "arena.h"
 #include "platform_gl.h"
 
+// Not every platform's headers define the compressed formats.
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+typedef struct {
+	GLsizei width;
+	GLsizei height;
+	GLsizei size;
+	const GLvoid* data;
+} CompressedTextureLevel;
+
 GLuint load_texture(
 	const GLsizei width, const GLsizei height,
 	const GLenum type, const GLvoid* pixels);
+
+/* Uploads every level as given; with more than one, they should run down to 1x1. */
+GLuint load_compressed_texture(
+	const GLenum internal_format, const int level_count, const CompressedTextureLevel* levels);
+
+/* Only deletes textures that gl_resources is tracking. */
+void delete_texture(const GLuint texture);
+
+/* Checks the formats that the context lists in GL_COMPRESSED_TEXTURE_FORMATS. */
+int is_compressed_texture_format_supported(const GLenum internal_format, Arena* arena);
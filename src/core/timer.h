@@ -0,0 +1,20 @@
+#pragma once
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+/* Returns a monotonic timestamp in microseconds. Only useful for measuring intervals. */
+static inline long long get_time_in_microseconds() {
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return (long long) (mach_absolute_time() * timebase.numer / timebase.denom / 1000);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long) now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+#endif
+}
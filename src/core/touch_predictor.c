@@ -0,0 +1,282 @@
+#include "touch_predictor.h"
+#include "math_helper.h"
+#include "platform_log.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#define TAG "touch_predictor"
+
+// Only samples this close to the latest one are fitted, so that the fit
+// follows changes of direction.
+static const long long fit_window_us = 60000;
+// Acceleration is only fitted with at least this many samples, since with
+// fewer it's mostly noise.
+static const int min_samples_for_acceleration = 4;
+// Extrapolating further than this is more guesswork than prediction.
+static const long long max_extrapolation_us = 66667;
+// Samples usually come at least this often while the finger moves. After
+// that, the prediction eases back to the last sample over the fade.
+static const long long hold_us = 25000;
+static const long long fade_us = 50000;
+
+static const TouchSample* get_sample(const TouchPredictor* predictor, int age) {
+	// Zero is the latest sample.
+	const int index = (predictor->next_sample - 1 - age + MAX_TOUCH_SAMPLES) % MAX_TOUCH_SAMPLES;
+	return &predictor->samples[index];
+}
+
+static double get_determinant(const double m[3][3]) {
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+	     - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+	     + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+/* Solves for the coefficients by Cramer's rule. Returns zero if the system is
+   too close to singular. */
+static int solve_3x3(const double m[3][3], const double rhs[3], double result[3]) {
+	const double determinant = get_determinant(m);
+	if (fabs(determinant) <= 1e-9 * fabs(m[0][0] * m[1][1] * m[2][2]))
+		return 0;
+
+	int column, row;
+	for (column = 0; column < 3; column++) {
+		double replaced[3][3];
+		memcpy(replaced, m, sizeof(replaced));
+		for (row = 0; row < 3; row++)
+			replaced[row][column] = rhs[row];
+		result[column] = get_determinant(replaced) / determinant;
+	}
+	return 1;
+}
+
+/* Fits x = x0 + v * t + a * t^2 / 2 to the recent samples, in seconds from
+   the latest, and keeps the derivatives at the latest sample. Without enough
+   samples for acceleration, it's a straight line, and with one, standing still. */
+static void fit_motion(TouchPredictor* predictor) {
+	const TouchSample* latest = get_sample(predictor, 0);
+	TouchMotion motion = {latest->time_us, latest->x, latest->z, 0.0f, 0.0f, 0.0f, 0.0f};
+
+	// Sums of the basis functions 1, t and t^2 / 2 times each other, and
+	// times the positions.
+	double sums[3][3] = {{0}};
+	double x_sums[3] = {0}, z_sums[3] = {0};
+	int fitted = 0;
+	int age;
+	for (age = 0; age < predictor->sample_count; age++) {
+		const TouchSample* sample = get_sample(predictor, age);
+		if (latest->time_us - sample->time_us > fit_window_us)
+			break;
+
+		const double t = (double) (sample->time_us - latest->time_us) / 1000000.0;
+		const double basis[3] = {1.0, t, t * t / 2.0};
+		int i, j;
+		for (i = 0; i < 3; i++) {
+			for (j = 0; j < 3; j++)
+				sums[i][j] += basis[i] * basis[j];
+			x_sums[i] += basis[i] * sample->x;
+			z_sums[i] += basis[i] * sample->z;
+		}
+		fitted++;
+	}
+
+	double x_fit[3], z_fit[3];
+	if (fitted >= min_samples_for_acceleration
+	 && solve_3x3(sums, x_sums, x_fit) && solve_3x3(sums, z_sums, z_fit)) {
+		motion.velocity_x = (float) x_fit[1];
+		motion.velocity_z = (float) z_fit[1];
+		motion.acceleration_x = (float) x_fit[2];
+		motion.acceleration_z = (float) z_fit[2];
+	} else if (fitted >= 2) {
+		const double determinant = sums[0][0] * sums[1][1] - sums[0][1] * sums[0][1];
+		if (determinant > 0.0) {
+			motion.velocity_x = (float) ((sums[0][0] * x_sums[1] - sums[0][1] * x_sums[0]) / determinant);
+			motion.velocity_z = (float) ((sums[0][0] * z_sums[1] - sums[0][1] * z_sums[0]) / determinant);
+		}
+	}
+
+	predictor->motion = motion;
+}
+
+static void clamp_to_bounds(const TableBounds* bounds, float* x, float* z) {
+	*x = clamp(*x, bounds->left, bounds->right);
+	*z = clamp(*z, bounds->far, bounds->near);
+}
+
+static void extrapolate_motion(const TouchMotion* motion, const TableBounds* bounds,
+	long long now_us, long long lookahead_us, float* x, float* z) {
+	const long long age_us = now_us > motion->time_us ? now_us - motion->time_us : 0;
+	long long horizon_us = age_us + lookahead_us;
+	if (horizon_us > max_extrapolation_us)
+		horizon_us = max_extrapolation_us;
+
+	float weight = 1.0f;
+	if (age_us > hold_us)
+		weight = age_us - hold_us >= fade_us ? 0.0f : 1.0f - (float) (age_us - hold_us) / (float) fade_us;
+
+	const float t = (float) horizon_us / 1000000.0f;
+	*x = motion->x + weight * (motion->velocity_x * t + motion->acceleration_x * t * t / 2.0f);
+	*z = motion->z + weight * (motion->velocity_z * t + motion->acceleration_z * t * t / 2.0f);
+	clamp_to_bounds(bounds, x, z);
+}
+
+void init_touch_predictor(TouchPredictor* predictor, const TableBounds* bounds) {
+	assert(predictor != NULL);
+	assert(bounds != NULL);
+	memset(predictor, 0, sizeof(TouchPredictor));
+	predictor->bounds = *bounds;
+}
+
+void reset_touch_predictor(TouchPredictor* predictor) {
+	assert(predictor != NULL);
+	predictor->sample_count = 0;
+	predictor->next_sample = 0;
+}
+
+void add_touch_sample(TouchPredictor* predictor, long long time_us, float x, float z) {
+	assert(predictor != NULL);
+	assert(predictor->sample_count == 0 || time_us >= get_sample(predictor, 0)->time_us);
+
+	predictor->samples[predictor->next_sample] = (TouchSample) {time_us, x, z};
+	predictor->next_sample = (predictor->next_sample + 1) % MAX_TOUCH_SAMPLES;
+	if (predictor->sample_count < MAX_TOUCH_SAMPLES)
+		predictor->sample_count++;
+	fit_motion(predictor);
+}
+
+int predict_touch(const TouchPredictor* predictor, long long now_us, long long lookahead_us, float* x, float* z) {
+	assert(predictor != NULL);
+	assert(lookahead_us >= 0);
+	assert(x != NULL && z != NULL);
+
+	if (predictor->sample_count == 0)
+		return 0;
+	extrapolate_motion(&predictor->motion, &predictor->bounds, now_us, lookahead_us, x, z);
+	return 1;
+}
+
+int get_sampled_touch_position(const TouchPredictor* predictor, long long time_us, float* x, float* z) {
+	assert(predictor != NULL);
+	assert(x != NULL && z != NULL);
+
+	int age;
+	for (age = 0; age + 1 < predictor->sample_count; age++) {
+		const TouchSample* after = get_sample(predictor, age);
+		const TouchSample* before = get_sample(predictor, age + 1);
+		if (time_us > after->time_us)
+			return 0;
+		if (time_us < before->time_us)
+			continue;
+
+		const long long span_us = after->time_us - before->time_us;
+		const float fraction = span_us > 0 ? (float) (time_us - before->time_us) / (float) span_us : 1.0f;
+		*x = before->x + (after->x - before->x) * fraction;
+		*z = before->z + (after->z - before->z) * fraction;
+		return 1;
+	}
+	return 0;
+}
+
+void reset_touch_prediction_measurement(TouchPredictionMeasurement* measurement) {
+	assert(measurement != NULL);
+	memset(measurement, 0, sizeof(TouchPredictionMeasurement));
+}
+
+void record_touch_prediction(TouchPredictionMeasurement* measurement, const TouchPredictor* predictor,
+	long long now_us, long long show_delay_us) {
+	assert(measurement != NULL);
+	assert(predictor != NULL);
+	if (predictor->sample_count == 0)
+		return;
+
+	// Predictions that were never reached, because the finger stopped, make
+	// way for new ones.
+	if (measurement->pending_count == MAX_PENDING_PREDICTIONS) {
+		memmove(&measurement->pending[0], &measurement->pending[1],
+			(MAX_PENDING_PREDICTIONS - 1) * sizeof(measurement->pending[0]));
+		measurement->pending_count--;
+	}
+
+	const int index = measurement->pending_count++;
+	measurement->pending[index].predicted_at_us = now_us;
+	measurement->pending[index].shown_at_us = now_us + show_delay_us;
+	measurement->pending[index].motion = predictor->motion;
+}
+
+void resolve_touch_predictions(TouchPredictionMeasurement* measurement, const TouchPredictor* predictor) {
+	assert(measurement != NULL);
+	assert(predictor != NULL);
+	if (predictor->sample_count == 0)
+		return;
+
+	const long long latest_us = get_sample(predictor, 0)->time_us;
+	int i = 0;
+	while (i < measurement->pending_count) {
+		const long long shown_at_us = measurement->pending[i].shown_at_us;
+		if (shown_at_us > latest_us) {
+			i++;
+			continue;
+		}
+
+		// Anything from before the oldest sample, like from an earlier
+		// touch, is dropped without a score.
+		float actual_x, actual_z;
+		if (get_sampled_touch_position(predictor, shown_at_us, &actual_x, &actual_z)) {
+			const TouchMotion* motion = &measurement->pending[i].motion;
+			clamp_to_bounds(&predictor->bounds, &actual_x, &actual_z);
+
+			float x = motion->x, z = motion->z;
+			clamp_to_bounds(&predictor->bounds, &x, &z);
+			float error = hypotf(x - actual_x, z - actual_z);
+			measurement->unpredicted_squared_error += error * error;
+			if (error > measurement->unpredicted_max_error)
+				measurement->unpredicted_max_error = error;
+
+			int lookahead;
+			for (lookahead = 0; lookahead < PREDICTION_LOOKAHEAD_COUNT; lookahead++) {
+				extrapolate_motion(motion, &predictor->bounds, measurement->pending[i].predicted_at_us,
+					prediction_lookaheads_us[lookahead], &x, &z);
+				error = hypotf(x - actual_x, z - actual_z);
+				measurement->squared_errors[lookahead] += error * error;
+				if (error > measurement->max_errors[lookahead])
+					measurement->max_errors[lookahead] = error;
+			}
+
+			measurement->total_show_delay_us += shown_at_us - measurement->pending[i].predicted_at_us;
+			measurement->frame_count++;
+		}
+
+		// Kept in order, oldest first, so that the oldest can make way.
+		measurement->pending_count--;
+		memmove(&measurement->pending[i], &measurement->pending[i + 1],
+			(measurement->pending_count - i) * sizeof(measurement->pending[0]));
+	}
+}
+
+void log_touch_prediction_measurement(const TouchPredictionMeasurement* measurement) {
+	assert(measurement != NULL);
+	if (!LOGGING_ON)
+		return;
+
+	if (measurement->frame_count == 0) {
+		DEBUG_LOG_WRITE_D(TAG, "No predictions were measured; the finger has to keep moving while frames are shown");
+		return;
+	}
+
+	const double frames = (double) measurement->frame_count;
+	DEBUG_LOG_PRINT_D(TAG, "%d frames, shown %.1f ms after they were recorded on average",
+		measurement->frame_count, measurement->total_show_delay_us / frames / 1000.0);
+	DEBUG_LOG_PRINT_D(TAG, "  without prediction: RMS error %.4f, max %.4f",
+		sqrt(measurement->unpredicted_squared_error / frames), measurement->unpredicted_max_error);
+
+	int best = 0;
+	int lookahead;
+	for (lookahead = 0; lookahead < PREDICTION_LOOKAHEAD_COUNT; lookahead++) {
+		DEBUG_LOG_PRINT_D(TAG, "  %4.1f ms lookahead: RMS error %.4f, max %.4f",
+			prediction_lookaheads_us[lookahead] / 1000.0,
+			sqrt(measurement->squared_errors[lookahead] / frames), measurement->max_errors[lookahead]);
+		if (measurement->squared_errors[lookahead] < measurement->squared_errors[best])
+			best = lookahead;
+	}
+	DEBUG_LOG_PRINT_D(TAG, "The best lookahead was %.1f ms", prediction_lookaheads_us[best] / 1000.0);
+}
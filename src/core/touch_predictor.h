@@ -0,0 +1,100 @@
+#pragma once
+#include "physics.h"
+
+/* Extrapolates where a finger is going from where it's been, so that what it
+   drags can be drawn where the finger will be when the frame is shown,
+   rather than where it was a frame or two before.
+
+   Velocity and acceleration are fitted by least squares to the samples of the
+   last few tens of milliseconds, and the prediction carries on from the
+   latest sample, so that each real sample corrects it. Once samples stop
+   coming, the finger is taken to have stopped, and the prediction eases back
+   to where it was last seen. Predictions are kept within the given bounds.
+
+   Positions are in table coordinates, and times in microseconds. */
+
+#define MAX_TOUCH_SAMPLES 8
+#define MAX_PENDING_PREDICTIONS 32
+#define PREDICTION_LOOKAHEAD_COUNT 7
+
+typedef struct {
+	long long time_us;
+	float x;
+	float z;
+} TouchSample;
+
+/* The fit, as of the latest sample. */
+typedef struct {
+	long long time_us;
+	float x;
+	float z;
+	// Per second, and per second squared.
+	float velocity_x;
+	float velocity_z;
+	float acceleration_x;
+	float acceleration_z;
+} TouchMotion;
+
+typedef struct {
+	TableBounds bounds;
+	// A ring, oldest first from next_sample once it's full.
+	TouchSample samples[MAX_TOUCH_SAMPLES];
+	int sample_count;
+	int next_sample;
+	TouchMotion motion;
+} TouchPredictor;
+
+/* Compares predictions against where the finger really was when the frames
+   they were made for were shown, at a range of lookaheads, so that the game's
+   lookahead can be tuned. Only frames shown while the finger kept moving
+   are counted, since it's the samples on either side that say where it was. */
+typedef struct {
+	struct {
+		long long predicted_at_us;
+		long long shown_at_us;
+		TouchMotion motion;
+	} pending[MAX_PENDING_PREDICTIONS];
+	int pending_count;
+
+	int frame_count;
+	long long total_show_delay_us;
+	// Where the finger was last seen, without any prediction.
+	double unpredicted_squared_error;
+	float unpredicted_max_error;
+	double squared_errors[PREDICTION_LOOKAHEAD_COUNT];
+	float max_errors[PREDICTION_LOOKAHEAD_COUNT];
+} TouchPredictionMeasurement;
+
+// From none to three frames at 60 Hz, in half frames.
+static const long long prediction_lookaheads_us[PREDICTION_LOOKAHEAD_COUNT] = {
+	0, 8333, 16667, 25000, 33333, 41667, 50000};
+
+void init_touch_predictor(TouchPredictor* predictor, const TableBounds* bounds);
+
+/* Forgets every sample, as when a new touch starts. */
+void reset_touch_predictor(TouchPredictor* predictor);
+
+/* Samples have to come in order. */
+void add_touch_sample(TouchPredictor* predictor, long long time_us, float x, float z);
+
+/* Predicts where the finger will be lookahead_us after now. Returns zero if
+   there have been no samples since the last reset. */
+int predict_touch(const TouchPredictor* predictor, long long now_us, long long lookahead_us, float* x, float* z);
+
+/* Where the finger was at the given time, between the samples on either
+   side of it. Returns zero if the samples don't reach that far. */
+int get_sampled_touch_position(const TouchPredictor* predictor, long long time_us, float* x, float* z);
+
+void reset_touch_prediction_measurement(TouchPredictionMeasurement* measurement);
+
+/* Remembers the predictor's fit for a frame recorded now, which is expected
+   to be shown after the given delay. */
+void record_touch_prediction(TouchPredictionMeasurement* measurement, const TouchPredictor* predictor,
+	long long now_us, long long show_delay_us);
+
+/* Scores every remembered prediction that the predictor's samples now
+   reach past. Call after adding samples. */
+void resolve_touch_predictions(TouchPredictionMeasurement* measurement, const TouchPredictor* predictor);
+
+/* Logs the error at each lookahead, and which did best. */
+void log_touch_prediction_measurement(const TouchPredictionMeasurement* measurement);
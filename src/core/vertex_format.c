@@ -0,0 +1,87 @@
+#include "vertex_format.h"
+#include "buffer.h"
+#include "math_helper.h"
+#include "platform_gl.h"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+const VertexFormat quantized_position_3d_format = {
+	{3, GL_SHORT, GL_TRUE, 0},
+	{0, 0, GL_FALSE, 0},
+	4 * sizeof(GLshort)};
+
+const VertexFormat quantized_position_2d_texture_format = {
+	{2, GL_SHORT, GL_TRUE, 0},
+	{2, GL_UNSIGNED_SHORT, GL_TRUE, 2 * sizeof(GLshort)},
+	4 * sizeof(GLshort)};
+
+const VertexFormat position_2d_format = {
+	{2, GL_FLOAT, GL_FALSE, 0},
+	{0, 0, GL_FALSE, 0},
+	2 * sizeof(GLfloat)};
+
+static GLshort quantize_signed(float value, float scale) {
+	return (GLshort) lrintf(clamp(value / scale, -1.0f, 1.0f) * 32767.0f);
+}
+
+static GLushort quantize_unsigned(float value) {
+	return (GLushort) lrintf(clamp(value, 0.0f, 1.0f) * 65535.0f);
+}
+
+void* quantize_vertices(const VertexFormat* format, const float* vertices, int vertex_count,
+	vec3 position_scale, Arena* arena) {
+	assert(format != NULL);
+	assert(vertices != NULL);
+	assert(arena != NULL);
+	assert(format->position.type == GL_SHORT);
+	assert(format->texture_coordinates.component_count == 0 || format->texture_coordinates.type == GL_UNSIGNED_SHORT);
+
+	const int position_components = format->position.component_count;
+	const int components_per_vertex = position_components + format->texture_coordinates.component_count;
+	int vertex, i;
+
+	// Axes that the format doesn't store, or where every vertex is at zero, keep a scale of one.
+	position_scale[0] = position_scale[1] = position_scale[2] = 0.0f;
+	for (vertex = 0; vertex < vertex_count; vertex++) {
+		for (i = 0; i < position_components; i++)
+			position_scale[i] = fmaxf(position_scale[i], fabsf(vertices[vertex * components_per_vertex + i]));
+	}
+	for (i = 0; i < 3; i++) {
+		if (position_scale[i] == 0.0f)
+			position_scale[i] = 1.0f;
+	}
+
+	unsigned char* data = allocate_from_arena(arena, (size_t) vertex_count * format->stride);
+	memset(data, 0, (size_t) vertex_count * format->stride);
+
+	for (vertex = 0; vertex < vertex_count; vertex++) {
+		const float* in = vertices + vertex * components_per_vertex;
+		unsigned char* out = data + (size_t) vertex * format->stride;
+
+		GLshort* position = (GLshort*) (out + format->position.offset);
+		for (i = 0; i < position_components; i++)
+			position[i] = quantize_signed(in[i], position_scale[i]);
+
+		GLushort* texture_coordinates = (GLushort*) (out + format->texture_coordinates.offset);
+		for (i = 0; i < format->texture_coordinates.component_count; i++)
+			texture_coordinates[i] = quantize_unsigned(in[position_components + i]);
+	}
+
+	return data;
+}
+
+static void bind_attribute(const VertexAttributeFormat* attribute, GLsizei stride, size_t base_offset, GLint location) {
+	if (attribute->component_count == 0 || location < 0)
+		return;
+	glVertexAttribPointer(location, attribute->component_count, attribute->type, attribute->normalized,
+		stride, BUFFER_OFFSET(base_offset + attribute->offset));
+	glEnableVertexAttribArray(location);
+}
+
+void bind_vertex_format(const VertexFormat* format, size_t base_offset,
+	GLint position_location, GLint texture_coordinates_location) {
+	assert(format != NULL);
+	bind_attribute(&format->position, format->stride, base_offset, position_location);
+	bind_attribute(&format->texture_coordinates, format->stride, base_offset, texture_coordinates_location);
+}
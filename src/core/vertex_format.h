@@ -0,0 +1,43 @@
+#pragma once
+#include "arena.h"
+#include "platform_gl.h"
+#include "linmath.h"
+
+/* Describes how vertices are laid out in a buffer, so that drawing code sets
+   up its attributes from the format instead of from hardcoded strides.
+
+   Quantized positions are stored as normalized shorts, which the GPU reads
+   back as -1..1; the scale that maps that range back to model space is
+   folded into the matrix the vertices are drawn with. Texture coordinates are
+   normalized unsigned shorts, which cover 0..1 exactly. */
+
+typedef struct {
+	// Zero for an attribute that the format doesn't have.
+	GLint component_count;
+	GLenum type;
+	GLboolean normalized;
+	size_t offset;
+} VertexAttributeFormat;
+
+typedef struct {
+	VertexAttributeFormat position;
+	VertexAttributeFormat texture_coordinates;
+	GLsizei stride;
+} VertexFormat;
+
+// X, Y, Z, padded to eight bytes so every vertex stays four-byte aligned.
+extern const VertexFormat quantized_position_3d_format;
+// X, Y, then S, T.
+extern const VertexFormat quantized_position_2d_texture_format;
+// X, Y as floats, for vertices that are written every frame.
+extern const VertexFormat position_2d_format;
+
+/* Converts vertices given as floats, with the same components in the same
+   order as the format, into the format's layout in the arena. The scale to
+   draw them with is the largest magnitude on each axis. */
+void* quantize_vertices(const VertexFormat* format, const float* vertices, int vertex_count,
+	vec3 position_scale, Arena* arena);
+
+/* The first vertex is at base_offset in the buffer bound to GL_ARRAY_BUFFER. */
+void bind_vertex_format(const VertexFormat* format, size_t base_offset,
+	GLint position_location, GLint texture_coordinates_location);
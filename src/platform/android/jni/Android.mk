@@ -7,22 +7,44 @@ include $(CLEAR_VARS)
 LOCAL_MODULE    := game
 LOCAL_CFLAGS    := -Wall -Wextra
 LOCAL_SRC_FILES := platform_asset_utils.c \
+                   platform_gl.c \
                    platform_log.c \
                    renderer_wrapper.c \
+                   $(CORE_RELATIVE_PATH)/ai.c \
+                   $(CORE_RELATIVE_PATH)/arena.c \
 				   $(CORE_RELATIVE_PATH)/asset_utils.c \
 				   $(CORE_RELATIVE_PATH)/buffer.c \
+                   $(CORE_RELATIVE_PATH)/camera.c \
+                   $(CORE_RELATIVE_PATH)/command_list.c \
+                   $(CORE_RELATIVE_PATH)/entities.c \
+                   $(CORE_RELATIVE_PATH)/frame_pipeline.c \
+                   $(CORE_RELATIVE_PATH)/frame_uniforms.c \
 				   $(CORE_RELATIVE_PATH)/game_objects.c \
                    $(CORE_RELATIVE_PATH)/game.c \
+                   $(CORE_RELATIVE_PATH)/game_state.c \
+                   $(CORE_RELATIVE_PATH)/gl_features.c \
+                   $(CORE_RELATIVE_PATH)/gl_resources.c \
                    $(CORE_RELATIVE_PATH)/image.c \
+                   $(CORE_RELATIVE_PATH)/ktx.c \
+                   $(CORE_RELATIVE_PATH)/particles.c \
+                   $(CORE_RELATIVE_PATH)/picking.c \
                    $(CORE_RELATIVE_PATH)/program.c \
+                   $(CORE_RELATIVE_PATH)/qoi.c \
+                   $(CORE_RELATIVE_PATH)/render_target.c \
+                   $(CORE_RELATIVE_PATH)/resolution_scaler.c \
                    $(CORE_RELATIVE_PATH)/shader.c \
+                   $(CORE_RELATIVE_PATH)/stream_buffer.c \
+                   $(CORE_RELATIVE_PATH)/table_sdf.c \
+                   $(CORE_RELATIVE_PATH)/telemetry.c \
                    $(CORE_RELATIVE_PATH)/texture.c \
+                   $(CORE_RELATIVE_PATH)/touch_predictor.c \
+                   $(CORE_RELATIVE_PATH)/vertex_format.c \
                   
 LOCAL_C_INCLUDES := $(PROJECT_ROOT_PATH)/platform/common/
 LOCAL_C_INCLUDES += $(PROJECT_ROOT_PATH)/core/
 LOCAL_C_INCLUDES += $(PROJECT_ROOT_PATH)/3rdparty/linmath/
 LOCAL_STATIC_LIBRARIES := libpng
-LOCAL_LDLIBS := -lGLESv2 -llog -landroid
+LOCAL_LDLIBS := -lGLESv2 -lEGL -llog -landroid
 
 include $(BUILD_SHARED_LIBRARY)
 
@@ -11,8 +11,10 @@ JNIEXPORT void JNICALL Java_com_learnopengles_airhockey_platform_PlatformFileUti
 	asset_manager = AAssetManager_fromJava(env, java_asset_manager);
 }
 
-FileData get_asset_data(const char* relative_path) {
+FileData get_asset_data(const char* relative_path, Arena* arena) {
 	assert(relative_path != NULL);
+	// The asset manager maps assets in place, so nothing is allocated.
+	UNUSED(arena);
 	AAsset* asset = AAssetManager_open(asset_manager, relative_path, AASSET_MODE_STREAMING);
 	assert(asset != NULL);
 
@@ -0,0 +1,29 @@
+#include "platform_gl.h"
+#include <EGL/egl.h>
+#include <stddef.h>
+
+void (GL_APIENTRY* gles3_bind_buffer_range)(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+	GLsizeiptr size);
+GLuint (GL_APIENTRY* gles3_get_uniform_block_index)(GLuint program, const GLchar* uniform_block_name);
+void (GL_APIENTRY* gles3_uniform_block_binding)(GLuint program, GLuint uniform_block_index,
+	GLuint uniform_block_binding);
+void* (GL_APIENTRY* gles3_map_buffer_range)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+GLboolean (GL_APIENTRY* gles3_unmap_buffer)(GLenum target);
+GLsync (GL_APIENTRY* gles3_fence_sync)(GLenum condition, GLbitfield flags);
+GLenum (GL_APIENTRY* gles3_client_wait_sync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+void (GL_APIENTRY* gles3_delete_sync)(GLsync sync);
+
+#define LOAD(function, name) ((function) = (__typeof__(function)) eglGetProcAddress(name))
+
+int load_gles3_functions() {
+	// eglGetProcAddress() may return an entry point for anything on older
+	// devices, so this is only trusted once the context says it's 3.0.
+	return LOAD(gles3_bind_buffer_range, "glBindBufferRange") != NULL
+		&& LOAD(gles3_get_uniform_block_index, "glGetUniformBlockIndex") != NULL
+		&& LOAD(gles3_uniform_block_binding, "glUniformBlockBinding") != NULL
+		&& LOAD(gles3_map_buffer_range, "glMapBufferRange") != NULL
+		&& LOAD(gles3_unmap_buffer, "glUnmapBuffer") != NULL
+		&& LOAD(gles3_fence_sync, "glFenceSync") != NULL
+		&& LOAD(gles3_client_wait_sync, "glClientWaitSync") != NULL
+		&& LOAD(gles3_delete_sync, "glDeleteSync") != NULL;
+}
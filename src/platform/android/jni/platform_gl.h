@@ -1 +1,50 @@
+#pragma once
+/* The game links against OpenGL ES 2.0 only, so that it still loads on
+   devices that don't have 3.0. The parts of 3.0 that the core uses are
+   declared here, with values from <GLES3/gl3.h>, and their functions are
+   looked up once a context is current. gl_features only turns them on if
+   the context is 3.0 and every one of them was found. */
 #include <GLES2/gl2.h>
+
+#define GL_ES_VERSION_3_0 1
+#define PLATFORM_LOADS_GLES3_FUNCTIONS 1
+
+typedef khronos_uint64_t GLuint64;
+typedef struct __GLsync* GLsync;
+
+#define GL_STREAM_READ                    0x88E1
+#define GL_PIXEL_PACK_BUFFER              0x88EB
+#define GL_UNIFORM_BUFFER                 0x8A11
+#define GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 0x8A34
+#define GL_INVALID_INDEX                  0xFFFFFFFFu
+#define GL_MAP_READ_BIT                   0x0001
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT       0x0004
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_TIMEOUT_EXPIRED                0x911B
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+
+/* Returns non-zero if every function below was found. */
+int load_gles3_functions();
+
+extern void (GL_APIENTRY* gles3_bind_buffer_range)(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+	GLsizeiptr size);
+extern GLuint (GL_APIENTRY* gles3_get_uniform_block_index)(GLuint program, const GLchar* uniform_block_name);
+extern void (GL_APIENTRY* gles3_uniform_block_binding)(GLuint program, GLuint uniform_block_index,
+	GLuint uniform_block_binding);
+extern void* (GL_APIENTRY* gles3_map_buffer_range)(GLenum target, GLintptr offset, GLsizeiptr length,
+	GLbitfield access);
+extern GLboolean (GL_APIENTRY* gles3_unmap_buffer)(GLenum target);
+extern GLsync (GL_APIENTRY* gles3_fence_sync)(GLenum condition, GLbitfield flags);
+extern GLenum (GL_APIENTRY* gles3_client_wait_sync)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+extern void (GL_APIENTRY* gles3_delete_sync)(GLsync sync);
+
+#define glBindBufferRange gles3_bind_buffer_range
+#define glGetUniformBlockIndex gles3_get_uniform_block_index
+#define glUniformBlockBinding gles3_uniform_block_binding
+#define glMapBufferRange gles3_map_buffer_range
+#define glUnmapBuffer gles3_unmap_buffer
+#define glFenceSync gles3_fence_sync
+#define glClientWaitSync gles3_client_wait_sync
+#define glDeleteSync gles3_delete_sync
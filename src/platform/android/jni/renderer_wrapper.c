@@ -22,6 +22,12 @@ JNIEXPORT void JNICALL Java_com_learnopengles_airhockey_RendererWrapper_on_1draw
 	on_draw_frame();
 }
 
+JNIEXPORT jboolean JNICALL Java_com_learnopengles_airhockey_RendererWrapper_is_1frame_1needed(JNIEnv* env, jclass cls) {
+	UNUSED(env);
+	UNUSED(cls);
+	return is_frame_needed() ? JNI_TRUE : JNI_FALSE;
+}
+
 JNIEXPORT void JNICALL Java_com_learnopengles_airhockey_RendererWrapper_on_1touch_1press(JNIEnv* env, jclass cls, jfloat normalized_x, jfloat normalized_y) {
 	UNUSED(env);
 	UNUSED(cls);
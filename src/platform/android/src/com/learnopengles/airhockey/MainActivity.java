@@ -26,6 +26,8 @@ public class MainActivity extends Activity {
 
 		final boolean supportsEs2 = 
 			configurationInfo.reqGlEsVersion >= 0x20000 || isProbablyEmulator();
+		// The game checks which version it got, and only uses ES 3 where it's there.
+		final boolean supportsEs3 = configurationInfo.reqGlEsVersion >= 0x30000;
 
 		if (supportsEs2) {
 			glSurfaceView = new GLSurfaceView(this);
@@ -35,9 +37,10 @@ public class MainActivity extends Activity {
 				glSurfaceView.setEGLConfigChooser(8, 8, 8, 8, 16, 0);
 			}
 
-			final RendererWrapper rendererWrapper = new RendererWrapper(this);
-			glSurfaceView.setEGLContextClientVersion(2);
+			final RendererWrapper rendererWrapper = new RendererWrapper(this, glSurfaceView);
+			glSurfaceView.setEGLContextClientVersion(supportsEs3 ? 3 : 2);
 			glSurfaceView.setRenderer(rendererWrapper);
+			glSurfaceView.setRenderMode(GLSurfaceView.RENDERMODE_WHEN_DIRTY);
 			rendererSet = true;
 			setContentView(glSurfaceView);
 			
@@ -61,6 +64,7 @@ public class MainActivity extends Activity {
 	                                    normalizedX, normalizedY);
 	                            }
 	                        });
+	                        glSurfaceView.requestRender();
 	                    } else if (event.getAction() == MotionEvent.ACTION_MOVE) {
 	                        glSurfaceView.queueEvent(new Runnable() {
 	                            @Override
@@ -69,6 +73,7 @@ public class MainActivity extends Activity {
 	                                    normalizedX, normalizedY);
 	                            }
 	                        });
+	                        glSurfaceView.requestRender();
 	                    }                    
 
 	                    return true;                    
@@ -4,6 +4,7 @@ import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
 import android.content.Context;
+import android.opengl.GLSurfaceView;
 import android.opengl.GLSurfaceView.Renderer;
 
 import com.learnopengles.airhockey.platform.PlatformFileUtils;
@@ -14,9 +15,13 @@ public class RendererWrapper implements Renderer {
 	}
 	
 	private final Context context;	
+	private final GLSurfaceView glSurfaceView;
 	
-	public RendererWrapper(Context context) {
+	// The view renders when dirty, so frames are only drawn while the game
+	// says that something has changed, or when a touch comes in.
+	public RendererWrapper(Context context, GLSurfaceView glSurfaceView) {
 		this.context = context;
+		this.glSurfaceView = glSurfaceView;
 	}
 	
 	@Override
@@ -33,6 +38,9 @@ public class RendererWrapper implements Renderer {
 	@Override
 	public void onDrawFrame(GL10 gl) {
 		on_draw_frame();
+		if (is_frame_needed()) {
+			glSurfaceView.requestRender();
+		}
 	}
 	
 	private static native void on_surface_created();
@@ -41,6 +49,8 @@ public class RendererWrapper implements Renderer {
 
 	private static native void on_draw_frame();
 
+	private static native boolean is_frame_needed();
+
 	public void handleTouchPress(float normalizedX, float normalizedY) {
 		on_touch_press(normalizedX, normalizedY);		
 	}
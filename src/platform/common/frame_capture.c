@@ -0,0 +1,393 @@
+#include "frame_capture.h"
+#include "gl_features.h"
+#include "platform_gl.h"
+#include "platform_log.h"
+#include "timer.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define TAG "frame_capture"
+
+// Frames waiting for the writer thread. Enough to ride out the odd slow
+// write without making capture_frame() wait.
+#define FRAME_SLOT_COUNT 8
+
+// A readback is mapped this many frames after it was issued.
+#define PIXEL_PACK_BUFFER_COUNT 3
+
+struct FrameCapture {
+	FILE* file;
+	CaptureFormat format;
+	int width;
+	int height;
+	size_t frame_size;
+
+	// Frames go from the render thread to the writer through a ring of slots.
+	uint8_t* slots[FRAME_SLOT_COUNT];
+	int first_full_slot;
+	int full_slot_count;
+	int is_stopping;
+	pthread_mutex_t mutex;
+	pthread_cond_t slot_filled;
+	pthread_cond_t slot_emptied;
+	pthread_t writer;
+
+	// Owned by the writer thread.
+	uint8_t* output;
+	size_t output_size;
+
+	int uses_pixel_pack_buffers;
+	GLuint pixel_pack_buffers[PIXEL_PACK_BUFFER_COUNT];
+	int next_pixel_pack_buffer;
+	int pending_readbacks;
+
+	FrameCaptureStats stats;
+};
+
+/* RGBA to YUV */
+
+// BT.601 with studio range, in 8 bits of fraction, as Y4M players expect.
+static inline uint8_t get_luma(int r, int g, int b) {
+	return (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline uint8_t get_blue_difference(int r, int g, int b) {
+	return (uint8_t) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline uint8_t get_red_difference(int r, int g, int b) {
+	return (uint8_t) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/* Converts columns [first_x, width) of two rows, averaging chroma over each 2x2 block. */
+static void convert_row_pair_scalar(const uint8_t* top, const uint8_t* bottom, int first_x, int width,
+	uint8_t* top_luma, uint8_t* bottom_luma, uint8_t* u, uint8_t* v) {
+	int x;
+	for (x = first_x; x < width; x += 2) {
+		const uint8_t* pixels[4] = {top + x * 4, top + x * 4 + 4, bottom + x * 4, bottom + x * 4 + 4};
+		top_luma[x] = get_luma(pixels[0][0], pixels[0][1], pixels[0][2]);
+		top_luma[x + 1] = get_luma(pixels[1][0], pixels[1][1], pixels[1][2]);
+		bottom_luma[x] = get_luma(pixels[2][0], pixels[2][1], pixels[2][2]);
+		bottom_luma[x + 1] = get_luma(pixels[3][0], pixels[3][1], pixels[3][2]);
+
+		const int r = (pixels[0][0] + pixels[1][0] + pixels[2][0] + pixels[3][0] + 2) >> 2;
+		const int g = (pixels[0][1] + pixels[1][1] + pixels[2][1] + pixels[3][1] + 2) >> 2;
+		const int b = (pixels[0][2] + pixels[1][2] + pixels[2][2] + pixels[3][2] + 2) >> 2;
+		u[x / 2] = get_blue_difference(r, g, b);
+		v[x / 2] = get_red_difference(r, g, b);
+	}
+}
+
+#if defined(__SSE2__)
+
+/* Splits eight RGBA pixels into 16-bit red, green and blue. */
+static inline void unpack_channels(const uint8_t* pixels, __m128i* r, __m128i* g, __m128i* b) {
+	const __m128i low_byte = _mm_set1_epi32(0xFF);
+	const __m128i first = _mm_loadu_si128((const __m128i*) pixels);
+	const __m128i second = _mm_loadu_si128((const __m128i*) (pixels + 16));
+
+	*r = _mm_packs_epi32(_mm_and_si128(first, low_byte), _mm_and_si128(second, low_byte));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(first, 8), low_byte),
+		_mm_and_si128(_mm_srli_epi32(second, 8), low_byte));
+	*b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(first, 16), low_byte),
+		_mm_and_si128(_mm_srli_epi32(second, 16), low_byte));
+}
+
+static inline __m128i get_luma_x8(__m128i r, __m128i g, __m128i b) {
+	// The weighted sum tops out at 56228, so it's done in unsigned 16 bits.
+	const __m128i sum = _mm_add_epi16(
+		_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(66)), _mm_mullo_epi16(g, _mm_set1_epi16(129))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(25)), _mm_set1_epi16(128)));
+	return _mm_add_epi16(_mm_srli_epi16(sum, 8), _mm_set1_epi16(16));
+}
+
+static inline __m128i get_chroma_x8(__m128i r, __m128i g, __m128i b, short r_weight, short g_weight, short b_weight) {
+	// Each weighted sum stays within +/-28560, so signed 16 bits is enough.
+	const __m128i sum = _mm_add_epi16(
+		_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(r_weight)), _mm_mullo_epi16(g, _mm_set1_epi16(g_weight))),
+		_mm_add_epi16(_mm_mullo_epi16(b, _mm_set1_epi16(b_weight)), _mm_set1_epi16(128)));
+	return _mm_add_epi16(_mm_srai_epi16(sum, 8), _mm_set1_epi16(128));
+}
+
+/* Sums horizontally adjacent pairs of two rows and averages them, giving four
+   values in the low half of the result. */
+static inline __m128i average_2x2(__m128i top, __m128i bottom) {
+	const __m128i pair_sums = _mm_madd_epi16(_mm_add_epi16(top, bottom), _mm_set1_epi16(1));
+	const __m128i averages = _mm_srli_epi32(_mm_add_epi32(pair_sums, _mm_set1_epi32(2)), 2);
+	return _mm_packs_epi32(averages, averages);
+}
+
+/* Sixteen pixels from each row at a time: sixteen luma samples per row and eight of each chroma. */
+static void convert_row_pair(const uint8_t* top, const uint8_t* bottom, int width,
+	uint8_t* top_luma, uint8_t* bottom_luma, uint8_t* u, uint8_t* v) {
+	int x;
+	for (x = 0; x + 16 <= width; x += 16) {
+		__m128i top_r[2], top_g[2], top_b[2], bottom_r[2], bottom_g[2], bottom_b[2];
+		__m128i u_halves[2], v_halves[2];
+		int half;
+
+		for (half = 0; half < 2; half++) {
+			unpack_channels(top + (x + half * 8) * 4, &top_r[half], &top_g[half], &top_b[half]);
+			unpack_channels(bottom + (x + half * 8) * 4, &bottom_r[half], &bottom_g[half], &bottom_b[half]);
+
+			const __m128i r = average_2x2(top_r[half], bottom_r[half]);
+			const __m128i g = average_2x2(top_g[half], bottom_g[half]);
+			const __m128i b = average_2x2(top_b[half], bottom_b[half]);
+			u_halves[half] = get_chroma_x8(r, g, b, -38, -74, 112);
+			v_halves[half] = get_chroma_x8(r, g, b, 112, -94, -18);
+		}
+
+		_mm_storeu_si128((__m128i*) (top_luma + x), _mm_packus_epi16(
+			get_luma_x8(top_r[0], top_g[0], top_b[0]), get_luma_x8(top_r[1], top_g[1], top_b[1])));
+		_mm_storeu_si128((__m128i*) (bottom_luma + x), _mm_packus_epi16(
+			get_luma_x8(bottom_r[0], bottom_g[0], bottom_b[0]), get_luma_x8(bottom_r[1], bottom_g[1], bottom_b[1])));
+
+		// Only the low four lanes of each half are meaningful.
+		const __m128i u_values = _mm_packus_epi16(_mm_unpacklo_epi64(u_halves[0], u_halves[1]), _mm_setzero_si128());
+		const __m128i v_values = _mm_packus_epi16(_mm_unpacklo_epi64(v_halves[0], v_halves[1]), _mm_setzero_si128());
+		_mm_storel_epi64((__m128i*) (u + x / 2), u_values);
+		_mm_storel_epi64((__m128i*) (v + x / 2), v_values);
+	}
+
+	convert_row_pair_scalar(top, bottom, x, width, top_luma, bottom_luma, u, v);
+}
+
+#else
+
+static void convert_row_pair(const uint8_t* top, const uint8_t* bottom, int width,
+	uint8_t* top_luma, uint8_t* bottom_luma, uint8_t* u, uint8_t* v) {
+	convert_row_pair_scalar(top, bottom, 0, width, top_luma, bottom_luma, u, v);
+}
+
+#endif
+
+/* Converts a bottom-up RGBA frame, as GL reads it back, to top-down I420. */
+static void convert_rgba_to_i420(const uint8_t* rgba, int width, int height, uint8_t* out) {
+	uint8_t* luma = out;
+	uint8_t* u = luma + width * height;
+	uint8_t* v = u + (width / 2) * (height / 2);
+	const size_t stride = (size_t) width * 4;
+	int y;
+
+	for (y = 0; y < height; y += 2) {
+		const uint8_t* top = rgba + (height - 1 - y) * stride;
+		const uint8_t* bottom = top - stride;
+		convert_row_pair(top, bottom, width, luma + y * width, luma + (y + 1) * width,
+			u + (y / 2) * (width / 2), v + (y / 2) * (width / 2));
+	}
+}
+
+/* Writer thread */
+
+static void write_frame(FrameCapture* capture, const uint8_t* rgba) {
+	if (capture->format == CAPTURE_FORMAT_Y4M) {
+		convert_rgba_to_i420(rgba, capture->width, capture->height, capture->output);
+		fputs("FRAME\n", capture->file);
+		fwrite(capture->output, 1, capture->output_size, capture->file);
+	} else {
+		const size_t stride = (size_t) capture->width * 4;
+		int y;
+		for (y = capture->height - 1; y >= 0; y--)
+			fwrite(rgba + y * stride, 1, stride, capture->file);
+	}
+}
+
+static void* run_writer(void* argument) {
+	FrameCapture* capture = argument;
+
+	pthread_mutex_lock(&capture->mutex);
+	for (;;) {
+		while (capture->full_slot_count == 0 && !capture->is_stopping)
+			pthread_cond_wait(&capture->slot_filled, &capture->mutex);
+		if (capture->full_slot_count == 0)
+			break;
+
+		const uint8_t* slot = capture->slots[capture->first_full_slot];
+		pthread_mutex_unlock(&capture->mutex);
+
+		write_frame(capture, slot);
+
+		pthread_mutex_lock(&capture->mutex);
+		capture->first_full_slot = (capture->first_full_slot + 1) % FRAME_SLOT_COUNT;
+		capture->full_slot_count--;
+		pthread_cond_signal(&capture->slot_emptied);
+	}
+	pthread_mutex_unlock(&capture->mutex);
+	return NULL;
+}
+
+/* Render thread */
+
+static uint8_t* acquire_empty_slot(FrameCapture* capture) {
+	pthread_mutex_lock(&capture->mutex);
+	if (capture->full_slot_count == FRAME_SLOT_COUNT) {
+		capture->stats.frames_waited_for_writer++;
+		while (capture->full_slot_count == FRAME_SLOT_COUNT)
+			pthread_cond_wait(&capture->slot_emptied, &capture->mutex);
+	}
+	uint8_t* slot = capture->slots[(capture->first_full_slot + capture->full_slot_count) % FRAME_SLOT_COUNT];
+	pthread_mutex_unlock(&capture->mutex);
+	return slot;
+}
+
+static void submit_slot(FrameCapture* capture) {
+	pthread_mutex_lock(&capture->mutex);
+	capture->full_slot_count++;
+	capture->stats.frames_captured++;
+	pthread_cond_signal(&capture->slot_filled);
+	pthread_mutex_unlock(&capture->mutex);
+}
+
+#if HAVE_GLES3_HEADERS
+
+/* Maps the oldest readback, which has had a couple of frames to complete, and queues it. */
+static void collect_oldest_readback(FrameCapture* capture) {
+	const int oldest = (capture->next_pixel_pack_buffer + PIXEL_PACK_BUFFER_COUNT - capture->pending_readbacks)
+		% PIXEL_PACK_BUFFER_COUNT;
+	uint8_t* slot = acquire_empty_slot(capture);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pixel_pack_buffers[oldest]);
+	const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, capture->frame_size, GL_MAP_READ_BIT);
+	if (pixels != NULL) {
+		memcpy(slot, pixels, capture->frame_size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	} else {
+		DEBUG_LOG_WRITE_W(TAG, "Couldn't map a pixel pack buffer; the frame will be blank.");
+		memset(slot, 0, capture->frame_size);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	capture->pending_readbacks--;
+	submit_slot(capture);
+}
+
+static void read_frame_into_pixel_pack_buffer(FrameCapture* capture) {
+	if (capture->pending_readbacks == PIXEL_PACK_BUFFER_COUNT)
+		collect_oldest_readback(capture);
+
+	// With a pack buffer bound, this only queues the copy.
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pixel_pack_buffers[capture->next_pixel_pack_buffer]);
+	glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	capture->next_pixel_pack_buffer = (capture->next_pixel_pack_buffer + 1) % PIXEL_PACK_BUFFER_COUNT;
+	capture->pending_readbacks++;
+}
+
+#endif
+
+static void read_frame(FrameCapture* capture) {
+#if HAVE_GLES3_HEADERS
+	if (capture->uses_pixel_pack_buffers) {
+		read_frame_into_pixel_pack_buffer(capture);
+		return;
+	}
+#endif
+
+	uint8_t* slot = acquire_empty_slot(capture);
+	glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, slot);
+	submit_slot(capture);
+}
+
+FrameCapture* start_frame_capture(const char* path, CaptureFormat format,
+	int width, int height, int frames_per_second) {
+	assert(path != NULL);
+	assert(width > 0 && height > 0 && frames_per_second > 0);
+
+	if (format == CAPTURE_FORMAT_Y4M && (width % 2 != 0 || height % 2 != 0)) {
+		DEBUG_LOG_PRINT_E(TAG, "Y4M capture needs an even size, not %dx%d", width, height);
+		return NULL;
+	}
+
+	FrameCapture* capture = calloc(1, sizeof(FrameCapture));
+	assert(capture != NULL);
+	capture->file = fopen(path, "wb");
+	if (capture->file == NULL) {
+		DEBUG_LOG_PRINT_E(TAG, "Couldn't open %s for writing", path);
+		free(capture);
+		return NULL;
+	}
+
+	capture->format = format;
+	capture->width = width;
+	capture->height = height;
+	capture->frame_size = (size_t) width * height * 4;
+	capture->output_size = (size_t) width * height + 2 * (size_t) (width / 2) * (height / 2);
+
+	int i;
+	for (i = 0; i < FRAME_SLOT_COUNT; i++) {
+		capture->slots[i] = malloc(capture->frame_size);
+		assert(capture->slots[i] != NULL);
+	}
+	if (format == CAPTURE_FORMAT_Y4M) {
+		capture->output = malloc(capture->output_size);
+		assert(capture->output != NULL);
+		fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, frames_per_second);
+	}
+
+	capture->uses_pixel_pack_buffers = get_gl_features()->has_pixel_pack_buffers;
+#if HAVE_GLES3_HEADERS
+	if (capture->uses_pixel_pack_buffers) {
+		glGenBuffers(PIXEL_PACK_BUFFER_COUNT, capture->pixel_pack_buffers);
+		for (i = 0; i < PIXEL_PACK_BUFFER_COUNT; i++) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->pixel_pack_buffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, capture->frame_size, NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+#endif
+	capture->stats.uses_pixel_pack_buffers = capture->uses_pixel_pack_buffers;
+
+	pthread_mutex_init(&capture->mutex, NULL);
+	pthread_cond_init(&capture->slot_filled, NULL);
+	pthread_cond_init(&capture->slot_emptied, NULL);
+	pthread_create(&capture->writer, NULL, run_writer, capture);
+
+	return capture;
+}
+
+void capture_frame(FrameCapture* capture) {
+	assert(capture != NULL);
+	const long long start = get_time_in_microseconds();
+	read_frame(capture);
+	capture->stats.total_capture_time_us += get_time_in_microseconds() - start;
+}
+
+FrameCaptureStats stop_frame_capture(FrameCapture* capture) {
+	assert(capture != NULL);
+
+#if HAVE_GLES3_HEADERS
+	if (capture->uses_pixel_pack_buffers) {
+		while (capture->pending_readbacks > 0)
+			collect_oldest_readback(capture);
+		glDeleteBuffers(PIXEL_PACK_BUFFER_COUNT, capture->pixel_pack_buffers);
+	}
+#endif
+
+	pthread_mutex_lock(&capture->mutex);
+	capture->is_stopping = 1;
+	pthread_cond_signal(&capture->slot_filled);
+	pthread_mutex_unlock(&capture->mutex);
+	pthread_join(capture->writer, NULL);
+
+	pthread_cond_destroy(&capture->slot_emptied);
+	pthread_cond_destroy(&capture->slot_filled);
+	pthread_mutex_destroy(&capture->mutex);
+
+	fclose(capture->file);
+	int i;
+	for (i = 0; i < FRAME_SLOT_COUNT; i++)
+		free(capture->slots[i]);
+	free(capture->output);
+
+	const FrameCaptureStats stats = capture->stats;
+	free(capture);
+	return stats;
+}
@@ -0,0 +1,32 @@
+#pragma once
+/* Records every frame to a file without waiting on the GPU. Where the
+   context has pixel pack buffers, each frame is read back into one of a ring
+   of buffers and only mapped a couple of frames later, once the copy has
+   finished; elsewhere it falls back to glReadPixels(). Either way the pixels
+   are handed to a writer thread, which converts and writes them out. */
+
+typedef enum {
+	CAPTURE_FORMAT_Y4M,
+	CAPTURE_FORMAT_RAW_RGBA,
+} CaptureFormat;
+
+typedef struct {
+	unsigned long long frames_captured;
+	// Frames where the writer had fallen behind and capture_frame() had to wait.
+	unsigned long long frames_waited_for_writer;
+	long long total_capture_time_us;
+	int uses_pixel_pack_buffers;
+} FrameCaptureStats;
+
+typedef struct FrameCapture FrameCapture;
+
+/* Y4M needs an even width and height, since chroma is subsampled 2x2. Call
+   with the context current, once get_gl_features() knows what it can do. */
+FrameCapture* start_frame_capture(const char* path, CaptureFormat format,
+	int width, int height, int frames_per_second);
+
+/* Call after drawing each frame, with the framebuffer to capture bound. */
+void capture_frame(FrameCapture* capture);
+
+/* Writes out any frames still in flight, closes the file and frees everything. */
+FrameCaptureStats stop_frame_capture(FrameCapture* capture);
@@ -1,4 +1,5 @@
 #include "platform_file_utils.h"
 
-FileData get_asset_data(const char* relative_path);
+/* Platforms that need to copy the asset into memory do so in the arena. */
+FileData get_asset_data(const char* relative_path, Arena* arena);
 void release_asset_data(const FileData* file_data);
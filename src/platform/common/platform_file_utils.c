@@ -1,10 +1,10 @@
 #include "platform_file_utils.h"
 #include <assert.h>
 #include <stdio.h>
-#include <stdlib.h>
 
-FileData get_file_data(const char* path) {
+FileData get_file_data(const char* path, Arena* arena) {
 	assert(path != NULL);
+	assert(arena != NULL);
 		
 	FILE* stream = fopen(path, "r");
 	assert (stream != NULL);
@@ -13,7 +13,7 @@ FileData get_file_data(const char* path) {
 	long stream_size = ftell(stream);
 	fseek(stream, 0, SEEK_SET);
 
-	void* buffer = malloc(stream_size);
+	void* buffer = allocate_from_arena(arena, stream_size);
 	fread(buffer, stream_size, 1, stream);
 
 	assert(ferror(stream) == 0);
@@ -21,10 +21,3 @@ FileData get_file_data(const char* path) {
 
 	return (FileData) {stream_size, buffer, NULL};
 }
-
-void release_file_data(const FileData* file_data) {
-	assert(file_data != NULL);	
-	assert(file_data->data != NULL);
-
-	free((void*)file_data->data);
-}
@@ -1,9 +1,11 @@
 #pragma once
+#include "arena.h"
+
 typedef struct {
 	const long data_length;
 	const void* data;
 	const void* file_handle;
 } FileData;
 
-FileData get_file_data(const char* path);
-void release_file_data(const FileData* file_data);
\ No newline at end of file
+/* The data is allocated from the arena, and goes when the arena scope ends. */
+FileData get_file_data(const char* path, Arena* arena);
\ No newline at end of file
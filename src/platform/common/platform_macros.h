@@ -3,3 +3,9 @@
 #else
 #define PRINTF_ATTRIBUTE(format_pos, arg_pos)
 #endif
+
+#if defined(__GNUC__)
+#define ALIGN_ATTRIBUTE(alignment) __attribute__((aligned(alignment)))
+#else
+#define ALIGN_ATTRIBUTE(alignment)
+#endif
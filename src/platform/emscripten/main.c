@@ -18,6 +18,7 @@ int main()
 		on_surface_created();
 		on_surface_changed(width, height);
 		emscripten_set_main_loop(do_frame, 0, 1);
+		on_surface_destroyed();
 	}
 		
 	shutdown_gl();
@@ -43,8 +44,12 @@ static int init_gl()
 static void do_frame()
 {	
 	handle_input();
-	on_draw_frame();
-	glfwSwapBuffers();
+	// The canvas keeps showing the last frame until something changes.
+	if (is_frame_needed()) {
+		on_draw_frame();
+		glfwSwapBuffers();
+		on_frame_presented();
+	}
 }
 
 static void handle_input()
@@ -1,15 +1,17 @@
 #include "platform_asset_utils.h"
+#include "macros.h"
 #include "platform_file_utils.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-FileData get_asset_data(const char* relative_path) {
+FileData get_asset_data(const char* relative_path, Arena* arena) {
 	assert(relative_path != NULL);
-	return get_file_data(relative_path);
+	return get_file_data(relative_path, arena);
 }
 
 void release_asset_data(const FileData* file_data) {
 	assert(file_data != NULL);
-	release_file_data(file_data);
+	// The data belongs to the arena, so there's nothing to release.
+	UNUSED(file_data);
 }
@@ -1 +1 @@
-#include <GLES2/gl2.h>
\ No newline at end of file
+#include <GLES3/gl3.h>
\ No newline at end of file
@@ -0,0 +1,331 @@
+#define _GNU_SOURCE
+#include "env.h"
+#include "ai.h"
+#include "game_state.h"
+#include "linmath.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Matches the opponent on the server, which also runs many tables at once.
+static const float ai_mallet_speed = 0.03f;
+static const long long ai_budget_us = 10;
+
+// How fast the puck is served at the start of each episode.
+static const float serve_speed = 0.02f;
+
+// Shades of the puck and mallets in frames, on a black table.
+static const uint8_t puck_shade = 255;
+static const uint8_t blue_mallet_shade = 170;
+static const uint8_t red_mallet_shade = 85;
+
+typedef struct {
+	GameState state;
+	unsigned int episode_frame;
+	unsigned int random_state;
+} Table;
+
+struct Env {
+	int table_count;
+	int episode_length;
+	int red_is_ai;
+	Table* tables;
+	AiController* ais;
+	// Which tables finished their episode during the current step.
+	uint8_t* done;
+
+	int fd;
+	size_t shared_size;
+	EnvSharedHeader* shared;
+	uint64_t step;
+
+	EnvStats stats;
+};
+
+static size_t round_up_to_cache_line(size_t size) {
+	return (size + CACHE_LINE_SIZE - 1) & ~(size_t) (CACHE_LINE_SIZE - 1);
+}
+
+/* Returns an anonymous shared memory file of the given size, or -1. */
+static int create_shared_memory(size_t size) {
+#if defined(MFD_ALLOW_SEALING)
+	const int fd = memfd_create("airhockey_env", MFD_ALLOW_SEALING);
+#else
+	// Without memfd, a POSIX shared memory object is unlinked as soon as it's
+	// created, which leaves just the descriptor like a memfd would.
+	char name[64];
+	snprintf(name, sizeof(name), "/airhockey_env_%d", (int) getpid());
+	const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd >= 0)
+		shm_unlink(name);
+#endif
+	if (fd < 0)
+		return -1;
+
+	if (ftruncate(fd, (off_t) size) != 0) {
+		close(fd);
+		return -1;
+	}
+#if defined(MFD_ALLOW_SEALING)
+	// Consumers can trust the size to stay put once they've mapped it.
+	fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#endif
+	return fd;
+}
+
+static float next_random(unsigned int* state) {
+	*state = *state * 1664525u + 1013904223u;
+	return (float) (*state >> 8) / 16777216.0f;
+}
+
+// Every env in the process plays on the same table, baked by the first one.
+static TableSdf table_sdf;
+
+/* Starts an episode with the puck served from the center in a random direction. */
+static void reset_table(Env* env, int index) {
+	Table* table = &env->tables[index];
+	init_game_state(&table->state);
+	table->episode_frame = 0;
+
+	const float angle = next_random(&table->random_state) * 2.0f * (float) M_PI;
+	table->state.puck_vector[0] = cosf(angle) * serve_speed;
+	table->state.puck_vector[2] = sinf(angle) * serve_speed;
+
+	if (env->red_is_ai) {
+		init_ai_controller(&env->ais[index], table_bounds, puck_radius, mallet_radius, ai_mallet_speed, ai_budget_us);
+		set_ai_controller_table(&env->ais[index], &table_sdf);
+	}
+}
+
+Env* env_create(int table_count, const EnvOptions* options) {
+	assert(table_count > 0);
+	static const EnvOptions default_options = {0, 0, 0, 0, 1};
+	if (options == NULL)
+		options = &default_options;
+	assert(options->frame_width >= 0 && options->frame_height >= 0);
+	assert((options->frame_width == 0) == (options->frame_height == 0));
+
+	if (table_sdf.samples == NULL)
+		bake_standard_table_sdf(&table_sdf);
+
+	Env* env = calloc(1, sizeof(Env));
+	assert(env != NULL);
+	env->table_count = table_count;
+	env->episode_length = options->episode_length;
+	env->red_is_ai = options->red_is_ai;
+	env->fd = -1;
+	// Each table's state starts on its own cache line, which calloc() doesn't promise.
+	void* tables;
+	if (posix_memalign(&tables, CACHE_LINE_SIZE, table_count * sizeof(Table)) != 0)
+		tables = NULL;
+	assert(tables != NULL);
+	memset(tables, 0, table_count * sizeof(Table));
+	env->tables = tables;
+	env->done = calloc(table_count, sizeof(uint8_t));
+	assert(env->done != NULL);
+	if (env->red_is_ai) {
+		env->ais = calloc(table_count, sizeof(AiController));
+		assert(env->ais != NULL);
+	}
+
+	const size_t frame_size = (size_t) options->frame_width * options->frame_height;
+	const size_t slots_offset = round_up_to_cache_line(sizeof(EnvSharedHeader));
+	const size_t slot_size = round_up_to_cache_line(table_count * (sizeof(EnvObservation) + frame_size));
+	env->shared_size = slots_offset + slot_size * ENV_OBSERVATION_SLOTS;
+
+	env->fd = create_shared_memory(env->shared_size);
+	if (env->fd < 0) {
+		perror("Couldn't create shared memory for observations");
+		env_destroy(env);
+		return NULL;
+	}
+	env->shared = mmap(NULL, env->shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, env->fd, 0);
+	if (env->shared == MAP_FAILED) {
+		perror("Couldn't map shared memory for observations");
+		env->shared = NULL;
+		env_destroy(env);
+		return NULL;
+	}
+
+	EnvSharedHeader* shared = env->shared;
+	shared->magic = ENV_SHARED_MAGIC;
+	shared->version = ENV_SHARED_VERSION;
+	shared->table_count = (uint32_t) table_count;
+	shared->frame_width = (uint32_t) options->frame_width;
+	shared->frame_height = (uint32_t) options->frame_height;
+	shared->slots_offset = slots_offset;
+	shared->slot_size = slot_size;
+
+	int i;
+	for (i = 0; i < table_count; i++)
+		env->tables[i].random_state = options->seed * 2654435761u + (unsigned int) i;
+
+	env_reset(env);
+	return env;
+}
+
+void env_destroy(Env* env) {
+	assert(env != NULL);
+	if (env->shared != NULL) {
+		__atomic_store_n(&env->shared->is_closed, 1, __ATOMIC_RELEASE);
+		munmap(env->shared, env->shared_size);
+	}
+	if (env->fd >= 0)
+		close(env->fd);
+	free(env->ais);
+	free(env->done);
+	free(env->tables);
+	free(env);
+}
+
+/* Observations */
+
+static void fill_disc(uint8_t* frame, int width, int height, const float* position, float radius, uint8_t shade) {
+	// The table's bounds map onto the whole frame.
+	const float pixels_per_unit_x = width / (table_bounds.right - table_bounds.left);
+	const float pixels_per_unit_z = height / (table_bounds.near - table_bounds.far);
+	const float center_x = (position[0] - table_bounds.left) * pixels_per_unit_x;
+	const float center_y = (position[2] - table_bounds.far) * pixels_per_unit_z;
+	const float radius_x = radius * pixels_per_unit_x;
+	const float radius_y = radius * pixels_per_unit_z;
+
+	const int first_row = (int) fmaxf(0.0f, floorf(center_y - radius_y));
+	const int last_row = (int) fminf((float) height - 1.0f, ceilf(center_y + radius_y));
+	int x, y;
+	for (y = first_row; y <= last_row; y++) {
+		const float dy = ((float) y + 0.5f - center_y) / radius_y;
+		if (dy * dy >= 1.0f)
+			continue;
+		// The span of the row that's inside the ellipse.
+		const float half_span = radius_x * sqrtf(1.0f - dy * dy);
+		const int first_column = (int) fmaxf(0.0f, ceilf(center_x - half_span - 0.5f));
+		const int last_column = (int) fminf((float) width - 1.0f, floorf(center_x + half_span - 0.5f));
+		for (x = first_column; x <= last_column; x++)
+			frame[y * width + x] = shade;
+	}
+}
+
+static void draw_frame(uint8_t* frame, int width, int height, const GameState* state) {
+	memset(frame, 0, (size_t) width * height);
+	fill_disc(frame, width, height, state->blue_mallet_position, mallet_radius, blue_mallet_shade);
+	fill_disc(frame, width, height, state->red_mallet_position, mallet_radius, red_mallet_shade);
+	fill_disc(frame, width, height, state->puck_position, puck_radius, puck_shade);
+}
+
+/* Waits for the slot the next step goes to, if anyone is still reading it. */
+static void wait_for_slot(Env* env, uint64_t step) {
+	EnvSharedHeader* shared = env->shared;
+	// Sequentially consistent, to pair with env_attach_consumer().
+	if (step <= ENV_OBSERVATION_SLOTS || !__atomic_load_n(&shared->has_consumer, __ATOMIC_SEQ_CST))
+		return;
+
+	const uint64_t previous_step_in_slot = step - ENV_OBSERVATION_SLOTS;
+	if (__atomic_load_n(&shared->consumed_step, __ATOMIC_ACQUIRE) >= previous_step_in_slot)
+		return;
+
+	env->stats.steps_waited_for_consumer++;
+	int spins = 0;
+	while (__atomic_load_n(&shared->consumed_step, __ATOMIC_ACQUIRE) < previous_step_in_slot) {
+		if (++spins > 100)
+			sched_yield();
+	}
+}
+
+static void publish_observations(Env* env, const uint8_t* done) {
+	EnvSharedHeader* shared = env->shared;
+	const uint64_t step = ++env->step;
+	wait_for_slot(env, step);
+
+	EnvObservation* observations = (EnvObservation*) env_get_observations(shared, step);
+	uint8_t* frames = (uint8_t*) (observations + env->table_count);
+	const size_t frame_size = (size_t) shared->frame_width * shared->frame_height;
+	int i;
+
+	for (i = 0; i < env->table_count; i++) {
+		const GameState* state = &env->tables[i].state;
+		observations[i] = (EnvObservation) {
+			{state->puck_position[0], state->puck_position[2]},
+			{state->puck_vector[0], state->puck_vector[2]},
+			{state->blue_mallet_position[0], state->blue_mallet_position[2]},
+			{state->blue_mallet_position[0] - state->previous_blue_mallet_position[0],
+			 state->blue_mallet_position[2] - state->previous_blue_mallet_position[2]},
+			{state->red_mallet_position[0], state->red_mallet_position[2]},
+			{state->red_mallet_position[0] - state->previous_red_mallet_position[0],
+			 state->red_mallet_position[2] - state->previous_red_mallet_position[2]},
+			env->tables[i].episode_frame,
+			done != NULL ? done[i] : 0};
+
+		if (frame_size > 0)
+			draw_frame(frames + i * frame_size, (int) shared->frame_width, (int) shared->frame_height, state);
+	}
+
+	__atomic_store_n(&shared->published_step, step, __ATOMIC_SEQ_CST);
+}
+
+/* Stepping */
+
+void env_reset(Env* env) {
+	assert(env != NULL);
+	int i;
+	for (i = 0; i < env->table_count; i++)
+		reset_table(env, i);
+	publish_observations(env, NULL);
+}
+
+void env_step(Env* env, const EnvAction* actions) {
+	assert(env != NULL);
+	assert(actions != NULL);
+
+	uint8_t* done = env->done;
+	int i;
+
+	for (i = 0; i < env->table_count; i++) {
+		Table* table = &env->tables[i];
+		GameInput input = {
+			{1, actions[i].blue_x, actions[i].blue_z},
+			{1, actions[i].red_x, actions[i].red_z}};
+
+		if (env->red_is_ai) {
+			vec3 target;
+			memcpy(target, table->state.red_mallet_position, sizeof(target));
+			update_ai_controller(&env->ais[i], table->state.puck_position, table->state.puck_vector, target);
+			input.red = (MalletInput) {1, target[0], target[2]};
+		}
+
+		update_game_state(&table->state, &input, &table_sdf);
+		table->episode_frame++;
+
+		done[i] = env->episode_length > 0 && table->episode_frame >= (unsigned int) env->episode_length;
+		if (done[i])
+			reset_table(env, i);
+	}
+
+	env->stats.steps++;
+	publish_observations(env, done);
+}
+
+/* Sharing */
+
+int env_get_shared_fd(const Env* env) {
+	assert(env != NULL);
+	return env->fd;
+}
+
+size_t env_get_shared_size(const Env* env) {
+	assert(env != NULL);
+	return env->shared_size;
+}
+
+const EnvSharedHeader* env_get_shared(const Env* env) {
+	assert(env != NULL);
+	return env->shared;
+}
+
+EnvStats env_get_stats(const Env* env) {
+	assert(env != NULL);
+	return env->stats;
+}
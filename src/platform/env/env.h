@@ -0,0 +1,152 @@
+#pragma once
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* A batch of air hockey tables that are stepped together, for training.
+   Every step applies one action per table with the game's own rules from
+   game_state.c, then publishes an observation of every table to a shared
+   memory region that other processes can map and read in place.
+
+   The region starts with an EnvSharedHeader, followed by
+   ENV_OBSERVATION_SLOTS slots that each hold one step: an EnvObservation per
+   table, then a frame per table if frames were asked for. Step n goes to slot
+   n % ENV_OBSERVATION_SLOTS, and is published by storing n in published_step
+   once it's written. A consumer reads the slot and then stores n in
+   consumed_step. Before writing to a slot again, the producer waits until an
+   attached consumer has finished with the step that was in it, so neither
+   side ever takes a lock and the producer is at most one step ahead. */
+
+#define ENV_SHARED_MAGIC 0x56454841 // "AHEV"
+#define ENV_SHARED_VERSION 1
+#define ENV_OBSERVATION_SLOTS 2
+
+/* Where each player wants their mallet, in table coordinates, like a touch
+   dragged across the table. Each mallet goes straight there, but is kept
+   inside the walls on its own half, however far outside it the target is.
+   The red target is ignored when red is played by the AI. */
+typedef struct {
+	float blue_x;
+	float blue_z;
+	float red_x;
+	float red_z;
+} EnvAction;
+
+/* Positions are X and Z on the table, and velocities are per frame. */
+typedef struct {
+	float puck_position[2];
+	float puck_velocity[2];
+	float blue_mallet_position[2];
+	float blue_mallet_velocity[2];
+	float red_mallet_position[2];
+	float red_mallet_velocity[2];
+	uint32_t episode_frame;
+	// The episode ran out during this step, and the table was reset; the
+	// observation is the first one of the next episode.
+	uint32_t done;
+} EnvObservation;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t table_count;
+	// Frames are one byte per pixel, a top-down view with the far end of the
+	// table in the first row. Both are zero without frames.
+	uint32_t frame_width;
+	uint32_t frame_height;
+	uint32_t reserved;
+	uint64_t slots_offset;
+	uint64_t slot_size;
+
+	// Only accessed atomically. Each is on its own cache line so that the
+	// producer and consumer don't contend for one.
+	uint64_t published_step __attribute__((aligned(64)));
+	uint64_t consumed_step __attribute__((aligned(64)));
+	uint32_t has_consumer;
+	// Set once the producer is gone and no more steps will be published.
+	uint32_t is_closed;
+} EnvSharedHeader;
+
+typedef struct {
+	int frame_width;
+	int frame_height;
+	// In frames; each table is reset once its episode is this long. Zero
+	// means episodes never end.
+	int episode_length;
+	int red_is_ai;
+	unsigned int seed;
+} EnvOptions;
+
+typedef struct {
+	unsigned long long steps;
+	// Steps that had to wait for the consumer to finish with their slot.
+	unsigned long long steps_waited_for_consumer;
+} EnvStats;
+
+typedef struct Env Env;
+
+/* Returns NULL if the shared memory couldn't be created. Options can be NULL
+   for no frames, endless episodes and two controlled players. */
+Env* env_create(int table_count, const EnvOptions* options);
+/* Marks the region as closed for consumers, and releases the process's side of it. */
+void env_destroy(Env* env);
+
+/* Puts every table back at the start of an episode and publishes the result as a step. */
+void env_reset(Env* env);
+/* Takes one action per table, advances every table by a frame, and publishes the result. */
+void env_step(Env* env, const EnvAction* actions);
+
+/* The region's file descriptor, for handing to consumers, and its size. */
+int env_get_shared_fd(const Env* env);
+size_t env_get_shared_size(const Env* env);
+/* The region as this process maps it, for reading observations without another process. */
+const EnvSharedHeader* env_get_shared(const Env* env);
+EnvStats env_get_stats(const Env* env);
+
+/* Consumers */
+
+/* Waits for the step after last_step to be published and returns it, or
+   returns 0 if the producer closed the region first. Call env_finish_step()
+   with it once done reading. */
+static inline uint64_t env_wait_for_step(const EnvSharedHeader* shared, uint64_t last_step) {
+	int spins = 0;
+	for (;;) {
+		if (__atomic_load_n(&shared->published_step, __ATOMIC_ACQUIRE) > last_step)
+			return last_step + 1;
+		if (__atomic_load_n(&shared->is_closed, __ATOMIC_ACQUIRE))
+			return 0;
+		// Spinning only pays off while the producer is running on another core.
+		if (++spins > 100)
+			sched_yield();
+	}
+}
+
+/* Starts reading from the next step on, and makes the producer wait for
+   this consumer from then on. */
+static inline uint64_t env_attach_consumer(EnvSharedHeader* shared) {
+	// The producer has to see the consumer before the step it starts from is
+	// read, or it could carry on without waiting and overwrite the step after
+	// it. That's a store followed by a load of another variable, which only
+	// sequential consistency keeps in order, on both sides.
+	__atomic_store_n(&shared->has_consumer, 1, __ATOMIC_SEQ_CST);
+	const uint64_t step = __atomic_load_n(&shared->published_step, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&shared->consumed_step, step, __ATOMIC_RELEASE);
+	return step;
+}
+
+static inline void env_finish_step(EnvSharedHeader* shared, uint64_t step) {
+	__atomic_store_n(&shared->consumed_step, step, __ATOMIC_RELEASE);
+}
+
+static inline const EnvObservation* env_get_observations(const EnvSharedHeader* shared, uint64_t step) {
+	return (const EnvObservation*) ((const unsigned char*) shared + shared->slots_offset
+		+ (step % ENV_OBSERVATION_SLOTS) * shared->slot_size);
+}
+
+/* Returns the frame of the given table, or NULL without frames. */
+static inline const uint8_t* env_get_frame(const EnvSharedHeader* shared, uint64_t step, int table) {
+	if (shared->frame_width == 0)
+		return NULL;
+	return (const uint8_t*) (env_get_observations(shared, step) + shared->table_count)
+		+ (size_t) table * shared->frame_width * shared->frame_height;
+}
@@ -0,0 +1,136 @@
+/* Measures how many steps per second a batch of tables can be stepped at,
+   first on its own and then with a consumer process reading every step's
+   observations out of the shared memory as they're published. Blue chases
+   the puck; red is played by the AI unless -r is given. */
+#define _GNU_SOURCE
+#include "env.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Reads every step in the region until the producer closes it, touching
+   every observation and frame as a real consumer would, and reports what it
+   saw. Runs in its own process. */
+static int run_consumer(int fd, size_t size) {
+	EnvSharedHeader* shared = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shared == MAP_FAILED || shared->magic != ENV_SHARED_MAGIC || shared->version != ENV_SHARED_VERSION) {
+		fprintf(stderr, "Couldn't map the observations\n");
+		return EXIT_FAILURE;
+	}
+
+	const size_t frame_size = (size_t) shared->frame_width * shared->frame_height;
+	unsigned long long steps = 0, episodes_done = 0, lit_pixels = 0;
+	double checksum = 0.0;
+	uint64_t step = env_attach_consumer(shared);
+	unsigned int i;
+	size_t pixel;
+
+	while ((step = env_wait_for_step(shared, step)) != 0) {
+		const EnvObservation* observations = env_get_observations(shared, step);
+		for (i = 0; i < shared->table_count; i++) {
+			checksum += observations[i].puck_position[0] + observations[i].puck_position[1];
+			episodes_done += observations[i].done;
+
+			const uint8_t* frame = env_get_frame(shared, step, (int) i);
+			for (pixel = 0; frame != NULL && pixel < frame_size; pixel++)
+				lit_pixels += frame[pixel] != 0;
+		}
+		env_finish_step(shared, step);
+		steps++;
+	}
+
+	printf("consumer: read %llu steps, %llu episodes ended, %.1f lit pixels per table, checksum %.3f\n",
+		steps, episodes_done, steps > 0 ? (double) lit_pixels / steps / shared->table_count : 0.0, checksum);
+	fflush(stdout);
+	munmap(shared, size);
+	return EXIT_SUCCESS;
+}
+
+/* Returns the steps per second. */
+static double run_steps(int table_count, const EnvOptions* options, int step_count, int with_consumer) {
+	Env* env = env_create(table_count, options);
+	if (env == NULL)
+		exit(EXIT_FAILURE);
+	const EnvSharedHeader* shared = env_get_shared(env);
+
+	pid_t consumer = -1;
+	if (with_consumer) {
+		fflush(stdout);
+		consumer = fork();
+		if (consumer < 0) {
+			perror("Couldn't start the consumer");
+			exit(EXIT_FAILURE);
+		}
+		// The consumer inherits the descriptor, as it would if it were passed over a socket.
+		if (consumer == 0)
+			_exit(run_consumer(env_get_shared_fd(env), env_get_shared_size(env)));
+		while (!__atomic_load_n(&shared->has_consumer, __ATOMIC_ACQUIRE))
+			sched_yield();
+	}
+
+	EnvAction* actions = calloc(table_count, sizeof(EnvAction));
+	if (actions == NULL)
+		exit(EXIT_FAILURE);
+
+	const long long start = get_time_in_microseconds();
+	int step, i;
+	for (step = 0; step < step_count; step++) {
+		// The latest observations are this process's own, so they're read in place.
+		const EnvObservation* observations = env_get_observations(shared, shared->published_step);
+		for (i = 0; i < table_count; i++) {
+			actions[i] = (EnvAction) {
+				observations[i].puck_position[0], observations[i].puck_position[1] + 0.1f,
+				observations[i].puck_position[0], observations[i].puck_position[1] - 0.1f};
+		}
+		env_step(env, actions);
+	}
+	const long long elapsed = get_time_in_microseconds() - start;
+
+	const EnvStats stats = env_get_stats(env);
+	env_destroy(env);
+	free(actions);
+	if (consumer > 0)
+		waitpid(consumer, NULL, 0);
+
+	const double steps_per_second = step_count * 1000000.0 / elapsed;
+	printf("%d tables, %s: %.0f steps/s, %.0f table steps/s, %llu of %llu steps waited for the consumer\n",
+		table_count, with_consumer ? "with a consumer" : "alone", steps_per_second, steps_per_second * table_count,
+		stats.steps_waited_for_consumer, stats.steps);
+	return steps_per_second;
+}
+
+int main(int argc, char** argv) {
+	EnvOptions options = {0, 0, 600, 1, 1};
+	int table_count = 64;
+	int step_count = 20000;
+	int option;
+
+	while ((option = getopt(argc, argv, "n:s:w:h:e:r")) != -1) {
+		switch (option) {
+			case 'n': table_count = atoi(optarg); break;
+			case 's': step_count = atoi(optarg); break;
+			case 'w': options.frame_width = atoi(optarg); break;
+			case 'h': options.frame_height = atoi(optarg); break;
+			case 'e': options.episode_length = atoi(optarg); break;
+			case 'r': options.red_is_ai = 0; break;
+			default:
+				fprintf(stderr, "Usage: %s [-n tables] [-s steps] [-w frame width -h frame height] "
+					"[-e frames per episode] [-r control red instead of the AI]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (table_count < 1 || step_count < 1 || options.frame_width < 0 || options.frame_height < 0
+	 || (options.frame_width == 0) != (options.frame_height == 0)) {
+		fprintf(stderr, "Tables and steps must be positive, and frames need both a width and a height.\n");
+		return EXIT_FAILURE;
+	}
+
+	const double alone = run_steps(table_count, &options, step_count, 0);
+	const double with_consumer = run_steps(table_count, &options, step_count, 1);
+	printf("the consumer costs %.1f%% of the steps per second\n", 100.0 * (1.0 - with_consumer / alone));
+	return EXIT_SUCCESS;
+}
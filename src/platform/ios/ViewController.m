@@ -16,7 +16,11 @@
 {
     [super viewDidLoad];
     
-    self.context = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
+    // The game checks which one it got, and only uses ES 3 where it's there.
+    self.context = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES3];
+    if (!self.context) {
+        self.context = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
+    }
 
     if (!self.context) {
         NSLog(@"Failed to create ES context");
@@ -33,6 +37,9 @@
 
 - (void)dealloc
 {
+    [EAGLContext setCurrentContext:self.context];
+    on_surface_destroyed();
+
     if ([EAGLContext currentContext] == self.context) {
         [EAGLContext setCurrentContext:nil];
     }
@@ -1 +1 @@
-#include <OpenGLES/ES2/gl.h>
\ No newline at end of file
+#include <OpenGLES/ES3/gl.h>
\ No newline at end of file
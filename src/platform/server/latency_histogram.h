@@ -0,0 +1,48 @@
+#pragma once
+#include <string.h>
+
+/* Counts latencies in one microsecond buckets up to 100 ms, with everything
+   slower counted in the last bucket. Cheap enough to update on every tick. */
+#define LATENCY_HISTOGRAM_BUCKETS 100000
+
+typedef struct {
+	unsigned int counts[LATENCY_HISTOGRAM_BUCKETS];
+	unsigned long long total;
+	long long max_us;
+} LatencyHistogram;
+
+static inline void reset_latency_histogram(LatencyHistogram* histogram) {
+	memset(histogram, 0, sizeof(*histogram));
+}
+
+static inline void add_latency(LatencyHistogram* histogram, long long latency_us) {
+	const long long bucket = latency_us < 0 ? 0
+		: latency_us >= LATENCY_HISTOGRAM_BUCKETS ? LATENCY_HISTOGRAM_BUCKETS - 1
+		: latency_us;
+	histogram->counts[bucket]++;
+	histogram->total++;
+	if (latency_us > histogram->max_us)
+		histogram->max_us = latency_us;
+}
+
+static inline void merge_latency_histogram(LatencyHistogram* into, const LatencyHistogram* from) {
+	int i;
+	for (i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+		into->counts[i] += from->counts[i];
+	into->total += from->total;
+	if (from->max_us > into->max_us)
+		into->max_us = from->max_us;
+}
+
+/* Returns the latency below which the given fraction of samples fall. */
+static inline long long get_latency_percentile(const LatencyHistogram* histogram, double fraction) {
+	const unsigned long long threshold = (unsigned long long) (histogram->total * fraction);
+	unsigned long long seen = 0;
+	int i;
+	for (i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+		seen += histogram->counts[i];
+		if (seen > threshold)
+			return i;
+	}
+	return histogram->max_us;
+}
@@ -0,0 +1,313 @@
+/* Plays many sessions against a local server over loopback. Both players of
+   every session press their mallet and then drag it around at the server's
+   tick rate; the first state that comes back with each touch echoed in it is
+   used to time the round trip from sending that touch to receiving it, which
+   takes in the network and queueing as well as the tick. */
+#define _GNU_SOURCE
+#include "camera.h"
+#include "game_state.h"
+#include "latency_histogram.h"
+#include "linmath.h"
+#include "protocol.h"
+#include "timer.h"
+#include <arpa/inet.h>
+#include <assert.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define BATCH_SIZE 64
+
+typedef struct {
+	int index;
+	pthread_t thread;
+	int first_session;
+	int session_count;
+	int* socket_fds;
+	struct sockaddr_in* shard_addresses;
+
+	struct mmsghdr outgoing_headers[BATCH_SIZE];
+	struct iovec outgoing_vectors[BATCH_SIZE];
+	ClientPacket outgoing_packets[BATCH_SIZE];
+	int outgoing_shards[BATCH_SIZE];
+	int outgoing_count;
+
+	// Per session and player, the echoed time that was last measured, since
+	// the server keeps echoing it until the next touch arrives.
+	uint64_t* measured_client_times_us;
+
+	LatencyHistogram latency;
+	unsigned long long states_received;
+	unsigned long long packets_sent;
+} Client;
+
+static int server_port = DEFAULT_SERVER_PORT;
+static int shard_count = 1;
+static double duration_seconds = 10.0;
+static Camera cameras[2];
+static float press_points[2][2];
+
+/* Finds where a mallet at its starting position appears on a player's screen. */
+static void get_press_point(const Camera* camera, vec3 mallet_position, float* out) {
+	mat4x4 view_projection_matrix;
+	memcpy(view_projection_matrix, camera->view_projection_matrix, sizeof(mat4x4));
+
+	vec4 world = {mallet_position[0], mallet_position[1], mallet_position[2], 1.0f};
+	vec4 clip;
+	mat4x4_mul_vec4(clip, view_projection_matrix, world);
+	out[0] = clip[0] / clip[3];
+	out[1] = clip[1] / clip[3];
+}
+
+static void flush_outgoing(Client* client) {
+	// Consecutive packets for the same shard go out in one call.
+	int start = 0;
+	while (start < client->outgoing_count) {
+		const int shard = client->outgoing_shards[start];
+		int end = start + 1;
+		while (end < client->outgoing_count && client->outgoing_shards[end] == shard)
+			end++;
+
+		int i;
+		for (i = start; i < end; i++) {
+			client->outgoing_headers[i].msg_hdr.msg_name = &client->shard_addresses[shard];
+			client->outgoing_headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		}
+
+		int sent = start;
+		while (sent < end) {
+			const int result = sendmmsg(client->socket_fds[shard], &client->outgoing_headers[sent], end - sent, 0);
+			if (result <= 0)
+				break;
+			sent += result;
+		}
+		client->packets_sent += sent - start;
+		start = end;
+	}
+	client->outgoing_count = 0;
+}
+
+static void queue_packet(Client* client, uint8_t type, uint8_t player, uint32_t session_id, float x, float y) {
+	if (client->outgoing_count == BATCH_SIZE)
+		flush_outgoing(client);
+
+	const int i = client->outgoing_count++;
+	client->outgoing_packets[i] = (ClientPacket) {
+		type, player, 0, session_id, x, y, (uint64_t) get_time_in_microseconds()};
+	client->outgoing_shards[i] = get_shard_for_session(session_id, shard_count);
+}
+
+static void receive_states(Client* client, int socket_fd) {
+	struct mmsghdr headers[BATCH_SIZE];
+	struct iovec vectors[BATCH_SIZE];
+	StatePacket packets[BATCH_SIZE];
+	int i;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		vectors[i] = (struct iovec) {&packets[i], sizeof(packets[i])};
+		memset(&headers[i], 0, sizeof(headers[i]));
+		headers[i].msg_hdr.msg_iov = &vectors[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	for (;;) {
+		const int count = recvmmsg(socket_fd, headers, BATCH_SIZE, MSG_DONTWAIT, NULL);
+		if (count <= 0)
+			return;
+
+		const long long now = get_time_in_microseconds();
+		for (i = 0; i < count; i++) {
+			if (headers[i].msg_len != sizeof(StatePacket) || packets[i].type != PACKET_STATE)
+				continue;
+			client->states_received++;
+
+			const int session = (int) packets[i].session_id - client->first_session;
+			if (session < 0 || session >= client->session_count || packets[i].player > PLAYER_RED)
+				continue;
+			uint64_t* measured_time_us = &client->measured_client_times_us[session * 2 + packets[i].player];
+			if (packets[i].echoed_client_time_us == *measured_time_us)
+				continue;
+			*measured_time_us = packets[i].echoed_client_time_us;
+			add_latency(&client->latency, now - (long long) packets[i].echoed_client_time_us);
+		}
+
+		if (count < BATCH_SIZE)
+			return;
+	}
+}
+
+static void send_to_all_sessions(Client* client, uint8_t type, long long tick_number) {
+	int i;
+	for (i = 0; i < client->session_count; i++) {
+		const uint32_t session_id = (uint32_t) (client->first_session + i);
+		int player;
+		for (player = PLAYER_BLUE; player <= PLAYER_RED; player++) {
+			// Wiggle the touch around the mallet's starting point, with every
+			// session a little out of phase with the others.
+			const float phase = (float) tick_number * 0.05f + (float) session_id;
+			const float x = press_points[player][0] + (type == PACKET_TOUCH_DRAG ? 0.3f * sinf(phase) : 0.0f);
+			const float y = press_points[player][1] + (type == PACKET_TOUCH_DRAG ? 0.1f * cosf(phase) : 0.0f);
+			queue_packet(client, type, (uint8_t) player, session_id, x, y);
+		}
+	}
+	flush_outgoing(client);
+}
+
+static void* run_client(void* argument) {
+	Client* client = argument;
+	const int epoll_fd = epoll_create1(0);
+	const int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	assert(epoll_fd >= 0 && timer_fd >= 0);
+
+	const long tick_ns = 1000000000L / SERVER_TICKS_PER_SECOND;
+	const struct itimerspec interval = {{0, tick_ns}, {0, tick_ns}};
+	timerfd_settime(timer_fd, 0, &interval, NULL);
+
+	struct epoll_event timer_event = {EPOLLIN, {.fd = timer_fd}};
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &timer_event);
+	int i;
+	for (i = 0; i < shard_count; i++) {
+		struct epoll_event socket_event = {EPOLLIN, {.fd = client->socket_fds[i]}};
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->socket_fds[i], &socket_event);
+	}
+
+	send_to_all_sessions(client, PACKET_JOIN, 0);
+	send_to_all_sessions(client, PACKET_TOUCH_PRESS, 0);
+
+	// Ignore the first second while every session gets going.
+	const long long start = get_time_in_microseconds();
+	const long long warmed_up = start + 1000000;
+	const long long end = start + (long long) (duration_seconds * 1000000.0);
+	long long tick_number = 0;
+	int is_warm = 0;
+
+	while (get_time_in_microseconds() < end) {
+		struct epoll_event events[16];
+		const int count = epoll_wait(epoll_fd, events, 16, 100);
+
+		for (i = 0; i < count; i++) {
+			if (events[i].data.fd == timer_fd) {
+				uint64_t expirations;
+				if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+					send_to_all_sessions(client, PACKET_TOUCH_DRAG, ++tick_number);
+			} else {
+				receive_states(client, events[i].data.fd);
+			}
+		}
+
+		if (!is_warm && get_time_in_microseconds() >= warmed_up) {
+			is_warm = 1;
+			reset_latency_histogram(&client->latency);
+			client->states_received = 0;
+		}
+	}
+
+	send_to_all_sessions(client, PACKET_LEAVE, tick_number);
+	close(timer_fd);
+	close(epoll_fd);
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	int session_count = 1000;
+	int thread_count = 1;
+	int option;
+
+	while ((option = getopt(argc, argv, "p:s:n:t:d:")) != -1) {
+		switch (option) {
+			case 'p': server_port = atoi(optarg); break;
+			case 's': shard_count = atoi(optarg); break;
+			case 'n': session_count = atoi(optarg); break;
+			case 't': thread_count = atoi(optarg); break;
+			case 'd': duration_seconds = atof(optarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-p server base port] [-s server shards] [-n sessions] [-t threads] [-d seconds]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (shard_count < 1 || session_count < 1 || thread_count < 1 || duration_seconds <= 1.0) {
+		fprintf(stderr, "Shards, sessions and threads must be positive, and the duration over one second.\n");
+		return EXIT_FAILURE;
+	}
+
+	init_camera(&cameras[PLAYER_BLUE], 480.0f / 800.0f, 0);
+	init_camera(&cameras[PLAYER_RED], 480.0f / 800.0f, 1);
+	GameState initial_state;
+	init_game_state(&initial_state);
+	get_press_point(&cameras[PLAYER_BLUE], initial_state.blue_mallet_position, press_points[PLAYER_BLUE]);
+	get_press_point(&cameras[PLAYER_RED], initial_state.red_mallet_position, press_points[PLAYER_RED]);
+
+	struct sockaddr_in* shard_addresses = calloc(shard_count, sizeof(struct sockaddr_in));
+	Client* clients = calloc(thread_count, sizeof(Client));
+	assert(shard_addresses != NULL && clients != NULL);
+
+	int i;
+	for (i = 0; i < shard_count; i++) {
+		shard_addresses[i].sin_family = AF_INET;
+		shard_addresses[i].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		shard_addresses[i].sin_port = htons((uint16_t) (server_port + i));
+	}
+
+	const int sessions_per_thread = (session_count + thread_count - 1) / thread_count;
+	for (i = 0; i < thread_count; i++) {
+		Client* client = &clients[i];
+		client->index = i;
+		client->first_session = 1 + i * sessions_per_thread;
+		client->session_count = session_count - i * sessions_per_thread;
+		if (client->session_count > sessions_per_thread)
+			client->session_count = sessions_per_thread;
+		if (client->session_count < 0)
+			client->session_count = 0;
+		client->shard_addresses = shard_addresses;
+		client->socket_fds = calloc(shard_count, sizeof(int));
+		client->measured_client_times_us = calloc(client->session_count * 2 + 1, sizeof(uint64_t));
+		assert(client->socket_fds != NULL && client->measured_client_times_us != NULL);
+
+		int shard;
+		for (shard = 0; shard < shard_count; shard++) {
+			const int buffer_size = 8 * 1024 * 1024;
+			client->socket_fds[shard] = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+			assert(client->socket_fds[shard] >= 0);
+			setsockopt(client->socket_fds[shard], SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+		}
+
+		int j;
+		for (j = 0; j < BATCH_SIZE; j++) {
+			client->outgoing_vectors[j] = (struct iovec) {&client->outgoing_packets[j], sizeof(ClientPacket)};
+			client->outgoing_headers[j].msg_hdr.msg_iov = &client->outgoing_vectors[j];
+			client->outgoing_headers[j].msg_hdr.msg_iovlen = 1;
+		}
+
+		pthread_create(&client->thread, NULL, run_client, client);
+	}
+
+	LatencyHistogram* total = calloc(1, sizeof(LatencyHistogram));
+	unsigned long long states_received = 0;
+	assert(total != NULL);
+	for (i = 0; i < thread_count; i++) {
+		pthread_join(clients[i].thread, NULL);
+		merge_latency_histogram(total, &clients[i].latency);
+		states_received += clients[i].states_received;
+	}
+
+	const double measured_seconds = duration_seconds - 1.0;
+	const double expected_states = (double) session_count * 2.0 * SERVER_TICKS_PER_SECOND * measured_seconds;
+
+	printf("sessions: %d on %d server cores (%.1f sessions per core)\n",
+		session_count, shard_count, (double) session_count / shard_count);
+	printf("states received: %llu of %.0f expected (%.1f%%)\n",
+		states_received, expected_states, 100.0 * states_received / expected_states);
+	printf("touch to state round trip: p50 %lld us, p90 %lld us, p99 %lld us, p99.9 %lld us, max %lld us\n",
+		get_latency_percentile(total, 0.5), get_latency_percentile(total, 0.9),
+		get_latency_percentile(total, 0.99), get_latency_percentile(total, 0.999), total->max_us);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,466 @@
+/* A headless match server. Sessions are split across shards, one per core,
+   and each shard runs its own event loop on its own port: nonblocking UDP
+   read and written in batches, and a timer that ticks every session in the
+   shard at a fixed rate and broadcasts the resulting state to its players. */
+#define _GNU_SOURCE
+#include "ai.h"
+#include "camera.h"
+#include "game_state.h"
+#include "latency_histogram.h"
+#include "protocol.h"
+#include "telemetry.h"
+#include "timer.h"
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define MAX_SESSIONS_PER_SHARD 8192
+#define SESSION_TABLE_SIZE (MAX_SESSIONS_PER_SHARD * 2)
+#define BATCH_SIZE 64
+#define MAX_CATCH_UP_TICKS 4
+
+static const long long session_timeout_us = 10000000;
+static const long long stats_interval_us = 5000000;
+
+// A session with only a blue player gets an AI opponent, with a much smaller
+// budget than the local game so that thousands of them fit into a tick.
+static const float ai_mallet_speed = 0.03f;
+static const long long ai_budget_us = 10;
+
+// Baked before the shards start; the same table that clients play on.
+static TableSdf table_sdf;
+
+typedef struct {
+	uint32_t id;
+	int joined[2];
+	int pressed[2];
+	struct sockaddr_in addresses[2];
+	uint64_t last_client_time_us[2];
+	long long last_heard_us;
+	GameState state;
+	GameInput pending_input;
+	AiController* ai;
+} Session;
+
+typedef struct {
+	int index;
+	int socket_fd;
+	int timer_fd;
+	int epoll_fd;
+	pthread_t thread;
+
+	// Sessions are packed at the front of this array; the table maps a
+	// session id to its position with open addressing.
+	Session* sessions;
+	int session_count;
+	int table[SESSION_TABLE_SIZE];
+
+	struct mmsghdr outgoing_headers[BATCH_SIZE];
+	struct iovec outgoing_vectors[BATCH_SIZE];
+	StatePacket outgoing_packets[BATCH_SIZE];
+	struct sockaddr_in outgoing_addresses[BATCH_SIZE];
+	int outgoing_count;
+
+	LatencyHistogram tick_latency;
+	long long next_stats_us;
+} Shard;
+
+static volatile sig_atomic_t is_running = 1;
+static Camera cameras[2];
+
+static void handle_signal(int signal_number) {
+	(void) signal_number;
+	is_running = 0;
+}
+
+static unsigned int hash_session_id(uint32_t id) {
+	return (id * 2654435761u) % SESSION_TABLE_SIZE;
+}
+
+/* Returns the table slot holding the session, or the empty slot where it would go. */
+static unsigned int find_table_slot(const Shard* shard, uint32_t id) {
+	unsigned int slot = hash_session_id(id);
+	while (shard->table[slot] >= 0 && shard->sessions[shard->table[slot]].id != id)
+		slot = (slot + 1) % SESSION_TABLE_SIZE;
+	return slot;
+}
+
+static Session* find_session(Shard* shard, uint32_t id) {
+	const int index = shard->table[find_table_slot(shard, id)];
+	return index >= 0 ? &shard->sessions[index] : NULL;
+}
+
+static Session* create_session(Shard* shard, uint32_t id) {
+	if (shard->session_count == MAX_SESSIONS_PER_SHARD)
+		return NULL;
+
+	const int index = shard->session_count++;
+	Session* session = &shard->sessions[index];
+	memset(session, 0, sizeof(*session));
+	session->id = id;
+	init_game_state(&session->state);
+
+	shard->table[find_table_slot(shard, id)] = index;
+	return session;
+}
+
+static void remove_session(Shard* shard, Session* session) {
+	unsigned int slot = find_table_slot(shard, session->id);
+	const int index = shard->table[slot];
+	const int last = shard->session_count - 1;
+	free(session->ai);
+
+	// Backward-shift deletion keeps every probe sequence unbroken without tombstones.
+	shard->table[slot] = -1;
+	unsigned int next = (slot + 1) % SESSION_TABLE_SIZE;
+	while (shard->table[next] >= 0) {
+		const unsigned int home = hash_session_id(shard->sessions[shard->table[next]].id);
+		if ((next - home + SESSION_TABLE_SIZE) % SESSION_TABLE_SIZE >= (next - slot + SESSION_TABLE_SIZE) % SESSION_TABLE_SIZE) {
+			shard->table[slot] = shard->table[next];
+			shard->table[next] = -1;
+			slot = next;
+		}
+		next = (next + 1) % SESSION_TABLE_SIZE;
+	}
+
+	// Keep the sessions packed by moving the last one into the hole.
+	if (index != last) {
+		shard->sessions[index] = shard->sessions[last];
+		shard->table[find_table_slot(shard, shard->sessions[index].id)] = index;
+	}
+	shard->session_count--;
+}
+
+static void flush_outgoing(Shard* shard) {
+	int sent = 0;
+	while (sent < shard->outgoing_count) {
+		const int result = sendmmsg(shard->socket_fd, &shard->outgoing_headers[sent], shard->outgoing_count - sent, 0);
+		if (result < 0) {
+			// Drop the rest of this batch rather than stall the tick; the
+			// next state supersedes it anyway.
+			if (errno != EINTR)
+				break;
+			continue;
+		}
+		sent += result;
+	}
+	shard->outgoing_count = 0;
+}
+
+static void queue_state(Shard* shard, const Session* session, int player) {
+	if (shard->outgoing_count == BATCH_SIZE)
+		flush_outgoing(shard);
+
+	const int i = shard->outgoing_count++;
+	const GameState* state = &session->state;
+	shard->outgoing_packets[i] = (StatePacket) {
+		PACKET_STATE, (uint8_t) player, {0, 0}, session->id, state->frame,
+		state->puck_position[0], state->puck_position[2],
+		state->blue_mallet_position[0], state->blue_mallet_position[2],
+		state->red_mallet_position[0], state->red_mallet_position[2],
+		session->last_client_time_us[player]};
+	shard->outgoing_addresses[i] = session->addresses[player];
+}
+
+static void handle_packet(Shard* shard, const ClientPacket* packet, const struct sockaddr_in* address, long long now) {
+	if (packet->player > PLAYER_RED)
+		return;
+
+	Session* session = find_session(shard, packet->session_id);
+	if (session == NULL) {
+		if (packet->type != PACKET_JOIN)
+			return;
+		session = create_session(shard, packet->session_id);
+		if (session == NULL)
+			return;
+	}
+
+	const int player = packet->player;
+	session->last_heard_us = now;
+	session->last_client_time_us[player] = packet->client_time_us;
+
+	switch (packet->type) {
+		case PACKET_JOIN:
+			session->joined[player] = 1;
+			session->addresses[player] = *address;
+			break;
+		case PACKET_TOUCH_PRESS: {
+			float* mallet_position = player == PLAYER_BLUE
+				? session->state.blue_mallet_position : session->state.red_mallet_position;
+			session->pressed[player] = is_mallet_touched(&cameras[player], mallet_position, mallet_height,
+				packet->normalized_x, packet->normalized_y);
+			break;
+		}
+		case PACKET_TOUCH_DRAG: {
+			if (session->pressed[player] == 0)
+				break;
+
+			vec3 touched_point;
+			get_touched_point_on_table(&cameras[player], packet->normalized_x, packet->normalized_y, touched_point);
+			MalletInput* input = player == PLAYER_BLUE ? &session->pending_input.blue : &session->pending_input.red;
+			*input = (MalletInput) {1, touched_point[0], touched_point[2]};
+			break;
+		}
+		case PACKET_LEAVE:
+			session->joined[player] = 0;
+			if (session->joined[PLAYER_BLUE] == 0 && session->joined[PLAYER_RED] == 0)
+				remove_session(shard, session);
+			break;
+	}
+}
+
+static void receive_packets(Shard* shard) {
+	struct mmsghdr headers[BATCH_SIZE];
+	struct iovec vectors[BATCH_SIZE];
+	ClientPacket packets[BATCH_SIZE];
+	struct sockaddr_in addresses[BATCH_SIZE];
+	int i;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		vectors[i] = (struct iovec) {&packets[i], sizeof(packets[i])};
+		memset(&headers[i], 0, sizeof(headers[i]));
+		headers[i].msg_hdr.msg_iov = &vectors[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+		headers[i].msg_hdr.msg_name = &addresses[i];
+		headers[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+	}
+
+	for (;;) {
+		const int count = recvmmsg(shard->socket_fd, headers, BATCH_SIZE, MSG_DONTWAIT, NULL);
+		if (count <= 0)
+			return;
+
+		const long long now = get_time_in_microseconds();
+		for (i = 0; i < count; i++) {
+			if (headers[i].msg_len == sizeof(ClientPacket))
+				handle_packet(shard, &packets[i], &addresses[i], now);
+			headers[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+		}
+
+		if (count < BATCH_SIZE)
+			return;
+	}
+}
+
+static void update_ai_opponent(Session* session) {
+	if (session->ai == NULL) {
+		session->ai = malloc(sizeof(AiController));
+		assert(session->ai != NULL);
+		init_ai_controller(session->ai, table_bounds, puck_radius, mallet_radius, ai_mallet_speed, ai_budget_us);
+		set_ai_controller_table(session->ai, &table_sdf);
+	}
+
+	vec3 target;
+	memcpy(target, session->state.red_mallet_position, sizeof(target));
+	update_ai_controller(session->ai, session->state.puck_position, session->state.puck_vector, target);
+	session->pending_input.red = (MalletInput) {1, target[0], target[2]};
+}
+
+static void tick(Shard* shard, long long now) {
+	int i = 0;
+
+	while (i < shard->session_count) {
+		Session* session = &shard->sessions[i];
+		if (now - session->last_heard_us > session_timeout_us) {
+			remove_session(shard, session);
+			continue;
+		}
+
+		if (session->joined[PLAYER_RED] == 0)
+			update_ai_opponent(session);
+
+		update_game_state(&session->state, &session->pending_input, &table_sdf);
+		memset(&session->pending_input, 0, sizeof(session->pending_input));
+
+		if (session->joined[PLAYER_BLUE])
+			queue_state(shard, session, PLAYER_BLUE);
+		if (session->joined[PLAYER_RED])
+			queue_state(shard, session, PLAYER_RED);
+		i++;
+	}
+
+	flush_outgoing(shard);
+}
+
+static void print_stats(Shard* shard) {
+	printf("shard %d: %d sessions, tick p50 %lld us, p99 %lld us, max %lld us\n",
+		shard->index, shard->session_count,
+		get_latency_percentile(&shard->tick_latency, 0.5),
+		get_latency_percentile(&shard->tick_latency, 0.99),
+		shard->tick_latency.max_us);
+	fflush(stdout);
+	reset_latency_histogram(&shard->tick_latency);
+}
+
+static void* run_shard(void* argument) {
+	Shard* shard = argument;
+	struct epoll_event events[2];
+
+	while (is_running) {
+		const int count = epoll_wait(shard->epoll_fd, events, 2, 100);
+		int i;
+
+		for (i = 0; i < count; i++) {
+			if (events[i].data.fd == shard->socket_fd) {
+				receive_packets(shard);
+			} else {
+				uint64_t expirations = 0;
+				if (read(shard->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+					continue;
+				if (expirations > MAX_CATCH_UP_TICKS)
+					expirations = MAX_CATCH_UP_TICKS;
+
+				while (expirations-- > 0) {
+					const long long start = get_time_in_microseconds();
+					tick(shard, start);
+					const long long tick_time_us = get_time_in_microseconds() - start;
+					add_latency(&shard->tick_latency, tick_time_us);
+					record_shard_tick_telemetry(shard->index, shard->session_count, tick_time_us);
+				}
+
+				const long long now = get_time_in_microseconds();
+				if (now >= shard->next_stats_us) {
+					print_stats(shard);
+					shard->next_stats_us = now + stats_interval_us;
+				}
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static int create_shard_socket(int port) {
+	const int socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+	if (socket_fd < 0)
+		return -1;
+
+	const int buffer_size = 8 * 1024 * 1024;
+	setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+	setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons((uint16_t) port);
+
+	if (bind(socket_fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+		close(socket_fd);
+		return -1;
+	}
+
+	return socket_fd;
+}
+
+static int init_shard(Shard* shard, int index, int port) {
+	memset(shard, 0, sizeof(*shard));
+	shard->index = index;
+	memset(shard->table, -1, sizeof(shard->table));
+
+	// Each session's state starts on its own cache line, which calloc() doesn't promise.
+	void* sessions;
+	if (posix_memalign(&sessions, CACHE_LINE_SIZE, MAX_SESSIONS_PER_SHARD * sizeof(Session)) != 0)
+		return 0;
+	memset(sessions, 0, MAX_SESSIONS_PER_SHARD * sizeof(Session));
+	shard->sessions = sessions;
+	shard->socket_fd = create_shard_socket(port);
+	shard->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	shard->epoll_fd = epoll_create1(0);
+	if (shard->socket_fd < 0 || shard->timer_fd < 0 || shard->epoll_fd < 0)
+		return 0;
+
+	const long tick_ns = 1000000000L / SERVER_TICKS_PER_SECOND;
+	const struct itimerspec interval = {{0, tick_ns}, {0, tick_ns}};
+	timerfd_settime(shard->timer_fd, 0, &interval, NULL);
+
+	struct epoll_event socket_event = {EPOLLIN, {.fd = shard->socket_fd}};
+	struct epoll_event timer_event = {EPOLLIN, {.fd = shard->timer_fd}};
+	epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->socket_fd, &socket_event);
+	epoll_ctl(shard->epoll_fd, EPOLL_CTL_ADD, shard->timer_fd, &timer_event);
+
+	int i;
+	for (i = 0; i < BATCH_SIZE; i++) {
+		shard->outgoing_vectors[i] = (struct iovec) {&shard->outgoing_packets[i], sizeof(StatePacket)};
+		shard->outgoing_headers[i].msg_hdr.msg_iov = &shard->outgoing_vectors[i];
+		shard->outgoing_headers[i].msg_hdr.msg_iovlen = 1;
+		shard->outgoing_headers[i].msg_hdr.msg_name = &shard->outgoing_addresses[i];
+		shard->outgoing_headers[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+	}
+
+	shard->next_stats_us = get_time_in_microseconds() + stats_interval_us;
+	return 1;
+}
+
+static void pin_thread_to_core(pthread_t thread, int core) {
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(core, &cpus);
+	pthread_setaffinity_np(thread, sizeof(cpus), &cpus);
+}
+
+int main(int argc, char** argv) {
+	const long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+	int port = DEFAULT_SERVER_PORT;
+	int shard_count = (int) core_count;
+	int option;
+
+	while ((option = getopt(argc, argv, "p:s:")) != -1) {
+		switch (option) {
+			case 'p': port = atoi(optarg); break;
+			case 's': shard_count = atoi(optarg); break;
+			default:
+				fprintf(stderr, "Usage: %s [-p base port] [-s shards]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (shard_count < 1)
+		shard_count = 1;
+
+	// Clients always send touches as seen on a 480x800 portrait screen.
+	init_camera(&cameras[PLAYER_BLUE], 480.0f / 800.0f, 0);
+	init_camera(&cameras[PLAYER_RED], 480.0f / 800.0f, 1);
+	bake_standard_table_sdf(&table_sdf);
+
+	signal(SIGINT, handle_signal);
+	signal(SIGTERM, handle_signal);
+
+	Shard* shards = calloc(shard_count, sizeof(Shard));
+	assert(shards != NULL);
+
+	int i;
+	for (i = 0; i < shard_count; i++) {
+		if (!init_shard(&shards[i], i, port + i)) {
+			fprintf(stderr, "Could not set up shard %d on port %d: %s\n", i, port + i, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("Serving %d shards on ports %d-%d\n", shard_count, port, port + shard_count - 1);
+	if (share_telemetry())
+		printf("sharing telemetry as %s%d\n", TELEMETRY_NAME_PREFIX, (int) getpid());
+	fflush(stdout);
+
+	for (i = 0; i < shard_count; i++) {
+		pthread_create(&shards[i].thread, NULL, run_shard, &shards[i]);
+		pin_thread_to_core(shards[i].thread, (int) (i % core_count));
+	}
+
+	for (i = 0; i < shard_count; i++)
+		pthread_join(shards[i].thread, NULL);
+
+	stop_sharing_telemetry();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+
+/* Packets are sent as-is in host byte order, so the server and its clients
+   are expected to run on the same kind of machine. Each shard of the server
+   listens on its own port, starting at the base port, and a session always
+   lives on shard (session_id % shard_count). */
+
+#define DEFAULT_SERVER_PORT 27960
+#define SERVER_TICKS_PER_SECOND 60
+
+enum {
+	PACKET_JOIN = 1,
+	PACKET_TOUCH_PRESS,
+	PACKET_TOUCH_DRAG,
+	PACKET_LEAVE,
+	PACKET_STATE
+};
+
+enum {
+	PLAYER_BLUE = 0,
+	PLAYER_RED = 1
+};
+
+/* A touch from one of the players, in normalized device coordinates of a
+   480x800 portrait view from that player's end of the table. These map
+   directly onto on_touch_press() and on_touch_drag(). */
+typedef struct {
+	uint8_t type;
+	uint8_t player;
+	uint16_t reserved;
+	uint32_t session_id;
+	float normalized_x;
+	float normalized_y;
+	uint64_t client_time_us;
+} ClientPacket;
+
+/* Sent to every player in a session once per tick. The latest client_time_us
+   received from that player is echoed back, so clients can measure latency;
+   it stays the same until the player sends something new. */
+typedef struct {
+	uint8_t type;
+	// Who it was sent to, for clients that play both sides.
+	uint8_t player;
+	uint8_t reserved[2];
+	uint32_t session_id;
+	uint32_t frame;
+	float puck_x;
+	float puck_z;
+	float blue_mallet_x;
+	float blue_mallet_z;
+	float red_mallet_x;
+	float red_mallet_z;
+	uint64_t echoed_client_time_us;
+} StatePacket;
+
+static inline int get_shard_for_session(uint32_t session_id, int shard_count) {
+	return (int) (session_id % (uint32_t) shard_count);
+}
@@ -0,0 +1,818 @@
+/* Microbenchmarks for the core, run on the software rasterizer so that the
+   parts that need GL can be measured without a GPU. Each benchmark is warmed
+   up while the number of iterations per sample is calibrated, and is then
+   sampled repeatedly on a pinned CPU. Samples that are far from the median
+   are dropped as outliers before the rest are summarized.
+
+   With -j, the results are also written as JSON. With -b, they're compared
+   against the JSON of an earlier run, and the exit status is non-zero if
+   anything got slower by more than the threshold and its own noise. */
+#define _GNU_SOURCE
+#include "arena.h"
+#include "camera.h"
+#include "entities.h"
+#include "game.h"
+#include "game_state.h"
+#include "geometry.h"
+#include "image.h"
+#include "picking.h"
+#include "platform_asset_utils.h"
+#include "shader.h"
+#include "shapes.h"
+#include "soft_gl.h"
+#include "table_sdf.h"
+#include "timer.h"
+#include <math.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SAMPLES 1000
+// Geometry queries cycle through this many inputs, so that they can't be folded away.
+#define QUERY_COUNT 256
+#define CIRCLE_POINTS 32
+
+typedef struct {
+	const char* name;
+	// Called around every sample, outside of the timing.
+	void (*set_up)(void);
+	void (*tear_down)(void);
+	/* Returns the number of bytes processed, for benchmarks that are measured
+	   by throughput, or 0. */
+	long long (*run)(int iterations);
+} Benchmark;
+
+typedef struct {
+	int iterations_per_sample;
+	int samples;
+	int outliers;
+	// Per iteration, over the samples that weren't outliers.
+	double median_ns;
+	double mad_ns;
+	double mean_ns;
+	double stddev_ns;
+	double min_ns;
+	double max_ns;
+	double megabytes_per_second;
+} Result;
+
+typedef struct {
+	int sample_count;
+	long long warmup_us;
+	long long sample_target_us;
+	double regression_threshold;
+	const char* filter;
+	const char* json_path;
+	const char* baseline_path;
+} Options;
+
+// The game logs to stdout, so stdout is sent to /dev/null while benchmarks
+// run and the report is written to a copy of the original.
+static FILE* report;
+
+// Keeps results alive, so that the work producing them isn't optimized away.
+static volatile float sink;
+
+/* Geometry */
+
+static Ray rays[QUERY_COUNT];
+static Sphere spheres[QUERY_COUNT];
+static Plane table_plane = {{0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}};
+
+static float random_between(unsigned int* state, float low, float high) {
+	*state = *state * 1664525u + 1013904223u;
+	return low + (high - low) * (float) (*state >> 8) / 16777216.0f;
+}
+
+/* Rays from around where the camera is, towards the table, about half of
+   which pass through their sphere. */
+static void set_up_geometry() {
+	unsigned int state = 1;
+	int i;
+	for (i = 0; i < QUERY_COUNT; i++) {
+		rays[i] = (Ray) {{random_between(&state, -0.2f, 0.2f), 1.2f, 2.2f},
+			{random_between(&state, -0.5f, 0.5f), -1.2f, random_between(&state, -3.0f, -1.5f)}};
+		spheres[i] = (Sphere) {{random_between(&state, -0.5f, 0.5f), 0.075f, random_between(&state, -0.8f, 0.8f)},
+			random_between(&state, 0.05f, 0.3f)};
+	}
+}
+
+static void tear_down_nothing() {
+}
+
+static long long run_sphere_intersects_ray(int iterations) {
+	int i, hits = 0;
+	for (i = 0; i < iterations; i++)
+		hits += sphere_intersects_ray(spheres[i & (QUERY_COUNT - 1)], rays[i & (QUERY_COUNT - 1)]);
+	sink = (float) hits;
+	return 0;
+}
+
+static long long run_distance_between(int iterations) {
+	int i;
+	float total = 0.0f;
+	for (i = 0; i < iterations; i++)
+		total += distance_between(spheres[i & (QUERY_COUNT - 1)].center, rays[i & (QUERY_COUNT - 1)]);
+	sink = total;
+	return 0;
+}
+
+static long long run_ray_intersection_point(int iterations) {
+	int i;
+	float total = 0.0f;
+	for (i = 0; i < iterations; i++) {
+		vec3 point;
+		ray_intersection_point(point, rays[i & (QUERY_COUNT - 1)], table_plane);
+		total += point[0] + point[2];
+	}
+	sink = total;
+	return 0;
+}
+
+/* Shapes */
+
+static float shape_vertices[(CIRCLE_POINTS + 1) * 2 * 3];
+
+static void set_up_nothing() {
+}
+
+static long long run_gen_circle(int iterations) {
+	int i;
+	for (i = 0; i < iterations; i++)
+		gen_circle(shape_vertices, 0, 0.0f, (float) (i & 7) * 0.01f, 0.0f, 0.08f, CIRCLE_POINTS);
+	sink = shape_vertices[4];
+	return 0;
+}
+
+static long long run_gen_cylinder(int iterations) {
+	int i;
+	for (i = 0; i < iterations; i++)
+		gen_cylinder(shape_vertices, 0, 0.0f, (float) (i & 7) * 0.01f, 0.0f, 0.02f, 0.06f, CIRCLE_POINTS);
+	sink = shape_vertices[4];
+	return 0;
+}
+
+/* Picking */
+
+// A full batch of touches, each against a few mallets, as when several
+// fingers are down in a game with more than one mallet a side.
+#define PICK_OBJECT_COUNT 4
+static const float pick_mallet_height = 0.15f;
+
+static Camera pick_camera;
+static TouchPoint pick_touch_points[MAX_PICK_TOUCHES];
+static Sphere pick_objects[PICK_OBJECT_COUNT];
+
+static void set_up_picking() {
+	unsigned int state = 1;
+	int i;
+	init_camera(&pick_camera, 1920.0f / 1080.0f, 0);
+	for (i = 0; i < MAX_PICK_TOUCHES; i++)
+		pick_touch_points[i] = (TouchPoint) {random_between(&state, -1.0f, 1.0f), random_between(&state, -1.0f, 1.0f)};
+	for (i = 0; i < PICK_OBJECT_COUNT; i++) {
+		pick_objects[i] = (Sphere) {{random_between(&state, -0.5f, 0.5f), 0.075f, random_between(&state, -0.8f, 0.8f)},
+			pick_mallet_height / 2.0f};
+	}
+}
+
+static long long run_pick_touches(int iterations) {
+	PickHit hits[MAX_PICK_TOUCHES];
+	int i, hit_count = 0;
+	float total = 0.0f;
+	for (i = 0; i < iterations; i++) {
+		pick_touches(&pick_camera, pick_touch_points, MAX_PICK_TOUCHES, pick_objects, PICK_OBJECT_COUNT,
+			table_plane, hits);
+		hit_count += hits[i & (MAX_PICK_TOUCHES - 1)].object;
+		total += hits[i & (MAX_PICK_TOUCHES - 1)].plane_point[0];
+	}
+	sink = total + (float) hit_count;
+	return 0;
+}
+
+/* The same, a touch and an object at a time, as each touch was picked before. */
+static long long run_pick_touches_one_by_one(int iterations) {
+	int i, touch, object, hit_count = 0;
+	float total = 0.0f;
+	for (i = 0; i < iterations; i++) {
+		for (touch = 0; touch < MAX_PICK_TOUCHES; touch++) {
+			const TouchPoint point = pick_touch_points[touch];
+			for (object = 0; object < PICK_OBJECT_COUNT; object++) {
+				hit_count += is_mallet_touched(&pick_camera, pick_objects[object].center, pick_mallet_height,
+					point.normalized_x, point.normalized_y);
+			}
+			vec3 touched_point;
+			get_touched_point_on_table(&pick_camera, point.normalized_x, point.normalized_y, touched_point);
+			total += touched_point[0];
+		}
+	}
+	sink = total + (float) hit_count;
+	return 0;
+}
+
+/* Image decoding */
+
+// Asset data on this platform belongs to the arena it's read into, so it
+// goes when the arena is released.
+static Arena image_arena;
+static const void* image_data;
+static int image_data_size;
+
+static void set_up_image_decode(const char* path) {
+	init_arena(&image_arena, 4 * 1024 * 1024);
+	const FileData file = get_asset_data(path, &image_arena);
+	image_data = file.data;
+	image_data_size = (int) file.data_length;
+}
+
+static void set_up_png_decode() {
+	set_up_image_decode("textures/air_hockey_surface.png");
+}
+
+static void set_up_qoi_decode() {
+	set_up_image_decode("textures/air_hockey_surface.qoi");
+}
+
+static void tear_down_image_decode() {
+	release_arena(&image_arena);
+}
+
+// Counts decoded bytes, so that formats can be compared by throughput.
+static long long run_image_decode(int iterations) {
+	long long bytes = 0;
+	int i;
+	for (i = 0; i < iterations; i++) {
+		const ArenaMarker marker = begin_arena_scope(&image_arena);
+		const RawImageData image = get_raw_image_data(image_data, image_data_size, &image_arena);
+		bytes += image.size;
+		end_arena_scope(&image_arena, marker);
+	}
+	return bytes;
+}
+
+/* Shader programs */
+
+static Arena shader_arena;
+static const GLchar* vertex_shader_source;
+static GLint vertex_shader_source_length;
+static const GLchar* fragment_shader_source;
+static GLint fragment_shader_source_length;
+
+static void set_up_build_program() {
+	if (!soft_gl_create_context(64, 64, 2, 1)) {
+		fprintf(stderr, "Couldn't create a context\n");
+		exit(EXIT_FAILURE);
+	}
+	init_arena(&shader_arena, 64 * 1024);
+	const FileData vertex_shader_file = get_asset_data("shaders/texture_shader.vsh", &shader_arena);
+	const FileData fragment_shader_file = get_asset_data("shaders/texture_shader.fsh", &shader_arena);
+	vertex_shader_source = vertex_shader_file.data;
+	vertex_shader_source_length = (GLint) vertex_shader_file.data_length;
+	fragment_shader_source = fragment_shader_file.data;
+	fragment_shader_source_length = (GLint) fragment_shader_file.data_length;
+}
+
+static void tear_down_build_program() {
+	release_arena(&shader_arena);
+	soft_gl_destroy_context();
+}
+
+static long long run_build_program(int iterations) {
+	int i;
+	for (i = 0; i < iterations; i++) {
+		const GLuint program = build_program(vertex_shader_source, vertex_shader_source_length,
+			fragment_shader_source, fragment_shader_source_length, &shader_arena);
+		delete_program(program);
+	}
+	return 0;
+}
+
+/* Physics */
+
+static GameState physics_state;
+static GameInput physics_inputs[64];
+static TableSdf physics_table_sdf;
+static const TableSdf* physics_table;
+
+/* The puck is served towards the blue mallet, which circles around its half
+   of the table, so that the steps include strikes as well as bounces. */
+static void set_up_physics_on(const TableSdf* table) {
+	int i;
+	physics_table = table;
+	init_game_state(&physics_state);
+	physics_state.puck_vector[0] = 0.01f;
+	physics_state.puck_vector[2] = 0.02f;
+	for (i = 0; i < 64; i++) {
+		const float angle = (float) i / 64.0f * 2.0f * (float) M_PI;
+		physics_inputs[i] = (GameInput) {{1, 0.3f * cosf(angle), 0.4f + 0.2f * sinf(angle)}, {0, 0.0f, 0.0f}};
+	}
+}
+
+// The baked table that the game, the env and the server play on.
+static void set_up_physics() {
+	bake_standard_table_sdf(&physics_table_sdf);
+	set_up_physics_on(&physics_table_sdf);
+}
+
+static void tear_down_physics() {
+	free_table_sdf(&physics_table_sdf);
+}
+
+// The same rectangle without a distance field, as before tables were baked.
+static void set_up_physics_rectangle() {
+	set_up_physics_on(NULL);
+}
+
+static long long run_physics_step(int iterations) {
+	int i;
+	for (i = 0; i < iterations; i++)
+		update_game_state(&physics_state, &physics_inputs[i & 63], physics_table);
+	sink = physics_state.puck_position[0];
+	return 0;
+}
+
+/* Table collision */
+
+// Rounded corners, a goal mouth cut into each end and four round obstacles,
+// for about a hundred edges in all.
+#define TABLE_CORNER_SEGMENTS 8
+#define TABLE_OBSTACLE_COUNT 4
+#define TABLE_OBSTACLE_SEGMENTS 16
+
+static float table_walls[(4 * (TABLE_CORNER_SEGMENTS + 1) + 8) * 2];
+static float table_obstacles[TABLE_OBSTACLE_COUNT][TABLE_OBSTACLE_SEGMENTS * 2 + 2];
+static TableOutline table_outlines[1 + TABLE_OBSTACLE_COUNT];
+static TableShape table_shape;
+static TableSdf bench_table_sdf;
+static float table_queries[QUERY_COUNT][2];
+
+static int append_point(float* points, int point_count, float x, float z) {
+	points[point_count * 2] = x;
+	points[point_count * 2 + 1] = z;
+	return point_count + 1;
+}
+
+static void set_up_table_shape() {
+	const float pi = (float) M_PI;
+	const float corner_radius = 0.15f;
+	const float goal_half_width = 0.15f;
+	const float goal_depth = 0.08f;
+	int count = 0;
+
+	// Around from the far left corner, through the far goal, then the near one.
+	count = append_arc_to_outline(table_walls, count, table_bounds.left + corner_radius, table_bounds.far + corner_radius,
+		corner_radius, pi, 1.5f * pi, TABLE_CORNER_SEGMENTS);
+	count = append_point(table_walls, count, -goal_half_width, table_bounds.far);
+	count = append_point(table_walls, count, -goal_half_width, table_bounds.far - goal_depth);
+	count = append_point(table_walls, count, goal_half_width, table_bounds.far - goal_depth);
+	count = append_point(table_walls, count, goal_half_width, table_bounds.far);
+	count = append_arc_to_outline(table_walls, count, table_bounds.right - corner_radius, table_bounds.far + corner_radius,
+		corner_radius, 1.5f * pi, 2.0f * pi, TABLE_CORNER_SEGMENTS);
+	count = append_arc_to_outline(table_walls, count, table_bounds.right - corner_radius, table_bounds.near - corner_radius,
+		corner_radius, 0.0f, 0.5f * pi, TABLE_CORNER_SEGMENTS);
+	count = append_point(table_walls, count, goal_half_width, table_bounds.near);
+	count = append_point(table_walls, count, goal_half_width, table_bounds.near + goal_depth);
+	count = append_point(table_walls, count, -goal_half_width, table_bounds.near + goal_depth);
+	count = append_point(table_walls, count, -goal_half_width, table_bounds.near);
+	count = append_arc_to_outline(table_walls, count, table_bounds.left + corner_radius, table_bounds.near - corner_radius,
+		corner_radius, 0.5f * pi, pi, TABLE_CORNER_SEGMENTS);
+	table_outlines[0] = (TableOutline) {table_walls, count};
+
+	int i;
+	for (i = 0; i < TABLE_OBSTACLE_COUNT; i++) {
+		const float x = (i % 2 == 0 ? -0.25f : 0.25f);
+		const float z = (i < 2 ? -0.35f : 0.35f);
+		// The last point of the circle is the first one again, so it's left off.
+		const int obstacle_count = append_arc_to_outline(table_obstacles[i], 0, x, z, 0.06f,
+			0.0f, 2.0f * pi, TABLE_OBSTACLE_SEGMENTS) - 1;
+		table_outlines[1 + i] = (TableOutline) {table_obstacles[i], obstacle_count};
+	}
+	table_shape = (TableShape) {table_outlines, 1 + TABLE_OBSTACLE_COUNT};
+
+	unsigned int state = 1;
+	for (i = 0; i < QUERY_COUNT; i++) {
+		table_queries[i][0] = random_between(&state, table_bounds.left, table_bounds.right);
+		table_queries[i][1] = random_between(&state, table_bounds.far, table_bounds.near);
+	}
+}
+
+static void set_up_table_sdf() {
+	set_up_table_shape();
+	bake_table_sdf(&bench_table_sdf, &table_shape, 0.01f, 0.1f);
+}
+
+static void tear_down_table_sdf() {
+	free_table_sdf(&bench_table_sdf);
+}
+
+static long long run_table_sdf_query(int iterations) {
+	float total = 0.0f, normal[2];
+	int i;
+	for (i = 0; i < iterations; i++) {
+		const float* query = table_queries[i & (QUERY_COUNT - 1)];
+		total += sample_table_sdf(&bench_table_sdf, query[0], query[1], normal) + normal[0];
+	}
+	sink = total;
+	return 0;
+}
+
+/* The same query, answered by going through every edge. */
+static long long run_table_edges_query(int iterations) {
+	float total = 0.0f, normal[2];
+	int i;
+	for (i = 0; i < iterations; i++) {
+		const float* query = table_queries[i & (QUERY_COUNT - 1)];
+		total += get_distance_to_table_edges(&table_shape, query[0], query[1], normal) + normal[0];
+	}
+	sink = total;
+	return 0;
+}
+
+static long long run_table_sdf_bake(int iterations) {
+	int i;
+	for (i = 0; i < iterations; i++) {
+		TableSdf sdf;
+		bake_table_sdf(&sdf, &table_shape, 0.01f, 0.1f);
+		sink = sdf.samples[0];
+		free_table_sdf(&sdf);
+	}
+	return 0;
+}
+
+/* Entities */
+
+static World bench_world;
+
+/* A full world where nothing moves, so the check has to look at every velocity. */
+static void set_up_entities() {
+	init_world(&bench_world);
+	int i;
+	for (i = 0; i < MAX_ENTITIES; i++) {
+		const Entity entity = create_entity(&bench_world);
+		add_transform(&bench_world, entity, 0.0f, 0.0f, 0.0f);
+		add_velocity(&bench_world, entity, 0.0f, 0.0f, 0.0f);
+	}
+}
+
+static long long run_has_moving_entities(int iterations) {
+	int moving = 0;
+	int i;
+	for (i = 0; i < iterations; i++)
+		moving += has_moving_entities(&bench_world, 0.0001f);
+	sink = (float) moving;
+	return 0;
+}
+
+/* Frames */
+
+static int frame;
+
+static void drag_and_draw_frame() {
+	on_touch_drag(0.4f * sinf((float) frame * 0.05f), -0.55f + 0.15f * cosf((float) frame * 0.07f));
+	on_draw_frame();
+	soft_gl_finish();
+	frame++;
+}
+
+/* Draws at a phone-sized resolution on one thread, with the blue mallet
+   dragged around as the soft platform's main does. */
+static void set_up_draw_frame_with_version(int major_version) {
+	if (!soft_gl_create_context(480, 800, major_version, 1)) {
+		fprintf(stderr, "Couldn't create a context\n");
+		exit(EXIT_FAILURE);
+	}
+	on_surface_created();
+	on_surface_changed(480, 800);
+	on_touch_press(0.0f, -0.55f);
+
+	// The first few frames are left out while caches warm up.
+	for (frame = 0; frame < 10; )
+		drag_and_draw_frame();
+}
+
+/* With uniform buffers. */
+static void set_up_draw_frame() {
+	set_up_draw_frame_with_version(3);
+}
+
+/* Without, setting each object's uniforms with glUniform*(). */
+static void set_up_draw_frame_es2() {
+	set_up_draw_frame_with_version(2);
+}
+
+static void tear_down_draw_frame() {
+	on_surface_destroyed();
+	soft_gl_destroy_context();
+}
+
+static long long run_draw_frame(int iterations) {
+	int i;
+	for (i = 0; i < iterations; i++)
+		drag_and_draw_frame();
+	return 0;
+}
+
+static const Benchmark benchmarks[] = {
+	{"geometry/sphere_intersects_ray", set_up_geometry, tear_down_nothing, run_sphere_intersects_ray},
+	{"geometry/distance_between", set_up_geometry, tear_down_nothing, run_distance_between},
+	{"geometry/ray_intersection_point", set_up_geometry, tear_down_nothing, run_ray_intersection_point},
+	{"picking/pick_touches", set_up_picking, tear_down_nothing, run_pick_touches},
+	{"picking/pick_touches_one_by_one", set_up_picking, tear_down_nothing, run_pick_touches_one_by_one},
+	{"shapes/gen_circle", set_up_nothing, tear_down_nothing, run_gen_circle},
+	{"shapes/gen_cylinder", set_up_nothing, tear_down_nothing, run_gen_cylinder},
+	{"image/png_decode", set_up_png_decode, tear_down_image_decode, run_image_decode},
+	{"image/qoi_decode", set_up_qoi_decode, tear_down_image_decode, run_image_decode},
+	{"shader/build_program", set_up_build_program, tear_down_build_program, run_build_program},
+	{"physics/step", set_up_physics, tear_down_physics, run_physics_step},
+	{"physics/step_rectangle", set_up_physics_rectangle, tear_down_nothing, run_physics_step},
+	{"physics/table_sdf_query", set_up_table_sdf, tear_down_table_sdf, run_table_sdf_query},
+	{"physics/table_edges_query", set_up_table_shape, tear_down_nothing, run_table_edges_query},
+	{"physics/table_sdf_bake", set_up_table_shape, tear_down_nothing, run_table_sdf_bake},
+	{"entities/has_moving_entities", set_up_entities, tear_down_nothing, run_has_moving_entities},
+	{"game/on_draw_frame", set_up_draw_frame, tear_down_draw_frame, run_draw_frame},
+	{"game/on_draw_frame_es2", set_up_draw_frame_es2, tear_down_draw_frame, run_draw_frame},
+};
+
+/* Measurement */
+
+/* Returns how long the iterations took, in microseconds, and adds the bytes they processed to bytes. */
+static long long run_sample(const Benchmark* benchmark, int iterations, long long* bytes) {
+	benchmark->set_up();
+	const long long start = get_time_in_microseconds();
+	*bytes += benchmark->run(iterations);
+	const long long elapsed = get_time_in_microseconds() - start;
+	benchmark->tear_down();
+	return elapsed;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+	const double first = *(const double*) a;
+	const double second = *(const double*) b;
+	return (first > second) - (first < second);
+}
+
+static double get_median(const double* sorted, int count) {
+	return count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0;
+}
+
+static Result measure(const Benchmark* benchmark, const Options* options) {
+	Result result;
+	memset(&result, 0, sizeof(result));
+	long long bytes = 0;
+
+	// Doubles the iterations until a sample takes long enough to time well,
+	// then keeps going at that count until the warmup time is up.
+	int iterations = 1;
+	long long warmup_elapsed = 0;
+	for (;;) {
+		const long long elapsed = run_sample(benchmark, iterations, &bytes);
+		warmup_elapsed += elapsed;
+		if (elapsed < options->sample_target_us && iterations < (1 << 28)) {
+			iterations = elapsed > 0 && options->sample_target_us / elapsed < 2
+				? (int) ((long long) iterations * options->sample_target_us / elapsed + 1) : iterations * 2;
+			continue;
+		}
+		if (warmup_elapsed >= options->warmup_us)
+			break;
+	}
+	result.iterations_per_sample = iterations;
+
+	static double samples[MAX_SAMPLES];
+	static double deviations[MAX_SAMPLES];
+	long long total_us = 0;
+	int i;
+	bytes = 0;
+	for (i = 0; i < options->sample_count; i++) {
+		const long long elapsed = run_sample(benchmark, iterations, &bytes);
+		total_us += elapsed;
+		samples[i] = (double) elapsed * 1000.0 / iterations;
+	}
+
+	// Samples with a modified z-score over 3.5 are outliers: usually the
+	// sample was interrupted, rather than the code being slower.
+	qsort(samples, options->sample_count, sizeof(double), compare_doubles);
+	const double median = get_median(samples, options->sample_count);
+	for (i = 0; i < options->sample_count; i++)
+		deviations[i] = fabs(samples[i] - median);
+	qsort(deviations, options->sample_count, sizeof(double), compare_doubles);
+	const double mad = get_median(deviations, options->sample_count);
+	const double outlier_distance = 3.5 * 1.4826 * mad;
+
+	double sum = 0.0, sum_of_squares = 0.0;
+	int kept = 0;
+	result.min_ns = INFINITY;
+	result.max_ns = 0.0;
+	for (i = 0; i < options->sample_count; i++) {
+		if (mad > 0.0 && fabs(samples[i] - median) > outlier_distance) {
+			result.outliers++;
+			continue;
+		}
+		sum += samples[i];
+		sum_of_squares += samples[i] * samples[i];
+		result.min_ns = fmin(result.min_ns, samples[i]);
+		result.max_ns = fmax(result.max_ns, samples[i]);
+		kept++;
+	}
+
+	result.samples = options->sample_count;
+	result.median_ns = median;
+	result.mad_ns = mad;
+	result.mean_ns = sum / kept;
+	result.stddev_ns = sqrt(fmax(0.0, sum_of_squares / kept - result.mean_ns * result.mean_ns));
+	if (bytes > 0 && total_us > 0)
+		result.megabytes_per_second = (double) bytes / total_us;
+	return result;
+}
+
+/* Baselines */
+
+static char* read_text_file(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	const long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* text = malloc(length + 1);
+	if (text != NULL && fread(text, 1, length, file) == (size_t) length) {
+		text[length] = '\0';
+	} else {
+		free(text);
+		text = NULL;
+	}
+	fclose(file);
+	return text;
+}
+
+static int read_baseline_number(const char* object, const char* key, double* value) {
+	char quoted_key[64];
+	snprintf(quoted_key, sizeof(quoted_key), "\"%s\":", key);
+	const char* found = strstr(object, quoted_key);
+	const char* object_end = strchr(object, '}');
+	if (found == NULL || (object_end != NULL && found > object_end))
+		return 0;
+	*value = strtod(found + strlen(quoted_key), NULL);
+	return 1;
+}
+
+/* Only reads the JSON this tool writes, where each benchmark is an object
+   that starts with its name. */
+static int find_baseline(const char* baseline, const char* name, double* median_ns, double* mad_ns) {
+	char quoted_name[256];
+	snprintf(quoted_name, sizeof(quoted_name), "\"name\": \"%s\"", name);
+	const char* object = strstr(baseline, quoted_name);
+	return object != NULL
+		&& read_baseline_number(object, "median_ns", median_ns)
+		&& read_baseline_number(object, "mad_ns", mad_ns);
+}
+
+/* Returns 1 if the benchmark regressed against the baseline. A change only
+   counts if it's over the threshold and also over three times the larger
+   spread of the two runs. */
+static int compare_with_baseline(const char* baseline, const char* name, const Result* result, double threshold) {
+	double baseline_median_ns, baseline_mad_ns;
+	if (!find_baseline(baseline, name, &baseline_median_ns, &baseline_mad_ns) || baseline_median_ns <= 0.0) {
+		fprintf(report, "%36s not in the baseline\n", "");
+		return 0;
+	}
+
+	const double change = result->median_ns / baseline_median_ns - 1.0;
+	const double noise = 3.0 * fmax(result->mad_ns / result->median_ns, baseline_mad_ns / baseline_median_ns);
+	const double significant_change = fmax(threshold, noise);
+	const char* verdict = change > significant_change ? "REGRESSION"
+		: change < -significant_change ? "improvement" : "no change";
+
+	fprintf(report, "%36s %+.1f%% against %.1f ns: %s\n", "", 100.0 * change, baseline_median_ns, verdict);
+	return change > significant_change;
+}
+
+/* Output */
+
+static void print_result(const char* name, const Result* result) {
+	fprintf(report, "%-36s %12.1f ns +- %4.1f%%  %14.0f/s", name, result->median_ns,
+		100.0 * result->mad_ns / result->median_ns, 1e9 / result->median_ns);
+	if (result->megabytes_per_second > 0.0)
+		fprintf(report, "  %8.1f MB/s", result->megabytes_per_second);
+	if (result->outliers > 0)
+		fprintf(report, "  (%d outlier%s)", result->outliers, result->outliers > 1 ? "s" : "");
+	fprintf(report, "\n");
+}
+
+static void write_json_result(FILE* file, const char* name, const Result* result, int is_last) {
+	fprintf(file, "\t\t{\"name\": \"%s\", \"iterations_per_sample\": %d, \"samples\": %d, \"outliers\": %d, "
+		"\"median_ns\": %.3f, \"mad_ns\": %.3f, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, "
+		"\"min_ns\": %.3f, \"max_ns\": %.3f, \"operations_per_second\": %.1f, \"megabytes_per_second\": %.3f}%s\n",
+		name, result->iterations_per_sample, result->samples, result->outliers,
+		result->median_ns, result->mad_ns, result->mean_ns, result->stddev_ns,
+		result->min_ns, result->max_ns, 1e9 / result->median_ns, result->megabytes_per_second,
+		is_last ? "" : ",");
+}
+
+/* Returns the CPU the benchmarks are pinned to, or -1 if pinning failed. */
+static int pin_to_cpu(int cpu) {
+	if (cpu < 0)
+		cpu = sched_getcpu();
+	if (cpu < 0)
+		return -1;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+		fprintf(stderr, "Couldn't pin to CPU %d; results may be noisier\n", cpu);
+		return -1;
+	}
+	return cpu;
+}
+
+int main(int argc, char** argv) {
+	Options options = {20, 250000, 50000, 0.05, NULL, NULL, NULL};
+	int cpu = -1;
+	int option;
+
+	while ((option = getopt(argc, argv, "n:w:s:c:f:j:b:r:")) != -1) {
+		switch (option) {
+			case 'n': options.sample_count = atoi(optarg); break;
+			case 'w': options.warmup_us = atoll(optarg) * 1000; break;
+			case 's': options.sample_target_us = atoll(optarg) * 1000; break;
+			case 'c': cpu = atoi(optarg); break;
+			case 'f': options.filter = optarg; break;
+			case 'j': options.json_path = optarg; break;
+			case 'b': options.baseline_path = optarg; break;
+			case 'r': options.regression_threshold = atof(optarg) / 100.0; break;
+			default:
+				fprintf(stderr, "Usage: %s [-n samples] [-w warmup ms] [-s ms per sample] [-c cpu to pin to] "
+					"[-f only benchmarks containing this] [-j write JSON here] [-b compare with this JSON] "
+					"[-r regression threshold in percent]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (options.sample_count < 3 || options.sample_count > MAX_SAMPLES || options.sample_target_us < 1000) {
+		fprintf(stderr, "Use between 3 and %d samples, of at least 1 ms each.\n", MAX_SAMPLES);
+		return EXIT_FAILURE;
+	}
+
+	char* baseline = NULL;
+	if (options.baseline_path != NULL) {
+		baseline = read_text_file(options.baseline_path);
+		if (baseline == NULL) {
+			fprintf(stderr, "Couldn't read %s\n", options.baseline_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	FILE* json = NULL;
+	if (options.json_path != NULL) {
+		json = fopen(options.json_path, "w");
+		if (json == NULL) {
+			fprintf(stderr, "Couldn't write %s\n", options.json_path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	report = fdopen(dup(STDOUT_FILENO), "w");
+	if (report == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+		fprintf(stderr, "Couldn't separate the report from the game's logging\n");
+		return EXIT_FAILURE;
+	}
+
+	cpu = pin_to_cpu(cpu);
+	fprintf(report, "%d samples per benchmark, pinned to CPU %d\n", options.sample_count, cpu);
+
+	const int benchmark_count = (int) (sizeof(benchmarks) / sizeof(benchmarks[0]));
+	int selected[sizeof(benchmarks) / sizeof(benchmarks[0])];
+	int selected_count = 0, regressions = 0, i;
+	for (i = 0; i < benchmark_count; i++) {
+		if (options.filter == NULL || strstr(benchmarks[i].name, options.filter) != NULL)
+			selected[selected_count++] = i;
+	}
+
+	if (json != NULL)
+		fprintf(json, "{\n\t\"cpu\": %d,\n\t\"samples\": %d,\n\t\"benchmarks\": [\n", cpu, options.sample_count);
+
+	for (i = 0; i < selected_count; i++) {
+		const Benchmark* benchmark = &benchmarks[selected[i]];
+		const Result result = measure(benchmark, &options);
+		print_result(benchmark->name, &result);
+		if (baseline != NULL)
+			regressions += compare_with_baseline(baseline, benchmark->name, &result, options.regression_threshold);
+		if (json != NULL)
+			write_json_result(json, benchmark->name, &result, i == selected_count - 1);
+		fflush(report);
+	}
+
+	if (json != NULL) {
+		fprintf(json, "\t]\n}\n");
+		fclose(json);
+	}
+	free(baseline);
+
+	if (regressions > 0) {
+		fprintf(report, "%d benchmark%s regressed\n", regressions, regressions > 1 ? "s" : "");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
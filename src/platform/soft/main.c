@@ -0,0 +1,252 @@
+/* Runs the game headless on the software rasterizer and reports how fast it
+   draws, at a phone-sized and at a 1080p framebuffer, first on one thread and
+   then on every thread asked for. The blue mallet is dragged around so that
+   the puck keeps moving. With -c, the threaded runs are repeated while
+   capturing every frame, to show what capture adds to the frame time.
+   With -i, the single threaded runs then let go of the mallet and tick at
+   60 Hz for that many frames, only drawing the ones that the game says have
+   changed, to show how many an idle table skips. With -m, they first drag
+   the mallet for that many frames at 60 Hz, measuring how well the game
+   predicts where the finger will be when each frame is shown. With -g 2,
+   the context is OpenGL ES 2.0 rather than 3.0, so that the game falls back
+   to what it does without ES 3.
+   Telemetry is shared for as long as it runs, for telemetry_reader to watch. */
+#include "frame_capture.h"
+#include "game.h"
+#include "soft_gl.h"
+#include "telemetry.h"
+#include "timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+	int width;
+	int height;
+} Resolution;
+
+static const Resolution resolutions[] = {{480, 800}, {1920, 1080}};
+
+// The display refresh that idle frames are ticked at.
+static const long long vsync_interval_us = 16667;
+
+static int gl_major_version = 3;
+
+static void write_ppm(const char* path, int width, int height) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Couldn't write %s\n", path);
+		return;
+	}
+
+	const GLubyte* pixels = soft_gl_get_color_buffer();
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	int x, y;
+	// The color buffer starts at the bottom row.
+	for (y = height - 1; y >= 0; y--) {
+		for (x = 0; x < width; x++)
+			fwrite(pixels + ((size_t) y * width + x) * 4, 1, 3, file);
+	}
+	fclose(file);
+}
+
+static FrameCapture* start_capture(const Resolution* resolution, const char* capture_prefix, CaptureFormat format) {
+	char path[1024];
+	snprintf(path, sizeof(path), "%s_%dx%d.%s", capture_prefix, resolution->width, resolution->height,
+		format == CAPTURE_FORMAT_Y4M ? "y4m" : "rgba");
+
+	FrameCapture* capture = start_frame_capture(path, format, resolution->width, resolution->height, 60);
+	if (capture == NULL)
+		exit(EXIT_FAILURE);
+	return capture;
+}
+
+static void wait_for_next_tick(long long* next_tick_us) {
+	*next_tick_us += vsync_interval_us;
+	const long long wait_us = *next_tick_us - get_time_in_microseconds();
+	if (wait_us > 0) {
+		const struct timespec wait = {wait_us / 1000000, (wait_us % 1000000) * 1000L};
+		nanosleep(&wait, NULL);
+	}
+}
+
+/* Ticks like a display would without any input, drawing only the frames that
+   are needed, then touches the table to check that drawing wakes up again. */
+static void run_idle_frames(int frame_count, double frame_time_us) {
+	int frames_drawn = 0;
+	int last_frame_drawn = -1;
+	long long next_tick_us = get_time_in_microseconds();
+	int i;
+
+	for (i = 0; i < frame_count; i++) {
+		if (is_frame_needed()) {
+			on_draw_frame();
+			soft_gl_finish();
+			on_frame_presented();
+			frames_drawn++;
+			last_frame_drawn = i;
+		}
+		wait_for_next_tick(&next_tick_us);
+	}
+
+	on_touch_press(0.0f, -0.55f);
+	const int woke_up = is_frame_needed();
+	if (woke_up) {
+		on_draw_frame();
+		soft_gl_finish();
+		on_frame_presented();
+	}
+
+	const int frames_skipped = frame_count - frames_drawn;
+	printf("idle: drew %d of %d frames, the last at frame %d, skipping %d and about %.1f ms of rendering; %s on touch\n",
+		frames_drawn, frame_count, last_frame_drawn, frames_skipped, frames_skipped * frame_time_us / 1000.0,
+		woke_up ? "woke up" : "DIDN'T wake up");
+}
+
+/* Drags the mallet like a finger would, going by the clock rather than the
+   frame, with a drag each tick. */
+static void run_prediction_frames(int frame_count) {
+	long long next_tick_us = get_time_in_microseconds();
+	int i;
+
+	// The drags start where the mallet does, in the middle of its half of
+	// the table, and stay on that half.
+	on_touch_press(0.0f, -0.15f);
+	set_touch_prediction_measuring(1);
+	const long long start_us = get_time_in_microseconds();
+	for (i = 0; i < frame_count; i++) {
+		const float seconds = (float) (get_time_in_microseconds() - start_us) / 1000000.0f;
+		on_touch_drag(0.4f * sinf(seconds * 4.4f), -0.15f + 0.15f * (cosf(seconds * 3.1f) - 1.0f));
+		on_draw_frame();
+		soft_gl_finish();
+		on_frame_presented();
+		wait_for_next_tick(&next_tick_us);
+	}
+	set_touch_prediction_measuring(0);
+}
+
+/* Returns the average time per frame, in microseconds. Every frame is
+   captured if there's a capture prefix. */
+static double run_frames(const Resolution* resolution, int thread_count, int frame_count, int idle_frame_count,
+	int prediction_frame_count, const char* output_prefix, const char* capture_prefix, CaptureFormat capture_format) {
+	if (!soft_gl_create_context(resolution->width, resolution->height, gl_major_version, thread_count)) {
+		fprintf(stderr, "Couldn't create a %dx%d OpenGL ES %d context with %d threads\n",
+			resolution->width, resolution->height, gl_major_version, thread_count);
+		exit(EXIT_FAILURE);
+	}
+
+	on_surface_created();
+	on_surface_changed(resolution->width, resolution->height);
+	on_touch_press(0.0f, -0.55f);
+	// Capture reads back through the context, so it starts once the game has
+	// found out what the context can do.
+	FrameCapture* capture = capture_prefix != NULL ? start_capture(resolution, capture_prefix, capture_format) : NULL;
+
+	long long start = 0;
+	int i;
+	// The first few frames are left out while caches warm up.
+	for (i = -10; i < frame_count; i++) {
+		if (i == 0)
+			start = get_time_in_microseconds();
+		on_touch_drag(0.4f * sinf((float) i * 0.05f), -0.55f + 0.15f * cosf((float) i * 0.07f));
+		on_draw_frame();
+		soft_gl_finish();
+		on_frame_presented();
+		if (capture != NULL && i >= 0)
+			capture_frame(capture);
+	}
+	const long long elapsed = get_time_in_microseconds() - start;
+	if (prediction_frame_count > 0)
+		run_prediction_frames(prediction_frame_count);
+	if (idle_frame_count > 0)
+		run_idle_frames(idle_frame_count, (double) elapsed / frame_count);
+
+	if (capture != NULL) {
+		const FrameCaptureStats stats = stop_frame_capture(capture);
+		printf("captured %llu frames %s, %.2f ms each on the render thread, %llu waited for the writer\n",
+			stats.frames_captured, stats.uses_pixel_pack_buffers ? "through pixel pack buffers" : "with glReadPixels()",
+			(double) stats.total_capture_time_us / 1000.0 / stats.frames_captured, stats.frames_waited_for_writer);
+	}
+
+	if (output_prefix != NULL) {
+		char path[1024];
+		snprintf(path, sizeof(path), "%s_%dx%d.ppm", output_prefix, resolution->width, resolution->height);
+		write_ppm(path, resolution->width, resolution->height);
+	}
+
+	on_surface_destroyed();
+	soft_gl_destroy_context();
+	return (double) elapsed / frame_count;
+}
+
+int main(int argc, char** argv) {
+	int thread_count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	int frame_count = 300;
+	int idle_frame_count = 0;
+	int prediction_frame_count = 0;
+	const char* output_prefix = NULL;
+	const char* capture_prefix = NULL;
+	CaptureFormat capture_format = CAPTURE_FORMAT_Y4M;
+	int option;
+
+	while ((option = getopt(argc, argv, "t:f:i:m:g:o:c:r")) != -1) {
+		switch (option) {
+			case 't': thread_count = atoi(optarg); break;
+			case 'f': frame_count = atoi(optarg); break;
+			case 'i': idle_frame_count = atoi(optarg); break;
+			case 'm': prediction_frame_count = atoi(optarg); break;
+			case 'g': gl_major_version = atoi(optarg); break;
+			case 'o': output_prefix = optarg; break;
+			case 'c': capture_prefix = optarg; break;
+			case 'r': capture_format = CAPTURE_FORMAT_RAW_RGBA; break;
+			default:
+				fprintf(stderr, "Usage: %s [-t threads] [-f frames] [-i idle frames to tick through after them] "
+					"[-m frames to measure touch prediction over after them] [-g OpenGL ES major version, 2 or 3] "
+					"[-o output prefix for the last frames] "
+					"[-c capture prefix for every frame] [-r capture raw RGBA instead of Y4M]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (thread_count < 1 || frame_count < 1 || idle_frame_count < 0 || prediction_frame_count < 0) {
+		fprintf(stderr, "Threads and frames must be positive.\n");
+		return EXIT_FAILURE;
+	}
+	if (gl_major_version != 2 && gl_major_version != 3) {
+		fprintf(stderr, "The OpenGL ES version must be 2 or 3.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (share_telemetry())
+		printf("sharing telemetry as %s%d\n", TELEMETRY_NAME_PREFIX, (int) getpid());
+
+	size_t i;
+	for (i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+		const Resolution* resolution = &resolutions[i];
+		const double single_thread_us = run_frames(resolution, 1, frame_count, idle_frame_count, prediction_frame_count,
+			NULL, NULL, capture_format);
+		printf("%dx%d, 1 thread: %.2f ms per frame, %.1f fps\n",
+			resolution->width, resolution->height, single_thread_us / 1000.0, 1000000.0 / single_thread_us);
+
+		double threaded_us = single_thread_us;
+		if (thread_count > 1 || output_prefix != NULL) {
+			threaded_us = run_frames(resolution, thread_count, frame_count, 0, 0, output_prefix, NULL, capture_format);
+			printf("%dx%d, %d thread%s: %.2f ms per frame, %.1f fps (%.2fx)\n",
+				resolution->width, resolution->height, thread_count, thread_count > 1 ? "s" : "", threaded_us / 1000.0,
+				1000000.0 / threaded_us, single_thread_us / threaded_us);
+		}
+
+		if (capture_prefix != NULL) {
+			const double capturing_us = run_frames(resolution, thread_count, frame_count, 0, 0, NULL,
+				capture_prefix, capture_format);
+			printf("%dx%d, %d thread%s, capturing: %.2f ms per frame (%+.1f%%)\n",
+				resolution->width, resolution->height, thread_count, thread_count > 1 ? "s" : "",
+				capturing_us / 1000.0, 100.0 * (capturing_us - threaded_us) / threaded_us);
+		}
+	}
+
+	stop_sharing_telemetry();
+	return EXIT_SUCCESS;
+}
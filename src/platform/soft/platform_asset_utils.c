@@ -0,0 +1,24 @@
+#include "platform_asset_utils.h"
+#include "macros.h"
+#include "platform_file_utils.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Assets are read straight from the repository unless AIRHOCKEY_ASSETS points somewhere else. */
+static const char* default_asset_root = "../../../assets";
+
+FileData get_asset_data(const char* relative_path, Arena* arena) {
+	assert(relative_path != NULL);
+	const char* asset_root = getenv("AIRHOCKEY_ASSETS");
+	char path[1024];
+
+	snprintf(path, sizeof(path), "%s/%s", asset_root != NULL ? asset_root : default_asset_root, relative_path);
+	return get_file_data(path, arena);
+}
+
+void release_asset_data(const FileData* file_data) {
+	assert(file_data != NULL);
+	// The data belongs to the arena, so there's nothing to release.
+	UNUSED(file_data);
+}
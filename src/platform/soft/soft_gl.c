@@ -0,0 +1,1592 @@
+/* A small OpenGL ES 2.0 and 3.0 implementation on the CPU, enough to run the
+   core. There's no shader compiler: a program that samples a texture in its
+   fragment shader is run as "position times u_MvpMatrix, textured with
+   u_TextureUnit at a_TextureCoordinates", and any other program as "position
+   times u_MvpMatrix, filled with u_Color", which is what the core's shaders
+   do. A program with a uniform block takes u_MvpMatrix and u_Color from it
+   instead, laid out as the core's ObjectUniforms block is under std140.
+
+   Vertices are transformed, clipped and set up as soon as they're drawn, and
+   the resulting triangles are binned into screen tiles. Nothing is
+   rasterized until the frame is finished, at which point the tiles are
+   shared out between the worker threads. Every tile is owned by exactly one
+   thread, and draws its triangles in submission order, so the result
+   doesn't depend on the number of threads. */
+#define _GNU_SOURCE
+#include "soft_gl.h"
+#include "soft_gl_internal.h"
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_THREADS 64
+#define MAX_ATTRIBUTES 2
+#define MAX_TEXTURE_UNITS 8
+#define MAX_CLIPPED_VERTICES 5
+#define MAX_UNIFORM_BUFFER_BINDINGS 4
+// Like most mobile GPUs, so that callers have to space their ranges out.
+#define UNIFORM_BUFFER_OFFSET_ALIGNMENT 256
+
+enum {
+	POSITION_ATTRIBUTE = 0,
+	TEXTURE_COORDINATES_ATTRIBUTE = 1,
+};
+
+enum {
+	MVP_MATRIX_UNIFORM = 0,
+	COLOR_UNIFORM = 1,
+	TEXTURE_UNIT_UNIFORM = 2,
+};
+
+typedef struct {
+	int is_used;
+	GLubyte* data;
+	GLsizeiptr size;
+	int is_mapped;
+} Buffer;
+
+typedef struct {
+	int is_used;
+	int width;
+	int height;
+	GLint wrap_s;
+	GLint wrap_t;
+	uint32_t* texels;
+} Texture;
+
+/* Only depth renderbuffers are supported; color is drawn into textures. */
+typedef struct {
+	int is_used;
+	int width;
+	int height;
+	float* depth;
+} Renderbuffer;
+
+typedef struct {
+	int is_used;
+	GLuint color_texture;
+	GLuint depth_renderbuffer;
+} FramebufferObject;
+
+typedef struct {
+	int is_used;
+	GLenum type;
+	char* source;
+} Shader;
+
+typedef struct {
+	int is_used;
+	GLuint vertex_shader;
+	GLuint fragment_shader;
+	int is_textured;
+	int has_uniform_block;
+	GLuint uniform_block_binding;
+	GLfloat mvp_matrix[16];
+	GLfloat color[4];
+	GLint texture_unit;
+} Program;
+
+typedef struct {
+	int is_enabled;
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLsizei stride;
+	GLuint buffer;
+	size_t offset;
+} Attribute;
+
+typedef struct {
+	GLuint buffer;
+	GLintptr offset;
+	GLsizeiptr size;
+} UniformBufferBinding;
+
+typedef struct {
+	float clip[4];
+	float s;
+	float t;
+} Vertex;
+
+typedef struct {
+	uint32_t* indices;
+	int count;
+	int capacity;
+} TileBin;
+
+typedef struct {
+	pthread_t threads[MAX_THREADS];
+	int thread_count;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_ready;
+	pthread_cond_t work_done;
+	unsigned int generation;
+	int busy_workers;
+	int next_tile;
+	int is_shutting_down;
+} WorkerPool;
+
+static struct {
+	int is_created;
+	int major_version;
+	SoftFramebuffer window;
+	// What's drawn to: the window, or the attachments of the bound
+	// framebuffer object, or nothing if that isn't complete.
+	SoftFramebuffer framebuffer;
+	int tiles_x;
+	int tiles_y;
+	TileBin* bins;
+	int bin_capacity;
+
+	SoftTriangle* triangles;
+	int triangle_count;
+	int triangle_capacity;
+	SoftClear pending_clear;
+
+	Buffer* buffers;
+	int buffer_capacity;
+	Texture* textures;
+	int texture_capacity;
+	Shader* shaders;
+	int shader_capacity;
+	Program* programs;
+	int program_capacity;
+	FramebufferObject* framebuffer_objects;
+	int framebuffer_object_capacity;
+	Renderbuffer* renderbuffers;
+	int renderbuffer_capacity;
+
+	Attribute attributes[MAX_ATTRIBUTES];
+	GLuint array_buffer;
+	GLuint uniform_buffer;
+	GLuint pixel_pack_buffer;
+	UniformBufferBinding uniform_buffer_bindings[MAX_UNIFORM_BUFFER_BINDINGS];
+	GLuint current_program;
+	GLuint bound_textures[MAX_TEXTURE_UNITS];
+	int active_texture_unit;
+	GLint viewport[4];
+	uint32_t clear_color;
+	int depth_test;
+	GLuint bound_framebuffer;
+	GLuint bound_renderbuffer;
+	GLenum error;
+
+	WorkerPool pool;
+} context;
+
+static void set_error(GLenum error) {
+	if (context.error == GL_NO_ERROR)
+		context.error = error;
+}
+
+/* For OpenGL ES 3.0 functions, which a 2.0 context doesn't have. */
+static int is_version_3() {
+	if (context.major_version >= 3)
+		return 1;
+	set_error(GL_INVALID_OPERATION);
+	return 0;
+}
+
+/* Object names are indices into a growing table, offset by one so that zero is never used. */
+static GLuint allocate_name(void** table, int* capacity, size_t element_size) {
+	int i;
+	for (i = 0; i < *capacity; i++) {
+		if (!*(int*) ((char*) *table + i * element_size))
+			break;
+	}
+
+	if (i == *capacity) {
+		const int new_capacity = *capacity ? *capacity * 2 : 16;
+		*table = realloc(*table, new_capacity * element_size);
+		assert(*table != NULL);
+		memset((char*) *table + *capacity * element_size, 0, (new_capacity - *capacity) * element_size);
+		*capacity = new_capacity;
+	}
+
+	memset((char*) *table + i * element_size, 0, element_size);
+	*(int*) ((char*) *table + i * element_size) = 1;
+	return (GLuint) i + 1;
+}
+
+#define LOOKUP(table, capacity, name) \
+	((name) != 0 && (int) (name) <= (capacity) && (table)[(name) - 1].is_used ? &(table)[(name) - 1] : NULL)
+
+static Buffer* get_buffer(GLuint name) { return LOOKUP(context.buffers, context.buffer_capacity, name); }
+static Texture* get_texture(GLuint name) { return LOOKUP(context.textures, context.texture_capacity, name); }
+static Shader* get_shader(GLuint name) { return LOOKUP(context.shaders, context.shader_capacity, name); }
+static Program* get_program(GLuint name) { return LOOKUP(context.programs, context.program_capacity, name); }
+static FramebufferObject* get_framebuffer_object(GLuint name) {
+	return LOOKUP(context.framebuffer_objects, context.framebuffer_object_capacity, name);
+}
+static Renderbuffer* get_renderbuffer(GLuint name) {
+	return LOOKUP(context.renderbuffers, context.renderbuffer_capacity, name);
+}
+
+/* Worker pool */
+
+static void rasterize_tiles() {
+	const int tile_count = context.tiles_x * context.tiles_y;
+	int tile;
+
+	while ((tile = __atomic_fetch_add(&context.pool.next_tile, 1, __ATOMIC_RELAXED)) < tile_count) {
+		const TileBin* bin = &context.bins[tile];
+		rasterize_tile(&context.framebuffer, tile % context.tiles_x, tile / context.tiles_x,
+			&context.pending_clear, context.triangles, bin->indices, bin->count);
+	}
+}
+
+static void* run_worker(void* argument) {
+	WorkerPool* pool = argument;
+	unsigned int seen_generation = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+	for (;;) {
+		while (pool->generation == seen_generation && !pool->is_shutting_down)
+			pthread_cond_wait(&pool->work_ready, &pool->mutex);
+		if (pool->is_shutting_down)
+			break;
+		seen_generation = pool->generation;
+		pthread_mutex_unlock(&pool->mutex);
+
+		rasterize_tiles();
+
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->busy_workers == 0)
+			pthread_cond_signal(&pool->work_done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+static void start_worker_pool(WorkerPool* pool, int thread_count) {
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+
+	// The calling thread is one of the workers.
+	pool->thread_count = thread_count - 1;
+	int i;
+	for (i = 0; i < pool->thread_count; i++)
+		pthread_create(&pool->threads[i], NULL, run_worker, pool);
+}
+
+static void stop_worker_pool(WorkerPool* pool) {
+	pthread_mutex_lock(&pool->mutex);
+	pool->is_shutting_down = 1;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->mutex);
+
+	int i;
+	for (i = 0; i < pool->thread_count; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	pthread_cond_destroy(&pool->work_done);
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+static void flush() {
+	if (context.triangle_count == 0 && !context.pending_clear.clear_color && !context.pending_clear.clear_depth)
+		return;
+
+	WorkerPool* pool = &context.pool;
+	pool->next_tile = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->busy_workers = pool->thread_count;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->mutex);
+
+	rasterize_tiles();
+
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->busy_workers > 0)
+		pthread_cond_wait(&pool->work_done, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+
+	int i;
+	for (i = 0; i < context.tiles_x * context.tiles_y; i++)
+		context.bins[i].count = 0;
+	context.triangle_count = 0;
+	context.pending_clear.clear_color = 0;
+	context.pending_clear.clear_depth = 0;
+}
+
+/* Switches what's drawn to, after whatever was drawn to the last one has landed. */
+static void draw_to(const SoftFramebuffer* framebuffer) {
+	flush();
+	context.framebuffer = *framebuffer;
+	context.tiles_x = (framebuffer->width + TILE_SIZE - 1) / TILE_SIZE;
+	context.tiles_y = (framebuffer->height + TILE_SIZE - 1) / TILE_SIZE;
+
+	const int bin_count = context.tiles_x * context.tiles_y;
+	if (bin_count > context.bin_capacity) {
+		context.bins = realloc(context.bins, bin_count * sizeof(TileBin));
+		assert(context.bins != NULL);
+		memset(context.bins + context.bin_capacity, 0, (bin_count - context.bin_capacity) * sizeof(TileBin));
+		context.bin_capacity = bin_count;
+	}
+}
+
+/* Context */
+
+int soft_gl_create_context(int width, int height, int major_version, int thread_count) {
+	assert(!context.is_created);
+	if (width <= 0 || height <= 0 || (major_version != 2 && major_version != 3)
+	 || thread_count < 1 || thread_count > MAX_THREADS)
+		return 0;
+
+	memset(&context, 0, sizeof(context));
+	context.major_version = major_version;
+	context.window.width = width;
+	context.window.height = height;
+	context.window.color_buffer = calloc((size_t) width * height, sizeof(uint32_t));
+	context.window.depth_buffer = calloc((size_t) width * height, sizeof(float));
+	if (context.window.color_buffer == NULL || context.window.depth_buffer == NULL)
+		return 0;
+	draw_to(&context.window);
+
+	context.viewport[2] = width;
+	context.viewport[3] = height;
+	context.pending_clear.depth = 1.0f;
+
+	start_worker_pool(&context.pool, thread_count);
+	context.is_created = 1;
+	return 1;
+}
+
+void soft_gl_destroy_context() {
+	assert(context.is_created);
+	stop_worker_pool(&context.pool);
+
+	int i;
+	for (i = 0; i < context.bin_capacity; i++)
+		free(context.bins[i].indices);
+	for (i = 0; i < context.buffer_capacity; i++)
+		free(context.buffers[i].data);
+	for (i = 0; i < context.texture_capacity; i++)
+		free(context.textures[i].texels);
+	for (i = 0; i < context.renderbuffer_capacity; i++)
+		free(context.renderbuffers[i].depth);
+	for (i = 0; i < context.shader_capacity; i++)
+		free(context.shaders[i].source);
+
+	free(context.bins);
+	free(context.triangles);
+	free(context.buffers);
+	free(context.textures);
+	free(context.shaders);
+	free(context.programs);
+	free(context.framebuffer_objects);
+	free(context.renderbuffers);
+	free(context.window.color_buffer);
+	free(context.window.depth_buffer);
+	memset(&context, 0, sizeof(context));
+}
+
+void soft_gl_finish() {
+	flush();
+}
+
+const GLubyte* soft_gl_get_color_buffer() {
+	return (const GLubyte*) context.window.color_buffer;
+}
+
+/* Vertex processing */
+
+static float fetch_component(const GLubyte* source, GLenum type, GLboolean normalized) {
+	switch (type) {
+		case GL_FLOAT: { float value; memcpy(&value, source, sizeof(value)); return value; }
+		case GL_SHORT: {
+			short value; memcpy(&value, source, sizeof(value));
+			return normalized ? fmaxf((float) value / 32767.0f, -1.0f) : (float) value;
+		}
+		case GL_UNSIGNED_SHORT: {
+			unsigned short value; memcpy(&value, source, sizeof(value));
+			return normalized ? (float) value / 65535.0f : (float) value;
+		}
+		case GL_BYTE: {
+			const signed char value = *(const signed char*) source;
+			return normalized ? fmaxf((float) value / 127.0f, -1.0f) : (float) value;
+		}
+		case GL_UNSIGNED_BYTE: return normalized ? (float) *source / 255.0f : (float) *source;
+		default: return 0.0f;
+	}
+}
+
+static size_t get_type_size(GLenum type) {
+	switch (type) {
+		case GL_FLOAT: return sizeof(GLfloat);
+		case GL_SHORT: case GL_UNSIGNED_SHORT: return sizeof(GLshort);
+		default: return sizeof(GLbyte);
+	}
+}
+
+static void fetch_attribute(const Attribute* attribute, int vertex, float* out) {
+	out[0] = 0.0f; out[1] = 0.0f; out[2] = 0.0f; out[3] = 1.0f;
+	const Buffer* buffer = get_buffer(attribute->buffer);
+	if (!attribute->is_enabled || buffer == NULL)
+		return;
+
+	const size_t component_size = get_type_size(attribute->type);
+	const size_t stride = attribute->stride ? (size_t) attribute->stride : component_size * attribute->size;
+	const size_t start = attribute->offset + stride * vertex;
+	if (start + component_size * attribute->size > (size_t) buffer->size)
+		return;
+
+	int i;
+	for (i = 0; i < attribute->size; i++)
+		out[i] = fetch_component(buffer->data + start + component_size * i, attribute->type, attribute->normalized);
+}
+
+static void transform_vertex(const Program* program, int index, Vertex* vertex) {
+	float position[4], texture_coordinates[4];
+	fetch_attribute(&context.attributes[POSITION_ATTRIBUTE], index, position);
+	fetch_attribute(&context.attributes[TEXTURE_COORDINATES_ATTRIBUTE], index, texture_coordinates);
+
+	// Column-major, like glUniformMatrix4fv() without transposition.
+	const GLfloat* m = program->mvp_matrix;
+	int row;
+	for (row = 0; row < 4; row++) {
+		vertex->clip[row] = m[row] * position[0] + m[4 + row] * position[1]
+			+ m[8 + row] * position[2] + m[12 + row] * position[3];
+	}
+	vertex->s = texture_coordinates[0];
+	vertex->t = texture_coordinates[1];
+}
+
+static Vertex lerp_vertex(const Vertex* a, const Vertex* b, float amount) {
+	Vertex result;
+	int i;
+	for (i = 0; i < 4; i++)
+		result.clip[i] = a->clip[i] + (b->clip[i] - a->clip[i]) * amount;
+	result.s = a->s + (b->s - a->s) * amount;
+	result.t = a->t + (b->t - a->t) * amount;
+	return result;
+}
+
+/* Clips a polygon against the plane where distance() is zero, keeping the positive side. */
+static int clip_polygon(const Vertex* in, int in_count, Vertex* out, float sign) {
+	int out_count = 0;
+	int i;
+
+	for (i = 0; i < in_count; i++) {
+		const Vertex* current = &in[i];
+		const Vertex* next = &in[(i + 1) % in_count];
+		const float current_distance = current->clip[3] + sign * current->clip[2];
+		const float next_distance = next->clip[3] + sign * next->clip[2];
+
+		if (current_distance >= 0.0f)
+			out[out_count++] = *current;
+		if ((current_distance >= 0.0f) != (next_distance >= 0.0f))
+			out[out_count++] = lerp_vertex(current, next, current_distance / (current_distance - next_distance));
+	}
+
+	return out_count;
+}
+
+static SoftPlane get_attribute_plane(const SoftPlane* edges, float inverse_area, const float* values) {
+	SoftPlane plane = {0.0f, 0.0f, 0.0f};
+	int i;
+	for (i = 0; i < 3; i++) {
+		plane.a += edges[i].a * values[i];
+		plane.b += edges[i].b * values[i];
+		plane.c += edges[i].c * values[i];
+	}
+	plane.a *= inverse_area;
+	plane.b *= inverse_area;
+	plane.c *= inverse_area;
+	return plane;
+}
+
+static void bin_triangle(const SoftTriangle* triangle) {
+	if (context.triangle_count == context.triangle_capacity) {
+		context.triangle_capacity = context.triangle_capacity ? context.triangle_capacity * 2 : 1024;
+		context.triangles = realloc(context.triangles, context.triangle_capacity * sizeof(SoftTriangle));
+		assert(context.triangles != NULL);
+	}
+
+	const uint32_t index = (uint32_t) context.triangle_count++;
+	context.triangles[index] = *triangle;
+
+	int tile_x, tile_y;
+	for (tile_y = triangle->min_y / TILE_SIZE; tile_y <= triangle->max_y / TILE_SIZE; tile_y++) {
+		for (tile_x = triangle->min_x / TILE_SIZE; tile_x <= triangle->max_x / TILE_SIZE; tile_x++) {
+			TileBin* bin = &context.bins[tile_y * context.tiles_x + tile_x];
+			if (bin->count == bin->capacity) {
+				bin->capacity = bin->capacity ? bin->capacity * 2 : 64;
+				bin->indices = realloc(bin->indices, bin->capacity * sizeof(uint32_t));
+				assert(bin->indices != NULL);
+			}
+			bin->indices[bin->count++] = index;
+		}
+	}
+}
+
+static void setup_triangle(const Program* program, const Vertex* vertices[3]) {
+	float x[3], y[3], z[3], inverse_w[3], s_over_w[3], t_over_w[3];
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		const Vertex* vertex = vertices[i];
+		inverse_w[i] = 1.0f / vertex->clip[3];
+		x[i] = context.viewport[0] + (vertex->clip[0] * inverse_w[i] + 1.0f) * 0.5f * context.viewport[2];
+		y[i] = context.viewport[1] + (vertex->clip[1] * inverse_w[i] + 1.0f) * 0.5f * context.viewport[3];
+		z[i] = (vertex->clip[2] * inverse_w[i] + 1.0f) * 0.5f;
+		s_over_w[i] = vertex->s * inverse_w[i];
+		t_over_w[i] = vertex->t * inverse_w[i];
+	}
+
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0.0f || isnan(area))
+		return;
+
+	// Nothing is culled, so clockwise triangles are turned around.
+	if (area < 0.0f) {
+		float* attributes[] = {x, y, z, inverse_w, s_over_w, t_over_w};
+		for (i = 0; i < 6; i++) {
+			const float swap = attributes[i][1];
+			attributes[i][1] = attributes[i][2];
+			attributes[i][2] = swap;
+		}
+		area = -area;
+	}
+
+	SoftTriangle triangle;
+	const float min_x = fminf(x[0], fminf(x[1], x[2])), max_x = fmaxf(x[0], fmaxf(x[1], x[2]));
+	const float min_y = fminf(y[0], fminf(y[1], y[2])), max_y = fmaxf(y[0], fmaxf(y[1], y[2]));
+	const int viewport_max_x = context.viewport[0] + context.viewport[2] - 1;
+	const int viewport_max_y = context.viewport[1] + context.viewport[3] - 1;
+	triangle.min_x = (int) fmaxf(floorf(min_x), fmaxf((float) context.viewport[0], 0.0f));
+	triangle.min_y = (int) fmaxf(floorf(min_y), fmaxf((float) context.viewport[1], 0.0f));
+	triangle.max_x = (int) fminf(ceilf(max_x), fminf((float) viewport_max_x, (float) context.framebuffer.width - 1));
+	triangle.max_y = (int) fminf(ceilf(max_y), fminf((float) viewport_max_y, (float) context.framebuffer.height - 1));
+	if (triangle.min_x > triangle.max_x || triangle.min_y > triangle.max_y)
+		return;
+
+	// The edge function opposite each vertex is positive inside the triangle,
+	// and equal to the area at that vertex.
+	for (i = 0; i < 3; i++) {
+		const int j = (i + 1) % 3, k = (i + 2) % 3;
+		const float dx = x[k] - x[j], dy = y[k] - y[j];
+		triangle.edges[i] = (SoftPlane) {-dy, dx, dy * x[j] - dx * y[j]};
+		triangle.is_top_left[i] = dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+	}
+
+	const float inverse_area = 1.0f / area;
+	triangle.depth = get_attribute_plane(triangle.edges, inverse_area, z);
+	triangle.depth_test = context.depth_test;
+	triangle.is_textured = program->is_textured;
+
+	if (program->is_textured) {
+		const int unit = program->texture_unit;
+		const Texture* texture = unit >= 0 && unit < MAX_TEXTURE_UNITS
+			? get_texture(context.bound_textures[unit]) : NULL;
+		if (texture == NULL || texture->texels == NULL) {
+			// Sampling an incomplete texture gives opaque black.
+			triangle.is_textured = 0;
+			triangle.color = pack_rgba(0.0f, 0.0f, 0.0f, 1.0f);
+		} else {
+			triangle.inverse_w = get_attribute_plane(triangle.edges, inverse_area, inverse_w);
+			triangle.s_over_w = get_attribute_plane(triangle.edges, inverse_area, s_over_w);
+			triangle.t_over_w = get_attribute_plane(triangle.edges, inverse_area, t_over_w);
+			triangle.texture = (SoftTextureImage) {texture->width, texture->height,
+				texture->wrap_s == GL_REPEAT, texture->wrap_t == GL_REPEAT, texture->texels};
+		}
+	} else {
+		triangle.color = pack_rgba(program->color[0], program->color[1], program->color[2], program->color[3]);
+	}
+
+	bin_triangle(&triangle);
+}
+
+static void draw_triangle(const Program* program, const Vertex* a, const Vertex* b, const Vertex* c) {
+	// Only the near and far planes are clipped against; the sides are
+	// handled by limiting each triangle's bounds to the viewport.
+	Vertex polygon[MAX_CLIPPED_VERTICES], clipped[MAX_CLIPPED_VERTICES];
+	polygon[0] = *a;
+	polygon[1] = *b;
+	polygon[2] = *c;
+
+	int count = clip_polygon(polygon, 3, clipped, 1.0f);
+	count = clip_polygon(clipped, count, polygon, -1.0f);
+
+	int i;
+	for (i = 1; i + 1 < count; i++) {
+		const Vertex* vertices[3] = {&polygon[0], &polygon[i], &polygon[i + 1]};
+		setup_triangle(program, vertices);
+	}
+}
+
+/* Buffers */
+
+void glGenBuffers(GLsizei n, GLuint* buffers) {
+	int i;
+	for (i = 0; i < n; i++)
+		buffers[i] = allocate_name((void**) &context.buffers, &context.buffer_capacity, sizeof(Buffer));
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+	int i;
+	for (i = 0; i < n; i++) {
+		Buffer* buffer = get_buffer(buffers[i]);
+		if (buffer == NULL)
+			continue;
+		free(buffer->data);
+		memset(buffer, 0, sizeof(Buffer));
+		if (context.array_buffer == buffers[i])
+			context.array_buffer = 0;
+		if (context.uniform_buffer == buffers[i])
+			context.uniform_buffer = 0;
+		if (context.pixel_pack_buffer == buffers[i])
+			context.pixel_pack_buffer = 0;
+		int j;
+		for (j = 0; j < MAX_UNIFORM_BUFFER_BINDINGS; j++) {
+			if (context.uniform_buffer_bindings[j].buffer == buffers[i])
+				memset(&context.uniform_buffer_bindings[j], 0, sizeof(UniformBufferBinding));
+		}
+	}
+}
+
+GLboolean glIsBuffer(GLuint buffer) {
+	return get_buffer(buffer) != NULL;
+}
+
+/* Where the buffer bound to a target is kept, or NULL if the context doesn't have the target. */
+static GLuint* get_buffer_binding(GLenum target) {
+	switch (target) {
+		case GL_ARRAY_BUFFER: return &context.array_buffer;
+		case GL_UNIFORM_BUFFER: return context.major_version >= 3 ? &context.uniform_buffer : NULL;
+		case GL_PIXEL_PACK_BUFFER: return context.major_version >= 3 ? &context.pixel_pack_buffer : NULL;
+		default: return NULL;
+	}
+}
+
+static Buffer* get_bound_buffer(GLenum target) {
+	const GLuint* binding = get_buffer_binding(target);
+	return binding != NULL ? get_buffer(*binding) : NULL;
+}
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+	GLuint* binding = get_buffer_binding(target);
+	if (binding == NULL) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	*binding = buffer;
+}
+
+void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	if (!is_version_3())
+		return;
+	if (target != GL_UNIFORM_BUFFER) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (index >= MAX_UNIFORM_BUFFER_BINDINGS || offset < 0 || size <= 0
+	 || offset % UNIFORM_BUFFER_OFFSET_ALIGNMENT != 0) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+
+	// Binding a range binds the buffer to the target as well.
+	context.uniform_buffer = buffer;
+	context.uniform_buffer_bindings[index] = (UniformBufferBinding) {buffer, offset, size};
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage) {
+	(void) usage;
+	Buffer* buffer = get_bound_buffer(target);
+	if (buffer == NULL || size < 0) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+
+	free(buffer->data);
+	buffer->data = malloc(size ? size : 1);
+	if (buffer->data == NULL) {
+		buffer->size = 0;
+		set_error(GL_OUT_OF_MEMORY);
+		return;
+	}
+	buffer->size = size;
+	buffer->is_mapped = 0;
+	if (data != NULL)
+		memcpy(buffer->data, data, size);
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data) {
+	Buffer* buffer = get_bound_buffer(target);
+	if (buffer == NULL || offset < 0 || size < 0 || offset + size > buffer->size) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	// Vertices are transformed as they're drawn, so nothing in flight refers to the old contents.
+	memcpy(buffer->data + offset, data, size);
+}
+
+GLvoid* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	if (!is_version_3())
+		return NULL;
+	Buffer* buffer = get_bound_buffer(target);
+	if (buffer == NULL || buffer->is_mapped) {
+		set_error(GL_INVALID_OPERATION);
+		return NULL;
+	}
+	if (offset < 0 || length <= 0 || offset + length > buffer->size || access == 0) {
+		set_error(GL_INVALID_VALUE);
+		return NULL;
+	}
+	// As with glBufferSubData(), nothing in flight refers to the buffer, so it can be written in place.
+	buffer->is_mapped = 1;
+	return buffer->data + offset;
+}
+
+GLboolean glUnmapBuffer(GLenum target) {
+	if (!is_version_3())
+		return GL_FALSE;
+	Buffer* buffer = get_bound_buffer(target);
+	if (buffer == NULL || !buffer->is_mapped) {
+		set_error(GL_INVALID_OPERATION);
+		return GL_FALSE;
+	}
+	buffer->is_mapped = 0;
+	return GL_TRUE;
+}
+
+/* Sync objects */
+
+/* Draws read their buffers as they're submitted, so every fence has already
+   been passed by the time it's made. They're all the same object. */
+static int fence;
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+	if (!is_version_3())
+		return NULL;
+	if (condition != GL_SYNC_GPU_COMMANDS_COMPLETE || flags != 0) {
+		set_error(condition != GL_SYNC_GPU_COMMANDS_COMPLETE ? GL_INVALID_ENUM : GL_INVALID_VALUE);
+		return NULL;
+	}
+	return (GLsync) &fence;
+}
+
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+	(void) timeout;
+	if (!is_version_3())
+		return GL_WAIT_FAILED;
+	if (sync != (GLsync) &fence || (flags & ~GL_SYNC_FLUSH_COMMANDS_BIT) != 0) {
+		set_error(GL_INVALID_VALUE);
+		return GL_WAIT_FAILED;
+	}
+	return GL_ALREADY_SIGNALED;
+}
+
+void glDeleteSync(GLsync sync) {
+	if (!is_version_3())
+		return;
+	if (sync != NULL && sync != (GLsync) &fence)
+		set_error(GL_INVALID_VALUE);
+}
+
+/* Framebuffer objects */
+
+/* A framebuffer object is complete with a texture to draw color into and a
+   depth renderbuffer of the same size. Without a depth buffer, the depth
+   test would have nothing to test against, so that's left unsupported. */
+static GLenum get_framebuffer_status(const FramebufferObject* framebuffer) {
+	const Texture* color = get_texture(framebuffer->color_texture);
+	const Renderbuffer* depth = get_renderbuffer(framebuffer->depth_renderbuffer);
+	if (color == NULL && depth == NULL)
+		return GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT;
+	if ((color != NULL && color->texels == NULL) || (depth != NULL && depth->depth == NULL))
+		return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
+	if (color == NULL || depth == NULL)
+		return GL_FRAMEBUFFER_UNSUPPORTED;
+	if (color->width != depth->width || color->height != depth->height)
+		return GL_FRAMEBUFFER_INCOMPLETE_DIMENSIONS;
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+/* Called whenever the bound framebuffer, or anything attached to it, changes. */
+static void update_draw_framebuffer() {
+	const FramebufferObject* framebuffer = get_framebuffer_object(context.bound_framebuffer);
+	if (framebuffer == NULL) {
+		draw_to(&context.window);
+		return;
+	}
+
+	SoftFramebuffer attachments = {0, 0, NULL, NULL};
+	if (get_framebuffer_status(framebuffer) == GL_FRAMEBUFFER_COMPLETE) {
+		const Texture* color = get_texture(framebuffer->color_texture);
+		attachments.width = color->width;
+		attachments.height = color->height;
+		// Both are stored bottom row first, like the window.
+		attachments.color_buffer = color->texels;
+		attachments.depth_buffer = get_renderbuffer(framebuffer->depth_renderbuffer)->depth;
+	}
+	draw_to(&attachments);
+}
+
+static int is_draw_framebuffer_complete() {
+	return context.framebuffer.color_buffer != NULL;
+}
+
+void glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+	GLsizei i;
+	for (i = 0; i < n; i++) {
+		framebuffers[i] = allocate_name((void**) &context.framebuffer_objects, &context.framebuffer_object_capacity,
+			sizeof(FramebufferObject));
+	}
+}
+
+void glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+	GLsizei i;
+	for (i = 0; i < n; i++)
+		renderbuffers[i] = allocate_name((void**) &context.renderbuffers, &context.renderbuffer_capacity, sizeof(Renderbuffer));
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+	GLsizei i;
+	for (i = 0; i < n; i++) {
+		FramebufferObject* framebuffer = get_framebuffer_object(framebuffers[i]);
+		if (framebuffer == NULL)
+			continue;
+		memset(framebuffer, 0, sizeof(FramebufferObject));
+		if (framebuffers[i] == context.bound_framebuffer) {
+			context.bound_framebuffer = 0;
+			update_draw_framebuffer();
+		}
+	}
+}
+
+/* Deleting an attachment detaches it from every framebuffer object, not just
+   the bound one, so that none are left pointing at freed memory. */
+static void detach_from_framebuffer_objects(GLuint texture, GLuint renderbuffer) {
+	int i;
+	for (i = 0; i < context.framebuffer_object_capacity; i++) {
+		FramebufferObject* framebuffer = &context.framebuffer_objects[i];
+		if (texture != 0 && framebuffer->color_texture == texture)
+			framebuffer->color_texture = 0;
+		if (renderbuffer != 0 && framebuffer->depth_renderbuffer == renderbuffer)
+			framebuffer->depth_renderbuffer = 0;
+	}
+}
+
+void glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+	// The bound framebuffer might be drawing into one of them.
+	flush();
+
+	GLsizei i;
+	for (i = 0; i < n; i++) {
+		Renderbuffer* renderbuffer = get_renderbuffer(renderbuffers[i]);
+		if (renderbuffer == NULL)
+			continue;
+		free(renderbuffer->depth);
+		memset(renderbuffer, 0, sizeof(Renderbuffer));
+		detach_from_framebuffer_objects(0, renderbuffers[i]);
+		if (renderbuffers[i] == context.bound_renderbuffer)
+			context.bound_renderbuffer = 0;
+	}
+	update_draw_framebuffer();
+}
+
+GLboolean glIsFramebuffer(GLuint framebuffer) {
+	return get_framebuffer_object(framebuffer) != NULL;
+}
+
+GLboolean glIsRenderbuffer(GLuint renderbuffer) {
+	return get_renderbuffer(renderbuffer) != NULL;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	if (target != GL_FRAMEBUFFER) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (framebuffer != 0 && get_framebuffer_object(framebuffer) == NULL) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	context.bound_framebuffer = framebuffer;
+	update_draw_framebuffer();
+}
+
+void glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+	if (target != GL_RENDERBUFFER) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (renderbuffer != 0 && get_renderbuffer(renderbuffer) == NULL) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	context.bound_renderbuffer = renderbuffer;
+}
+
+void glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+	Renderbuffer* renderbuffer = get_renderbuffer(context.bound_renderbuffer);
+	if (target != GL_RENDERBUFFER || internalformat != GL_DEPTH_COMPONENT16) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (renderbuffer == NULL) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	if (width <= 0 || height <= 0) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+
+	flush();
+	free(renderbuffer->depth);
+	renderbuffer->depth = calloc((size_t) width * height, sizeof(float));
+	if (renderbuffer->depth == NULL) {
+		renderbuffer->width = renderbuffer->height = 0;
+		set_error(GL_OUT_OF_MEMORY);
+	} else {
+		renderbuffer->width = width;
+		renderbuffer->height = height;
+	}
+	update_draw_framebuffer();
+}
+
+void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+	FramebufferObject* framebuffer = get_framebuffer_object(context.bound_framebuffer);
+	if (target != GL_FRAMEBUFFER || attachment != GL_COLOR_ATTACHMENT0 || textarget != GL_TEXTURE_2D) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (framebuffer == NULL || (texture != 0 && get_texture(texture) == NULL)) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	if (level != 0) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	framebuffer->color_texture = texture;
+	update_draw_framebuffer();
+}
+
+void glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+	FramebufferObject* framebuffer = get_framebuffer_object(context.bound_framebuffer);
+	if (target != GL_FRAMEBUFFER || attachment != GL_DEPTH_ATTACHMENT || renderbuffertarget != GL_RENDERBUFFER) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (framebuffer == NULL || (renderbuffer != 0 && get_renderbuffer(renderbuffer) == NULL)) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	framebuffer->depth_renderbuffer = renderbuffer;
+	update_draw_framebuffer();
+}
+
+GLenum glCheckFramebufferStatus(GLenum target) {
+	if (target != GL_FRAMEBUFFER) {
+		set_error(GL_INVALID_ENUM);
+		return 0;
+	}
+	const FramebufferObject* framebuffer = get_framebuffer_object(context.bound_framebuffer);
+	return framebuffer == NULL ? GL_FRAMEBUFFER_COMPLETE : get_framebuffer_status(framebuffer);
+}
+
+/* Textures */
+
+void glGenTextures(GLsizei n, GLuint* textures) {
+	int i;
+	for (i = 0; i < n; i++) {
+		textures[i] = allocate_name((void**) &context.textures, &context.texture_capacity, sizeof(Texture));
+		context.textures[textures[i] - 1].wrap_s = GL_REPEAT;
+		context.textures[textures[i] - 1].wrap_t = GL_REPEAT;
+	}
+}
+
+void glDeleteTextures(GLsizei n, const GLuint* textures) {
+	// Binned triangles point at the texels.
+	flush();
+
+	int i, unit;
+	for (i = 0; i < n; i++) {
+		Texture* texture = get_texture(textures[i]);
+		if (texture == NULL)
+			continue;
+		free(texture->texels);
+		memset(texture, 0, sizeof(Texture));
+		for (unit = 0; unit < MAX_TEXTURE_UNITS; unit++) {
+			if (context.bound_textures[unit] == textures[i])
+				context.bound_textures[unit] = 0;
+		}
+		detach_from_framebuffer_objects(textures[i], 0);
+	}
+	update_draw_framebuffer();
+}
+
+GLboolean glIsTexture(GLuint texture) {
+	return get_texture(texture) != NULL;
+}
+
+void glActiveTexture(GLenum texture) {
+	if (texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + MAX_TEXTURE_UNITS) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	context.active_texture_unit = texture - GL_TEXTURE0;
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+	if (target != GL_TEXTURE_2D) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	context.bound_textures[context.active_texture_unit] = texture;
+}
+
+static Texture* get_bound_texture(GLenum target) {
+	Texture* texture = target == GL_TEXTURE_2D ? get_texture(context.bound_textures[context.active_texture_unit]) : NULL;
+	if (texture == NULL)
+		set_error(GL_INVALID_OPERATION);
+	return texture;
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+	Texture* texture = get_bound_texture(target);
+	if (texture == NULL)
+		return;
+
+	// Filtering is always bilinear from the base level.
+	if (pname == GL_TEXTURE_WRAP_S || pname == GL_TEXTURE_WRAP_T) {
+		flush();
+		if (pname == GL_TEXTURE_WRAP_S)
+			texture->wrap_s = param;
+		else
+			texture->wrap_t = param;
+	}
+}
+
+static uint32_t unpack_texel(const GLubyte* source, GLenum format) {
+	switch (format) {
+		case GL_RGBA: return source[0] | source[1] << 8 | source[2] << 16 | (uint32_t) source[3] << 24;
+		case GL_RGB: return source[0] | source[1] << 8 | source[2] << 16 | 0xFF000000u;
+		case GL_LUMINANCE: return source[0] | source[0] << 8 | source[0] << 16 | 0xFF000000u;
+		case GL_LUMINANCE_ALPHA: return source[0] | source[0] << 8 | source[0] << 16 | (uint32_t) source[1] << 24;
+		default: return (uint32_t) source[0] << 24;
+	}
+}
+
+static int get_format_components(GLenum format) {
+	switch (format) {
+		case GL_RGBA: return 4;
+		case GL_RGB: return 3;
+		case GL_LUMINANCE_ALPHA: return 2;
+		case GL_LUMINANCE: case GL_ALPHA: return 1;
+		default: return 0;
+	}
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+	GLint border, GLenum format, GLenum type, const GLvoid* pixels) {
+	Texture* texture = get_bound_texture(target);
+	if (texture == NULL)
+		return;
+
+	const int components = get_format_components(format);
+	if (components == 0 || (GLenum) internalformat != format || type != GL_UNSIGNED_BYTE) {
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (width <= 0 || height <= 0 || border != 0) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	// Only the base level is ever sampled.
+	if (level != 0)
+		return;
+
+	flush();
+	free(texture->texels);
+	texture->texels = malloc((size_t) width * height * sizeof(uint32_t));
+	if (texture->texels == NULL) {
+		set_error(GL_OUT_OF_MEMORY);
+		return;
+	}
+	texture->width = width;
+	texture->height = height;
+
+	// Rows are padded to GL_UNPACK_ALIGNMENT, which is four unless changed.
+	const size_t row_length = ((size_t) width * components + 3) & ~(size_t) 3;
+	int x, y;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			texture->texels[y * width + x] = pixels != NULL
+				? unpack_texel((const GLubyte*) pixels + y * row_length + x * components, format) : 0;
+		}
+	}
+	// The texture might be what's being drawn to.
+	update_draw_framebuffer();
+}
+
+/* No compressed formats are listed, so callers fall back to glTexImage2D(). */
+void glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+	GLint border, GLsizei imageSize, const GLvoid* data) {
+	(void) level;
+	(void) internalformat;
+	(void) width;
+	(void) height;
+	(void) border;
+	(void) imageSize;
+	(void) data;
+	if (get_bound_texture(target) != NULL)
+		set_error(GL_INVALID_ENUM);
+}
+
+void glGenerateMipmap(GLenum target) {
+	get_bound_texture(target);
+}
+
+/* Shaders and programs */
+
+GLuint glCreateShader(GLenum type) {
+	if (type != GL_VERTEX_SHADER && type != GL_FRAGMENT_SHADER) {
+		set_error(GL_INVALID_ENUM);
+		return 0;
+	}
+	const GLuint name = allocate_name((void**) &context.shaders, &context.shader_capacity, sizeof(Shader));
+	context.shaders[name - 1].type = type;
+	return name;
+}
+
+void glDeleteShader(GLuint shader) {
+	Shader* object = get_shader(shader);
+	if (object == NULL)
+		return;
+	free(object->source);
+	memset(object, 0, sizeof(Shader));
+}
+
+GLboolean glIsShader(GLuint shader) {
+	return get_shader(shader) != NULL;
+}
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+	Shader* object = get_shader(shader);
+	if (object == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+
+	size_t total_length = 0;
+	int i;
+	for (i = 0; i < count; i++)
+		total_length += length != NULL && length[i] >= 0 ? (size_t) length[i] : strlen(string[i]);
+
+	free(object->source);
+	object->source = malloc(total_length + 1);
+	assert(object->source != NULL);
+
+	size_t position = 0;
+	for (i = 0; i < count; i++) {
+		const size_t part_length = length != NULL && length[i] >= 0 ? (size_t) length[i] : strlen(string[i]);
+		memcpy(object->source + position, string[i], part_length);
+		position += part_length;
+	}
+	object->source[position] = '\0';
+}
+
+void glCompileShader(GLuint shader) {
+	if (get_shader(shader) == NULL)
+		set_error(GL_INVALID_VALUE);
+}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+	if (get_shader(shader) == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	*params = pname == GL_INFO_LOG_LENGTH ? 1 : GL_TRUE;
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei bufsize, GLsizei* length, GLchar* infolog) {
+	(void) shader;
+	if (bufsize > 0)
+		infolog[0] = '\0';
+	if (length != NULL)
+		*length = 0;
+}
+
+GLuint glCreateProgram(void) {
+	const GLuint name = allocate_name((void**) &context.programs, &context.program_capacity, sizeof(Program));
+	context.programs[name - 1].color[3] = 1.0f;
+	return name;
+}
+
+void glDeleteProgram(GLuint program) {
+	Program* object = get_program(program);
+	if (object != NULL)
+		memset(object, 0, sizeof(Program));
+	if (context.current_program == program)
+		context.current_program = 0;
+}
+
+GLboolean glIsProgram(GLuint program) {
+	return get_program(program) != NULL;
+}
+
+void glAttachShader(GLuint program, GLuint shader) {
+	Program* object = get_program(program);
+	const Shader* shader_object = get_shader(shader);
+	if (object == NULL || shader_object == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (shader_object->type == GL_VERTEX_SHADER)
+		object->vertex_shader = shader;
+	else
+		object->fragment_shader = shader;
+}
+
+void glDetachShader(GLuint program, GLuint shader) {
+	Program* object = get_program(program);
+	if (object == NULL || get_shader(shader) == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+
+	if (object->vertex_shader == shader)
+		object->vertex_shader = 0;
+	else if (object->fragment_shader == shader)
+		object->fragment_shader = 0;
+	else
+		set_error(GL_INVALID_OPERATION);
+}
+
+void glLinkProgram(GLuint program) {
+	Program* object = get_program(program);
+	if (object == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+
+	const Shader* vertex_shader = get_shader(object->vertex_shader);
+	const Shader* fragment_shader = get_shader(object->fragment_shader);
+	object->is_textured = fragment_shader != NULL && fragment_shader->source != NULL
+		&& (strstr(fragment_shader->source, "texture2D") != NULL || strstr(fragment_shader->source, "texture(") != NULL);
+	object->has_uniform_block = context.major_version >= 3 && vertex_shader != NULL && vertex_shader->source != NULL
+		&& strstr(vertex_shader->source, "uniform ObjectUniforms") != NULL;
+}
+
+void glValidateProgram(GLuint program) {
+	if (get_program(program) == NULL)
+		set_error(GL_INVALID_VALUE);
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+	if (get_program(program) == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	*params = pname == GL_INFO_LOG_LENGTH ? 1 : GL_TRUE;
+}
+
+void glGetProgramInfoLog(GLuint program, GLsizei bufsize, GLsizei* length, GLchar* infolog) {
+	(void) program;
+	if (bufsize > 0)
+		infolog[0] = '\0';
+	if (length != NULL)
+		*length = 0;
+}
+
+void glUseProgram(GLuint program) {
+	context.current_program = program;
+}
+
+int glGetAttribLocation(GLuint program, const GLchar* name) {
+	(void) program;
+	if (strcmp(name, "a_Position") == 0)
+		return POSITION_ATTRIBUTE;
+	if (strcmp(name, "a_TextureCoordinates") == 0)
+		return TEXTURE_COORDINATES_ATTRIBUTE;
+	return -1;
+}
+
+int glGetUniformLocation(GLuint program, const GLchar* name) {
+	(void) program;
+	if (strcmp(name, "u_MvpMatrix") == 0)
+		return MVP_MATRIX_UNIFORM;
+	if (strcmp(name, "u_Color") == 0)
+		return COLOR_UNIFORM;
+	if (strcmp(name, "u_TextureUnit") == 0)
+		return TEXTURE_UNIT_UNIFORM;
+	return -1;
+}
+
+GLuint glGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName) {
+	if (!is_version_3())
+		return GL_INVALID_INDEX;
+	const Program* object = get_program(program);
+	if (object == NULL) {
+		set_error(GL_INVALID_VALUE);
+		return GL_INVALID_INDEX;
+	}
+	return object->has_uniform_block && strcmp(uniformBlockName, "ObjectUniforms") == 0 ? 0 : GL_INVALID_INDEX;
+}
+
+void glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+	if (!is_version_3())
+		return;
+	Program* object = get_program(program);
+	if (object == NULL || !object->has_uniform_block || uniformBlockIndex != 0
+	 || uniformBlockBinding >= MAX_UNIFORM_BUFFER_BINDINGS) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	object->uniform_block_binding = uniformBlockBinding;
+}
+
+void glUniform1i(GLint location, GLint x) {
+	Program* program = get_program(context.current_program);
+	if (program != NULL && location == TEXTURE_UNIT_UNIFORM)
+		program->texture_unit = x;
+}
+
+void glUniform4fv(GLint location, GLsizei count, const GLfloat* v) {
+	Program* program = get_program(context.current_program);
+	if (program != NULL && location == COLOR_UNIFORM && count >= 1)
+		memcpy(program->color, v, sizeof(program->color));
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	Program* program = get_program(context.current_program);
+	if (transpose) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	if (program != NULL && location == MVP_MATRIX_UNIFORM && count >= 1)
+		memcpy(program->mvp_matrix, value, sizeof(program->mvp_matrix));
+}
+
+/* Vertex attributes */
+
+void glEnableVertexAttribArray(GLuint index) {
+	if (index < MAX_ATTRIBUTES)
+		context.attributes[index].is_enabled = 1;
+}
+
+void glDisableVertexAttribArray(GLuint index) {
+	if (index < MAX_ATTRIBUTES)
+		context.attributes[index].is_enabled = 0;
+}
+
+void glVertexAttribPointer(GLuint indx, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* ptr) {
+	// Client-side arrays aren't supported; everything comes from buffers.
+	if (indx >= MAX_ATTRIBUTES || size < 1 || size > 4 || context.array_buffer == 0) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+
+	Attribute* attribute = &context.attributes[indx];
+	attribute->size = size;
+	attribute->type = type;
+	attribute->normalized = normalized;
+	attribute->stride = stride;
+	attribute->buffer = context.array_buffer;
+	attribute->offset = (size_t) ptr;
+}
+
+/* Drawing */
+
+/* Fills in the uniforms of a program with a uniform block from the range
+   bound for it. Returns zero if there isn't enough of one. */
+static int fetch_uniform_block(Program* program) {
+	// u_MvpMatrix, then u_Color, under std140.
+	const GLsizeiptr block_size = sizeof(program->mvp_matrix) + sizeof(program->color);
+	const UniformBufferBinding* binding = &context.uniform_buffer_bindings[program->uniform_block_binding];
+	const Buffer* buffer = get_buffer(binding->buffer);
+	if (buffer == NULL || binding->size < block_size || binding->offset + block_size > buffer->size)
+		return 0;
+
+	memcpy(program->mvp_matrix, buffer->data + binding->offset, sizeof(program->mvp_matrix));
+	memcpy(program->color, buffer->data + binding->offset + sizeof(program->mvp_matrix), sizeof(program->color));
+	return 1;
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	const Program* bound_program = get_program(context.current_program);
+	if (bound_program == NULL) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	if (!is_draw_framebuffer_complete()) {
+		set_error(GL_INVALID_FRAMEBUFFER_OPERATION);
+		return;
+	}
+	// Uniforms from a block only last for the draw, as the buffer can change.
+	Program block_program;
+	const Program* program = bound_program;
+	if (bound_program->has_uniform_block) {
+		block_program = *bound_program;
+		if (!fetch_uniform_block(&block_program)) {
+			set_error(GL_INVALID_OPERATION);
+			return;
+		}
+		program = &block_program;
+	}
+	if (mode != GL_TRIANGLES && mode != GL_TRIANGLE_STRIP && mode != GL_TRIANGLE_FAN) {
+		// Points and lines are never drawn by the core.
+		set_error(GL_INVALID_ENUM);
+		return;
+	}
+	if (count < 3)
+		return;
+
+	Vertex* vertices = malloc(count * sizeof(Vertex));
+	assert(vertices != NULL);
+	int i;
+	for (i = 0; i < count; i++)
+		transform_vertex(program, first + i, &vertices[i]);
+
+	if (mode == GL_TRIANGLES) {
+		for (i = 0; i + 2 < count; i += 3)
+			draw_triangle(program, &vertices[i], &vertices[i + 1], &vertices[i + 2]);
+	} else if (mode == GL_TRIANGLE_STRIP) {
+		for (i = 0; i + 2 < count; i++)
+			draw_triangle(program, &vertices[i], &vertices[i + 1], &vertices[i + 2]);
+	} else {
+		for (i = 1; i + 1 < count; i++)
+			draw_triangle(program, &vertices[0], &vertices[i], &vertices[i + 1]);
+	}
+
+	free(vertices);
+}
+
+void glClear(GLbitfield mask) {
+	if (!is_draw_framebuffer_complete()) {
+		set_error(GL_INVALID_FRAMEBUFFER_OPERATION);
+		return;
+	}
+	// A clear after drawing has to wait for that drawing to land.
+	if (context.triangle_count > 0)
+		flush();
+
+	if (mask & GL_COLOR_BUFFER_BIT) {
+		context.pending_clear.clear_color = 1;
+		context.pending_clear.color = context.clear_color;
+	}
+	if (mask & GL_DEPTH_BUFFER_BIT)
+		context.pending_clear.clear_depth = 1;
+}
+
+void glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha) {
+	context.clear_color = pack_rgba(red, green, blue, alpha);
+}
+
+void glEnable(GLenum cap) {
+	if (cap == GL_DEPTH_TEST)
+		context.depth_test = 1;
+}
+
+void glDisable(GLenum cap) {
+	if (cap == GL_DEPTH_TEST)
+		context.depth_test = 0;
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	if (width < 0 || height < 0) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	context.viewport[0] = x;
+	context.viewport[1] = y;
+	context.viewport[2] = width;
+	context.viewport[3] = height;
+}
+
+void glFinish(void) {
+	flush();
+}
+
+void glFlush(void) {
+	flush();
+}
+
+GLenum glGetError(void) {
+	const GLenum error = context.error;
+	context.error = GL_NO_ERROR;
+	return error;
+}
+
+void glGetIntegerv(GLenum pname, GLint* params) {
+	switch (pname) {
+		case GL_FRAMEBUFFER_BINDING: *params = (GLint) context.bound_framebuffer; break;
+		case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+			if (is_version_3())
+				*params = UNIFORM_BUFFER_OFFSET_ALIGNMENT;
+			break;
+		case GL_NUM_COMPRESSED_TEXTURE_FORMATS: *params = 0; break;
+		case GL_COMPRESSED_TEXTURE_FORMATS: break;
+		default: set_error(GL_INVALID_ENUM); break;
+	}
+}
+
+const GLubyte* glGetString(GLenum name) {
+	switch (name) {
+		case GL_VENDOR: return (const GLubyte*) "airhockey";
+		case GL_RENDERER: return (const GLubyte*) "soft_gl tiled rasterizer";
+		case GL_VERSION:
+			return (const GLubyte*) (context.major_version >= 3 ? "OpenGL ES 3.0 soft_gl" : "OpenGL ES 2.0 soft_gl");
+		case GL_EXTENSIONS: return (const GLubyte*) "";
+		default: set_error(GL_INVALID_ENUM); return NULL;
+	}
+}
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* pixels) {
+	if (format != GL_RGBA || type != GL_UNSIGNED_BYTE) {
+		set_error(GL_INVALID_OPERATION);
+		return;
+	}
+	if (width < 0 || height < 0) {
+		set_error(GL_INVALID_VALUE);
+		return;
+	}
+	if (!is_draw_framebuffer_complete()) {
+		set_error(GL_INVALID_FRAMEBUFFER_OPERATION);
+		return;
+	}
+
+	// With a pixel pack buffer bound, the pointer is an offset into it.
+	if (context.pixel_pack_buffer != 0) {
+		const Buffer* buffer = get_buffer(context.pixel_pack_buffer);
+		const GLintptr offset = (GLintptr) pixels;
+		if (buffer == NULL || buffer->is_mapped || offset < 0
+		 || offset + (GLsizeiptr) width * height * 4 > buffer->size) {
+			set_error(GL_INVALID_OPERATION);
+			return;
+		}
+		pixels = buffer->data + offset;
+	}
+	flush();
+
+	// Pixels outside the framebuffer are undefined; they're left as zero.
+	const int first_column = x < 0 ? -x : 0;
+	const int last_column = x + width > context.framebuffer.width ? context.framebuffer.width - x : width;
+	int row;
+	for (row = 0; row < height; row++) {
+		GLubyte* destination = (GLubyte*) pixels + (size_t) row * width * 4;
+		const int source_y = y + row;
+		if (source_y < 0 || source_y >= context.framebuffer.height || first_column >= last_column) {
+			memset(destination, 0, (size_t) width * 4);
+			continue;
+		}
+
+		memset(destination, 0, (size_t) first_column * 4);
+		memcpy(destination + first_column * 4,
+			context.framebuffer.color_buffer + (size_t) source_y * context.framebuffer.width + x + first_column,
+			(size_t) (last_column - first_column) * 4);
+		memset(destination + last_column * 4, 0, (size_t) (width - last_column) * 4);
+	}
+}
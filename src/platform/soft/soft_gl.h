@@ -0,0 +1,16 @@
+#pragma once
+#include "platform_gl.h"
+
+/* Creates the one and only context, with an RGBA8 color buffer and a depth
+   buffer of the given size, as OpenGL ES 2.0 or 3.0. Triangles are binned
+   into tiles as they're drawn, and the tiles are rasterized in parallel by
+   thread_count threads (including the calling thread) whenever the frame is
+   finished. */
+int soft_gl_create_context(int width, int height, int major_version, int thread_count);
+void soft_gl_destroy_context();
+
+/* Rasterizes everything drawn so far; glFinish() and glReadPixels() do the same. */
+void soft_gl_finish();
+
+/* The color buffer, bottom row first like glReadPixels(). Valid after soft_gl_finish(). */
+const GLubyte* soft_gl_get_color_buffer();
@@ -0,0 +1,70 @@
+#pragma once
+#include "platform_gl.h"
+#include <stdint.h>
+
+#define TILE_SIZE 64
+
+typedef struct {
+	int width;
+	int height;
+	int repeat_s;
+	int repeat_t;
+	const uint32_t* texels;
+} SoftTextureImage;
+
+/* A value that varies linearly across the screen: a * x + b * y + c. */
+typedef struct {
+	float a;
+	float b;
+	float c;
+} SoftPlane;
+
+/* A triangle after transformation, clipping and viewport mapping, reduced to
+   the edge functions and attribute planes needed to rasterize it into any of
+   the tiles it overlaps. */
+typedef struct {
+	SoftPlane edges[3];
+	int is_top_left[3];
+	SoftPlane depth;
+	SoftPlane inverse_w;
+	SoftPlane s_over_w;
+	SoftPlane t_over_w;
+	int min_x;
+	int min_y;
+	int max_x;
+	int max_y;
+	int is_textured;
+	int depth_test;
+	uint32_t color;
+	SoftTextureImage texture;
+} SoftTriangle;
+
+typedef struct {
+	int width;
+	int height;
+	uint32_t* color_buffer;
+	float* depth_buffer;
+} SoftFramebuffer;
+
+typedef struct {
+	int clear_color;
+	int clear_depth;
+	uint32_t color;
+	float depth;
+} SoftClear;
+
+static inline uint32_t pack_rgba(float r, float g, float b, float a) {
+	const float clamped[4] = {
+		r < 0.0f ? 0.0f : r > 1.0f ? 1.0f : r,
+		g < 0.0f ? 0.0f : g > 1.0f ? 1.0f : g,
+		b < 0.0f ? 0.0f : b > 1.0f ? 1.0f : b,
+		a < 0.0f ? 0.0f : a > 1.0f ? 1.0f : a};
+	return (uint32_t) (clamped[0] * 255.0f + 0.5f)
+		| (uint32_t) (clamped[1] * 255.0f + 0.5f) << 8
+		| (uint32_t) (clamped[2] * 255.0f + 0.5f) << 16
+		| (uint32_t) (clamped[3] * 255.0f + 0.5f) << 24;
+}
+
+/* Rasterizes the given triangles, in order, into one tile of the framebuffer. */
+void rasterize_tile(const SoftFramebuffer* framebuffer, int tile_x, int tile_y, const SoftClear* clear,
+	const SoftTriangle* triangles, const uint32_t* triangle_indices, int triangle_count);
@@ -0,0 +1,250 @@
+#include "soft_gl_internal.h"
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static void clear_tile(const SoftFramebuffer* framebuffer, const SoftClear* clear,
+	int min_x, int min_y, int max_x, int max_y);
+static void rasterize_triangle(const SoftFramebuffer* framebuffer, const SoftTriangle* triangle,
+	int min_x, int min_y, int max_x, int max_y);
+static uint32_t sample_bilinear(const SoftTextureImage* texture, float s, float t);
+
+void rasterize_tile(const SoftFramebuffer* framebuffer, int tile_x, int tile_y, const SoftClear* clear,
+	const SoftTriangle* triangles, const uint32_t* triangle_indices, int triangle_count) {
+	const int min_x = tile_x * TILE_SIZE;
+	const int min_y = tile_y * TILE_SIZE;
+	const int max_x = min_x + TILE_SIZE < framebuffer->width ? min_x + TILE_SIZE - 1 : framebuffer->width - 1;
+	const int max_y = min_y + TILE_SIZE < framebuffer->height ? min_y + TILE_SIZE - 1 : framebuffer->height - 1;
+
+	clear_tile(framebuffer, clear, min_x, min_y, max_x, max_y);
+
+	int i;
+	for (i = 0; i < triangle_count; i++) {
+		const SoftTriangle* triangle = &triangles[triangle_indices[i]];
+		rasterize_triangle(framebuffer, triangle,
+			triangle->min_x > min_x ? triangle->min_x : min_x,
+			triangle->min_y > min_y ? triangle->min_y : min_y,
+			triangle->max_x < max_x ? triangle->max_x : max_x,
+			triangle->max_y < max_y ? triangle->max_y : max_y);
+	}
+}
+
+static void clear_tile(const SoftFramebuffer* framebuffer, const SoftClear* clear,
+	int min_x, int min_y, int max_x, int max_y) {
+	int x, y;
+
+	for (y = min_y; y <= max_y; y++) {
+		uint32_t* color_row = framebuffer->color_buffer + y * framebuffer->width;
+		float* depth_row = framebuffer->depth_buffer + y * framebuffer->width;
+
+		if (clear->clear_color) {
+			for (x = min_x; x <= max_x; x++)
+				color_row[x] = clear->color;
+		}
+		if (clear->clear_depth) {
+			for (x = min_x; x <= max_x; x++)
+				depth_row[x] = clear->depth;
+		}
+	}
+}
+
+static inline float evaluate_plane(const SoftPlane* plane, float x, float y) {
+	return plane->a * x + plane->b * y + plane->c;
+}
+
+/* Shades one covered pixel that passed the depth test. */
+static inline uint32_t shade_pixel(const SoftTriangle* triangle, float x, float y) {
+	if (!triangle->is_textured)
+		return triangle->color;
+
+	// Perspective correction: s/w and t/w interpolate linearly in screen
+	// space, so dividing by the interpolated 1/w recovers s and t.
+	const float w = 1.0f / evaluate_plane(&triangle->inverse_w, x, y);
+	return sample_bilinear(&triangle->texture,
+		evaluate_plane(&triangle->s_over_w, x, y) * w,
+		evaluate_plane(&triangle->t_over_w, x, y) * w);
+}
+
+#if defined(__SSE2__)
+
+/* Evaluates the edge functions for four pixels at a time. */
+static void rasterize_triangle(const SoftFramebuffer* framebuffer, const SoftTriangle* triangle,
+	int min_x, int min_y, int max_x, int max_y) {
+	if (min_x > max_x || min_y > max_y)
+		return;
+
+	const __m128 lane_offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128i lane_indices = _mm_setr_epi32(0, 1, 2, 3);
+	__m128 edge_a[3], edge_b[3], edge_c[3];
+	int i;
+	for (i = 0; i < 3; i++) {
+		edge_a[i] = _mm_set1_ps(triangle->edges[i].a);
+		edge_b[i] = _mm_set1_ps(triangle->edges[i].b);
+		edge_c[i] = _mm_set1_ps(triangle->edges[i].c);
+	}
+	const __m128 depth_a = _mm_set1_ps(triangle->depth.a);
+	const __m128 depth_b = _mm_set1_ps(triangle->depth.b);
+	const __m128 depth_c = _mm_set1_ps(triangle->depth.c);
+	const __m128 zero = _mm_setzero_ps();
+
+	const int first_x = min_x & ~3;
+	int x, y;
+
+	for (y = min_y; y <= max_y; y++) {
+		uint32_t* color_row = framebuffer->color_buffer + y * framebuffer->width;
+		float* depth_row = framebuffer->depth_buffer + y * framebuffer->width;
+		const __m128 pixel_y = _mm_set1_ps((float) y + 0.5f);
+
+		__m128 row_c[3];
+		for (i = 0; i < 3; i++)
+			row_c[i] = _mm_add_ps(_mm_mul_ps(edge_b[i], pixel_y), edge_c[i]);
+		const __m128 row_depth_c = _mm_add_ps(_mm_mul_ps(depth_b, pixel_y), depth_c);
+
+		for (x = first_x; x <= max_x; x += 4) {
+			const __m128 pixel_x = _mm_add_ps(_mm_set1_ps((float) x), lane_offsets);
+
+			// Only the lanes inside the bounding box in this tile count.
+			const __m128i lane_x = _mm_add_epi32(_mm_set1_epi32(x), lane_indices);
+			__m128 mask = _mm_castsi128_ps(_mm_and_si128(
+				_mm_cmpgt_epi32(lane_x, _mm_set1_epi32(min_x - 1)),
+				_mm_cmplt_epi32(lane_x, _mm_set1_epi32(max_x + 1))));
+
+			// Pixels exactly on an edge belong to the triangle only if it's a
+			// top or left edge, so that triangles sharing an edge don't both
+			// draw it.
+			for (i = 0; i < 3; i++) {
+				const __m128 edge = _mm_add_ps(_mm_mul_ps(edge_a[i], pixel_x), row_c[i]);
+				mask = _mm_and_ps(mask, triangle->is_top_left[i] ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero));
+			}
+
+			const int coverage = _mm_movemask_ps(mask);
+			if (coverage == 0)
+				continue;
+
+			const __m128 depth = _mm_add_ps(_mm_mul_ps(depth_a, pixel_x), row_depth_c);
+
+			// Whole groups of four are read and written as vectors, with the
+			// lanes that aren't drawn keeping their old values. A group that
+			// runs off the end of the row would touch the next row, which
+			// belongs to another tile, so that one goes a lane at a time.
+			if (x + 3 < framebuffer->width) {
+				if (triangle->depth_test) {
+					const __m128 old_depth = _mm_loadu_ps(depth_row + x);
+					mask = _mm_and_ps(mask, _mm_cmplt_ps(depth, old_depth));
+					if (_mm_movemask_ps(mask) == 0)
+						continue;
+					_mm_storeu_ps(depth_row + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, old_depth)));
+				}
+
+				__m128i colors;
+				if (triangle->is_textured) {
+					const int shaded = _mm_movemask_ps(mask);
+					uint32_t color_lanes[4];
+					int lane;
+					for (lane = 0; lane < 4; lane++) {
+						color_lanes[lane] = (shaded & (1 << lane))
+							? shade_pixel(triangle, (float) (x + lane) + 0.5f, (float) y + 0.5f) : 0;
+					}
+					colors = _mm_loadu_si128((const __m128i*) color_lanes);
+				} else {
+					colors = _mm_set1_epi32((int) triangle->color);
+				}
+
+				const __m128i color_mask = _mm_castps_si128(mask);
+				const __m128i old_colors = _mm_loadu_si128((const __m128i*) (color_row + x));
+				_mm_storeu_si128((__m128i*) (color_row + x),
+					_mm_or_si128(_mm_and_si128(color_mask, colors), _mm_andnot_si128(color_mask, old_colors)));
+				continue;
+			}
+
+			float depth_lanes[4];
+			_mm_storeu_ps(depth_lanes, depth);
+			int lane;
+			for (lane = 0; lane < 4; lane++) {
+				if ((coverage & (1 << lane)) == 0)
+					continue;
+				if (triangle->depth_test) {
+					if (!(depth_lanes[lane] < depth_row[x + lane]))
+						continue;
+					depth_row[x + lane] = depth_lanes[lane];
+				}
+				color_row[x + lane] = shade_pixel(triangle, (float) (x + lane) + 0.5f, (float) y + 0.5f);
+			}
+		}
+	}
+}
+
+#else
+
+static void rasterize_triangle(const SoftFramebuffer* framebuffer, const SoftTriangle* triangle,
+	int min_x, int min_y, int max_x, int max_y) {
+	int x, y, i;
+
+	for (y = min_y; y <= max_y; y++) {
+		uint32_t* color_row = framebuffer->color_buffer + y * framebuffer->width;
+		float* depth_row = framebuffer->depth_buffer + y * framebuffer->width;
+		const float pixel_y = (float) y + 0.5f;
+
+		for (x = min_x; x <= max_x; x++) {
+			const float pixel_x = (float) x + 0.5f;
+			int is_inside = 1;
+
+			for (i = 0; i < 3 && is_inside; i++) {
+				const float edge = evaluate_plane(&triangle->edges[i], pixel_x, pixel_y);
+				is_inside = triangle->is_top_left[i] ? edge >= 0.0f : edge > 0.0f;
+			}
+			if (!is_inside)
+				continue;
+
+			const float depth = evaluate_plane(&triangle->depth, pixel_x, pixel_y);
+			if (triangle->depth_test) {
+				if (!(depth < depth_row[x]))
+					continue;
+				depth_row[x] = depth;
+			}
+
+			color_row[x] = shade_pixel(triangle, pixel_x, pixel_y);
+		}
+	}
+}
+
+#endif
+
+static inline int wrap_coordinate(int coordinate, int size, int repeat) {
+	// Most textures are a power of two in size, which avoids the division.
+	if (repeat && (size & (size - 1)) == 0)
+		return coordinate & (size - 1);
+	if (repeat) {
+		coordinate %= size;
+		return coordinate < 0 ? coordinate + size : coordinate;
+	}
+	return coordinate < 0 ? 0 : coordinate >= size ? size - 1 : coordinate;
+}
+
+static inline uint32_t lerp_texels(uint32_t a, uint32_t b, uint32_t weight) {
+	// Two channels at a time, with 8 bits of fraction.
+	const uint32_t a_even = a & 0x00FF00FF, a_odd = (a >> 8) & 0x00FF00FF;
+	const uint32_t b_even = b & 0x00FF00FF, b_odd = (b >> 8) & 0x00FF00FF;
+	const uint32_t even = ((a_even * (256 - weight) + b_even * weight) >> 8) & 0x00FF00FF;
+	const uint32_t odd = ((a_odd * (256 - weight) + b_odd * weight) >> 8) & 0x00FF00FF;
+	return even | (odd << 8);
+}
+
+static uint32_t sample_bilinear(const SoftTextureImage* texture, float s, float t) {
+	const float u = s * (float) texture->width - 0.5f;
+	const float v = t * (float) texture->height - 0.5f;
+	const float floor_u = floorf(u);
+	const float floor_v = floorf(v);
+	const uint32_t weight_u = (uint32_t) ((u - floor_u) * 256.0f);
+	const uint32_t weight_v = (uint32_t) ((v - floor_v) * 256.0f);
+
+	const int x0 = wrap_coordinate((int) floor_u, texture->width, texture->repeat_s);
+	const int x1 = wrap_coordinate((int) floor_u + 1, texture->width, texture->repeat_s);
+	const int y0 = wrap_coordinate((int) floor_v, texture->height, texture->repeat_t);
+	const int y1 = wrap_coordinate((int) floor_v + 1, texture->height, texture->repeat_t);
+
+	const uint32_t* row0 = texture->texels + y0 * texture->width;
+	const uint32_t* row1 = texture->texels + y1 * texture->width;
+	return lerp_texels(lerp_texels(row0[x0], row0[x1], weight_u), lerp_texels(row1[x0], row1[x1], weight_u), weight_v);
+}
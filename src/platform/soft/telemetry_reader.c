@@ -0,0 +1,342 @@
+/* Watches a running game's or match server's telemetry from outside. It
+   maps the block read-only and takes a snapshot at a high rate, without the
+   process ever waiting on it, then reports what changed over each interval.
+   For a game, that's the frame rate, frame and render times, draw calls,
+   simulation steps, input latency, skipped idle frames, and the GPU memory
+   and GL objects that the game has. Gauges, like texture memory and the
+   render scale, are tracked at every snapshot so that short peaks between
+   reports show up. For a server, it's the sessions, ticks and tick times
+   across all of its shards.
+
+   Only needs telemetry.h and timer.h; none of the game is linked in. */
+#define _GNU_SOURCE
+#include "telemetry.h"
+#include "timer.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// Where shm_open() keeps segments on Linux.
+#define SHARED_MEMORY_DIRECTORY "/dev/shm"
+// A writer that stays in the middle of an update for this many tries has
+// probably died there.
+#define MAX_SNAPSHOT_TRIES 100000
+
+typedef struct {
+	TelemetryRenderSection render;
+	TelemetryGameSection game;
+	// Shards that have never ticked are left out, and stay zero.
+	TelemetryShardSection shards[TELEMETRY_MAX_SHARDS];
+} Snapshot;
+
+typedef struct {
+	unsigned long long snapshots;
+	unsigned long long retries;
+	int64_t peak_texture_bytes;
+	uint32_t lowest_render_scale_per_mille;
+} SamplingStats;
+
+static int is_process_alive(int process_id) {
+	return process_id > 0 && (kill(process_id, 0) == 0 || errno == EPERM);
+}
+
+/* Finds the newest segment whose process is still running, and removes the
+   ones left behind by processes that died, if asked. Returns its process ID,
+   or 0. */
+static int find_running_game(int remove_stale) {
+	DIR* directory = opendir(SHARED_MEMORY_DIRECTORY);
+	if (directory == NULL)
+		return 0;
+
+	const char* prefix = TELEMETRY_NAME_PREFIX + 1;
+	const size_t prefix_length = strlen(prefix);
+	int newest_process_id = 0;
+	time_t newest_time = 0;
+	struct dirent* entry;
+
+	while ((entry = readdir(directory)) != NULL) {
+		if (strncmp(entry->d_name, prefix, prefix_length) != 0)
+			continue;
+		const int process_id = atoi(entry->d_name + prefix_length);
+		if (!is_process_alive(process_id)) {
+			if (remove_stale) {
+				char name[sizeof(entry->d_name) + 1];
+				snprintf(name, sizeof(name), "/%s", entry->d_name);
+				if (shm_unlink(name) == 0)
+					fprintf(stderr, "Removed %s, left behind by process %d\n", name, process_id);
+			}
+			continue;
+		}
+
+		char path[512];
+		struct stat status;
+		snprintf(path, sizeof(path), "%s/%s", SHARED_MEMORY_DIRECTORY, entry->d_name);
+		if (stat(path, &status) == 0 && (newest_process_id == 0 || status.st_mtime > newest_time)) {
+			newest_process_id = process_id;
+			newest_time = status.st_mtime;
+		}
+	}
+	closedir(directory);
+	return newest_process_id;
+}
+
+static const TelemetryBlock* map_block(int process_id) {
+	char name[64];
+	snprintf(name, sizeof(name), "%s%d", TELEMETRY_NAME_PREFIX, process_id);
+	const int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open %s: %s\n", name, strerror(errno));
+		return NULL;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) != 0 || (size_t) status.st_size < sizeof(TelemetryBlock)) {
+		fprintf(stderr, "%s is too small to be a telemetry block\n", name);
+		close(fd);
+		return NULL;
+	}
+	const TelemetryBlock* block = mmap(NULL, sizeof(TelemetryBlock), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (block == MAP_FAILED) {
+		fprintf(stderr, "Couldn't map %s: %s\n", name, strerror(errno));
+		return NULL;
+	}
+
+	if (__atomic_load_n(&block->magic, __ATOMIC_ACQUIRE) != TELEMETRY_MAGIC
+	 || block->version != TELEMETRY_VERSION || block->size != sizeof(TelemetryBlock)) {
+		fprintf(stderr, "%s has version %u of the layout, of %u bytes; this reader knows version %u, of %zu bytes\n",
+			name, block->version, block->size, TELEMETRY_VERSION, sizeof(TelemetryBlock));
+		munmap((void*) block, sizeof(TelemetryBlock));
+		return NULL;
+	}
+	return block;
+}
+
+/* Copies a section once its writer isn't in the middle of an update, as
+   described in telemetry.h. Returns 0 if the writer never finished. */
+static int read_section(void* copy, const void* section, size_t size, const uint32_t* sequence, SamplingStats* stats) {
+	int tries;
+	for (tries = 0; tries < MAX_SNAPSHOT_TRIES; tries++) {
+		const uint32_t before = __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+		if ((before & 1) == 0) {
+			memcpy(copy, section, size);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(sequence, __ATOMIC_RELAXED) == before)
+				return 1;
+		}
+		stats->retries++;
+	}
+	return 0;
+}
+
+static int take_snapshot(const TelemetryBlock* block, Snapshot* snapshot, SamplingStats* stats) {
+	if (!read_section(&snapshot->render, &block->render, sizeof(snapshot->render), &block->render.sequence, stats)
+	 || !read_section(&snapshot->game, &block->game, sizeof(snapshot->game), &block->game.sequence, stats))
+		return 0;
+	int i;
+	for (i = 0; i < TELEMETRY_MAX_SHARDS; i++) {
+		const TelemetryShardSection* shard = &block->shards[i];
+		if (__atomic_load_n(&shard->sequence, __ATOMIC_RELAXED) != 0
+		 && !read_section(&snapshot->shards[i], shard, sizeof(snapshot->shards[i]), &shard->sequence, stats))
+			return 0;
+	}
+
+	stats->snapshots++;
+	if (snapshot->render.texture_bytes > stats->peak_texture_bytes)
+		stats->peak_texture_bytes = snapshot->render.texture_bytes;
+	if (snapshot->render.render_scale_per_mille < stats->lowest_render_scale_per_mille)
+		stats->lowest_render_scale_per_mille = snapshot->render.render_scale_per_mille;
+	return 1;
+}
+
+/* Estimates a percentile of what was added to the histogram between the two
+   snapshots of it, from the middle of the bucket it falls in. */
+static double estimate_percentile(const TelemetryHistogram* before, const TelemetryHistogram* after, double percentile) {
+	const uint64_t count = after->count - before->count;
+	if (count == 0)
+		return 0.0;
+
+	const uint64_t rank = (uint64_t) (percentile / 100.0 * (double) (count - 1)) + 1;
+	uint64_t seen = 0;
+	int bucket;
+	for (bucket = 0; bucket < TELEMETRY_HISTOGRAM_BUCKETS; bucket++) {
+		seen += after->buckets[bucket] - before->buckets[bucket];
+		if (seen >= rank)
+			break;
+	}
+	if (bucket >= TELEMETRY_HISTOGRAM_BUCKETS - 1)
+		return (double) get_telemetry_bucket_lower_bound(TELEMETRY_HISTOGRAM_BUCKETS - 1);
+
+	const double lower = (double) get_telemetry_bucket_lower_bound(bucket);
+	const double upper = (double) get_telemetry_bucket_lower_bound(bucket + 1);
+	return upper - lower <= 1.0 ? lower : (lower + upper) / 2.0;
+}
+
+static double get_mean(const TelemetryHistogram* before, const TelemetryHistogram* after) {
+	const uint64_t count = after->count - before->count;
+	return count > 0 ? (double) (after->sum - before->sum) / (double) count : 0.0;
+}
+
+static void print_times(const char* name, const TelemetryHistogram* before, const TelemetryHistogram* after) {
+	if (after->count == before->count) {
+		printf("  %s -", name);
+		return;
+	}
+	printf("  %s %.2f/%.2f/%.2f ms", name, get_mean(before, after) / 1000.0,
+		estimate_percentile(before, after, 50.0) / 1000.0, estimate_percentile(before, after, 99.0) / 1000.0);
+}
+
+/* Skipped frames would each have cost about as much as the frames drawn so far. */
+static void print_idle(const Snapshot* before, const Snapshot* after, double seconds) {
+	const uint64_t frames_skipped = after->render.frames_skipped - before->render.frames_skipped;
+	const double idle_seconds = (double) (after->render.idle_time - before->render.idle_time) / 1000000.0;
+	const TelemetryHistogram none = {0, 0, 0, {0}};
+	const double frame_cost_us = get_mean(&none, &after->render.render_time) + get_mean(&none, &after->game.simulation_time);
+	printf("  idle %.0f%%, %.1f skipped/s saving %.2f ms/s", 100.0 * idle_seconds / seconds,
+		(double) frames_skipped / seconds, (double) frames_skipped * frame_cost_us / 1000.0 / seconds);
+}
+
+static void add_histogram(TelemetryHistogram* total, const TelemetryHistogram* histogram) {
+	total->count += histogram->count;
+	total->sum += histogram->sum;
+	if (histogram->max > total->max)
+		total->max = histogram->max;
+	int bucket;
+	for (bucket = 0; bucket < TELEMETRY_HISTOGRAM_BUCKETS; bucket++)
+		total->buckets[bucket] += histogram->buckets[bucket];
+}
+
+/* Ticks take microseconds rather than milliseconds, so their times are shown in those. */
+static void print_shards(const Snapshot* before, const Snapshot* after, double seconds) {
+	TelemetryHistogram before_ticks, after_ticks;
+	memset(&before_ticks, 0, sizeof(before_ticks));
+	memset(&after_ticks, 0, sizeof(after_ticks));
+	uint64_t sessions = 0;
+	int shard_count = 0;
+	int i;
+
+	for (i = 0; i < TELEMETRY_MAX_SHARDS; i++) {
+		if (after->shards[i].ticks == 0)
+			continue;
+		add_histogram(&before_ticks, &before->shards[i].tick_time);
+		add_histogram(&after_ticks, &after->shards[i].tick_time);
+		sessions += after->shards[i].sessions;
+		shard_count++;
+	}
+	printf("%d shards  %llu sessions  %.1f ticks/s", shard_count, (unsigned long long) sessions,
+		(double) (after_ticks.count - before_ticks.count) / seconds);
+	if (after_ticks.count == before_ticks.count)
+		printf("  tick -");
+	else
+		printf("  tick %.0f/%.0f/%.0f us", get_mean(&before_ticks, &after_ticks),
+			estimate_percentile(&before_ticks, &after_ticks, 50.0), estimate_percentile(&before_ticks, &after_ticks, 99.0));
+}
+
+static void print_report(const Snapshot* before, const Snapshot* after, double seconds, const SamplingStats* stats) {
+	// A server never draws, and a game never ticks shards.
+	if (after->render.frames == 0 && after->game.simulation_steps == 0) {
+		print_shards(before, after, seconds);
+		printf("  %.0f snapshots/s, %llu retries\n", (double) stats->snapshots / seconds, stats->retries);
+		fflush(stdout);
+		return;
+	}
+
+	const uint64_t frames = after->render.frames - before->render.frames;
+	printf("%6.1f fps", (double) frames / seconds);
+	printf("  %5.1f steps/s", (double) (after->game.simulation_steps - before->game.simulation_steps) / seconds);
+	printf("  %4.1f draws/frame", frames > 0 ? (double) (after->render.draw_calls - before->render.draw_calls) / frames : 0.0);
+	print_times("frame", &before->render.frame_interval, &after->render.frame_interval);
+	print_times("render", &before->render.render_time, &after->render.render_time);
+	print_times("simulate", &before->game.simulation_time, &after->game.simulation_time);
+	print_times("input", &before->render.input_latency, &after->render.input_latency);
+	print_idle(before, after, seconds);
+	printf("  textures %.2f MB (peak %.2f), buffers %.2f MB, %llu GL objects",
+		(double) after->render.texture_bytes / (1024.0 * 1024.0), (double) stats->peak_texture_bytes / (1024.0 * 1024.0),
+		(double) after->render.buffer_bytes / (1024.0 * 1024.0), (unsigned long long) after->render.gl_objects);
+	printf("  scale %.2f (lowest %.2f)", after->render.render_scale_per_mille / 1000.0,
+		stats->lowest_render_scale_per_mille / 1000.0);
+	printf("  %.0f snapshots/s, %llu retries\n", (double) stats->snapshots / seconds, stats->retries);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	int process_id = 0;
+	int sample_interval_us = 1000;
+	int report_interval_ms = 1000;
+	int report_count = 0;
+	int remove_stale = 0;
+	int option;
+
+	while ((option = getopt(argc, argv, "p:s:r:n:c")) != -1) {
+		switch (option) {
+			case 'p': process_id = atoi(optarg); break;
+			case 's': sample_interval_us = atoi(optarg); break;
+			case 'r': report_interval_ms = atoi(optarg); break;
+			case 'n': report_count = atoi(optarg); break;
+			case 'c': remove_stale = 1; break;
+			default:
+				fprintf(stderr, "Usage: %s [-p game's or server's process ID] [-s us between snapshots] [-r ms between reports] "
+					"[-n reports, or until the game exits] [-c remove segments left by games that died]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (sample_interval_us < 1 || report_interval_ms < 1 || report_count < 0) {
+		fprintf(stderr, "Intervals must be positive.\n");
+		return EXIT_FAILURE;
+	}
+	if (process_id == 0 && (process_id = find_running_game(remove_stale)) == 0) {
+		fprintf(stderr, "No running game or server is sharing its telemetry.\n");
+		return EXIT_FAILURE;
+	}
+
+	const TelemetryBlock* block = map_block(process_id);
+	if (block == NULL)
+		return EXIT_FAILURE;
+	printf("Watching process %d: times are mean/median/99th percentile\n", process_id);
+
+	static Snapshot previous, current;
+	SamplingStats stats = {0, 0, 0, UINT32_MAX};
+	if (!take_snapshot(block, &previous, &stats)) {
+		fprintf(stderr, "The game never finished updating its telemetry.\n");
+		return EXIT_FAILURE;
+	}
+
+	const struct timespec sample_interval = {sample_interval_us / 1000000, (sample_interval_us % 1000000) * 1000L};
+	long long report_start_us = get_time_in_microseconds();
+	int reports = 0;
+
+	while (report_count == 0 || reports < report_count) {
+		nanosleep(&sample_interval, NULL);
+		if (!take_snapshot(block, &current, &stats)) {
+			fprintf(stderr, "The game stopped in the middle of an update.\n");
+			break;
+		}
+
+		const long long now_us = get_time_in_microseconds();
+		if (now_us - report_start_us < report_interval_ms * 1000LL)
+			continue;
+
+		print_report(&previous, &current, (double) (now_us - report_start_us) / 1000000.0, &stats);
+		previous = current;
+		stats = (SamplingStats) {0, 0, current.render.texture_bytes, current.render.render_scale_per_mille};
+		report_start_us = now_us;
+		reports++;
+
+		if (!is_process_alive(process_id)) {
+			printf("Process %d has exited\n", process_id);
+			break;
+		}
+	}
+
+	munmap((void*) block, sizeof(TelemetryBlock));
+	return EXIT_SUCCESS;
+}
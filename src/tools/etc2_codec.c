@@ -0,0 +1,596 @@
+#include "etc2_codec.h"
+#include <assert.h>
+#include <float.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CANDIDATES_PER_SUB_BLOCK 27
+
+static const int etc_modifiers[8][4] = {
+	{2, 8, -2, -8}, {5, 17, -5, -17}, {9, 29, -9, -29}, {13, 42, -13, -42},
+	{18, 60, -18, -60}, {24, 80, -24, -80}, {33, 106, -33, -106}, {47, 183, -47, -183}};
+
+static const int eac_modifiers[16][8] = {
+	{-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12},
+	{-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+	{-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10},
+	{-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+	{-2, -6, -8, -10, 1, 5, 7, 9}, {-2, -5, -8, -10, 1, 4, 7, 9},
+	{-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+	{-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9},
+	{-4, -6, -8, -9, 3, 5, 7, 8}, {-3, -5, -7, -9, 2, 4, 6, 8}};
+
+typedef enum {
+	MODE_INDIVIDUAL,
+	MODE_DIFFERENTIAL,
+} SubBlockMode;
+
+/* The eight pixels of one half of a block, one array per channel. */
+typedef struct {
+	float r[8] __attribute__((aligned(16)));
+	float g[8] __attribute__((aligned(16)));
+	float b[8] __attribute__((aligned(16)));
+	float average[3];
+} SubBlock;
+
+typedef struct {
+	int color[3];
+	int table;
+	float error;
+} SubBlockChoice;
+
+static inline int clamp_to_byte(int value) {
+	return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+static inline int expand_4_bits(int value) { return value << 4 | value; }
+static inline int expand_5_bits(int value) { return value << 3 | value >> 2; }
+static inline int expand_6_bits(int value) { return value << 2 | value >> 4; }
+static inline int expand_7_bits(int value) { return value << 1 | value >> 6; }
+
+static inline int sign_extend_3_bits(int value) {
+	return value >= 4 ? value - 8 : value;
+}
+
+/* Sub-block 0 is the left half of the block, or the top half when flipped. */
+static inline int is_in_second_sub_block(int x, int y, int flip) {
+	return flip ? y >= 2 : x >= 2;
+}
+
+static void write_block(uint64_t bits, uint8_t block[ETC_BLOCK_BYTES]) {
+	int i;
+	for (i = 0; i < ETC_BLOCK_BYTES; i++)
+		block[i] = (uint8_t) (bits >> (56 - 8 * i));
+}
+
+static uint64_t read_block(const uint8_t block[ETC_BLOCK_BYTES]) {
+	uint64_t bits = 0;
+	int i;
+	for (i = 0; i < ETC_BLOCK_BYTES; i++)
+		bits = bits << 8 | block[i];
+	return bits;
+}
+
+static unsigned int get_color_error(const uint8_t pixels[16][4], const uint8_t decoded[16][4]) {
+	unsigned int error = 0;
+	int i, channel;
+	for (i = 0; i < 16; i++) {
+		for (channel = 0; channel < 3; channel++) {
+			const int difference = pixels[i][channel] - decoded[i][channel];
+			error += (unsigned int) (difference * difference);
+		}
+	}
+	return error;
+}
+
+/* Sub-block search */
+
+static void gather_sub_block(const uint8_t pixels[16][4], int flip, int second, SubBlock* sub_block) {
+	int x, y, count = 0;
+	memset(sub_block->average, 0, sizeof(sub_block->average));
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			if (is_in_second_sub_block(x, y, flip) != second)
+				continue;
+			const uint8_t* pixel = pixels[y * 4 + x];
+			sub_block->r[count] = pixel[0];
+			sub_block->g[count] = pixel[1];
+			sub_block->b[count] = pixel[2];
+			sub_block->average[0] += pixel[0] / 8.0f;
+			sub_block->average[1] += pixel[1] / 8.0f;
+			sub_block->average[2] += pixel[2] / 8.0f;
+			count++;
+		}
+	}
+}
+
+#if defined(__SSE2__)
+
+/* The error of a sub-block with every pixel at its nearest of the four
+   colors that the base color and table give, four pixels at a time. */
+static float get_sub_block_error(const SubBlock* sub_block, const int base[3], int table) {
+	__m128 best[2] = {_mm_set1_ps(FLT_MAX), _mm_set1_ps(FLT_MAX)};
+	int modifier, half;
+
+	for (modifier = 0; modifier < 4; modifier++) {
+		const int offset = etc_modifiers[table][modifier];
+		const __m128 r = _mm_set1_ps((float) clamp_to_byte(base[0] + offset));
+		const __m128 g = _mm_set1_ps((float) clamp_to_byte(base[1] + offset));
+		const __m128 b = _mm_set1_ps((float) clamp_to_byte(base[2] + offset));
+
+		for (half = 0; half < 2; half++) {
+			const __m128 dr = _mm_sub_ps(_mm_load_ps(sub_block->r + half * 4), r);
+			const __m128 dg = _mm_sub_ps(_mm_load_ps(sub_block->g + half * 4), g);
+			const __m128 db = _mm_sub_ps(_mm_load_ps(sub_block->b + half * 4), b);
+			const __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			best[half] = _mm_min_ps(best[half], error);
+		}
+	}
+
+	float lanes[4] __attribute__((aligned(16)));
+	_mm_store_ps(lanes, _mm_add_ps(best[0], best[1]));
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+#else
+
+static float get_sub_block_error(const SubBlock* sub_block, const int base[3], int table) {
+	float total = 0.0f;
+	int i, modifier;
+
+	for (i = 0; i < 8; i++) {
+		float best = FLT_MAX;
+		for (modifier = 0; modifier < 4; modifier++) {
+			const int offset = etc_modifiers[table][modifier];
+			const float dr = sub_block->r[i] - (float) clamp_to_byte(base[0] + offset);
+			const float dg = sub_block->g[i] - (float) clamp_to_byte(base[1] + offset);
+			const float db = sub_block->b[i] - (float) clamp_to_byte(base[2] + offset);
+			const float error = dr * dr + dg * dg + db * db;
+			if (error < best)
+				best = error;
+		}
+		total += best;
+	}
+	return total;
+}
+
+#endif
+
+/* Tries the quantized colors around the sub-block's average, with every
+   table, and keeps the best table for each color. */
+static void search_sub_block(const SubBlock* sub_block, int bits, SubBlockChoice choices[CANDIDATES_PER_SUB_BLOCK]) {
+	const int max_value = (1 << bits) - 1;
+	int centers[3], channel, i;
+	for (channel = 0; channel < 3; channel++)
+		centers[channel] = (int) (sub_block->average[channel] * max_value / 255.0f + 0.5f);
+
+	for (i = 0; i < CANDIDATES_PER_SUB_BLOCK; i++) {
+		SubBlockChoice* choice = &choices[i];
+		int base[3];
+		for (channel = 0; channel < 3; channel++) {
+			const int offsets[3] = {i % 3, i / 3 % 3, i / 9};
+			int value = centers[channel] + offsets[channel] - 1;
+			value = value < 0 ? 0 : value > max_value ? max_value : value;
+			choice->color[channel] = value;
+			base[channel] = bits == 4 ? expand_4_bits(value) : expand_5_bits(value);
+		}
+
+		choice->error = FLT_MAX;
+		int table;
+		for (table = 0; table < 8; table++) {
+			const float error = get_sub_block_error(sub_block, base, table);
+			if (error < choice->error) {
+				choice->error = error;
+				choice->table = table;
+			}
+		}
+	}
+}
+
+static int get_best_choice(const SubBlockChoice choices[CANDIDATES_PER_SUB_BLOCK]) {
+	int best = 0, i;
+	for (i = 1; i < CANDIDATES_PER_SUB_BLOCK; i++) {
+		if (choices[i].error < choices[best].error)
+			best = i;
+	}
+	return best;
+}
+
+/* Individual and differential modes */
+
+static uint64_t get_pixel_index_bits(const uint8_t pixels[16][4], int flip, const int bases[2][3], const int tables[2]) {
+	uint64_t bits = 0;
+	int x, y;
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			const int second = is_in_second_sub_block(x, y, flip);
+			const uint8_t* pixel = pixels[y * 4 + x];
+			int best_index = 0, best_error = 0x7FFFFFFF, index;
+
+			for (index = 0; index < 4; index++) {
+				const int offset = etc_modifiers[tables[second]][index];
+				const int dr = pixel[0] - clamp_to_byte(bases[second][0] + offset);
+				const int dg = pixel[1] - clamp_to_byte(bases[second][1] + offset);
+				const int db = pixel[2] - clamp_to_byte(bases[second][2] + offset);
+				const int error = dr * dr + dg * dg + db * db;
+				if (error < best_error) {
+					best_error = error;
+					best_index = index;
+				}
+			}
+
+			const int j = x * 4 + y;
+			bits |= (uint64_t) (best_index >> 1) << (16 + j);
+			bits |= (uint64_t) (best_index & 1) << j;
+		}
+	}
+
+	return bits;
+}
+
+static uint64_t pack_sub_blocks(const uint8_t pixels[16][4], SubBlockMode mode, int flip,
+	const SubBlockChoice* first, const SubBlockChoice* second) {
+	uint64_t bits = 0;
+	int bases[2][3], channel;
+
+	for (channel = 0; channel < 3; channel++) {
+		const int shift = 60 - channel * 8;
+		if (mode == MODE_INDIVIDUAL) {
+			bits |= (uint64_t) first->color[channel] << shift;
+			bits |= (uint64_t) second->color[channel] << (shift - 4);
+			bases[0][channel] = expand_4_bits(first->color[channel]);
+			bases[1][channel] = expand_4_bits(second->color[channel]);
+		} else {
+			const int delta = second->color[channel] - first->color[channel];
+			bits |= (uint64_t) first->color[channel] << (shift - 1);
+			bits |= (uint64_t) (delta & 7) << (shift - 4);
+			bases[0][channel] = expand_5_bits(first->color[channel]);
+			bases[1][channel] = expand_5_bits(second->color[channel]);
+		}
+	}
+
+	const int tables[2] = {first->table, second->table};
+	bits |= (uint64_t) tables[0] << 37;
+	bits |= (uint64_t) tables[1] << 34;
+	bits |= (uint64_t) (mode == MODE_DIFFERENTIAL) << 33;
+	bits |= (uint64_t) flip << 32;
+	return bits | get_pixel_index_bits(pixels, flip, bases, tables);
+}
+
+/* Differential mode needs the second base color within -4..3 of the first
+   in every channel, so the best pair that satisfies that is chosen. */
+static int find_differential_pair(const SubBlockChoice first[CANDIDATES_PER_SUB_BLOCK],
+	const SubBlockChoice second[CANDIDATES_PER_SUB_BLOCK], int* first_index, int* second_index) {
+	float best_error = FLT_MAX;
+	int i, j, channel;
+
+	for (i = 0; i < CANDIDATES_PER_SUB_BLOCK; i++) {
+		for (j = 0; j < CANDIDATES_PER_SUB_BLOCK; j++) {
+			const float error = first[i].error + second[j].error;
+			if (error >= best_error)
+				continue;
+
+			int fits = 1;
+			for (channel = 0; channel < 3 && fits; channel++) {
+				const int delta = second[j].color[channel] - first[i].color[channel];
+				fits = delta >= -4 && delta <= 3;
+			}
+			if (fits) {
+				best_error = error;
+				*first_index = i;
+				*second_index = j;
+			}
+		}
+	}
+
+	return best_error < FLT_MAX;
+}
+
+/* Planar mode */
+
+/* Fits color = O + x * (H - O) / 4 + y * (V - O) / 4 by least squares, then
+   tries the quantized values around the fit, one channel at a time since
+   the channels don't affect each other. */
+static uint64_t encode_planar_block(const uint8_t pixels[16][4]) {
+	double normal[3][3] = {{0}}, inverse[3][3];
+	int x, y, i, j;
+
+	for (y = 0; y < 4; y++) {
+		for (x = 0; x < 4; x++) {
+			const double weights[3] = {1.0 - x / 4.0 - y / 4.0, x / 4.0, y / 4.0};
+			for (i = 0; i < 3; i++) {
+				for (j = 0; j < 3; j++)
+					normal[i][j] += weights[i] * weights[j];
+			}
+		}
+	}
+
+	const double determinant = normal[0][0] * (normal[1][1] * normal[2][2] - normal[1][2] * normal[2][1])
+		- normal[0][1] * (normal[1][0] * normal[2][2] - normal[1][2] * normal[2][0])
+		+ normal[0][2] * (normal[1][0] * normal[2][1] - normal[1][1] * normal[2][0]);
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			const int r0 = (j + 1) % 3, r1 = (j + 2) % 3, c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+			inverse[i][j] = (normal[r0][c0] * normal[r1][c1] - normal[r0][c1] * normal[r1][c0]) / determinant;
+		}
+	}
+
+	int quantized[3][3];
+	int channel;
+	for (channel = 0; channel < 3; channel++) {
+		double projections[3] = {0.0, 0.0, 0.0};
+		for (y = 0; y < 4; y++) {
+			for (x = 0; x < 4; x++) {
+				const double weights[3] = {1.0 - x / 4.0 - y / 4.0, x / 4.0, y / 4.0};
+				for (i = 0; i < 3; i++)
+					projections[i] += weights[i] * pixels[y * 4 + x][channel];
+			}
+		}
+
+		// Green has seven bits; red and blue have six.
+		const int max_value = channel == 1 ? 127 : 63;
+		int centers[3];
+		for (i = 0; i < 3; i++) {
+			const double value = inverse[i][0] * projections[0] + inverse[i][1] * projections[1] + inverse[i][2] * projections[2];
+			centers[i] = (int) (value * max_value / 255.0 + 0.5);
+		}
+
+		int best_error = 0x7FFFFFFF, candidate;
+		for (candidate = 0; candidate < 27; candidate++) {
+			int values[3], expanded[3];
+			for (i = 0; i < 3; i++) {
+				const int offsets[3] = {candidate % 3, candidate / 3 % 3, candidate / 9};
+				values[i] = centers[i] + offsets[i] - 1;
+				values[i] = values[i] < 0 ? 0 : values[i] > max_value ? max_value : values[i];
+				expanded[i] = channel == 1 ? expand_7_bits(values[i]) : expand_6_bits(values[i]);
+			}
+
+			int error = 0;
+			for (y = 0; y < 4; y++) {
+				for (x = 0; x < 4; x++) {
+					const int decoded = clamp_to_byte((x * (expanded[1] - expanded[0])
+						+ y * (expanded[2] - expanded[0]) + 4 * expanded[0] + 2) >> 2);
+					const int difference = decoded - pixels[y * 4 + x][channel];
+					error += difference * difference;
+				}
+			}
+			if (error < best_error) {
+				best_error = error;
+				memcpy(quantized[channel], values, sizeof(values));
+			}
+		}
+	}
+
+	const int red_o = quantized[0][0], green_o = quantized[1][0], blue_o = quantized[2][0];
+	const int red_h = quantized[0][1], green_h = quantized[1][1], blue_h = quantized[2][1];
+	const int red_v = quantized[0][2], green_v = quantized[1][2], blue_v = quantized[2][2];
+
+	uint64_t bits = (uint64_t) red_o << 57
+		| (uint64_t) (green_o >> 6) << 56 | (uint64_t) (green_o & 63) << 49
+		| (uint64_t) (blue_o >> 5) << 48 | (uint64_t) ((blue_o >> 3) & 3) << 43 | (uint64_t) (blue_o & 7) << 39
+		| (uint64_t) (red_h >> 1) << 34 | (uint64_t) 1 << 33 | (uint64_t) (red_h & 1) << 32
+		| (uint64_t) green_h << 25 | (uint64_t) blue_h << 19
+		| (uint64_t) red_v << 13 | (uint64_t) green_v << 6 | (uint64_t) blue_v;
+
+	// The bits that planar mode doesn't use are set so that, read as
+	// differential mode, red and green stay in range and blue overflows,
+	// which is how a decoder recognizes planar mode.
+	const int red_delta = sign_extend_3_bits((red_o & 3) << 1 | green_o >> 6);
+	if ((red_o >> 2) + red_delta <= 15)
+		bits |= (uint64_t) 1 << 63;
+	const int green_delta = sign_extend_3_bits((green_o & 3) << 1 | blue_o >> 5);
+	if (((green_o & 63) >> 2) + green_delta <= 15)
+		bits |= (uint64_t) 1 << 55;
+	const int blue_low_bits = (blue_o >> 3) & 3, blue_delta_low_bits = (blue_o >> 1) & 3;
+	if (blue_low_bits + blue_delta_low_bits < 4)
+		bits |= (uint64_t) 1 << 42;
+	else
+		bits |= (uint64_t) 7 << 45;
+
+	return bits;
+}
+
+unsigned int encode_etc_color_block(const uint8_t pixels[16][4], int allow_planar_mode, uint8_t block[ETC_BLOCK_BYTES]) {
+	uint64_t candidates[5];
+	int candidate_count = 0;
+	int flip;
+
+	for (flip = 0; flip < 2; flip++) {
+		SubBlock sub_blocks[2];
+		SubBlockChoice individual[2][CANDIDATES_PER_SUB_BLOCK], differential[2][CANDIDATES_PER_SUB_BLOCK];
+		int second;
+
+		for (second = 0; second < 2; second++) {
+			gather_sub_block(pixels, flip, second, &sub_blocks[second]);
+			search_sub_block(&sub_blocks[second], 4, individual[second]);
+			search_sub_block(&sub_blocks[second], 5, differential[second]);
+		}
+
+		candidates[candidate_count++] = pack_sub_blocks(pixels, MODE_INDIVIDUAL, flip,
+			&individual[0][get_best_choice(individual[0])], &individual[1][get_best_choice(individual[1])]);
+
+		int first_index = 0, second_index = 0;
+		if (find_differential_pair(differential[0], differential[1], &first_index, &second_index)) {
+			candidates[candidate_count++] = pack_sub_blocks(pixels, MODE_DIFFERENTIAL, flip,
+				&differential[0][first_index], &differential[1][second_index]);
+		}
+	}
+
+	if (allow_planar_mode)
+		candidates[candidate_count++] = encode_planar_block(pixels);
+
+	// The estimates above ignore how pixel indices are finally chosen, so the
+	// candidates are compared by decoding them.
+	unsigned int best_error = 0xFFFFFFFF;
+	int i;
+	for (i = 0; i < candidate_count; i++) {
+		uint8_t candidate_block[ETC_BLOCK_BYTES], decoded[16][4];
+		write_block(candidates[i], candidate_block);
+		decode_etc_color_block(candidate_block, decoded);
+
+		const unsigned int error = get_color_error(pixels, decoded);
+		if (error < best_error) {
+			best_error = error;
+			memcpy(block, candidate_block, ETC_BLOCK_BYTES);
+		}
+	}
+
+	return best_error;
+}
+
+void decode_etc_color_block(const uint8_t block[ETC_BLOCK_BYTES], uint8_t pixels[16][4]) {
+	const uint64_t bits = read_block(block);
+	int bases[2][3], channel, x, y;
+
+	if ((bits >> 33) & 1) {
+		int overflowing_channel = -1;
+		for (channel = 0; channel < 3; channel++) {
+			const int shift = 59 - channel * 8;
+			const int base = (int) (bits >> shift) & 31;
+			const int delta = sign_extend_3_bits((int) (bits >> (shift - 3)) & 7);
+			if (base + delta < 0 || base + delta > 31) {
+				overflowing_channel = channel;
+				break;
+			}
+			bases[0][channel] = expand_5_bits(base);
+			bases[1][channel] = expand_5_bits(base + delta);
+		}
+
+		if (overflowing_channel == 2) {
+			const int red_o = expand_6_bits((int) (bits >> 57) & 63);
+			const int green_o = expand_7_bits((int) ((bits >> 56) & 1) << 6 | (int) ((bits >> 49) & 63));
+			const int blue_o = expand_6_bits((int) ((bits >> 48) & 1) << 5 | (int) ((bits >> 43) & 3) << 3 | (int) ((bits >> 39) & 7));
+			const int red_h = expand_6_bits((int) ((bits >> 34) & 31) << 1 | (int) ((bits >> 32) & 1));
+			const int green_h = expand_7_bits((int) (bits >> 25) & 127);
+			const int blue_h = expand_6_bits((int) (bits >> 19) & 63);
+			const int red_v = expand_6_bits((int) (bits >> 13) & 63);
+			const int green_v = expand_7_bits((int) (bits >> 6) & 127);
+			const int blue_v = expand_6_bits((int) bits & 63);
+
+			for (y = 0; y < 4; y++) {
+				for (x = 0; x < 4; x++) {
+					uint8_t* pixel = pixels[y * 4 + x];
+					pixel[0] = (uint8_t) clamp_to_byte((x * (red_h - red_o) + y * (red_v - red_o) + 4 * red_o + 2) >> 2);
+					pixel[1] = (uint8_t) clamp_to_byte((x * (green_h - green_o) + y * (green_v - green_o) + 4 * green_o + 2) >> 2);
+					pixel[2] = (uint8_t) clamp_to_byte((x * (blue_h - blue_o) + y * (blue_v - blue_o) + 4 * blue_o + 2) >> 2);
+					pixel[3] = 255;
+				}
+			}
+			return;
+		}
+
+		// T and H modes are never produced by the encoder.
+		assert(overflowing_channel == -1);
+	} else {
+		for (channel = 0; channel < 3; channel++) {
+			const int shift = 60 - channel * 8;
+			bases[0][channel] = expand_4_bits((int) (bits >> shift) & 15);
+			bases[1][channel] = expand_4_bits((int) (bits >> (shift - 4)) & 15);
+		}
+	}
+
+	const int tables[2] = {(int) (bits >> 37) & 7, (int) (bits >> 34) & 7};
+	const int flip = (int) (bits >> 32) & 1;
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			const int j = x * 4 + y;
+			const int index = (int) ((bits >> (16 + j)) & 1) << 1 | (int) ((bits >> j) & 1);
+			const int second = is_in_second_sub_block(x, y, flip);
+			const int offset = etc_modifiers[tables[second]][index];
+			uint8_t* pixel = pixels[y * 4 + x];
+
+			for (channel = 0; channel < 3; channel++)
+				pixel[channel] = (uint8_t) clamp_to_byte(bases[second][channel] + offset);
+			pixel[3] = 255;
+		}
+	}
+}
+
+/* EAC alpha */
+
+static unsigned int get_alpha_indices(const uint8_t pixels[16][4], int base, int multiplier, int table, uint64_t* indices) {
+	unsigned int total = 0;
+	int x, y, index;
+	*indices = 0;
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			const int alpha = pixels[y * 4 + x][3];
+			int best_error = 0x7FFFFFFF, best_index = 0;
+			for (index = 0; index < 8; index++) {
+				const int difference = alpha - clamp_to_byte(base + eac_modifiers[table][index] * multiplier);
+				if (difference * difference < best_error) {
+					best_error = difference * difference;
+					best_index = index;
+				}
+			}
+			total += (unsigned int) best_error;
+			*indices |= (uint64_t) best_index << (45 - 3 * (x * 4 + y));
+		}
+	}
+
+	return total;
+}
+
+unsigned int encode_eac_alpha_block(const uint8_t pixels[16][4], uint8_t block[ETC_BLOCK_BYTES]) {
+	int min_alpha = 255, max_alpha = 0, i;
+	for (i = 0; i < 16; i++) {
+		if (pixels[i][3] < min_alpha)
+			min_alpha = pixels[i][3];
+		if (pixels[i][3] > max_alpha)
+			max_alpha = pixels[i][3];
+	}
+
+	unsigned int best_error = 0xFFFFFFFF;
+	uint64_t best_bits = 0;
+	int table;
+
+	for (table = 0; table < 16; table++) {
+		// Stretch the table's range over the block's range, then look around that.
+		const int table_range = eac_modifiers[table][7] - eac_modifiers[table][3];
+		const int ideal_multiplier = (max_alpha - min_alpha + table_range / 2) / table_range;
+		int multiplier;
+
+		for (multiplier = ideal_multiplier - 1; multiplier <= ideal_multiplier + 1; multiplier++) {
+			if (multiplier < 1 || multiplier > 15)
+				continue;
+
+			const int center = (min_alpha - eac_modifiers[table][3] * multiplier + max_alpha - eac_modifiers[table][7] * multiplier) / 2;
+			int base;
+			for (base = center - 2; base <= center + 2; base++) {
+				if (base < 0 || base > 255)
+					continue;
+
+				uint64_t indices;
+				const unsigned int error = get_alpha_indices(pixels, base, multiplier, table, &indices);
+				if (error < best_error) {
+					best_error = error;
+					best_bits = (uint64_t) base << 56 | (uint64_t) multiplier << 52 | (uint64_t) table << 48 | indices;
+				}
+			}
+		}
+	}
+
+	write_block(best_bits, block);
+	return best_error;
+}
+
+void decode_eac_alpha_block(const uint8_t block[ETC_BLOCK_BYTES], uint8_t pixels[16][4]) {
+	const uint64_t bits = read_block(block);
+	const int base = (int) (bits >> 56);
+	const int multiplier = (int) (bits >> 52) & 15;
+	const int table = (int) (bits >> 48) & 15;
+	int x, y;
+
+	for (x = 0; x < 4; x++) {
+		for (y = 0; y < 4; y++) {
+			const int index = (int) (bits >> (45 - 3 * (x * 4 + y))) & 7;
+			pixels[y * 4 + x][3] = (uint8_t) clamp_to_byte(base + eac_modifiers[table][index] * multiplier);
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+/* Block compression for ETC2, in the 4x4 blocks of 8 bytes (RGB) or 16 bytes
+   (RGBA, with an EAC alpha block first) that glCompressedTexImage2D() takes.
+   Pixels are passed as 16 RGBA values in rows, top row first. */
+
+#define ETC_BLOCK_WIDTH 4
+#define ETC_BLOCK_HEIGHT 4
+#define ETC_BLOCK_BYTES 8
+
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define GL_ETC1_RGB8_OES 0x8D64
+
+/* With allow_planar_mode off, the block only uses the modes ETC1 has, so it
+   can also be decoded as GL_ETC1_RGB8_OES. Returns the squared error. */
+unsigned int encode_etc_color_block(const uint8_t pixels[16][4], int allow_planar_mode, uint8_t block[ETC_BLOCK_BYTES]);
+unsigned int encode_eac_alpha_block(const uint8_t pixels[16][4], uint8_t block[ETC_BLOCK_BYTES]);
+
+/* Decodes the modes that the encoder produces: individual, differential and planar. */
+void decode_etc_color_block(const uint8_t block[ETC_BLOCK_BYTES], uint8_t pixels[16][4]);
+void decode_eac_alpha_block(const uint8_t block[ETC_BLOCK_BYTES], uint8_t pixels[16][4]);
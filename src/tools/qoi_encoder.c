@@ -0,0 +1,182 @@
+/* Converts a PNG into a QOI file, which the game decodes with its own code
+   instead of libpng. The result is decoded again and compared with the
+   original pixels, since the format is meant to be lossless. */
+#include "qoi.h"
+#include "timer.h"
+#include <png.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void print_usage(const char* program_name) {
+	fprintf(stderr, "Usage: %s [-c 3|4] input.png output.qoi\n"
+		"  -c  Channels to record in the header (default: 3 if every pixel is opaque, otherwise 4)\n",
+		program_name);
+}
+
+static uint8_t* write_big_endian_32(uint8_t* p, uint32_t value) {
+	p[0] = (uint8_t) (value >> 24);
+	p[1] = (uint8_t) (value >> 16);
+	p[2] = (uint8_t) (value >> 8);
+	p[3] = (uint8_t) value;
+	return p + 4;
+}
+
+/* Follows the reference encoder, so the output is the same byte for byte.
+   Returns the encoded size; the buffer has to fit the worst case, of five
+   bytes per pixel plus the header and padding. */
+static size_t encode_qoi(const uint8_t* pixels, const QoiHeader* header, uint8_t* out) {
+	uint8_t* p = out;
+	memcpy(p, qoi_magic, sizeof(qoi_magic));
+	p = write_big_endian_32(p + sizeof(qoi_magic), header->width);
+	p = write_big_endian_32(p, header->height);
+	*p++ = header->channels;
+	*p++ = header->colorspace;
+
+	uint8_t index[64][4];
+	memset(index, 0, sizeof(index));
+	uint8_t previous[4] = {0, 0, 0, 255};
+	const size_t pixel_count = (size_t) header->width * header->height;
+	int run = 0;
+	size_t i;
+
+	for (i = 0; i < pixel_count; i++) {
+		const uint8_t* px = pixels + i * 4;
+
+		if (memcmp(px, previous, 4) == 0) {
+			run++;
+			if (run == 62 || i == pixel_count - 1) {
+				*p++ = QOI_OP_RUN | (run - 1);
+				run = 0;
+			}
+			continue;
+		}
+
+		if (run > 0) {
+			*p++ = QOI_OP_RUN | (run - 1);
+			run = 0;
+		}
+
+		const int position = get_qoi_index_position(px[0], px[1], px[2], px[3]);
+		if (memcmp(index[position], px, 4) == 0) {
+			*p++ = QOI_OP_INDEX | position;
+		} else {
+			memcpy(index[position], px, 4);
+
+			if (px[3] == previous[3]) {
+				const signed char dr = (signed char) (px[0] - previous[0]);
+				const signed char dg = (signed char) (px[1] - previous[1]);
+				const signed char db = (signed char) (px[2] - previous[2]);
+				const signed char dr_dg = (signed char) (dr - dg);
+				const signed char db_dg = (signed char) (db - dg);
+
+				if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+					*p++ = QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2);
+				} else if (dr_dg > -9 && dr_dg < 8 && dg > -33 && dg < 32 && db_dg > -9 && db_dg < 8) {
+					*p++ = QOI_OP_LUMA | (dg + 32);
+					*p++ = (uint8_t) ((dr_dg + 8) << 4 | (db_dg + 8));
+				} else {
+					*p++ = QOI_OP_RGB;
+					memcpy(p, px, 3);
+					p += 3;
+				}
+			} else {
+				*p++ = QOI_OP_RGBA;
+				memcpy(p, px, 4);
+				p += 4;
+			}
+		}
+		memcpy(previous, px, 4);
+	}
+
+	memcpy(p, qoi_padding, sizeof(qoi_padding));
+	return (size_t) (p + sizeof(qoi_padding) - out);
+}
+
+int main(int argc, char** argv) {
+	int channels = 0;
+	int option;
+
+	while ((option = getopt(argc, argv, "c:")) != -1) {
+		switch (option) {
+			case 'c':
+				channels = atoi(optarg);
+				if (channels != 3 && channels != 4) {
+					print_usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind != 2) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&image, argv[optind])) {
+		fprintf(stderr, "Couldn't read %s: %s\n", argv[optind], image.message);
+		return EXIT_FAILURE;
+	}
+
+	image.format = PNG_FORMAT_RGBA;
+	uint8_t* pixels = malloc(PNG_IMAGE_SIZE(image));
+	if (!png_image_finish_read(&image, NULL, pixels, 0, NULL)) {
+		fprintf(stderr, "Couldn't decode %s: %s\n", argv[optind], image.message);
+		return EXIT_FAILURE;
+	}
+
+	const size_t pixel_count = (size_t) image.width * image.height;
+	size_t i;
+	if (channels == 0) {
+		channels = 3;
+		for (i = 0; i < pixel_count && channels == 3; i++)
+			channels = pixels[i * 4 + 3] != 255 ? 4 : 3;
+	} else if (channels == 3) {
+		for (i = 0; i < pixel_count; i++)
+			pixels[i * 4 + 3] = 255;
+	}
+
+	const QoiHeader header = {image.width, image.height, (uint8_t) channels, 0};
+	uint8_t* encoded = malloc(QOI_HEADER_SIZE + pixel_count * 5 + QOI_PADDING_SIZE);
+	long long start_time = get_time_in_microseconds();
+	const size_t encoded_size = encode_qoi(pixels, &header, encoded);
+	const long long encode_time_us = get_time_in_microseconds() - start_time;
+
+	QoiHeader decoded_header;
+	uint8_t* decoded = malloc(pixel_count * 4);
+	start_time = get_time_in_microseconds();
+	if (!parse_qoi_header(encoded, encoded_size, &decoded_header)
+	 || !decode_qoi_pixels(encoded, encoded_size, &decoded_header, decoded)) {
+		fprintf(stderr, "Couldn't decode the encoded image\n");
+		return EXIT_FAILURE;
+	}
+	const long long decode_time_us = get_time_in_microseconds() - start_time;
+	if (memcmp(pixels, decoded, pixel_count * 4) != 0) {
+		fprintf(stderr, "The decoded image doesn't match %s\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	printf("Encoded %ux%u as %s in %.1f ms, and decoded it again in %.1f ms\n", image.width, image.height,
+		channels == 4 ? "RGBA" : "RGB", encode_time_us / 1000.0, decode_time_us / 1000.0);
+	printf("%zu bytes, against %zu bytes as RGBA8 (%.1fx smaller)\n",
+		encoded_size, pixel_count * 4, (double) (pixel_count * 4) / encoded_size);
+
+	FILE* file = fopen(argv[optind + 1], "wb");
+	if (file == NULL || fwrite(encoded, encoded_size, 1, file) != 1 || fclose(file) != 0) {
+		fprintf(stderr, "Couldn't write %s\n", argv[optind + 1]);
+		return EXIT_FAILURE;
+	}
+
+	free(pixels);
+	free(encoded);
+	free(decoded);
+	return EXIT_SUCCESS;
+}
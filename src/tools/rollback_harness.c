@@ -0,0 +1,232 @@
+/* Runs two peers against each other over a simulated network link that
+   delays each input by a number of frames. Each peer predicts the other's
+   input, then rolls back and re-simulates when the real input arrives. At the
+   end, both peers must agree exactly with a reference simulation that saw
+   every input on time. */
+#include "game_state.h"
+#include "linmath.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAMES 100000
+#define MAX_PACKETS_IN_FLIGHT 64
+
+// The frame budget at 60 frames per second.
+static const long long frame_budget_us = 16667;
+
+typedef struct {
+	unsigned int frame;
+	unsigned int arrival_frame;
+	MalletInput input;
+} Packet;
+
+// Both peers and the reference play on the game's table.
+static TableSdf table_sdf;
+
+typedef struct {
+	Packet packets[MAX_PACKETS_IN_FLIGHT];
+	int count;
+} Link;
+
+typedef struct {
+	int is_blue;
+	unsigned int random_state;
+	GameState state;
+	GameStateHistory history;
+	MalletInput last_remote_input;
+	unsigned int last_remote_input_frame;
+	int rollbacks;
+	int max_rollback_frames;
+	long long max_rollback_us;
+	long long total_rollback_us;
+} Peer;
+
+static MalletInput sent_blue_inputs[MAX_FRAMES];
+static MalletInput sent_red_inputs[MAX_FRAMES];
+
+static unsigned int next_random(unsigned int* state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+/* A player that chases the puck as they see it, with a bit of wobble. */
+static MalletInput get_local_input(Peer* peer) {
+	const float* mallet = peer->is_blue ? peer->state.blue_mallet_position : peer->state.red_mallet_position;
+	const float wobble_x = (float) (next_random(&peer->random_state) % 1000) / 1000.0f - 0.5f;
+	const float wobble_z = (float) (next_random(&peer->random_state) % 1000) / 1000.0f - 0.5f;
+
+	vec3 to_puck = {
+		peer->state.puck_position[0] - mallet[0] + wobble_x * 0.2f,
+		0.0f,
+		peer->state.puck_position[2] - mallet[2] + wobble_z * 0.2f};
+	const float distance = vec3_len(to_puck);
+	if (distance > 0.03f)
+		vec3_scale(to_puck, to_puck, 0.03f / distance);
+
+	return (MalletInput) {1, mallet[0] + to_puck[0], mallet[2] + to_puck[2]};
+}
+
+static void send_input(Link* link, unsigned int frame, unsigned int delay, MalletInput input) {
+	if (link->count == MAX_PACKETS_IN_FLIGHT) {
+		fprintf(stderr, "Too many packets in flight\n");
+		exit(EXIT_FAILURE);
+	}
+	link->packets[link->count++] = (Packet) {frame, frame + delay, input};
+}
+
+static int mallet_inputs_equal(const MalletInput* a, const MalletInput* b) {
+	return a->moved == b->moved && a->x == b->x && a->z == b->z;
+}
+
+/* Applies every input that has arrived by the given frame, then rolls back
+   to the earliest frame that was mispredicted. */
+static void receive_inputs(Peer* peer, Link* link, unsigned int now) {
+	unsigned int earliest_mispredicted_frame = peer->state.frame;
+	int i = 0;
+
+	while (i < link->count) {
+		const Packet packet = link->packets[i];
+		if (packet.arrival_frame > now) {
+			i++;
+			continue;
+		}
+		link->packets[i] = link->packets[--link->count];
+
+		const GameInput* recorded = get_recorded_input(&peer->history, packet.frame);
+		if (recorded == NULL) {
+			fprintf(stderr, "Input for frame %u arrived too late to roll back\n", packet.frame);
+			exit(EXIT_FAILURE);
+		}
+
+		GameInput corrected = *recorded;
+		MalletInput* remote = peer->is_blue ? &corrected.red : &corrected.blue;
+		if (!mallet_inputs_equal(remote, &packet.input)) {
+			*remote = packet.input;
+			set_recorded_input(&peer->history, packet.frame, &corrected);
+			if (packet.frame < earliest_mispredicted_frame)
+				earliest_mispredicted_frame = packet.frame;
+		}
+
+		// Predict that the remote player keeps doing what they did last.
+		if (packet.frame >= peer->last_remote_input_frame) {
+			peer->last_remote_input = packet.input;
+			peer->last_remote_input_frame = packet.frame;
+		}
+	}
+
+	if (earliest_mispredicted_frame < peer->state.frame) {
+		const long long start = get_time_in_microseconds();
+		const int frames = rollback_game_state(&peer->history, &peer->state, earliest_mispredicted_frame);
+		const long long elapsed = get_time_in_microseconds() - start;
+
+		if (frames < 0) {
+			fprintf(stderr, "Could not roll back to frame %u\n", earliest_mispredicted_frame);
+			exit(EXIT_FAILURE);
+		}
+
+		peer->rollbacks++;
+		peer->total_rollback_us += elapsed;
+		if (frames > peer->max_rollback_frames)
+			peer->max_rollback_frames = frames;
+		if (elapsed > peer->max_rollback_us)
+			peer->max_rollback_us = elapsed;
+	}
+}
+
+/* Simulates one frame on a peer, using its own input and its best guess at the remote input. */
+static void advance_peer(Peer* peer, Link* outgoing, unsigned int delay) {
+	const unsigned int frame = peer->state.frame;
+	const MalletInput local = get_local_input(peer);
+	GameInput input;
+
+	if (peer->is_blue) {
+		input = (GameInput) {local, peer->last_remote_input};
+		sent_blue_inputs[frame] = local;
+	} else {
+		input = (GameInput) {peer->last_remote_input, local};
+		sent_red_inputs[frame] = local;
+	}
+
+	send_input(outgoing, frame, delay, local);
+	step_game_state(&peer->history, &peer->state, &input);
+}
+
+static int game_states_equal(const GameState* a, const GameState* b) {
+	return a->frame == b->frame
+		&& memcmp(a->puck_position, b->puck_position, sizeof(vec3)) == 0
+		&& memcmp(a->puck_vector, b->puck_vector, sizeof(vec3)) == 0
+		&& memcmp(a->blue_mallet_position, b->blue_mallet_position, sizeof(vec3)) == 0
+		&& memcmp(a->red_mallet_position, b->red_mallet_position, sizeof(vec3)) == 0;
+}
+
+static void init_peer(Peer* peer, int is_blue, unsigned int seed) {
+	memset(peer, 0, sizeof(*peer));
+	peer->is_blue = is_blue;
+	peer->random_state = seed;
+	init_game_state(&peer->state);
+	init_game_state_history(&peer->history, &peer->state, &table_sdf);
+}
+
+static void print_peer_report(const char* name, const Peer* peer) {
+	printf("%s: %d rollbacks, deepest %d frames, worst %lld us, average %.1f us\n",
+		name, peer->rollbacks, peer->max_rollback_frames, peer->max_rollback_us,
+		peer->rollbacks > 0 ? (double) peer->total_rollback_us / peer->rollbacks : 0.0);
+}
+
+int main(int argc, char** argv) {
+	const unsigned int frames = argc > 1 ? (unsigned int) atoi(argv[1]) : 10000;
+	const unsigned int delay = argc > 2 ? (unsigned int) atoi(argv[2]) : 4;
+	const unsigned int jitter = argc > 3 ? (unsigned int) atoi(argv[3]) : 2;
+
+	if (frames == 0 || frames > MAX_FRAMES || delay + jitter > MAX_ROLLBACK_FRAMES) {
+		fprintf(stderr, "Usage: %s [frames <= %d] [delay] [jitter], with delay + jitter <= %d\n",
+			argv[0], MAX_FRAMES, MAX_ROLLBACK_FRAMES);
+		return EXIT_FAILURE;
+	}
+
+	bake_standard_table_sdf(&table_sdf);
+
+	static Peer blue, red;
+	static Link blue_to_red, red_to_blue;
+	unsigned int link_random_state = 12345;
+	init_peer(&blue, 1, 1);
+	init_peer(&red, 0, 2);
+
+	unsigned int frame;
+	for (frame = 0; frame < frames; frame++) {
+		receive_inputs(&blue, &red_to_blue, frame);
+		receive_inputs(&red, &blue_to_red, frame);
+
+		const unsigned int blue_delay = delay + (jitter > 0 ? next_random(&link_random_state) % (jitter + 1) : 0);
+		const unsigned int red_delay = delay + (jitter > 0 ? next_random(&link_random_state) % (jitter + 1) : 0);
+		advance_peer(&blue, &blue_to_red, blue_delay);
+		advance_peer(&red, &red_to_blue, red_delay);
+	}
+
+	// Let everything still in flight arrive.
+	receive_inputs(&blue, &red_to_blue, frames + delay + jitter);
+	receive_inputs(&red, &blue_to_red, frames + delay + jitter);
+
+	GameState reference;
+	init_game_state(&reference);
+	for (frame = 0; frame < frames; frame++) {
+		const GameInput input = {sent_blue_inputs[frame], sent_red_inputs[frame]};
+		update_game_state(&reference, &input, &table_sdf);
+	}
+
+	printf("%u frames, %u frames of delay, %u frames of jitter\n", frames, delay, jitter);
+	print_peer_report("blue", &blue);
+	print_peer_report("red", &red);
+
+	const long long worst_rollback_us = blue.max_rollback_us > red.max_rollback_us ? blue.max_rollback_us : red.max_rollback_us;
+	const int in_sync = game_states_equal(&blue.state, &reference) && game_states_equal(&red.state, &reference);
+	const int within_budget = worst_rollback_us < frame_budget_us;
+
+	printf("peers match reference: %s\n", in_sync ? "yes" : "NO");
+	printf("worst rollback within %lld us frame budget: %s\n", frame_budget_us, within_budget ? "yes" : "NO");
+
+	free_table_sdf(&table_sdf);
+	return in_sync && within_budget ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,310 @@
+/* Compresses a PNG into an ETC2 (or ETC1) KTX file with a full mipmap chain,
+   so textures can be uploaded with glCompressedTexImage2D() and stay
+   compressed in GPU memory. Block rows of every level are shared out between
+   worker threads. The result is decoded again to report the quality of each
+   level. */
+#include "etc2_codec.h"
+#include "timer.h"
+#include <math.h>
+#include <png.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LEVELS 16
+#define MAX_THREADS 64
+#define GL_RGB 0x1907
+#define GL_RGBA 0x1908
+
+typedef struct {
+	int width;
+	int height;
+	int blocks_wide;
+	int blocks_high;
+	uint8_t* pixels;
+	uint8_t* data;
+	size_t size;
+} Level;
+
+typedef struct {
+	Level levels[MAX_LEVELS];
+	int level_count;
+	int has_alpha;
+	int allow_planar_mode;
+	// Work is handed out one block row at a time, counting across all levels.
+	int total_block_rows;
+	int next_block_row;
+	pthread_mutex_t mutex;
+} EncodeJob;
+
+static void print_usage(const char* program_name) {
+	fprintf(stderr, "Usage: %s [-t threads] [-f etc2|etc1] [-n] input.png output.ktx\n"
+		"  -t  Number of threads (default: number of online processors)\n"
+		"  -f  etc2 may use planar blocks and EAC alpha; etc1 is RGB only (default: etc2)\n"
+		"  -n  Only the base level, without mipmaps\n", program_name);
+}
+
+static size_t get_block_bytes(const EncodeJob* job) {
+	return job->has_alpha ? ETC_BLOCK_BYTES * 2 : ETC_BLOCK_BYTES;
+}
+
+/* Each level is a box filter of the one above, halving each side down to 1x1. */
+static void build_mipmaps(EncodeJob* job, int generate_mipmaps) {
+	while (generate_mipmaps && job->level_count < MAX_LEVELS) {
+		const Level* source = &job->levels[job->level_count - 1];
+		if (source->width == 1 && source->height == 1)
+			break;
+
+		Level* level = &job->levels[job->level_count++];
+		level->width = source->width > 1 ? source->width / 2 : 1;
+		level->height = source->height > 1 ? source->height / 2 : 1;
+		level->pixels = malloc((size_t) level->width * level->height * 4);
+
+		int x, y, channel;
+		for (y = 0; y < level->height; y++) {
+			const int y0 = source->height > 1 ? y * 2 : 0, y1 = source->height > 1 ? y * 2 + 1 : 0;
+			for (x = 0; x < level->width; x++) {
+				const int x0 = source->width > 1 ? x * 2 : 0, x1 = source->width > 1 ? x * 2 + 1 : 0;
+				for (channel = 0; channel < 4; channel++) {
+					const int sum = source->pixels[(y0 * source->width + x0) * 4 + channel]
+						+ source->pixels[(y0 * source->width + x1) * 4 + channel]
+						+ source->pixels[(y1 * source->width + x0) * 4 + channel]
+						+ source->pixels[(y1 * source->width + x1) * 4 + channel];
+					level->pixels[(y * level->width + x) * 4 + channel] = (uint8_t) ((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	int i;
+	for (i = 0; i < job->level_count; i++) {
+		Level* level = &job->levels[i];
+		level->blocks_wide = (level->width + ETC_BLOCK_WIDTH - 1) / ETC_BLOCK_WIDTH;
+		level->blocks_high = (level->height + ETC_BLOCK_HEIGHT - 1) / ETC_BLOCK_HEIGHT;
+		level->size = (size_t) level->blocks_wide * level->blocks_high * get_block_bytes(job);
+		level->data = malloc(level->size);
+		job->total_block_rows += level->blocks_high;
+	}
+}
+
+/* Blocks that hang over the edge of small levels repeat the last row and column. */
+static void get_block_pixels(const Level* level, int block_x, int block_y, uint8_t pixels[16][4]) {
+	int x, y;
+	for (y = 0; y < ETC_BLOCK_HEIGHT; y++) {
+		int source_y = block_y * ETC_BLOCK_HEIGHT + y;
+		source_y = source_y < level->height ? source_y : level->height - 1;
+		for (x = 0; x < ETC_BLOCK_WIDTH; x++) {
+			int source_x = block_x * ETC_BLOCK_WIDTH + x;
+			source_x = source_x < level->width ? source_x : level->width - 1;
+			memcpy(pixels[y * 4 + x], level->pixels + (source_y * level->width + source_x) * 4, 4);
+		}
+	}
+}
+
+static void encode_block_row(EncodeJob* job, const Level* level, int block_y) {
+	const size_t block_bytes = get_block_bytes(job);
+	int block_x;
+
+	for (block_x = 0; block_x < level->blocks_wide; block_x++) {
+		uint8_t pixels[16][4];
+		uint8_t* block = level->data + ((size_t) block_y * level->blocks_wide + block_x) * block_bytes;
+		get_block_pixels(level, block_x, block_y, pixels);
+
+		// For RGBA, the alpha block comes first.
+		if (job->has_alpha) {
+			encode_eac_alpha_block(pixels, block);
+			block += ETC_BLOCK_BYTES;
+		}
+		encode_etc_color_block(pixels, job->allow_planar_mode, block);
+	}
+}
+
+static void* encode_worker(void* argument) {
+	EncodeJob* job = argument;
+
+	for (;;) {
+		pthread_mutex_lock(&job->mutex);
+		const int row = job->next_block_row++;
+		pthread_mutex_unlock(&job->mutex);
+		if (row >= job->total_block_rows)
+			break;
+
+		int level_index = 0, block_y = row;
+		while (block_y >= job->levels[level_index].blocks_high)
+			block_y -= job->levels[level_index++].blocks_high;
+		encode_block_row(job, &job->levels[level_index], block_y);
+	}
+
+	return NULL;
+}
+
+static double get_level_psnr(const EncodeJob* job, const Level* level) {
+	const size_t block_bytes = get_block_bytes(job);
+	const int channels = job->has_alpha ? 4 : 3;
+	double squared_error = 0.0;
+	int block_x, block_y, x, y, channel;
+
+	for (block_y = 0; block_y < level->blocks_high; block_y++) {
+		for (block_x = 0; block_x < level->blocks_wide; block_x++) {
+			const uint8_t* block = level->data + ((size_t) block_y * level->blocks_wide + block_x) * block_bytes;
+			uint8_t decoded[16][4];
+			if (job->has_alpha) {
+				decode_eac_alpha_block(block, decoded);
+				block += ETC_BLOCK_BYTES;
+			}
+			decode_etc_color_block(block, decoded);
+
+			for (y = 0; y < ETC_BLOCK_HEIGHT && block_y * ETC_BLOCK_HEIGHT + y < level->height; y++) {
+				for (x = 0; x < ETC_BLOCK_WIDTH && block_x * ETC_BLOCK_WIDTH + x < level->width; x++) {
+					const uint8_t* original = level->pixels
+						+ ((block_y * ETC_BLOCK_HEIGHT + y) * level->width + block_x * ETC_BLOCK_WIDTH + x) * 4;
+					for (channel = 0; channel < channels; channel++) {
+						const double difference = original[channel] - decoded[y * 4 + x][channel];
+						squared_error += difference * difference;
+					}
+				}
+			}
+		}
+	}
+
+	const double mean_squared_error = squared_error / ((double) level->width * level->height * channels);
+	return mean_squared_error > 0.0 ? 10.0 * log10(255.0 * 255.0 / mean_squared_error) : INFINITY;
+}
+
+static void write_uint32(FILE* file, uint32_t value) {
+	fwrite(&value, sizeof(value), 1, file);
+}
+
+/* KTX 1.1, in native byte order as the endianness field records. */
+static int write_ktx(const char* path, const EncodeJob* job, uint32_t internal_format) {
+	static const uint8_t identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'};
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return 0;
+
+	fwrite(identifier, sizeof(identifier), 1, file);
+	write_uint32(file, 0x04030201);
+	write_uint32(file, 0); // glType
+	write_uint32(file, 1); // glTypeSize
+	write_uint32(file, 0); // glFormat
+	write_uint32(file, internal_format);
+	write_uint32(file, job->has_alpha ? GL_RGBA : GL_RGB);
+	write_uint32(file, (uint32_t) job->levels[0].width);
+	write_uint32(file, (uint32_t) job->levels[0].height);
+	write_uint32(file, 0); // pixelDepth
+	write_uint32(file, 0); // numberOfArrayElements
+	write_uint32(file, 1); // numberOfFaces
+	write_uint32(file, (uint32_t) job->level_count);
+	write_uint32(file, 0); // bytesOfKeyValueData
+
+	// Block sizes are multiples of four, so no mip padding is needed.
+	int i;
+	for (i = 0; i < job->level_count; i++) {
+		write_uint32(file, (uint32_t) job->levels[i].size);
+		fwrite(job->levels[i].data, job->levels[i].size, 1, file);
+	}
+
+	return fclose(file) == 0;
+}
+
+int main(int argc, char** argv) {
+	int thread_count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	int generate_mipmaps = 1;
+	int option;
+	EncodeJob job = {.allow_planar_mode = 1};
+
+	while ((option = getopt(argc, argv, "t:f:n")) != -1) {
+		switch (option) {
+			case 't':
+				thread_count = atoi(optarg);
+				break;
+			case 'f':
+				if (strcmp(optarg, "etc1") == 0) {
+					job.allow_planar_mode = 0;
+				} else if (strcmp(optarg, "etc2") != 0) {
+					print_usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'n':
+				generate_mipmaps = 0;
+				break;
+			default:
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (argc - optind != 2) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	thread_count = thread_count < 1 ? 1 : thread_count > MAX_THREADS ? MAX_THREADS : thread_count;
+
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_file(&image, argv[optind])) {
+		fprintf(stderr, "Couldn't read %s: %s\n", argv[optind], image.message);
+		return EXIT_FAILURE;
+	}
+
+	image.format = PNG_FORMAT_RGBA;
+	Level* base_level = &job.levels[job.level_count++];
+	base_level->width = (int) image.width;
+	base_level->height = (int) image.height;
+	base_level->pixels = malloc(PNG_IMAGE_SIZE(image));
+	if (!png_image_finish_read(&image, NULL, base_level->pixels, 0, NULL)) {
+		fprintf(stderr, "Couldn't decode %s: %s\n", argv[optind], image.message);
+		return EXIT_FAILURE;
+	}
+
+	int i;
+	for (i = 0; i < base_level->width * base_level->height && !job.has_alpha; i++)
+		job.has_alpha = base_level->pixels[i * 4 + 3] != 255;
+	if (job.has_alpha && !job.allow_planar_mode) {
+		fprintf(stderr, "%s has transparent pixels, which ETC1 can't store\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	const uint32_t internal_format = !job.allow_planar_mode ? GL_ETC1_RGB8_OES
+		: job.has_alpha ? GL_COMPRESSED_RGBA8_ETC2_EAC : GL_COMPRESSED_RGB8_ETC2;
+	build_mipmaps(&job, generate_mipmaps);
+
+	const long long start_time = get_time_in_microseconds();
+	pthread_t threads[MAX_THREADS];
+	pthread_mutex_init(&job.mutex, NULL);
+	for (i = 0; i < thread_count; i++)
+		pthread_create(&threads[i], NULL, encode_worker, &job);
+	for (i = 0; i < thread_count; i++)
+		pthread_join(threads[i], NULL);
+	pthread_mutex_destroy(&job.mutex);
+	const long long encode_time_us = get_time_in_microseconds() - start_time;
+
+	size_t compressed_size = 0, uncompressed_size = 0;
+	for (i = 0; i < job.level_count; i++) {
+		const Level* level = &job.levels[i];
+		printf("Level %2d: %4dx%-4d %8zu bytes, PSNR %.2f dB\n",
+			i, level->width, level->height, level->size, get_level_psnr(&job, level));
+		compressed_size += level->size;
+		uncompressed_size += (size_t) level->width * level->height * 4;
+	}
+	printf("Encoded %d levels as %s with %d threads in %.1f ms\n", job.level_count,
+		internal_format == GL_ETC1_RGB8_OES ? "ETC1" : job.has_alpha ? "ETC2 RGBA" : "ETC2 RGB",
+		thread_count, encode_time_us / 1000.0);
+	printf("%zu bytes, against %zu bytes as RGBA8 (%.1fx smaller)\n",
+		compressed_size, uncompressed_size, (double) uncompressed_size / compressed_size);
+
+	if (!write_ktx(argv[optind + 1], &job, internal_format)) {
+		fprintf(stderr, "Couldn't write %s\n", argv[optind + 1]);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < job.level_count; i++) {
+		free(job.levels[i].pixels);
+		free(job.levels[i].data);
+	}
+	return EXIT_SUCCESS;
+}